@@ -0,0 +1,71 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Time the kinematics of markers and muscles and the name lookups they no longer perform
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Load a model
+///     2. Time the markers, their jacobian and the muscle geometry for a number of frames
+///     3. Time the segment lookups by name these functions would need at each frame if the
+///        rbdl body identifications were not resolved when the model is loaded
+///     4. Print them to the console
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+void benchmark(const utils::String& path, unsigned int nbFrames)
+{
+    Model model(path);
+    rigidbody::GeneralizedCoordinates Q(model);
+    Q.setZero();
+
+    // Names of the segments that are looked up at each frame
+    std::vector<utils::String> parents;
+    for (size_t i=0; i<model.nbMarkers(); ++i) {
+        parents.push_back(model.marker(i).parent());
+    }
+#ifdef MODULE_MUSCLES
+    for (size_t i=0; i<model.nbMuscles(); ++i) {
+        parents.push_back(model.muscle(i).position().originInLocal().parent());
+        parents.push_back(model.muscle(i).position().insertionInLocal().parent());
+    }
+#endif
+
+    utils::Timer timer(true);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        model.markers(Q);
+        model.markersJacobian(Q);
+#ifdef MODULE_MUSCLES
+        model.updateMuscles(Q, true);
+#endif
+    }
+    double timeKinematics(timer.stop());
+
+    timer.start();
+    unsigned int sum(0);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        // Each node was looked up once for its position and once for its jacobian
+        for (size_t i=0; i<parents.size(); ++i) {
+            sum += model.GetBodyId(parents[i].c_str());
+            sum += model.GetBodyId(parents[i].c_str());
+        }
+    }
+    double timeLookups(timer.stop());
+
+    std::cout << path << " (" << parents.size() << " nodes, "
+              << nbFrames << " frames)" << std::endl;
+    std::cout << "    Kinematics:         " << timeKinematics << " s" << std::endl;
+    std::cout << "    Saved name lookups: " << timeLookups << " s"
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+int main()
+{
+    benchmark("pyomecaman.bioMod", 10000);
+    benchmark("arm26.bioMod", 10000);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Time batches of muscle driven forward simulations
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Load a model and pack its state as [Q, Qdot, activations, fatigue states]
+///     2. Build one table of excitations per rollout
+///     3. Integrate the rollouts with each integrator, on one thread and on all the threads
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+void benchmark(
+    const Model& model,
+    INTEGRATOR integrator,
+    size_t nbThreads,
+    size_t nbRollouts,
+    size_t nbIntervals,
+    double dt)
+{
+    Simulator simulator(model, integrator, nbThreads);
+    simulator.setNbSteps(4);
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    Q.setZero();
+    Qdot.setZero();
+    utils::Vector x0(simulator.state(Q, Qdot));
+
+    // Each rollout has its own level of excitation, with no residual torques
+    utils::Matrix x0s(simulator.nbStates(), nbRollouts);
+    std::vector<utils::Matrix> controls;
+    std::vector<utils::Matrix> states(nbRollouts, utils::Matrix(simulator.nbStates(), nbIntervals + 1));
+    for (size_t r=0; r<nbRollouts; ++r) {
+        x0s.col(r) = x0;
+        utils::Matrix u(utils::Matrix::Zero(simulator.nbControls(), nbIntervals));
+        u.bottomRows(simulator.nbActivations()).setConstant(
+            static_cast<double>(r + 1) / static_cast<double>(nbRollouts + 1));
+        controls.push_back(u);
+    }
+
+    utils::Timer timer(true);
+    simulator.simulateBatch(x0s, controls, dt, states);
+    double time(timer.stop());
+
+    std::cout << "    " << INTEGRATOR_toStr(integrator) << " on " << simulator.nbThreads()
+              << " thread(s): " << time << " s (final Q of the last rollout "
+              << states.back().col(nbIntervals).head(model.nbQ()).transpose() << ")" << std::endl;
+}
+
+int main()
+{
+    Model model("arm26.bioMod");
+    size_t nbRollouts(64);
+    size_t nbIntervals(100);
+    double dt(0.01);
+
+    std::cout << nbRollouts << " rollouts of " << nbIntervals << " intervals" << std::endl;
+    for (INTEGRATOR integrator : {INTEGRATOR_SEMI_IMPLICIT_EULER, INTEGRATOR_RK4, INTEGRATOR_RK45}) {
+        benchmark(model, integrator, 1, nbRollouts, nbIntervals, dt);
+        benchmark(model, integrator, 0, nbRollouts, nbIntervals, dt);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "biorbd.h"
+#include "pyomecamanKernels.h"
+#include <iostream>
+
+///
+/// \brief main Compare the kinematics kernels generated for a model to the generic biorbd functions
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Use the kernels generated from pyomecaman.bioMod by biorbd_codegen
+///     2. Time the markers, their jacobian and the mass matrix computed by biorbd and by the kernels
+///     3. Print the timings and the largest difference between both
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+int main()
+{
+    Model model("pyomecaman.bioMod");
+    unsigned int nbFrames(100000);
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i);
+    }
+    pyomecamanKernels::VectorQ q(Q);
+    pyomecamanKernels::State state;
+    pyomecamanKernels::MatrixMarkers markers;
+    pyomecamanKernels::MatrixMarkersJacobian jacobian;
+    pyomecamanKernels::MatrixMass mass;
+
+    std::cout << "pyomecaman.bioMod (" << model.nbQ() << " dof, " << model.nbMarkers()
+              << " markers, " << nbFrames << " frames)" << std::endl;
+
+    // Markers
+    utils::Timer timer(true);
+    double sum(0);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        Q[0] += 1e-9;
+        sum += model.markers(Q)[0](0);
+    }
+    double timeBiorbd(timer.stop());
+    timer.start();
+    double sumKernels(0);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        q[0] += 1e-9;
+        pyomecamanKernels::forwardKinematics(q, state);
+        pyomecamanKernels::markers(state, markers);
+        sumKernels += markers(0, 0);
+    }
+    std::cout << "    markers: " << timeBiorbd << " s (biorbd), " << timer.stop()
+              << " s (kernels), difference " << std::abs(sum - sumKernels) << std::endl;
+
+    // Markers jacobian
+    timer.start();
+    sum = 0;
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        Q[0] += 1e-9;
+        sum += model.markersJacobian(Q)[0](0, 0);
+    }
+    timeBiorbd = timer.stop();
+    timer.start();
+    sumKernels = 0;
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        q[0] += 1e-9;
+        pyomecamanKernels::forwardKinematics(q, state);
+        pyomecamanKernels::markersJacobian(state, jacobian);
+        sumKernels += jacobian(0, 0);
+    }
+    std::cout << "    markersJacobian: " << timeBiorbd << " s (biorbd), " << timer.stop()
+              << " s (kernels), difference " << std::abs(sum - sumKernels) << std::endl;
+
+    // Mass matrix
+    timer.start();
+    sum = 0;
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        Q[0] += 1e-9;
+        sum += model.massMatrix(Q)(model.nbQ()-1, model.nbQ()-1);
+    }
+    timeBiorbd = timer.stop();
+    timer.start();
+    sumKernels = 0;
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        q[0] += 1e-9;
+        pyomecamanKernels::forwardKinematics(q, state);
+        pyomecamanKernels::massMatrix(state, mass);
+        sumKernels += mass(model.nbQ()-1, model.nbQ()-1);
+    }
+    std::cout << "    massMatrix: " << timeBiorbd << " s (biorbd), " << timer.stop()
+              << " s (kernels), difference " << std::abs(sum - sumKernels) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Compare the per-frame and the batched forward kinematics of the markers
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Load a model
+///     2. Build a whole trial of generalized coordinates (nbQ x nbFrames)
+///     3. Compute the markers one frame at a time (as done by rigid_body.markers_to_array in python)
+///     4. Compute the markers of all the frames at once into a preallocated matrix
+///     5. Print the time spent by both approaches to the console
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+int main()
+{
+    // Load a predefined model
+    Model model("pyomecaman.bioMod");
+    unsigned int nbFrames(10000);
+    unsigned int nbQ(static_cast<unsigned int>(model.nbQ()));
+    unsigned int nbMarkers(static_cast<unsigned int>(model.nbMarkers()));
+
+    // Create a trial
+    utils::Matrix Q(utils::Matrix::Random(nbQ, nbFrames));
+    utils::Matrix markersPerFrame(3*nbMarkers, nbFrames);
+    utils::Matrix markersBatched(3*nbMarkers, nbFrames);
+
+    // Per-frame loop
+    utils::Timer timer(true);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        rigidbody::GeneralizedCoordinates Qframe(Q.col(f));
+        std::vector<rigidbody::NodeSegment> markers(model.markers(Qframe));
+        for (unsigned int i=0; i<nbMarkers; ++i) {
+            markersPerFrame.block(3*i, f, 3, 1) = markers[i];
+        }
+    }
+    double timePerFrame(timer.stop());
+
+    // Batched
+    timer.start();
+    model.markers(Q, markersBatched);
+    double timeBatched(timer.stop());
+
+    std::cout << "Frames: " << nbFrames << ", markers: " << nbMarkers << std::endl;
+    std::cout << "Per-frame loop: " << timePerFrame << " s" << std::endl;
+    std::cout << "Batched:        " << timeBatched << " s" << std::endl;
+    std::cout << "Max difference: "
+              << (markersPerFrame - markersBatched).cwiseAbs().maxCoeff() << std::endl;
+
+    return 0;
+}
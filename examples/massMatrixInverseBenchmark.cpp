@@ -0,0 +1,83 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Time the inverse of the mass matrix of models of increasing sizes
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Create tree-shaped models of 15, 40 and 100 degrees of freedom
+///     2. Time the recursive massMatrixInverse, which works in a preallocated matrix
+///     3. Compare it to the inversion and to the Cholesky solve of the mass matrix
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+///
+/// \brief Create a model where each segment of one degree of freedom is attached to the
+/// segment half its index, so the model is a balanced tree
+/// \param nbDof The number of degrees of freedom of the model
+/// \return The model
+///
+Model treeModel(unsigned int nbDof)
+{
+    Model model;
+    rigidbody::SegmentCharacteristics characteristics(
+        1, utils::Vector3d(0, 0, -0.1), utils::Matrix3d(0.01, 0, 0, 0, 0.02, 0, 0, 0, 0.03));
+    utils::RotoTrans offset(utils::Rotation(), utils::Vector3d(0.05, 0, -0.2));
+    const char* axes[] = {"x", "y", "z"};
+    for (unsigned int i=0; i<nbDof; ++i) {
+        utils::String parent(i == 0 ? "root" : "Seg" + std::to_string((i - 1) / 2));
+        model.AddSegment("Seg" + std::to_string(i), parent, "", axes[i % 3], {}, {}, {},
+                         characteristics, i == 0 ? utils::RotoTrans() : offset);
+    }
+    return model;
+}
+
+void benchmark(unsigned int nbDof, unsigned int nbFrames)
+{
+    Model model(treeModel(nbDof));
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i);
+    }
+    utils::Matrix Minv(model.nbQddot(), model.nbQddot());
+    utils::Matrix identity(utils::Matrix::Identity(model.nbQddot(), model.nbQddot()));
+    model.UpdateKinematicsCustom(&Q);
+
+    double sum(0);
+    utils::Timer timer(true);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        model.massMatrixInverse(Q, Minv, false);
+        sum += Minv(0, 0);
+    }
+    double timeRecursive(timer.stop());
+
+    timer.start();
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        sum += model.massMatrix(Q, false).inverse()(0, 0);
+    }
+    double timeInverse(timer.stop());
+
+    timer.start();
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        sum += model.massMatrix(Q, false).llt().solve(identity)(0, 0);
+    }
+    double timeLlt(timer.stop());
+
+    std::cout << nbDof << " dof (" << nbFrames << " frames)" << std::endl;
+    std::cout << "    massMatrixInverse:                " << timeRecursive << " s" << std::endl;
+    std::cout << "    massMatrix(Q).inverse():          " << timeInverse << " s" << std::endl;
+    std::cout << "    massMatrix(Q).llt().solve(Id):    " << timeLlt << " s" << std::endl;
+    std::cout << "    (checksum " << sum << ")" << std::endl;
+}
+
+int main()
+{
+    benchmark(15, 10000);
+    benchmark(40, 2000);
+    benchmark(100, 200);
+    return 0;
+}
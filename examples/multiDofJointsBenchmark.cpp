@@ -0,0 +1,65 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Time the forward dynamics of models whose segments have many degrees of freedom
+/// \return Nothing
+///
+/// This examples shows how to
+///     1. Load a model, or create one with a 6 degrees of freedom (xyz/xyz) root
+///     2. Time the forward dynamics for a number of frames
+///     3. Print the number of rbdl bodies, the number of degrees of freedom and the timing
+///
+/// Translations in xyz and the rotation sequences xyz and zyx are each mapped onto a single
+/// rbdl joint, other sequences still need one rbdl body per degree of freedom. Running this
+/// example before and after that change gives the cost of these extra bodies.
+///
+/// Please note that this example will work only with the Eigen backend
+///
+
+using namespace BIORBD_NAMESPACE;
+
+void benchmark(Model& model, const utils::String& name, unsigned int nbFrames)
+{
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i);
+    }
+    QDot.setOnes();
+    Tau.setOnes();
+
+    utils::Timer timer(true);
+    double sum(0);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        sum += model.ForwardDynamics(Q, QDot, Tau)[0];
+    }
+    double time(timer.stop());
+
+    std::cout << name << " (" << model.mBodies.size() - 1 << " rbdl bodies, "
+              << model.dof_count << " dof, " << nbFrames << " frames)" << std::endl;
+    std::cout << "    ForwardDynamics: " << time << " s"
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+int main()
+{
+    Model pyomecaman("pyomecaman.bioMod");
+    benchmark(pyomecaman, "pyomecaman.bioMod", 100000);
+
+    // A root with 6 degrees of freedom which carries a chain of 3 hinges
+    Model freeFloating;
+    rigidbody::SegmentCharacteristics characteristics(
+        5, utils::Vector3d(0, 0, -0.2), utils::Matrix3d::Identity() * 0.1);
+    freeFloating.AddSegment("Root", "root", "xyz", "xyz", {}, {}, {},
+                            characteristics, utils::RotoTrans());
+    freeFloating.AddSegment("Seg1", "Root", "", "x", {}, {}, {},
+                            characteristics, utils::RotoTrans());
+    freeFloating.AddSegment("Seg2", "Seg1", "", "x", {}, {}, {},
+                            characteristics, utils::RotoTrans());
+    freeFloating.AddSegment("Seg3", "Seg2", "", "x", {}, {}, {},
+                            characteristics, utils::RotoTrans());
+    benchmark(freeFloating, "xyz/xyz root with 3 hinges", 100000);
+    return 0;
+}
@@ -118,6 +118,16 @@ public:
         bool useSoftContacts = true
     );
 
+    ///
+    /// \brief Get a workspace on the current model that can be evaluated concurrently with the model
+    /// \return A model sharing the description (segments, markers, muscle and ligament geometry parameters) and owning its own copy of everything written during an evaluation (RBDL kinematic caches, constraint buffers, soft contact engine buffers, muscle states and path, ligament lengths)
+    ///
+    /// A model must not be evaluated by several threads at once. Each thread should instead
+    /// own one workspace, created before the threads are spawned. Modifying the description
+    /// (e.g. adding a segment or a marker) while workspaces are being evaluated is undefined.
+    ///
+    Model workspace() const;
+
 private:
     std::shared_ptr<utils::Path> m_path;
 public:
@@ -126,6 +136,13 @@ public:
     /// \return The path of .bioMod file used to load the model
     ///
     utils::Path path() const;
+
+protected:
+    ///
+    /// \brief Return the complete model the joints are part of
+    /// \return This model
+    ///
+    virtual Model* completeModel();
 };
 
 }
@@ -0,0 +1,289 @@
+#ifndef BIORBD_HYBRID_SIMULATOR_H
+#define BIORBD_HYBRID_SIMULATOR_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "biorbdConfig.h"
+#include "Simulator.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+namespace BIORBD_NAMESPACE
+{
+namespace rigidbody
+{
+class Contacts;
+}
+
+///
+/// \brief Integrate the forward dynamics of a model whose rigid contacts make and break
+///
+/// Each rigid contact of the model is unilateral against the ground plane (normal along z): an
+/// inactive contact is made when it sinks of contactTolerance below the ground and an active
+/// contact is broken when the force it transmits along z crosses zero. The time of each event
+/// is localized by bisection on the step of the integrator. When contacts are made, the
+/// velocities jump to those given by ComputeConstraintImpulsesDirect, then the contacts which
+/// would pull on the ground are released one at a time. The contacts at or below the ground at
+/// the beginning of a rollout are active and the initial velocities are made consistent with them.
+///
+/// The active contacts are enforced with ForwardDynamicsConstraintsDirect. Each set of active
+/// contacts owns a constraint set, built and bound the first time it is reached and reused at
+/// each switch afterward.
+///
+/// Only the fixed step integrators are available. Loop constraints are not enforced.
+///
+class BIORBD_API HybridSimulator : public Simulator
+{
+public:
+    ///
+    /// \brief A change of the active contacts
+    ///
+    struct Event {
+        double time; ///< The time of the event
+        size_t contact; ///< The index of the rigid contact
+        CONTACT_EVENT type; ///< If the contact was made or broken
+    };
+
+    ///
+    /// \brief Construct a hybrid simulator
+    /// \param model The model to simulate. It must outlive the simulator and must not be modified while in use
+    /// \param integrator The time integrator (fixed step only)
+    /// \param nbThreads The number of threads used for the batches. If 0, the number of hardware threads is used
+    ///
+    HybridSimulator(
+        const Model& model,
+        INTEGRATOR integrator = INTEGRATOR_RK4,
+        size_t nbThreads = 0);
+
+    ///
+    /// \brief Set the height of the ground plane
+    /// \param height The height of the ground plane (default 0)
+    ///
+    void setGroundHeight(
+        double height);
+
+    ///
+    /// \brief Return the height of the ground plane
+    /// \return The height of the ground plane
+    ///
+    double groundHeight() const;
+
+    ///
+    /// \brief Set the penetration at which a contact is made
+    /// \param tolerance The penetration (default 1e-6). The contacts closer than that to the ground at the beginning are active
+    ///
+    void setContactTolerance(
+        double tolerance);
+
+    ///
+    /// \brief Return the penetration at which a contact is made
+    /// \return The penetration at which a contact is made
+    ///
+    double contactTolerance() const;
+
+    ///
+    /// \brief Set the precision on the time of the events
+    /// \param tolerance The precision on the time of the events (default 1e-10)
+    ///
+    void setEventTolerance(
+        double tolerance);
+
+    ///
+    /// \brief Return the precision on the time of the events
+    /// \return The precision on the time of the events
+    ///
+    double eventTolerance() const;
+
+    ///
+    /// \brief Set the maximal number of events in one step of the integrator
+    /// \param nbEvents The maximal number of events in one step (default 100)
+    ///
+    /// An error is raised beyond it, as it means the contacts chatter
+    ///
+    void setMaxNbEvents(
+        size_t nbEvents);
+
+    ///
+    /// \brief Return the maximal number of events in one step of the integrator
+    /// \return The maximal number of events in one step
+    ///
+    size_t maxNbEvents() const;
+
+    ///
+    /// \brief Return the number of rigid contacts
+    /// \return The number of rigid contacts
+    ///
+    size_t nbRigidContacts() const;
+
+    ///
+    /// \brief Return the contacts active at the end of the last rollout integrated by simulate
+    /// \return If each rigid contact is active
+    ///
+    const std::vector<bool>& activeContacts() const;
+
+    ///
+    /// \brief Return the events of the last rollout integrated by simulate
+    /// \return The events, in chronological order
+    ///
+    const std::vector<Event>& events() const;
+
+    ///
+    /// \brief Return the number of constraint sets built by simulate so far (one per set of active contacts reached)
+    /// \return The number of constraint sets built
+    ///
+    size_t nbConstraintSets() const;
+
+protected:
+    ///
+    /// \brief The per thread data of the contacts
+    ///
+    struct ContactMode {
+        std::vector<bool> active; ///< If each contact is active
+        std::vector<bool> nextActive; ///< The active contacts being switched to
+        std::map<std::vector<bool>, std::shared_ptr<rigidbody::Contacts>>
+                constraintSets; ///< The constraint set of each set of active contacts reached
+        rigidbody::Contacts* constraints; ///< The constraint set of the active contacts (nullptr if none)
+        std::vector<size_t> normalRows; ///< The row of the force along z of each active contact in constraints
+        std::vector<Event> events; ///< The events of the current rollout
+        utils::Vector xStart; ///< The state at the beginning of the step being localized
+        utils::Vector gStart; ///< The event functions at the beginning of the step
+        utils::Vector gEnd; ///< The event functions at the end of the step
+    };
+
+    ///
+    /// \brief Return the contact data of a workspace
+    /// \param ws The workspace
+    /// \return The contact data of the workspace
+    ///
+    ContactMode& mode(
+        Workspace& ws);
+
+    ///
+    /// \brief Switch the active contacts, building their constraint set if it was never reached
+    /// \param ws The workspace
+    /// \param active If each contact is active
+    ///
+    void setActiveContacts(
+        Workspace& ws,
+        const std::vector<bool>& active);
+
+    ///
+    /// \brief Compute the generalized accelerations with the active contacts enforced
+    /// \param ws The workspace
+    /// \return The generalized accelerations
+    ///
+    virtual rigidbody::GeneralizedAcceleration forwardDynamics(
+        Workspace& ws);
+
+    ///
+    /// \brief Integrate ws.x over an interval, stopping at each event
+    /// \param ws The workspace
+    /// \param t0 The time at the beginning of the interval
+    /// \param dt The duration of the interval
+    /// \param control The control function
+    ///
+    virtual void integrateInterval(
+        Workspace& ws,
+        double t0,
+        double dt,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Activate the initial contacts, then integrate one rollout from ws.x
+    /// \param ws The workspace
+    /// \param control The control function
+    /// \param currentInterval Set to the index of each interval before it is integrated (ignored if nullptr)
+    /// \param dt The duration of an interval
+    /// \param states The output states
+    ///
+    virtual void rollout(
+        Workspace& ws,
+        const ControlFunction& control,
+        size_t* currentInterval,
+        double dt,
+        utils::Matrix& states);
+
+    ///
+    /// \brief Take one step of the fixed step integrator on ws.x
+    /// \param ws The workspace
+    /// \param t The time at the beginning of the step
+    /// \param h The step
+    /// \param control The control function
+    ///
+    void step(
+        Workspace& ws,
+        double t,
+        double h,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Compute the event functions: the force along z of the active contacts, the height above
+    /// the penetration at which they are made of the inactive ones
+    /// \param ws The workspace
+    /// \param t The time
+    /// \param x The state
+    /// \param control The control function
+    /// \param g The output event functions (one per contact)
+    ///
+    void eventFunctions(
+        Workspace& ws,
+        double t,
+        const utils::Vector& x,
+        const ControlFunction& control,
+        utils::Vector& g);
+
+    ///
+    /// \brief Return if an event function crossed zero over a step
+    /// \param gStart The event function at the beginning of the step
+    /// \param gEnd The event function at the end of the step
+    /// \return If the event function crossed zero
+    ///
+    /// A function already at or below zero which keeps decreasing also crosses, so a contact
+    /// broken at the ground is made again if it sinks
+    ///
+    static bool hasCrossed(
+        double gStart,
+        double gEnd);
+
+    ///
+    /// \brief Switch the contacts whose event function crossed zero, then apply the impact
+    /// \param ws The workspace
+    /// \param t The time of the events
+    /// \param control The control function
+    ///
+    void applyEvents(
+        Workspace& ws,
+        double t,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Set the velocities of ws.x to those after an impact on the active contacts
+    /// \param ws The workspace
+    ///
+    void impact(
+        Workspace& ws);
+
+    ///
+    /// \brief Release, one at a time, the active contact which pulls the most on the ground
+    /// \param ws The workspace
+    /// \param t The time
+    /// \param control The control function
+    ///
+    void releaseTensileContacts(
+        Workspace& ws,
+        double t,
+        const ControlFunction& control);
+
+    double m_groundHeight; ///< The height of the ground plane
+    double m_contactTolerance; ///< The penetration at which a contact is made
+    double m_eventTolerance; ///< The precision on the time of the events
+    size_t m_maxNbEvents; ///< The maximal number of events in one step
+    size_t m_nbRigidContacts; ///< The number of rigid contacts
+    std::vector<ContactMode> m_modes; ///< The contact data of each workspace
+};
+
+}
+#endif
+
+#endif // BIORBD_HYBRID_SIMULATOR_H
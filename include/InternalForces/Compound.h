@@ -76,6 +76,15 @@ public:
     void DeepCopy(
         const Compound& other);
 
+    ///
+    /// \brief Give the compound its own copy of what is written during an evaluation
+    ///
+    /// Meant for a shallow copy: the description stays shared with the compound it was
+    /// copied from. The path modifiers are copied only if they hold wrapping objects, which
+    /// keep the state of the path.
+    ///
+    virtual void detachEvaluationState();
+
     ///
     /// \brief Set the name of a muscle
     /// \param name Name of the muscle
@@ -60,6 +60,14 @@ public:
     void DeepCopy(
         const Geometry& other);
 
+    ///
+    /// \brief Give the geometry its own copy of the path, its jacobians and the resolved segments
+    ///
+    /// Meant for a shallow copy: the origin and the insertion stay shared with the geometry it
+    /// was copied from.
+    ///
+    void detachEvaluationState();
+
     ///
     /// \brief Updates the position and dynamic elements of the muscles.
     /// \param model The joint model
@@ -308,6 +316,11 @@ protected:
     std::shared_ptr<utils::Matrix> m_G; ///< Internal matrix of the jacobian dimension to speed up calculation
     std::shared_ptr<utils::Matrix> m_jacobianLength; ///< The muscle length jacobian
 
+    std::shared_ptr<int> m_originParentId; ///< Rbdl id of the segment the origin is attached to (-1 if not resolved yet)
+    std::shared_ptr<int> m_insertionParentId; ///< Rbdl id of the segment the insertion is attached to (-1 if not resolved yet)
+    std::shared_ptr<std::vector<int>> m_pathModifiersParentId; ///< Rbdl id of the segment each path modifier is attached to (-1 if not resolved yet)
+    std::shared_ptr<std::vector<unsigned int>> m_pointsParentId; ///< Rbdl id of the segment each point in local is attached to
+
     std::shared_ptr<utils::Scalar> m_length; ///< length
     std::shared_ptr<utils::Scalar> m_velocity; ///< Velocity of the muscular elongation
 
@@ -86,6 +86,14 @@ public:
     void DeepCopy(
         const Ligament& other);
 
+    ///
+    /// \brief Give the ligament its own copy of its geometry and of its force components
+    ///
+    /// Meant for a shallow copy: the characteristics stay shared with the ligament it was
+    /// copied from.
+    ///
+    virtual void detachEvaluationState();
+
     // Get and set
 
     ///
@@ -247,6 +247,14 @@ public:
 
 
 protected:
+    ///
+    /// \brief Give the ligaments their own copy of what is written during an evaluation
+    ///
+    /// Meant for a shallow copy: the description of the ligaments stays shared with the
+    /// ligaments it was copied from, while their paths and forces are copied.
+    ///
+    void detachEvaluationState();
+
     std::shared_ptr<std::vector<std::shared_ptr<Ligament>>>
             m_ligaments; ///< Holder for ligament groups
 };
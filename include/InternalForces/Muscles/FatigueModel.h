@@ -60,6 +60,11 @@ public:
     void DeepCopy(
         const FatigueModel& other);
 
+    ///
+    /// \brief Replace the fatigue state shared with the model it was copied from by a copy of its own
+    ///
+    void detachFatigueState();
+
     ///
     /// \brief Compute the time derivative state
     /// \param emg EMG data
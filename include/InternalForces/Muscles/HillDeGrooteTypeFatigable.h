@@ -127,6 +127,11 @@ public:
     ///
     void DeepCopy(const HillDeGrooteTypeFatigable& other);
 
+    ///
+    /// \brief Give the muscle its own copy of its state, of its geometry, of its force components and of its fatigue state
+    ///
+    virtual void detachEvaluationState();
+
     ///
     /// \brief Compute the Force-Length of the contractile element
     /// \param emg EMG data
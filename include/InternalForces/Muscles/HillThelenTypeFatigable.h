@@ -126,6 +126,11 @@ public:
     ///
     void DeepCopy(const HillThelenTypeFatigable& other);
 
+    ///
+    /// \brief Give the muscle its own copy of its state, of its geometry, of its force components and of its fatigue state
+    ///
+    virtual void detachEvaluationState();
+
     ///
     /// \brief Compute the Force-Length of the contractile element
     /// \param emg EMG data
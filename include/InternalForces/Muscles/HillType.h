@@ -13,6 +13,7 @@ namespace internal_forces
 namespace muscles
 {
 class MuscleGeometry;
+class MuscleForceEngine;
 ///
 /// \brief Base class for all HillType muscles
 ///
@@ -29,6 +30,8 @@ class MuscleGeometry;
 ///
 class BIORBD_API HillType : public Muscle
 {
+    friend MuscleForceEngine;
+
 public:
     ///
     /// \brief Contruct a Hill-type muscle
@@ -114,6 +117,11 @@ public:
     void DeepCopy(
         const HillType& other);
 
+    ///
+    /// \brief Give the muscle its own copy of its state, of its geometry and of its force components
+    ///
+    virtual void detachEvaluationState();
+
     ///
     /// \brief Return the muscle force vector at origin and insertion
     /// \param emg The EMG data
@@ -23,6 +23,7 @@ namespace muscles
 class Characteristics;
 class State;
 class Muscles;
+class MuscleForceEngine;
 
 ///
 /// \brief Base class of all muscle
@@ -30,6 +31,7 @@ class Muscles;
 class BIORBD_API Muscle : public Compound
 {
     friend Muscles;
+    friend MuscleForceEngine;
 
 public:
     ///
@@ -115,6 +117,14 @@ public:
     void DeepCopy(
         const Muscle& other);
 
+    ///
+    /// \brief Give the muscle its own copy of its state and of its geometry
+    ///
+    /// Meant for a shallow copy: the characteristics stay shared with the muscle it was
+    /// copied from.
+    ///
+    virtual void detachEvaluationState();
+
     // Get and set
 
     ///
@@ -0,0 +1,215 @@
+#ifndef BIORBD_MUSCLES_MUSCLE_FORCE_ENGINE_H
+#define BIORBD_MUSCLES_MUSCLE_FORCE_ENGINE_H
+
+#include <memory>
+#include <vector>
+#include "biorbdConfig.h"
+#include "Utils/Vector.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace internal_forces
+{
+namespace muscles
+{
+class Muscle;
+class Muscles;
+class FatigueModel;
+class State;
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Evaluate the forces of all the Hill-type muscles of a model in batches
+///
+/// The muscles are gathered once and sorted by formulation (Hill, Thelen and DeGroote, the
+/// active-only and fatigable variants going with their formulation), with the constants of their
+/// curves packed in structure of arrays. At each evaluation, the length, velocity, activation,
+/// active fibers and characteristics of each muscle are gathered in contiguous columns, then the
+/// force-length, force-velocity, passive and damping curves of each formulation are evaluated on
+/// whole columns with the vectorized exp, log and sqrt of Eigen. The results are the same as
+/// HillType::force, which the other muscles (e.g. IdealizedActuator) still go through.
+///
+/// The same kernels can also give the closed-form derivatives of the forces with respect to the
+/// activation, the musculotendon length and the musculotendon velocity of each muscle.
+///
+/// The muscles are gathered again after invalidate is called (Muscles does so when it indexes its
+/// muscles again, after a muscle or a muscle group was added, or after a copy) or when the number of
+/// muscles changes.
+///
+class BIORBD_API MuscleForceEngine
+{
+public:
+    ///
+    /// \brief Construct an engine
+    ///
+    MuscleForceEngine();
+
+    ///
+    /// \brief Deep copy of the engine
+    /// \return A deep copy of the engine
+    ///
+    MuscleForceEngine DeepCopy() const;
+
+    ///
+    /// \brief Deep copy of the engine (the muscles are gathered again on next use)
+    /// \param other The engine to copy
+    ///
+    void DeepCopy(
+        const MuscleForceEngine& other);
+
+    ///
+    /// \brief Gather the muscles again on next use
+    ///
+    void invalidate();
+
+    ///
+    /// \brief Compute the force of all the muscles, assuming they are updated (via `updateMuscles`)
+    /// \param muscles The muscles of the model
+    /// \param emg The dynamic state of each muscle
+    /// \param forces The output force of each muscle (resized only if it is not nbMuscles)
+    ///
+    void computeForces(
+        Muscles& muscles,
+        const std::vector<std::shared_ptr<State>>& emg,
+        utils::Vector& forces);
+
+    ///
+    /// \brief Compute the force of all the muscles and their derivatives, assuming they are updated (via `updateMuscles`)
+    /// \param muscles The muscles of the model
+    /// \param emg The dynamic state of each muscle
+    /// \param forces The output force of each muscle
+    /// \param dForceActivation The output derivative of the force of each muscle with respect to its activation
+    /// \param dForceLength The output derivative of the force of each muscle with respect to its musculotendon length
+    /// \param dForceVelocity The output derivative of the force of each muscle with respect to its musculotendon velocity
+    ///
+    /// The output vectors are resized only if they are not nbMuscles. The derivatives are taken at
+    /// constant fatigue state and characteristics. They are analytical for the Hill-type muscles and
+    /// the idealized actuators; other muscles raise an error.
+    ///
+    void computeForceDerivatives(
+        Muscles& muscles,
+        const std::vector<std::shared_ptr<State>>& emg,
+        utils::Vector& forces,
+        utils::Vector& dForceActivation,
+        utils::Vector& dForceLength,
+        utils::Vector& dForceVelocity);
+
+    ///
+    /// \brief Return the number of muscles evaluated in batches
+    /// \return The number of muscles evaluated in batches
+    ///
+    size_t nbBatchedMuscles() const;
+
+protected:
+    ///
+    /// \brief Gather the muscles, sorted by formulation
+    /// \param muscles The muscles of the model
+    ///
+    void build(
+        Muscles& muscles);
+
+    ///
+    /// \brief Compute the force of all the muscles, and the derivatives of the batched ones if asked
+    /// \param muscles The muscles of the model
+    /// \param emg The dynamic state of each muscle
+    /// \param forces The output force of each muscle
+    /// \param withDerivatives If the derivatives of the curves are computed
+    ///
+    void evaluate(
+        Muscles& muscles,
+        const std::vector<std::shared_ptr<State>>& emg,
+        utils::Vector& forces,
+        bool withDerivatives);
+
+    ///
+    /// \brief Compute the curves of the Hill formulation on a range of the columns
+    /// \param start The first muscle of the range
+    /// \param size The number of muscles in the range
+    /// \param withDerivatives If the derivatives of the curves are computed
+    ///
+    void computeHill(
+        Eigen::Index start,
+        Eigen::Index size,
+        bool withDerivatives);
+
+    ///
+    /// \brief Compute the curves of the Thelen formulation on a range of the columns
+    /// \param start The first muscle of the range
+    /// \param size The number of muscles in the range
+    /// \param withDerivatives If the derivatives of the curves are computed
+    ///
+    void computeThelen(
+        Eigen::Index start,
+        Eigen::Index size,
+        bool withDerivatives);
+
+    ///
+    /// \brief Compute the curves of the DeGroote formulation on a range of the columns
+    /// \param start The first muscle of the range
+    /// \param size The number of muscles in the range
+    /// \param withDerivatives If the derivatives of the curves are computed
+    ///
+    void computeDeGroote(
+        Eigen::Index start,
+        Eigen::Index size,
+        bool withDerivatives);
+
+    ///
+    /// \brief The formulations of the curves, in the order the muscles are sorted
+    ///
+    enum FORMULATION {
+        FORMULATION_HILL,
+        FORMULATION_THELEN,
+        FORMULATION_DE_GROOTE,
+        NB_FORMULATIONS
+    };
+
+    bool m_isBuilt; ///< If the muscles are gathered
+    size_t m_nbMuscles; ///< The number of muscles of the model when they were gathered
+
+    // Description of the muscles evaluated in batches, sorted by formulation
+    std::vector<Muscle*> m_muscles; ///< Each muscle
+    std::vector<size_t> m_index; ///< The index of each muscle in the model
+    std::vector<FatigueModel*> m_fatigue; ///< The fatigue model of each muscle (nullptr if it is not fatigable)
+    std::vector<Eigen::Index> m_formulationStart; ///< The first muscle of each formulation (plus the total as last element)
+    Eigen::ArrayXd m_isPassive; ///< 1 if the passive and damping elements of the muscle are modelled, 0 for the active-only variants
+    Eigen::ArrayXd m_csteFlCE1; ///< The constant 1 of the FlCE of each muscle
+    Eigen::ArrayXd m_csteFlCE2; ///< The constant 2 of the FlCE of each muscle
+    Eigen::ArrayXd m_csteFvCE1; ///< The constant 1 of the FvCE of each muscle
+    Eigen::ArrayXd m_csteFvCE2; ///< The constant 2 of the FvCE of each muscle
+    Eigen::ArrayXd m_csteFlPE1; ///< The constant 1 of the FlPE of each muscle
+    Eigen::ArrayXd m_csteFlPE2; ///< The constant 2 of the FlPE of each muscle
+    Eigen::ArrayXd m_csteDamping; ///< The damping constant of each muscle
+    Eigen::ArrayXd m_maxShorteningSpeed; ///< The maximal shortening speed of each muscle
+    std::vector<Muscle*> m_otherMuscles; ///< The muscles which go through their own force function
+    std::vector<size_t> m_otherIndex; ///< The index of these muscles in the model
+
+    // State of the muscles of the current evaluation
+    Eigen::ArrayXd m_length; ///< The length of each muscle
+    Eigen::ArrayXd m_velocity; ///< The velocity of each muscle
+    Eigen::ArrayXd m_activation; ///< The activation of each muscle
+    Eigen::ArrayXd m_activeFibers; ///< The proportion of active fibers of each muscle
+    Eigen::ArrayXd m_optimalLength; ///< The optimal length of each muscle
+    Eigen::ArrayXd m_forceIsoMax; ///< The maximal isometric force of each muscle
+    Eigen::ArrayXd m_pennationAngle; ///< The pennation angle of each muscle
+    Eigen::ArrayXd m_useDamping; ///< 1 if the damping of the muscle is used, 0 otherwise
+    Eigen::ArrayXd m_normLength; ///< The length of each muscle normalized by its optimal length
+    Eigen::ArrayXd m_normVelocity; ///< The velocity of each muscle normalized as in its formulation
+    Eigen::ArrayXd m_FlCE; ///< The force-length of the contractile element of each muscle
+    Eigen::ArrayXd m_FvCE; ///< The force-velocity of the contractile element of each muscle
+    Eigen::ArrayXd m_FlPE; ///< The force-length of the passive element of each muscle
+    Eigen::ArrayXd m_damping; ///< The damping of each muscle
+    Eigen::ArrayXd m_force; ///< The force of each muscle
+    Eigen::ArrayXd m_dFlCEdLength; ///< The derivative of the FlCE of each muscle with respect to its length
+    Eigen::ArrayXd m_dFlCEdActivation; ///< The derivative of the FlCE of each muscle with respect to its activation
+    Eigen::ArrayXd m_dFvCEdVelocity; ///< The derivative of the FvCE of each muscle with respect to its velocity
+    Eigen::ArrayXd m_dFlPEdLength; ///< The derivative of the FlPE of each muscle with respect to its length
+    Eigen::ArrayXd m_dDampingdVelocity; ///< The derivative of the damping of each muscle with respect to its velocity
+};
+#endif
+
+}
+}
+}
+
+#endif // BIORBD_MUSCLES_MUSCLE_FORCE_ENGINE_H
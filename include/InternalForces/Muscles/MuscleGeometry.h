@@ -63,6 +63,14 @@ public:
     ///
     void DeepCopy(const MuscleGeometry& other);
 
+    ///
+    /// \brief Give the muscle geometry its own copy of the path, its jacobians and the lengths
+    ///
+    /// Meant for a shallow copy: the origin and the insertion stay shared with the geometry it
+    /// was copied from.
+    ///
+    void detachEvaluationState();
+
     ///
     /// \brief Updates the position and dynamic elements of the muscles.
     /// \param model The joint model
@@ -112,6 +120,24 @@ public:
         const Characteristics& characteristics,
         const rigidbody::GeneralizedVelocity* Qdot = nullptr);
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Updates the lengths and velocity of the muscle from a given musculotendon length and its jacobian
+    /// \param musculoTendonLength The musculotendon length
+    /// \param jacobianLength The jacobian of the musculotendon length
+    /// \param characteristics The muscle characteristics
+    /// \param Qdot The generalized velocities of the joints
+    ///
+    /// This is how a surrogate of the musculotendon length (see MuscleSurrogate) updates the muscle.
+    /// The points of the muscle and their jacobian are not updated.
+    ///
+    void updateKinematics(
+        const utils::Scalar& musculoTendonLength,
+        const utils::Matrix& jacobianLength,
+        const Characteristics& characteristics,
+        const rigidbody::GeneralizedVelocity* Qdot = nullptr);
+#endif
+
     ///
     /// \brief Return the previously computed muscle length
     /// \return The muscle lengh
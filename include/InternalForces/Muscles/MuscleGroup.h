@@ -22,12 +22,15 @@ namespace muscles
 class MuscleGeometry;
 class Muscle;
 class Characteristics;
+class Muscles;
 
 ///
 /// \brief A muscle group is muscle that share parents for both origin and insertion
 ///
 class BIORBD_API MuscleGroup
 {
+    friend Muscles;
+
 public:
     ///
     /// \brief Construct a muscle group
@@ -233,11 +236,17 @@ public:
     const utils::String& insertion() const;
 
 protected:
+    ///
+    /// \brief Replace the muscles shared with the group it was copied from by muscles which share their description only
+    ///
+    void detachEvaluationState();
+
     std::shared_ptr<std::vector<std::shared_ptr<Muscle>>>
     m_mus; ///< The set of muscles
     std::shared_ptr<utils::String> m_name; ///< The muscle group name
     std::shared_ptr<utils::String> m_originName; ///<The origin name
     std::shared_ptr<utils::String> m_insertName; ///< The insertion name
+    std::shared_ptr<bool> m_isMuscleTableOutdated; ///< Raised when a muscle is added (shared with the Muscles holding the group)
 
 };
 
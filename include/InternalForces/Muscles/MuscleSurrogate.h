@@ -0,0 +1,162 @@
+#ifndef BIORBD_MUSCLES_MUSCLE_SURROGATE_H
+#define BIORBD_MUSCLES_MUSCLE_SURROGATE_H
+
+#include <vector>
+#include "biorbdConfig.h"
+#include "Utils/Matrix.h"
+#include "Utils/Vector.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace rigidbody
+{
+class Joints;
+class GeneralizedCoordinates;
+}
+
+namespace internal_forces
+{
+namespace muscles
+{
+class Muscle;
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Polynomial surrogate of the musculotendon length of a muscle
+///
+/// The musculotendon length only depends on the dof spanned by the muscle, that is the dof
+/// which move some of its points (origin, insertion and path modifiers) but not all of them.
+/// The surrogate is fitted offline by sampling these dof within their ranges (Segment::QRanges)
+/// and solving the least-squares problem of a polynomial of total degree in the normalized
+/// coordinates. The length and its jacobian are then evaluated analytically, without updating
+/// the kinematics of the model nor the path of the muscle.
+///
+/// The error bounds are the largest errors measured on a validation set sampled independently
+/// from the one of the fit. They are not guaranteed outside the ranges of the dof.
+///
+class BIORBD_API MuscleSurrogate
+{
+public:
+    ///
+    /// \brief Construct an empty surrogate
+    ///
+    MuscleSurrogate();
+
+    ///
+    /// \brief Deep copy of the surrogate
+    /// \return A deep copy of the surrogate
+    ///
+    MuscleSurrogate DeepCopy() const;
+
+    ///
+    /// \brief Deep copy of the surrogate
+    /// \param other The surrogate to copy
+    ///
+    void DeepCopy(
+        const MuscleSurrogate& other);
+
+    ///
+    /// \brief Fit the surrogate of a muscle
+    /// \param model The joint model
+    /// \param muscle The muscle
+    /// \param degree The total degree of the polynomial
+    /// \param nbSamples The number of samples of the fit (0 to choose it from the number of coefficients)
+    /// \param seed The seed of the sampling
+    ///
+    /// The dof are sampled within Segment::QRanges, or within the default range of utils::Range
+    /// for the segments which have no ranges.
+    ///
+    /// The fit leaves the kinematics of the model and the geometry of the muscle at the last
+    /// sample of the validation set, which is not the state they had before the call. The
+    /// kinematics and the muscles must be updated again at the wanted Q after the fit.
+    ///
+    void fit(
+        rigidbody::Joints& model,
+        Muscle& muscle,
+        unsigned int degree = 4,
+        size_t nbSamples = 0,
+        unsigned int seed = 0);
+
+    ///
+    /// \brief Evaluate the musculotendon length and its jacobian
+    /// \param Q The generalized coordinates
+    /// \param length The output musculotendon length
+    /// \param jacobianLength The output jacobian of the musculotendon length (1 x nbQ, resized only if needed)
+    ///
+    void evaluate(
+        const rigidbody::GeneralizedCoordinates& Q,
+        utils::Scalar& length,
+        utils::Matrix& jacobianLength);
+
+    ///
+    /// \brief Return if the surrogate was fitted
+    /// \return If the surrogate was fitted
+    ///
+    bool isFitted() const;
+
+    ///
+    /// \brief Return the dof spanned by the muscle, in increasing order
+    /// \return The dof spanned by the muscle
+    ///
+    const std::vector<size_t>& dofs() const;
+
+    ///
+    /// \brief Return the total degree of the polynomial
+    /// \return The total degree of the polynomial
+    ///
+    unsigned int degree() const;
+
+    ///
+    /// \brief Return the coefficients of the polynomial
+    /// \return The coefficients of the polynomial
+    ///
+    const utils::Vector& coefficients() const;
+
+    ///
+    /// \brief Return the largest error on the musculotendon length measured on the validation set
+    /// \return The error bound on the musculotendon length
+    ///
+    double maxError() const;
+
+    ///
+    /// \brief Return the root mean square error on the musculotendon length measured on the validation set
+    /// \return The root mean square error on the musculotendon length
+    ///
+    double rmsError() const;
+
+    ///
+    /// \brief Return the largest error on the jacobian of the musculotendon length measured on the validation set
+    /// \return The error bound on each element of the jacobian
+    ///
+    double maxJacobianError() const;
+
+protected:
+    ///
+    /// \brief Compute the powers of the normalized coordinates of the spanned dof
+    /// \param Q The generalized coordinates
+    ///
+    void computePowers(
+        const rigidbody::GeneralizedCoordinates& Q);
+
+    bool m_isFitted; ///< If the surrogate was fitted
+    unsigned int m_degree; ///< The total degree of the polynomial
+    size_t m_nbQ; ///< The number of generalized coordinates of the model
+    std::vector<size_t> m_dofs; ///< The dof spanned by the muscle
+    utils::Vector m_center; ///< The center of the range of each spanned dof
+    utils::Vector m_halfRange; ///< The half width of the range of each spanned dof
+    std::vector<unsigned int> m_exponents; ///< The exponent of each spanned dof in each monomial (nbMonomials x nbDofs, row major)
+    utils::Vector m_coefficients; ///< The coefficient of each monomial
+    double m_maxError; ///< The largest error on the musculotendon length on the validation set
+    double m_rmsError; ///< The root mean square error on the musculotendon length on the validation set
+    double m_maxJacobianError; ///< The largest error on the jacobian on the validation set
+
+    utils::Matrix m_powers; ///< The powers of the normalized coordinates (degree+1 x nbDofs)
+    utils::Vector m_gradient; ///< The gradient with respect to the normalized coordinates
+};
+#endif
+
+}
+}
+}
+
+#endif // BIORBD_MUSCLES_MUSCLE_SURROGATE_H
@@ -31,6 +31,8 @@ namespace muscles
 class MuscleGroup;
 class State;
 class Muscle;
+class MuscleForceEngine;
+class MuscleSurrogate;
 
 ///
 /// \brief Muscle group holder
@@ -91,7 +93,7 @@ public:
     /// \brief Returns all the muscles. It sorts the muscles by group
     /// \return All the muscle
     ///
-    const std::vector<std::shared_ptr<Muscle>> muscles() const;
+    const std::vector<std::shared_ptr<Muscle>>& muscles() const;
 
     ///
     /// \brief Returns a specific muscle sorted by muscles()
@@ -101,6 +103,22 @@ public:
     const Muscle& muscle(
         size_t idx) const;
 
+    ///
+    /// \brief Returns a specific muscle sorted by muscles()
+    /// \param idx The muscle index
+    /// \return The muscle
+    ///
+    Muscle& muscle(
+        size_t idx);
+
+    ///
+    /// \brief Return the muscle group of a muscle
+    /// \param idx The muscle index (sorted by muscles())
+    /// \return The index of the muscle group
+    ///
+    size_t muscleGroupIndex(
+        size_t idx) const;
+
     ///
     /// \brief muscleNames Return the names for all the muscle ordered by their
     /// respective group name
@@ -295,6 +313,19 @@ public:
     utils::Vector muscleForces(
         const std::vector<std::shared_ptr<State>>& emg);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the muscle forces without allocating
+    /// \param emg The dynamic state
+    /// \param forces The output muscle forces (resized only if it is not nbMuscles)
+    ///
+    /// Warning: This function assumes that muscles are already updated (via `updateMuscles`)
+    ///
+    void muscleForces(
+        const std::vector<std::shared_ptr<State>>& emg,
+        utils::Vector& forces);
+#endif
+
     ///
     /// \brief Compute and return the muscle forces
     /// \param emg The dynamic state
@@ -325,9 +356,152 @@ public:
     ///
     size_t nbMuscles() const;
 
+#ifndef BIORBD_USE_CASADI_MATH
+#ifndef SWIG
+    ///
+    /// \brief Compute the muscle forces and their analytical derivatives
+    /// \param emg The dynamic state
+    /// \param forces The output muscle forces
+    /// \param dForceActivation The output derivative of each force with respect to the activation of its muscle
+    /// \param dForceLength The output derivative of each force with respect to the musculotendon length of its muscle
+    /// \param dForceVelocity The output derivative of each force with respect to the musculotendon velocity of its muscle
+    ///
+    /// Warning: This function assumes that muscles are already updated (via `updateMuscles`)
+    ///
+    void muscleForceDerivatives(
+        const std::vector<std::shared_ptr<State>>& emg,
+        utils::Vector& forces,
+        utils::Vector& dForceActivation,
+        utils::Vector& dForceLength,
+        utils::Vector& dForceVelocity);
+#endif
+
+    ///
+    /// \brief Compute the derivative of the muscular joint torque with respect to the muscle activations
+    /// \param emg The dynamic state
+    /// \return The derivative of the muscular joint torque (nbDof x nbMuscles)
+    ///
+    /// From \f$\tau = -J^T F\f$, it is \f$-J^T \text{diag}(\partial F / \partial a)\f$, with only one
+    /// evaluation of the forces.
+    ///
+    /// Warning: This function assumes that muscles are already updated (via `updateMuscles`)
+    ///
+    utils::Matrix muscularJointTorqueActivationJacobian(
+        const std::vector<std::shared_ptr<State>>& emg);
+
+    ///
+    /// \brief Compute the derivative of the muscular joint torque with respect to the generalized coordinates, at constant moment arms
+    /// \param emg The dynamic state
+    /// \return The derivative of the muscular joint torque through the muscle forces only (nbDof x nbQ)
+    ///
+    /// It is the derivative through the musculotendon lengths, \f$-J^T \text{diag}(\partial F / \partial l) J\f$,
+    /// with the muscle lengths jacobian \f$J\f$ (the moment arms) held constant. It is therefore NOT the full
+    /// derivative of the torque: the term \f$-(\partial J^T / \partial q) F\f$ is missing, as it would need the
+    /// second derivatives of the muscle lengths. It is only exact where the moment arms do not change with the
+    /// generalized coordinates.
+    ///
+    /// Warning: This function assumes that muscles are already updated (via `updateMuscles`)
+    ///
+    utils::Matrix muscularJointTorqueQJacobianAtConstantMomentArms(
+        const std::vector<std::shared_ptr<State>>& emg);
+
+    ///
+    /// \brief Compute the derivative of the muscular joint torque with respect to the generalized velocities
+    /// \param emg The dynamic state
+    /// \return The derivative of the muscular joint torque (nbDof x nbQdot)
+    ///
+    /// From \f$\tau = -J^T F\f$ and \f$\dot{l} = J \dot{q}\f$, it is \f$-J^T \text{diag}(\partial F / \partial \dot{l}) J\f$.
+    ///
+    /// Warning: This function assumes that muscles are already updated (via `updateMuscles`)
+    ///
+    utils::Matrix muscularJointTorqueQdotJacobian(
+        const std::vector<std::shared_ptr<State>>& emg);
+
+    ///
+    /// \brief Return the engine which evaluates the forces of the Hill-type muscles in batches
+    /// \return The muscle force engine
+    ///
+    MuscleForceEngine& muscleForceEngine();
+
+    ///
+    /// \brief Fit a polynomial surrogate of the musculotendon length of each muscle (see MuscleSurrogate)
+    /// \param degree The total degree of the polynomials
+    /// \param nbSamples The number of samples of each fit (0 to choose it from the number of coefficients)
+    ///
+    /// The surrogates are kept with the model, but they are not used until useMuscleSurrogates is
+    /// called. The muscles must be updated again after the fit.
+    ///
+    void fitMuscleSurrogates(
+        unsigned int degree = 4,
+        size_t nbSamples = 0);
+
+    ///
+    /// \brief Set if the muscles are updated from their surrogates
+    /// \param useSurrogates If the muscles are updated from their surrogates
+    ///
+    /// In this mode, updateMuscles(Q, ...) only sets the lengths, the velocities and the lengths
+    /// jacobian of the muscles from the polynomials. Neither the kinematics of the model nor the
+    /// points of the muscles are updated, and the wrapping and via points are only accounted for
+    /// through the fit. The error is bounded by MuscleSurrogate::maxError within the ranges of the dof.
+    ///
+    void useMuscleSurrogates(
+        bool useSurrogates);
+
+    ///
+    /// \brief Return if the muscles are updated from their surrogates
+    /// \return If the muscles are updated from their surrogates
+    ///
+    bool isUsingMuscleSurrogates() const;
+
+    ///
+    /// \brief Return the surrogate of a muscle
+    /// \param idx The muscle index
+    /// \return The surrogate of the muscle
+    ///
+    const MuscleSurrogate& muscleSurrogate(
+        size_t idx) const;
+#endif
+
 protected:
+    ///
+    /// \brief Index the muscles again if a muscle or a muscle group was added since they were indexed
+    ///
+    /// The index of a muscle in the table is also the slot of its state in stateSet and in the
+    /// vectors of states, forces and activations.
+    ///
+    void updateMuscleTable() const;
+
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Update the lengths, velocities and lengths jacobian of the muscles from their surrogates
+    /// \param Q The generalized coordinates
+    /// \param QDot The generalized velocities (nullptr if the velocities are not updated)
+    ///
+    void updateMusclesFromSurrogates(
+        const rigidbody::GeneralizedCoordinates& Q,
+        const rigidbody::GeneralizedVelocity* QDot);
+#endif
+
+    ///
+    /// \brief Give the muscles their own copy of what is written during an evaluation
+    ///
+    /// Meant for a shallow copy: the description of the muscles (characteristics, via points,
+    /// origins and insertions) stays shared with the muscles it was copied from. The states,
+    /// the paths, the force engine and the surrogates, which hold their evaluation buffers,
+    /// are copied.
+    ///
+    void detachEvaluationState();
+
     std::shared_ptr<std::vector<MuscleGroup>>
             m_mus; ///< Holder for muscle groups
+    std::shared_ptr<bool> m_isMuscleTableOutdated; ///< If a muscle or a muscle group was added since the muscles were indexed
+    std::shared_ptr<std::vector<std::shared_ptr<Muscle>>> m_muscleTable; ///< All the muscles, sorted by group
+    std::shared_ptr<std::vector<size_t>> m_muscleGroupTable; ///< The muscle group of each muscle
+#ifndef BIORBD_USE_CASADI_MATH
+    std::shared_ptr<MuscleForceEngine> m_muscleForceEngine; ///< The engine evaluating the forces of the Hill-type muscles
+    std::shared_ptr<std::vector<MuscleSurrogate>> m_muscleSurrogates; ///< The surrogate of the musculotendon length of each muscle
+    std::shared_ptr<bool> m_useMuscleSurrogates; ///< If the muscles are updated from their surrogates
+#endif
 };
 
 }
@@ -43,7 +43,7 @@ public:
     /// \param useResidual If use residual torque, if set to false, the optimization will fail if the model is not strong enough
     /// \param pNormFactor The p-norm to perform
     /// \param verbose Level of IPOPT verbose you want
-    /// \param eps The precision to perform the finite diffentiation
+    /// \param eps The precision of the finite differentiation (unused, the constraints jacobian is analytical)
     ///
     StaticOptimizationIpopt(
         Model &model,
@@ -21,6 +21,8 @@
 #include "InternalForces/Muscles/Muscle.h"
 #include "InternalForces/Muscles/MuscleGroup.h"
 #include "InternalForces/Muscles/Muscles.h"
+#include "InternalForces/Muscles/MuscleForceEngine.h"
+#include "InternalForces/Muscles/MuscleSurrogate.h"
 #include "InternalForces/Muscles/MusclesEnums.h"
 #include "InternalForces/Muscles/State.h"
 #include "InternalForces/Muscles/StateDynamics.h"
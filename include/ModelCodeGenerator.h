@@ -0,0 +1,58 @@
+#ifndef BIORBD_UTILS_CODE_GENERATOR_H
+#define BIORBD_UTILS_CODE_GENERATOR_H
+
+#include "biorbdConfig.h"
+namespace BIORBD_NAMESPACE
+{
+class Model;
+
+namespace utils
+{
+class Path;
+class String;
+}
+
+///
+/// \brief Generator of C++ kernels specialized for a given model
+///
+/// The kernels are straight-line code where the kinematic tree of the model is unrolled and
+/// all its constants (reference frames, axes, markers and inertias) are written in. They only
+/// depend on Eigen and use fixed-size types, so a model which does not change can be evaluated
+/// without going through rbdl and biorbd. The generated header provides, in its namespace:
+///     - nbQ, nbSegments and nbMarkers
+///     - forwardKinematics, which fills a State with the frames and the axes of the model
+///     - globalJCS, markers, markersJacobian and massMatrix, computed from a State or from Q
+///
+/// Only the translations, the rotations about one axis and the xyz/zyx Euler sequences are
+/// supported (quaternions are not).
+///
+class BIORBD_API CodeGenerator
+{
+public:
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Write the header of the kinematics kernels of a model
+    /// \param model The model to generate the kernels of
+    /// \param pathToWrite The path of the header to write
+    /// \param kernelsNamespace The namespace of the generated kernels
+    ///
+    static void writeKinematicsKernels(
+        Model &model,
+        const utils::Path& pathToWrite,
+        const utils::String& kernelsNamespace);
+
+    ///
+    /// \brief Return the header of the kinematics kernels of a model
+    /// \param model The model to generate the kernels of
+    /// \param kernelsNamespace The namespace of the generated kernels
+    /// \return The content of the header
+    ///
+    static utils::String kinematicsKernels(
+        Model &model,
+        const utils::String& kernelsNamespace);
+#endif
+};
+
+}
+
+#endif // BIORBD_UTILS_CODE_GENERATOR_H
@@ -0,0 +1,144 @@
+#ifndef BIORBD_RIGIDBODY_BLOCK_JACOBIAN_H
+#define BIORBD_RIGIDBODY_BLOCK_JACOBIAN_H
+
+#include <memory>
+#include <vector>
+#include "biorbdConfig.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace utils
+{
+class Matrix;
+class Vector;
+}
+
+namespace rigidbody
+{
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Jacobian of a set of points stored as one dense block per point
+///
+/// A point only depends on the degrees of freedom of the segment it is attached to and of
+/// the ancestors of that segment. Each block is 3 x (number of these dof) and the column
+/// pattern gives, for each column of the block, its column in the full jacobian. The
+/// pattern only depends on the structure of the model, so a BlockJacobian can be filled
+/// again at each frame without reallocation.
+///
+class BIORBD_API BlockJacobian
+{
+public:
+    ///
+    /// \brief Construct an empty jacobian
+    /// \param nbQ The number of columns of the full jacobian
+    ///
+    BlockJacobian(
+        size_t nbQ = 0);
+
+    ///
+    /// \brief Construct a jacobian with a given column pattern, all blocks set to zero
+    /// \param nbQ The number of columns of the full jacobian
+    /// \param columns The columns (in increasing order) of each point
+    ///
+    BlockJacobian(
+        size_t nbQ,
+        const std::vector<std::vector<size_t>>& columns);
+
+    ///
+    /// \brief Deep copy of the jacobian
+    /// \return A deep copy of the jacobian
+    ///
+    BlockJacobian DeepCopy() const;
+
+    ///
+    /// \brief Deep copy of the jacobian
+    /// \param other The jacobian to copy
+    ///
+    void DeepCopy(
+        const BlockJacobian& other);
+
+    ///
+    /// \brief Return the number of points
+    /// \return The number of points
+    ///
+    size_t nbPoints() const;
+
+    ///
+    /// \brief Return the number of columns of the full jacobian
+    /// \return The number of columns of the full jacobian
+    ///
+    size_t nbQ() const;
+
+    ///
+    /// \brief Return the number of entries which are not structurally zero
+    /// \return The number of entries which are not structurally zero
+    ///
+    size_t nbNonZeros() const;
+
+    ///
+    /// \brief Return the columns of the full jacobian a point depends on
+    /// \param idx The index of the point
+    /// \return The columns (in increasing order) of the block of the point
+    ///
+    const std::vector<size_t>& columns(
+        size_t idx) const;
+
+    ///
+    /// \brief Return the block of a point
+    /// \param idx The index of the point
+    /// \return The 3 x columns(idx).size() block of the point
+    ///
+    const utils::Matrix& block(
+        size_t idx) const;
+
+    ///
+    /// \brief Return the block of a point
+    /// \param idx The index of the point
+    /// \return The 3 x columns(idx).size() block of the point
+    ///
+    utils::Matrix& block(
+        size_t idx);
+
+    ///
+    /// \brief Return the full jacobian of a point
+    /// \param idx The index of the point
+    /// \return The 3 x nbQ jacobian of the point
+    ///
+    utils::Matrix dense(
+        size_t idx) const;
+
+    ///
+    /// \brief Return the full jacobian of all the points stacked
+    /// \return The 3*nbPoints x nbQ jacobian
+    ///
+    utils::Matrix dense() const;
+
+    ///
+    /// \brief Return the velocity of the points (J * v)
+    /// \param v A vector of size nbQ
+    /// \return The velocities of the points stacked (3*nbPoints)
+    ///
+    utils::Vector multiply(
+        const utils::Vector& v) const;
+
+    ///
+    /// \brief Return the product of the transposed jacobian and a vector (J^T * f)
+    /// \param f A vector of size 3*nbPoints
+    /// \return The product (nbQ)
+    ///
+    utils::Vector transposeMultiply(
+        const utils::Vector& f) const;
+
+protected:
+    std::shared_ptr<size_t> m_nbQ; ///< The number of columns of the full jacobian
+    std::shared_ptr<std::vector<std::vector<size_t>>> m_columns; ///< The columns of each point
+    std::shared_ptr<std::vector<utils::Matrix>> m_blocks; ///< The block of each point
+
+};
+#endif
+
+}
+}
+
+#endif // BIORBD_RIGIDBODY_BLOCK_JACOBIAN_H
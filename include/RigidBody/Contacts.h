@@ -5,6 +5,7 @@
 #include <memory>
 #include <rbdl/Constraints.h>
 #include "biorbdConfig.h"
+#include "RigidBody/RigidBodyEnums.h"
 
 namespace BIORBD_NAMESPACE
 {
@@ -25,6 +26,7 @@ class GeneralizedVelocity;
 class GeneralizedAcceleration;
 class GeneralizedTorque;
 class NodeSegment;
+class LoopConstraintSolver;
 
 ///
 /// \brief Class Contacts
@@ -132,6 +134,51 @@ public:
         const rigidbody::GeneralizedTorque& Tau,
         rigidbody::ExternalForceSet& externalForces);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the forward dynamics and the forces generated from loop constraints with the same solve
+    /// \param Q The generalized coordinates
+    /// \param Qdot The generalized velocities
+    /// \param Tau The generalized torques
+    /// \param externalForces the external forces
+    /// \param Qddot The output generalized accelerations
+    /// \param forces The output forces generated by the loop closure at the predecessor in the global frame
+    ///
+    /// The constrained system is solved with the solver of the model (see setConstraintSolver). The
+    /// direct solver goes through the loop constraint solver, which keeps its factorization and applies
+    /// the Baumgarte stabilization set on it. The other solvers do not use that stabilization.
+    ///
+    void calcLoopConstraintForces(
+        const rigidbody::GeneralizedCoordinates& Q,
+        const rigidbody::GeneralizedVelocity& Qdot,
+        const rigidbody::GeneralizedTorque& Tau,
+        rigidbody::ExternalForceSet& externalForces,
+        rigidbody::GeneralizedAcceleration& Qddot,
+        std::vector< utils::SpatialVector >& forces);
+#endif
+
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Return the solver of the dynamics of the loop constraints (to set its stabilization)
+    /// \return The loop constraint solver
+    ///
+    LoopConstraintSolver& loopConstraintSolver();
+
+    ///
+    /// \brief Project the generalized coordinates and velocities onto the constraints, to correct their drift
+    /// \param Q The generalized coordinates to project
+    /// \param Qdot The generalized velocities to project
+    /// \param tolerance The tolerance on the position error
+    /// \param maxNbIterations The maximal number of iterations of the projection of Q
+    /// \return If the projection of Q converged (Qdot is left untouched otherwise)
+    ///
+    bool projectOnConstraints(
+        rigidbody::GeneralizedCoordinates& Q,
+        rigidbody::GeneralizedVelocity& Qdot,
+        double tolerance = 1e-12,
+        unsigned int maxNbIterations = 100);
+#endif
+
     ///
     /// \brief Destroy the class properly
     ///
@@ -141,8 +188,24 @@ public:
     /// \brief Get constraints
     /// \return The constraints
     ///
+    /// The constraint set is bound to the model on the first call. It is then the workspace
+    /// that the constrained dynamics of the model reuse from one call to the other
+    ///
     Contacts &getConstraints();
 
+    ///
+    /// \brief Set the solver used by the constrained dynamics of the model
+    /// \param solver The solver
+    ///
+    void setConstraintSolver(
+        CONSTRAINT_SOLVER solver);
+
+    ///
+    /// \brief Return the solver used by the constrained dynamics of the model
+    /// \return The solver
+    ///
+    CONSTRAINT_SOLVER constraintSolver() const;
+
     ///
     /// \brief Check if there are contacts
     /// \return The presence of contacts
@@ -316,10 +379,22 @@ protected:
     utils::String swapAxes(
         const utils::String& axesToSwap) const;
 
+    ///
+    /// \brief Give the contacts their own copy of what is written during an evaluation
+    ///
+    /// Meant for a shallow copy: the declared contacts stay shared with the contacts they were
+    /// copied from, while the choice of the solver and the loop constraint solver are copied.
+    ///
+    void detachEvaluationState();
+
     std::shared_ptr<size_t> m_nbreConstraint; ///< Number of constraints
     std::shared_ptr<bool> m_isBinded; ///< If the model is ready
     std::shared_ptr<std::vector<rigidbody::NodeSegment>> m_rigidContacts; ///< The rigid contacts declared in the model (copy of RBDL information)
     std::shared_ptr<size_t> m_nbLoopConstraint; ///< Number of constraints
+    std::shared_ptr<CONSTRAINT_SOLVER> m_constraintSolver; ///< The solver of the constrained dynamics
+#ifndef BIORBD_USE_CASADI_MATH
+    std::shared_ptr<LoopConstraintSolver> m_loopConstraintSolver; ///< The solver of the dynamics of the loop constraints
+#endif
 };
 
 }
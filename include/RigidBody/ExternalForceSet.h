@@ -80,11 +80,40 @@ namespace BIORBD_NAMESPACE
                 bool useSoftContacts = true
             );
 
+            ///
+            /// \brief Construct a copy of an ExternalForceSet applied on another model
+            /// \param other The ExternalForceSet to copy
+            /// \param model The model onto which the external forces will be applied on. It must share the
+            /// description of the model [other] was created on (e.g. a workspace of that model)
+            ///
+            ExternalForceSet(
+                const ExternalForceSet& other,
+                Model& model
+            );
+
+            ///
+            /// \brief Replace the forces of the set by those of another set, keeping the model of this set
+            /// \param other The set to copy the forces from. It must be created on a model which shares the
+            /// description of the model of this set (e.g. a workspace of that model)
+            ///
+            /// The buffers of the set are reused, so a set bound to a workspace can take the forces of each
+            /// frame without allocating once they have reached their size
+            ///
+            void setForces(
+                const ExternalForceSet& other
+            );
+
             ///
             /// \brief Delete the set and free the ressources
             /// 
             ~ExternalForceSet();
 
+            ///
+            /// \brief Return the model the set refers to
+            /// \return The model the set refers to
+            ///
+            const Model& model() const;
+
             ///
             /// \brief Apply a new value to the specified spatial vector of the Set. WARNING: This vector 
             /// is expected to be acting on segmentName, applied at origin and expressed in the global reference frame.
@@ -110,6 +139,44 @@ namespace BIORBD_NAMESPACE
                 const utils::Vector3d& pointOfApplication
             );
 
+            ///
+            /// \brief Return the index of the rbdl body which receives the forces applied on a segment
+            /// \param segmentName The name of the segment
+            /// \return The index to give to addToBody
+            ///
+            /// Resolving the index once avoids looking for the segment by its name at each frame
+            ///
+            size_t bodyIndex(
+                const utils::String& segmentName
+            ) const;
+
+            ///
+            /// \brief Apply a new value to the specified spatial vector of the Set. WARNING: This vector 
+            /// is expected to be applied at origin and expressed in the global reference frame.
+            /// \param bodyIndex The index of the rbdl body, as returned by bodyIndex
+            /// \param vector The SpatialVector to add to the set.
+            ///
+            void addToBody(
+                size_t bodyIndex,
+                const utils::SpatialVector& vector
+            );
+
+            ///
+            /// \brief Apply a new value to the specified spatial vector of the Set. WARNING: This vector 
+            /// is expected to be applied at pointOfApplication and expressed in the global reference frame. 
+            /// \param bodyIndex The index of the rbdl body, as returned by bodyIndex
+            /// \param vector The SpatialVector to add to the set.
+            /// \param pointOfApplication Where the v vector is currenlty applied. 
+            ///
+            /// Along with setZero, this allows to update the set in place at each frame (e.g. from the
+            /// force plates) without allocating
+            ///
+            void addToBody(
+                size_t bodyIndex,
+                const utils::SpatialVector& vector, 
+                const utils::Vector3d& pointOfApplication
+            );
+
             ///
             /// \brief Apply a new value to the specified spatial vector of the Set. WARNING: This vector 
             /// is expected to be acting on segmentName, applied at pointOfApplication and expressed in the segment reference frame. 
@@ -186,6 +253,38 @@ namespace BIORBD_NAMESPACE
                 bool updateKin = true
             );
 
+            ///
+            /// \brief The forces in the format rbdl expects, that is one spatial vector per rbdl body
+            /// \param Q The generalized coordinates
+            /// \param QDot The generalized velocity
+            /// \param updateKin If the kinematics of the model should be computed
+            ///
+            /// computeRbdlSpatialVectors gives one spatial vector per dof of the segments. It only matches the
+            /// bodies of rbdl when each dof has its own body, which is not the case of the segments mapped onto
+            /// a multi-dof joint (xyz translations, xyz or zyx rotations)
+            ///
+            std::vector<RigidBodyDynamics::Math::SpatialVector> computeRbdlSpatialVectorsPerBody(
+                const rigidbody::GeneralizedCoordinates& Q,
+                const rigidbody::GeneralizedVelocity& QDot,
+                bool updateKin = true
+            );
+
+            ///
+            /// \brief The forces in a rbdl compatible format (one per rbdl body), computed in a buffer owned by the set
+            /// \param Q The generalized coordinates
+            /// \param QDot The generalized velocity
+            /// \param updateKin If the kinematics of the model should be computed
+            /// \return The buffer to give to rbdl, or nullptr if there is no force to apply (rbdl then skips them)
+            ///
+            /// The buffer is only reallocated if the number of bodies of the model changes, so the set can be
+            /// bound to a model once and used at each frame without allocating
+            ///
+            std::vector<RigidBodyDynamics::Math::SpatialVector>* computeRbdlSpatialVectorsInPlace(
+                const rigidbody::GeneralizedCoordinates& Q,
+                const rigidbody::GeneralizedVelocity& QDot,
+                bool updateKin = true
+            );
+
             /// 
             /// \brief The forces in a rbdl compatible format. This won't work if useTranslationalForces or useSoftContacts is set to true
             /// 
@@ -221,6 +320,22 @@ namespace BIORBD_NAMESPACE
             bool hasExternalForceInLocalReferenceFrame() const;
 
         protected:
+#ifndef SWIG
+            ///
+            /// \brief Fill the spatial vectors of each rbdl body with all the forces of the set
+            /// \param Q The generalized coordinates
+            /// \param QDot The generalized velocity
+            /// \param updateKin If the kinematics of the model should be computed
+            /// \param out The vector of SpatialVector to fill (resized only if it does not match the number of bodies)
+            ///
+            void fillSpatialVectors(
+                const rigidbody::GeneralizedCoordinates& Q,
+                const rigidbody::GeneralizedVelocity& QDot,
+                bool updateKin,
+                std::vector<utils::SpatialVector>& out
+            );
+#endif
+
             /// 
             /// \brief Add the forces expressed in the local reference to the internal Set.
             /// \param Q The Generalized coordinates. 
@@ -288,6 +403,12 @@ namespace BIORBD_NAMESPACE
 
             std::vector<utils::SpatialVector>
                 m_externalForces; ///< The vector that holds all the external forces
+            bool m_hasForcesAtOrigin; ///< If a force was added to m_externalForces since the last setZero
+
+            std::vector<utils::SpatialVector>
+                m_spatialVectors; ///< The buffer in which all the forces are combined
+            std::vector<RigidBodyDynamics::Math::SpatialVector>
+                m_rbdlSpatialVectors; ///< The buffer given to rbdl by computeRbdlSpatialVectorsInPlace
 
             LocalForcesInternal m_externalForcesInLocal; ///< The vector that holds all the external forces that are expressed in local reference frame (must call Q).
 
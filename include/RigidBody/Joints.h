@@ -6,9 +6,13 @@
 #include <rbdl/Constraints.h>
 #include "biorbdConfig.h"
 #include "Utils/Scalar.h"
+#include "Utils/Point3d.h"
+#include "RigidBody/RigidBodyEnums.h"
 
 namespace BIORBD_NAMESPACE
 {
+class Model;
+
 namespace utils
 {
 class String;
@@ -33,6 +37,9 @@ class Segment;
 class SegmentCharacteristics;
 class Mesh;
 class Contacts;
+#ifndef BIORBD_USE_CASADI_MATH
+struct WholeBodyQuantities;
+#endif
 
 ///
 /// \brief This is the core of the musculoskeletal model in biorbd
@@ -43,6 +50,8 @@ class BIORBD_API Joints
 class BIORBD_API Joints : public RigidBodyDynamics::Model
 #endif
 {
+    friend Contacts;
+
 public:
 
     ///
@@ -151,6 +160,17 @@ public:
     int getBodyRbdlId(
         const utils::String &segmentName) const;
 
+    ///
+    /// \brief Return the rbdl body identification of the segment a node is attached to
+    /// \param node The node attached to a segment
+    /// \return The rbdl body identification
+    ///
+    /// The identification resolved when the node was added to the model is used. The
+    /// lookup by name is only performed if the node was never bound to a segment
+    ///
+    unsigned int getParentRbdlId(
+        const NodeSegment& node) const;
+
     ///
     /// \brief Return the Biorbd body identification from rbdl
     /// \param idx The Rbdl body Id
@@ -173,16 +193,21 @@ public:
     ///
     std::vector<std::vector<size_t> > getDofSubTrees();
 
+    ///
+    /// \brief Return the dof which move a body, that is its own dof and those of its ancestors
+    /// \param rbdlId The rbdl body identification (movable or fixed)
+    /// \return The dof indices, in increasing order
+    ///
+    std::vector<size_t> getDofChain(
+        unsigned int rbdlId) const;
+
 protected:
     ///
-    /// \brief Return the rbdl idx of subtrees of each segments
-    /// \param subTrees the rbdl idx of subtrees of each segments to be filled
-    /// \param idx starting index to explore the subtrees
-    /// \return the rbdl idx of subtrees of each segments starting from the specified index
+    /// \brief Compute the dof subtrees of all the rbdl bodies (see m_dofSubTrees)
     ///
-    std::vector<std::vector<size_t> > recursiveDofSubTrees(
-        std::vector<std::vector<size_t> >subTrees,
-        size_t idx);
+    /// The topology only changes when segments are added, so it is computed there
+    ///
+    void updateDofSubTrees();
 
 public:
     ///
@@ -298,11 +323,107 @@ public:
     /// \param Qdot The generalized velocities
     /// \param Qddot The generalized accelerations
     ///
+    /// The generalized coordinates, velocities and accelerations the kinematics were last updated
+    /// with are remembered, so a call with the same state is skipped and a call where only the
+    /// velocities (or accelerations) changed only updates these (not with CasADi)
+    ///
     void UpdateKinematicsCustom(
         const GeneralizedCoordinates *Q = nullptr,
         const GeneralizedVelocity *Qdot = nullptr,
         const rigidbody::GeneralizedAcceleration *Qddot = nullptr);
 
+    ///
+    /// \brief Inform the model that rbdl updated the kinematics without going through UpdateKinematicsCustom
+    /// \param Q The generalized coordinates the positions were updated with (nullptr if unknown)
+    /// \param Qdot The generalized velocities the velocities were updated with (nullptr if unknown)
+    ///
+    /// This must be called after a rbdl function that updates the kinematics is called directly
+    /// on the model, otherwise the next UpdateKinematicsCustom could be wrongly skipped
+    ///
+    void kinematicsUpdatedByRbdl(
+        const GeneralizedCoordinates *Q = nullptr,
+        const GeneralizedVelocity *Qdot = nullptr);
+
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Update the positions of the bodies moved by some dof only
+    /// \param Q The generalized coordinates
+    /// \param changedDof The indices of the dof which changed since the last kinematics update
+    ///
+    /// The other generalized coordinates must be the ones the kinematics were last updated with.
+    /// Only the subtrees of the segments carrying the changed dof are recomputed. If the
+    /// positions were not up to date, all the bodies are updated.
+    ///
+    /// UpdateKinematicsCustom does the same on its own when it is only given Q, by comparing it
+    /// to the last Q the kinematics were updated with
+    ///
+    void UpdateKinematicsSubtrees(
+        const GeneralizedCoordinates &Q,
+        const std::vector<size_t>& changedDof);
+
+    ///
+    /// \brief Return the jacobian of the origin of a body, computed only once per update of its position
+    /// \param Q The generalized coordinates
+    /// \param rbdlId The rbdl body identification (a fixed body gives the jacobian of its movable parent)
+    /// \return The 6 x nbQdot jacobian of the origin of the movable body (angular rows first), in the global reference frame
+    ///
+    /// The kinematics must already be updated at Q, this does not update them. The jacobian is
+    /// kept until the position of the body is updated again (by UpdateKinematicsCustom,
+    /// UpdateKinematicsSubtrees or kinematicsUpdatedByRbdl).
+    ///
+    const RigidBodyDynamics::Math::MatrixNd& bodyJacobian(
+        const GeneralizedCoordinates &Q,
+        unsigned int rbdlId);
+
+    ///
+    /// \brief Compute the jacobian of a point from the jacobian of its body (see bodyJacobian)
+    /// \param Q The generalized coordinates
+    /// \param rbdlId The rbdl body the point is attached to (movable or fixed)
+    /// \param pointInLocal The position of the point in the reference frame of the body
+    /// \param jacobian The matrix to write the 3 x nbQdot jacobian of the point in
+    /// \param firstRow The row of jacobian where the jacobian of the point starts
+    ///
+    /// It gives the same as RigidBodyDynamics::CalcPointJacobian without updating the kinematics,
+    /// but the ancestors of the body are only walked for the first of its points after an update of
+    /// its position. The other points only cost the transport of the velocity of the origin.
+    ///
+    void pointJacobianFromBody(
+        const GeneralizedCoordinates &Q,
+        unsigned int rbdlId,
+        const utils::Vector3d &pointInLocal,
+        utils::Matrix &jacobian,
+        unsigned int firstRow);
+
+    ///
+    /// \brief Return the number of body jacobians computed by bodyJacobian
+    /// \return The number of body jacobians computed
+    ///
+    size_t nbBodyJacobiansComputed() const;
+#endif
+
+    ///
+    /// \brief Return the number of times UpdateKinematicsCustom actually updated the kinematics
+    /// \return The number of kinematics updates
+    ///
+    size_t nbKinematicsUpdates() const;
+
+    ///
+    /// \brief Return the number of times UpdateKinematicsCustom was skipped because the state did not change
+    /// \return The number of kinematics updates elided
+    ///
+    size_t nbKinematicsUpdatesElided() const;
+
+    ///
+    /// \brief Return the number of body positions recomputed by the kinematics updates
+    /// \return The number of body positions recomputed
+    ///
+    size_t nbKinematicsBodiesUpdated() const;
+
+    ///
+    /// \brief Set the kinematics updates counters to zero
+    ///
+    void resetKinematicsUpdatesCounters();
+
 
     // -- POSITION INTERFACE OF THE MODEL -- //
 
@@ -325,6 +446,21 @@ public:
     ///
     std::vector<utils::RotoTrans> allGlobalJCS() const;
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the joint coordinate system (JCS) of all the segments in global reference frame
+    /// \param Q The generalized coordinates
+    /// \param jcsOut The JCS of each segment, resized only if its size is not nbSegment
+    /// \param updateKin If the kinematics should be updated
+    ///
+    /// Once jcsOut has the right size, nothing is allocated
+    ///
+    void allGlobalJCS(
+        const GeneralizedCoordinates &Q,
+        std::vector<utils::RotoTrans>& jcsOut,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Return the joint coordinate system (JCS) for the segment in global reference frame at a given Q
     /// \param Q The generalized coordinates
@@ -514,6 +650,21 @@ public:
         const GeneralizedCoordinates &Q,
         bool updateKin=true);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the position of the center of mass of each segment
+    /// \param Q The generalized coordinates
+    /// \param comOut The center of mass of each segment, resized only if its size is not nbSegment
+    /// \param updateKin If the kinematics of the model should be computed
+    ///
+    /// Once comOut has the right size, nothing is allocated
+    ///
+    void CoMbySegment(
+        const GeneralizedCoordinates &Q,
+        std::vector<utils::Point3d>& comOut,
+        bool updateKin=true);
+#endif
+
     ///
     /// \brief Return the position of the center of mass of segment idx
     /// \param Q The generalized coordinates
@@ -654,6 +805,21 @@ public:
         bool updateKin = true
     );
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the vertices of the mesh for all segments in global reference frame
+    /// \param Q The generalized coordinates
+    /// \param pointsOut The vertices of each segment, resized only if their sizes do not match the meshes
+    /// \param updateKin If the kinematics of the model should be computed
+    ///
+    /// Once pointsOut has the right size, nothing is allocated
+    ///
+    void meshPoints(
+        const GeneralizedCoordinates &Q,
+        std::vector<std::vector<utils::Point3d>>& pointsOut,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Return the mesh faces for all the segments
     /// \return The mesh faces for all the segments
@@ -708,6 +874,19 @@ public:
         const GeneralizedCoordinates &Q,
         bool updateKin = true);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the mass matrix at a given position Q
+    /// \param Q The generalized coordinates
+    /// \param massMatrix The mass matrix, resized only if it is not nbQddot x nbQddot
+    /// \param updateKin If the kinematics should be updated
+    ///
+    void massMatrix(
+        const GeneralizedCoordinates &Q,
+        utils::Matrix &massMatrix,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Get the inverse mass matrix at a given position Q
     /// \param Q The generalized coordinates
@@ -718,6 +897,21 @@ public:
         const rigidbody::GeneralizedCoordinates &Q,
         bool updateKin = true);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the inverse mass matrix at a given position Q
+    /// \param Q The generalized coordinates
+    /// \param Minv The inverse mass matrix, resized only if it is not nbQddot x nbQddot
+    /// \param updateKin If the kinematics should be updated
+    ///
+    /// Once Minv has the right size, nothing is allocated
+    ///
+    void massMatrixInverse(
+        const rigidbody::GeneralizedCoordinates &Q,
+        utils::Matrix &Minv,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Calculate the angular momentum of the center of mass
     /// \param Q The generalized coordinates
@@ -769,7 +963,30 @@ public:
         const GeneralizedVelocity &Qdot,
         const rigidbody::GeneralizedAcceleration &Qddot,
         bool updateKin);
-        
+
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the mass, center of mass, angular momentum and energies of the model in one pass
+    /// \param Q The generalized coordinates
+    /// \param Qdot The generalized velocities
+    /// \param Qddot The generalized accelerations, the accelerations are not computed if nullptr
+    /// \param out The output quantities
+    /// \param perSegment If the quantities of each segment should also be filled
+    /// \param updateKin If the kinematics of the model should be computed
+    ///
+    /// The kinematics are updated once and the segments are visited once (twice for the angular
+    /// momentum of each segment), instead of once per quantity with CoM, CoMdot, CoMddot,
+    /// angularMomentum, KineticEnergy and PotentialEnergy.
+    ///
+    void wholeBodyQuantities(
+        const GeneralizedCoordinates &Q,
+        const GeneralizedVelocity &Qdot,
+        const GeneralizedAcceleration *Qddot,
+        WholeBodyQuantities& out,
+        bool perSegment = false,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Calculate the angular velocity of the model around its center of mass.
     /// \param Q The generalized coordinates
@@ -906,6 +1123,24 @@ public:
         const rigidbody::GeneralizedAcceleration& QDDot,
         rigidbody::ExternalForceSet& externalForces
     );
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Interface for the inverse dynamics of RBDL
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param QDDot The Generalzed Acceleration
+    /// \param externalForces External force acting on the system if there are any
+    /// \param Tau The output Generalized Torques (resized only if it is not nbGeneralizedTorque)
+    ///
+    /// With a force set updated in place at each frame (setZero and addToBody), nothing is allocated
+    ///
+    void InverseDynamics(const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const rigidbody::GeneralizedAcceleration& QDDot,
+        rigidbody::ExternalForceSet& externalForces,
+        GeneralizedTorque& Tau
+    );
+#endif
 
     ///
     /// \brief Interface to NonLinearEffect
@@ -929,6 +1164,21 @@ public:
         const GeneralizedVelocity& QDot,
         rigidbody::ExternalForceSet& externalForces
     );
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Interface to NonLinearEffect
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param externalForces External force acting on the system if there are any
+    /// \param Tau The output Generalized Torques of the bias effects (resized only if it is not nbGeneralizedTorque)
+    ///
+    void NonLinearEffect(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        rigidbody::ExternalForceSet& externalForces,
+        GeneralizedTorque& Tau
+    );
+#endif
 
     ///
     /// \brief Interface for the forward dynamics of RBDL
@@ -957,6 +1207,50 @@ public:
         rigidbody::ExternalForceSet& externalForces
     );
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Compute the derivatives of the inverse dynamics
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param QDDot The Generalized Accelerations
+    /// \param dTau_dQ The derivative of the torques with respect to Q
+    /// \param dTau_dQDot The derivative of the torques with respect to QDot
+    /// \param dTau_dQDDot The derivative of the torques with respect to QDDot (the mass matrix)
+    ///
+    /// The derivatives are propagated through the recursive Newton-Euler algorithm, one dof at a
+    /// time, on the subtree the dof moves. The matrices are resized only if they are not
+    /// nbQddot x nbQddot. The dynamics are those without external forces, so models with soft
+    /// contacts or quaternions are not supported
+    ///
+    void InverseDynamicsDerivatives(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedAcceleration& QDDot,
+        utils::Matrix& dTau_dQ,
+        utils::Matrix& dTau_dQDot,
+        utils::Matrix& dTau_dQDDot);
+
+    ///
+    /// \brief Compute the derivatives of the forward dynamics
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param Tau The Generalized Torques
+    /// \param dQDDot_dQ The derivative of the accelerations with respect to Q
+    /// \param dQDDot_dQDot The derivative of the accelerations with respect to QDot
+    /// \param dQDDot_dTau The derivative of the accelerations with respect to Tau (the inverse mass matrix)
+    ///
+    /// As ID(Q, QDot, FD(Q, QDot, Tau)) = Tau, the derivatives are -Minv times those of the inverse
+    /// dynamics evaluated at the accelerations of the forward dynamics. The same restrictions apply
+    ///
+    void ForwardDynamicsDerivatives(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedTorque& Tau,
+        utils::Matrix& dQDDot_dQ,
+        utils::Matrix& dQDDot_dQDot,
+        utils::Matrix& dQDDot_dTau);
+#endif
+
     ///
     /// \brief Biorbd's implementation of forward dynamics with a free floating base
     /// \param Q The Generalized Coordinates
@@ -969,6 +1263,25 @@ public:
         const GeneralizedVelocity& QDot,
         const GeneralizedAcceleration& QJointsDDot);
 
+#if !defined(BIORBD_USE_CASADI_MATH) && !defined(SWIG)
+    ///
+    /// \brief Biorbd's implementation of forward dynamics with a free floating base
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param QJointsDDot The Generalized Accelerations of the joints (no root)
+    /// \param QRootDDot The output Generalized Accelerations of the root (resized only if it is not nbRoot)
+    ///
+    /// Only the root rows of the dynamics are computed: one pass of the recursive Newton-Euler
+    /// algorithm with null root accelerations gives the root nonlinear effects, and the composite
+    /// inertias of the root bodies give the root block of the mass matrix
+    ///
+    void ForwardDynamicsFreeFloatingBase(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedAcceleration& QJointsDDot,
+        GeneralizedAcceleration& QRootDDot);
+#endif
+
     ///
     /// \brief Interface for the forward dynamics with contact of RBDL
     /// \param Q The Generalized Coordinates
@@ -1026,6 +1339,36 @@ public:
         rigidbody::ExternalForceSet& externalForces
     );
 
+    ///
+    /// \brief Forward dynamics with contact, solved with the constraint solver of the model
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param Tau The Generalized Torques
+    /// \return The Generalized Accelerations
+    ///
+    /// The solver is chosen with Contacts::setConstraintSolver. The constraint set of the model
+    /// is filled with the results (see Contacts::getForce)
+    ///
+    rigidbody::GeneralizedAcceleration ForwardDynamicsConstraints(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedTorque& Tau
+    );
+    ///
+    /// \brief Forward dynamics with contact, solved with the constraint solver of the model
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param Tau The Generalized Torques
+    /// \param externalForces External force acting on the system if there are any
+    /// \return The Generalized Accelerations
+    ///
+    rigidbody::GeneralizedAcceleration ForwardDynamicsConstraints(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedTorque& Tau,
+        rigidbody::ExternalForceSet& externalForces
+    );
+
     ///
     /// \brief Interface for contacts of the forward dynamics with contact of RBDL
     /// \param Q The Generalized Coordinates
@@ -1074,6 +1417,28 @@ public:
         const GeneralizedCoordinates& Q,
         const GeneralizedVelocity& QDotPre);
 
+    ///
+    /// \brief Compute the QDot post from an impact, solved with the direct method
+    /// \param Q The Generalized Coordinates
+    /// \param QDotPre The Generalized Velocities before impact
+    /// \param CS The constraint set active after the impact (it must be bound to the model)
+    /// \return The Generalized Velocities post acceleration
+    ///
+    GeneralizedVelocity ComputeConstraintImpulsesDirect(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDotPre,
+        rigidbody::Contacts& CS);
+
+    ///
+    /// \brief Compute the QDot post from an impact, solved with the constraint solver of the model
+    /// \param Q The Generalized Coordinates
+    /// \param QDotPre The Generalized Velocities before impact
+    /// \return The Generalized Velocities post acceleration
+    ///
+    GeneralizedVelocity ComputeConstraintImpulses(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDotPre);
+
 protected:
     std::shared_ptr<std::vector<Segment>>
             m_segments; ///< All the articulations
@@ -1089,6 +1454,46 @@ protected:
     m_nRotAQuat; ///< The number of segments per quaternion
     std::shared_ptr<bool>
     m_isKinematicsComputed; ///< If the kinematics are computed
+    std::shared_ptr<utils::Vector>
+    m_kinematicsQ; ///< The generalized coordinates of the last kinematics update
+    std::shared_ptr<utils::Vector>
+    m_kinematicsQdot; ///< The generalized velocities of the last kinematics update
+    std::shared_ptr<utils::Vector>
+    m_kinematicsQddot; ///< The generalized accelerations of the last kinematics update
+    std::shared_ptr<int>
+    m_kinematicsLevel; ///< What is up to date in the kinematics (0: nothing, 1: positions, 2: velocities, 3: accelerations)
+    std::shared_ptr<size_t>
+    m_nbKinematicsUpdates; ///< The number of kinematics updates performed
+    std::shared_ptr<size_t>
+    m_nbKinematicsUpdatesElided; ///< The number of kinematics updates skipped
+    std::shared_ptr<size_t>
+    m_nbKinematicsBodiesUpdated; ///< The number of body positions recomputed
+    std::shared_ptr<std::vector<bool>>
+    m_kinematicsDirtyDof; ///< The dof which changed since the last positions update
+    std::shared_ptr<std::vector<bool>>
+    m_kinematicsDirtyBodies; ///< The bodies whose position must be recomputed
+    std::shared_ptr<rigidbody::ExternalForceSet>
+    m_defaultExternalForces; ///< The external forces used when none are provided (bound to this model)
+    std::shared_ptr<std::vector<size_t>>
+    m_dofSubTreesStart; ///< Where the dof subtree of each rbdl body (but the base) starts in m_dofSubTrees, followed by the end of the last one
+    std::shared_ptr<std::vector<size_t>>
+    m_dofSubTrees; ///< The dof of each rbdl body and of its descendants, one body after the other
+#ifndef BIORBD_USE_CASADI_MATH
+    std::shared_ptr<std::vector<RigidBodyDynamics::Math::MatrixNd>>
+    m_massMatrixInverseF; ///< The 6 x nbQddot F matrix of each rbdl body used by massMatrixInverse
+    std::shared_ptr<utils::Vector>
+    m_freeFloatingBaseQDDot; ///< The accelerations with null root accelerations used by ForwardDynamicsFreeFloatingBase
+    std::shared_ptr<utils::Vector>
+    m_freeFloatingBaseTau; ///< The torques of the inverse dynamics used by ForwardDynamicsFreeFloatingBase
+    std::shared_ptr<utils::Matrix>
+    m_freeFloatingBaseMassMatrix; ///< The root block of the mass matrix used by ForwardDynamicsFreeFloatingBase
+    std::shared_ptr<std::vector<RigidBodyDynamics::Math::MatrixNd>>
+    m_bodyJacobians; ///< The 6 x nbQdot jacobian of the origin of each rbdl body, in the global reference frame
+    std::shared_ptr<std::vector<bool>>
+    m_isBodyJacobianComputed; ///< If the jacobian of each rbdl body is up to date with its position
+    std::shared_ptr<size_t>
+    m_nbBodyJacobiansComputed; ///< The number of body jacobians computed
+#endif
     std::shared_ptr<utils::Scalar>
     m_totalMass; ///< Mass of all the bodies combined
 
@@ -1124,6 +1529,84 @@ protected:
         const std::vector<utils::RotoTrans> &RT,
         size_t idx) const;
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Return if a generalized state is exactly the one the kinematics were updated with
+    /// \param current The generalized state to update the kinematics with
+    /// \param previous The generalized state the kinematics were last updated with
+    /// \return If both states are the same
+    ///
+    static bool isSameState(
+        const utils::Vector &current,
+        const utils::Vector &previous);
+#endif
+
+    ///
+    /// \brief Return the external forces used when none are provided, created on first use
+    /// \return The default external forces of the model
+    ///
+    /// The joints must be part of a Model (see completeModel). The set is never given out, so
+    /// it stays empty and the overloads without external forces stay stateless
+    ///
+    rigidbody::ExternalForceSet& defaultExternalForces();
+
+    ///
+    /// \brief Return the complete model the joints are part of
+    /// \return The complete model, nullptr if the joints are not part of a Model
+    ///
+    virtual BIORBD_NAMESPACE::Model* completeModel();
+
+    ///
+    /// \brief Forward dynamics with contact solved with a given solver
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param Tau The Generalized Torques
+    /// \param CS The Constraint set that will be filled
+    /// \param externalForces External force acting on the system
+    /// \param solver The solver to use
+    /// \return The Generalized Accelerations
+    ///
+    rigidbody::GeneralizedAcceleration computeForwardDynamicsConstraints(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedTorque& Tau,
+        Contacts& CS,
+        rigidbody::ExternalForceSet& externalForces,
+        CONSTRAINT_SOLVER solver);
+
+#ifndef BIORBD_USE_CASADI_MATH
+
+    ///
+    /// \brief Compute the derivatives of the inverse dynamics with respect to Q and QDot
+    /// \param Q The Generalized Coordinates
+    /// \param QDot The Generalized Velocities
+    /// \param QDDot The Generalized Accelerations
+    /// \param dTau_dQ The derivative of the torques with respect to Q
+    /// \param dTau_dQDot The derivative of the torques with respect to QDot
+    ///
+    /// The inverse dynamics are computed first, the model then holds the state they were
+    /// computed at
+    ///
+    void inverseDynamicsDerivatives(
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedAcceleration& QDDot,
+        utils::Matrix& dTau_dQ,
+        utils::Matrix& dTau_dQDot);
+
+    ///
+    /// \brief Mark the jacobians of all the bodies as outdated
+    ///
+    void invalidateBodyJacobians();
+
+    ///
+    /// \brief Recompute the positions of the bodies moved by the dof of m_kinematicsDirtyDof
+    /// \param Q The generalized coordinates
+    ///
+    void updateDirtySubtrees(
+        const GeneralizedCoordinates &Q);
+#endif
+
 public:
     ///
     /// \brief Check for the Generalized coordinates, velocities, acceleration and torque dimensions
@@ -11,6 +11,7 @@ namespace rigidbody
 {
 class Markers;
 class NodeSegment;
+class BlockJacobian;
 
 ///
 /// \brief Class Kinematic reconstruction algorithm using an Extended Kalman Filter using skin markers
@@ -129,6 +130,9 @@ protected:
     std::shared_ptr<utils::Matrix>
     m_PpInitial; ///< Initial covariance matrix
     std::shared_ptr<bool> m_firstIteration; ///< If first iteration was done
+#ifndef BIORBD_USE_CASADI_MATH
+    std::shared_ptr<BlockJacobian> m_jacobian; ///< The jacobian of the technical markers, reused at each frame
+#endif
 };
 
 }
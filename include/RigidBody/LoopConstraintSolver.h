@@ -0,0 +1,164 @@
+#ifndef BIORBD_RIGIDBODY_LOOP_CONSTRAINT_SOLVER_H
+#define BIORBD_RIGIDBODY_LOOP_CONSTRAINT_SOLVER_H
+
+#include <vector>
+#include "biorbdConfig.h"
+#include "Utils/Matrix.h"
+#include "Utils/Vector.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace utils
+{
+class SpatialVector;
+}
+
+namespace rigidbody
+{
+class Joints;
+class Contacts;
+class GeneralizedCoordinates;
+class GeneralizedVelocity;
+class GeneralizedAcceleration;
+class GeneralizedTorque;
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Solve the constrained dynamics of a closed-chain model and extract the forces of its loop constraints
+///
+/// The dynamics are solved with the direct method: the system [H G^T; G 0] is factorized, then
+/// solved for the accelerations and the Lagrange multipliers. The factorization is kept and only
+/// computed again when the system changes (that is when the generalized coordinates or the
+/// inertia of the model change), and the forces of the loop constraints are extracted from the
+/// multipliers of the same solve.
+///
+/// The drift of the loop constraints can be corrected with a Baumgarte stabilization of the
+/// accelerations (added to the one declared in the model for each constraint, if any) and by
+/// projecting the generalized coordinates and velocities back onto the constraints.
+///
+class BIORBD_API LoopConstraintSolver
+{
+public:
+    ///
+    /// \brief Construct a solver without stabilization
+    ///
+    LoopConstraintSolver();
+
+    ///
+    /// \brief Deep copy of the solver
+    /// \return A deep copy of the solver
+    ///
+    LoopConstraintSolver DeepCopy() const;
+
+    ///
+    /// \brief Deep copy of the solver (the factorization is computed again on next use)
+    /// \param other The solver to copy
+    ///
+    void DeepCopy(
+        const LoopConstraintSolver& other);
+
+    ///
+    /// \brief Set the Baumgarte stabilization of the loop constraints: G QDDot = gamma - 2 alpha G QDot - beta^2 error
+    /// \param alpha The gain on the velocity error (0 to disable)
+    /// \param beta The gain on the position error (0 to disable)
+    ///
+    void setBaumgarteStabilization(
+        double alpha,
+        double beta);
+
+    ///
+    /// \brief Return the gain on the velocity error of the Baumgarte stabilization
+    /// \return The gain on the velocity error
+    ///
+    double baumgarteAlpha() const;
+
+    ///
+    /// \brief Return the gain on the position error of the Baumgarte stabilization
+    /// \return The gain on the position error
+    ///
+    double baumgarteBeta() const;
+
+    ///
+    /// \brief Solve the constrained forward dynamics
+    /// \param model The joint model
+    /// \param CS The constraint set (bound to the model)
+    /// \param Q The generalized coordinates
+    /// \param QDot The generalized velocities
+    /// \param Tau The generalized torques
+    /// \param fExt The external forces of each rbdl body (nullptr if none)
+    /// \param QDDot The output generalized accelerations (resized only if it is not nbQddot)
+    ///
+    /// The forces of the constraints are left in CS.force, as rbdl does
+    ///
+    void forwardDynamics(
+        Joints& model,
+        Contacts& CS,
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        const GeneralizedTorque& Tau,
+        std::vector<RigidBodyDynamics::Math::SpatialVector>* fExt,
+        GeneralizedAcceleration& QDDot);
+
+    ///
+    /// \brief Extract the forces of the loop constraints from the last solve
+    /// \param model The joint model
+    /// \param CS The constraint set the last solve was made with
+    /// \param Q The generalized coordinates of the last solve
+    /// \param QDot The generalized velocities of the last solve
+    /// \param forces The output forces at the predecessor of each loop constraint, in the global reference frame
+    ///
+    void loopConstraintForces(
+        Joints& model,
+        Contacts& CS,
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        std::vector<utils::SpatialVector>& forces);
+
+    ///
+    /// \brief Project the generalized coordinates and velocities onto the constraints
+    /// \param model The joint model
+    /// \param CS The constraint set (bound to the model)
+    /// \param Q The generalized coordinates to project
+    /// \param QDot The generalized velocities to project (onto the constraints at the projected Q)
+    /// \param tolerance The tolerance on the position error
+    /// \param maxNbIterations The maximal number of iterations of the projection of Q
+    /// \return If the projection of Q converged (QDot is left untouched otherwise)
+    ///
+    bool project(
+        Joints& model,
+        Contacts& CS,
+        GeneralizedCoordinates& Q,
+        GeneralizedVelocity& QDot,
+        double tolerance = 1e-12,
+        unsigned int maxNbIterations = 100);
+
+    ///
+    /// \brief Return the number of times the system was factorized
+    /// \return The number of factorizations
+    ///
+    size_t nbFactorizations() const;
+
+protected:
+    double m_alpha; ///< The gain on the velocity error of the Baumgarte stabilization
+    double m_beta; ///< The gain on the position error of the Baumgarte stabilization
+
+    utils::Matrix m_system; ///< The system [H G^T; G 0] which was factorized
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> m_factorization; ///< The factorization of m_system
+    bool m_isFactorized; ///< If m_factorization holds the factorization of m_system
+    size_t m_nbFactorizations; ///< The number of factorizations
+    utils::Vector m_rhs; ///< The right-hand side [Tau - C; gamma]
+    utils::Vector m_solution; ///< The solution [QDDot; -force]
+    utils::Vector m_positionError; ///< The position error of the constraints
+    utils::Vector m_velocityError; ///< The velocity error of the constraints
+    utils::Vector m_weights; ///< The weights of the projection
+
+    std::vector<unsigned int> m_bodyIds; ///< The bodies of the loop constraint given to rbdl
+    std::vector<RigidBodyDynamics::Math::SpatialTransform> m_bodyFrames; ///< The frames of the loop constraint given to rbdl
+    std::vector<RigidBodyDynamics::Math::SpatialVector> m_forces; ///< The forces of the loop constraint given by rbdl
+};
+#endif
+
+}
+}
+
+#endif // BIORBD_RIGIDBODY_LOOP_CONSTRAINT_SOLVER_H
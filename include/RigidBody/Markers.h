@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include "biorbdConfig.h"
+#include "Utils/Point3d.h"
 
 namespace BIORBD_NAMESPACE
 {
@@ -19,6 +20,7 @@ class GeneralizedCoordinates;
 class GeneralizedVelocity;
 class GeneralizedAcceleration;
 class NodeSegment;
+class BlockJacobian;
 
 ///
 /// \brief Holder for the marker set
@@ -166,6 +168,89 @@ public:
     std::vector<NodeSegment> markers(
         bool removeAxis = true);
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Compute all the markers for a whole trial in the global reference frame
+    /// \param Q The generalized coordinates of each frame (nbQ x nbFrames)
+    /// \param markersOut The preallocated output (3*nbMarkers x nbFrames). Marker i of frame f is stored in rows 3*i to 3*i+2 of column f
+    /// \param removeAxis If there are axis to remove from the position variables
+    ///
+    /// The kinematics is updated only once per frame and no memory is allocated inside the frame loop
+    ///
+    void markers(
+        const utils::Matrix& Q,
+        utils::Matrix& markersOut,
+        bool removeAxis = true);
+
+#ifndef SWIG
+    ///
+    /// \brief Compute all the markers at a given Q in the global reference frame
+    /// \param Q The generalized coordinates
+    /// \param markersOut The position of each marker, resized only if its size is not nbMarkers
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    /// Once markersOut has the right size, nothing is allocated
+    ///
+    void markers(
+        const GeneralizedCoordinates &Q,
+        std::vector<utils::Point3d>& markersOut,
+        bool removeAxis = true,
+        bool updateKin = true);
+
+    ///
+    /// \brief Compute all the technical markers at a given Q in the global reference frame
+    /// \param Q The generalized coordinates
+    /// \param markersOut The position of each technical marker, resized only if its size is not nbTechnicalMarkers
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    /// Once markersOut has the right size, nothing is allocated
+    ///
+    void technicalMarkers(
+        const GeneralizedCoordinates &Q,
+        std::vector<utils::Point3d>& markersOut,
+        bool removeAxis = true,
+        bool updateKin = true);
+
+    ///
+    /// \brief Compute the linear velocity of all the markers
+    /// \param Q The generalized coordinates
+    /// \param Qdot The generalized velocities
+    /// \param markersOut The velocity of each marker, resized only if its size is not nbMarkers
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    /// Once markersOut has the right size, nothing is allocated
+    ///
+    void markersVelocity(
+        const GeneralizedCoordinates &Q,
+        const GeneralizedVelocity &Qdot,
+        std::vector<utils::Point3d>& markersOut,
+        bool removeAxis = true,
+        bool updateKin = true);
+
+    ///
+    /// \brief Compute the acceleration of all the markers
+    /// \param Q The generalized coordinates
+    /// \param Qdot The generalized velocities
+    /// \param Qddot The generalized accelerations
+    /// \param markersOut The acceleration of each marker, resized only if its size is not nbMarkers
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    /// Once markersOut has the right size, nothing is allocated
+    ///
+    void markerAcceleration(
+        const GeneralizedCoordinates &Q,
+        const GeneralizedVelocity &Qdot,
+        const GeneralizedAcceleration &Qddot,
+        std::vector<utils::Point3d>& markersOut,
+        bool removeAxis = true,
+        bool updateKin = true);
+#endif
+#endif
+
     ///
     /// \brief Return the linear velocity of a marker
     /// \param Q The generalized coordinates
@@ -372,6 +457,46 @@ public:
         bool removeAxis=true,
         bool updateKin = true);
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Return the structure of the jacobian of the markers, all blocks set to zero
+    /// \return The jacobian of the markers, to be filled by markersJacobian
+    ///
+    BlockJacobian markersJacobianPattern();
+
+    ///
+    /// \brief Return the structure of the jacobian of the technical markers, all blocks set to zero
+    /// \return The jacobian of the technical markers, to be filled by technicalMarkersJacobian
+    ///
+    BlockJacobian technicalMarkersJacobianPattern();
+
+    ///
+    /// \brief Compute the jacobian of the markers, only over the dof each marker depends on
+    /// \param Q The generalized coordinates
+    /// \param jacobian The jacobian to fill, as returned by markersJacobianPattern
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    void markersJacobian(
+        const GeneralizedCoordinates &Q,
+        BlockJacobian& jacobian,
+        bool removeAxis=true,
+        bool updateKin = true);
+
+    ///
+    /// \brief Compute the jacobian of the technical markers, only over the dof each marker depends on
+    /// \param Q The generalized coordinates
+    /// \param jacobian The jacobian to fill, as returned by technicalMarkersJacobianPattern
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    ///
+    void technicalMarkersJacobian(
+        const GeneralizedCoordinates &Q,
+        BlockJacobian& jacobian,
+        bool removeAxis=true,
+        bool updateKin = true);
+#endif
+
     ///
     /// \brief Return the jacobian of a chosen marker
     /// \param Q The generalized coordinates of the model
@@ -416,6 +541,31 @@ protected:
         bool updateKin,
         bool lookForTechnical); // Retourne la jacobienne des markers
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Return the structure of the jacobian of the markers
+    /// \param lookForTechnical Check if only technical markers are to be computed
+    /// \return The jacobian of the markers with all blocks set to zero
+    ///
+    BlockJacobian markersJacobianPattern(
+        bool lookForTechnical);
+
+    ///
+    /// \brief Compute the jacobian of the markers, only over the dof each marker depends on
+    /// \param Q The generalized coordinates
+    /// \param jacobian The jacobian to fill
+    /// \param removeAxis If there are axis to remove from the position variables
+    /// \param updateKin If the model should be updated
+    /// \param lookForTechnical Check if only technical markers are to be computed
+    ///
+    void markersJacobian(
+        const GeneralizedCoordinates &Q,
+        BlockJacobian& jacobian,
+        bool removeAxis,
+        bool updateKin,
+        bool lookForTechnical);
+#endif
+
     std::shared_ptr<std::vector<NodeSegment>>
             m_marks; ///< The markers
 
@@ -1,11 +1,65 @@
 #ifndef BIORBD_RIGIDBODY_ENUMS_H
 #define BIORBD_RIGIDBODY_ENUMS_H
 
-namespace biorbd
+namespace BIORBD_NAMESPACE
 {
 namespace rigidbody
 {
 
+///
+/// \brief The solvers of the constrained forward dynamics and impulses available
+///
+enum CONSTRAINT_SOLVER {
+    CONSTRAINT_SOLVER_DIRECT, ///< Solve the full system with the constraints at once
+    CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE, ///< Range-space method using the sparsity of the mass matrix
+    CONSTRAINT_SOLVER_NULL_SPACE ///< Null-space method
+};
+
+///
+/// \brief CONSTRAINT_SOLVER_toStr returns the solver name in a string format
+/// \param solver The solver to convert to string
+/// \return The name of the solver
+///
+inline const char* CONSTRAINT_SOLVER_toStr(CONSTRAINT_SOLVER solver)
+{
+    switch (solver) {
+    case CONSTRAINT_SOLVER_DIRECT:
+        return "Direct";
+    case CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE:
+        return "RangeSpaceSparse";
+    case CONSTRAINT_SOLVER_NULL_SPACE:
+        return "NullSpace";
+    default:
+        return "NoType";
+    }
+}
+
+
+///
+/// \brief The obstacles the soft contacts can collide with
+///
+enum SOFT_CONTACT_OBSTACLE {
+    SOFT_CONTACT_OBSTACLE_PLANE, ///< A plane defined by a point and its normal, the side of the normal is free
+    SOFT_CONTACT_OBSTACLE_SPHERE ///< A sphere defined by its center and its radius, the outside is free
+};
+
+///
+/// \brief SOFT_CONTACT_OBSTACLE_toStr returns the obstacle name in a string format
+/// \param obstacle The obstacle to convert to string
+/// \return The name of the obstacle
+///
+inline const char* SOFT_CONTACT_OBSTACLE_toStr(SOFT_CONTACT_OBSTACLE obstacle)
+{
+    switch (obstacle) {
+    case SOFT_CONTACT_OBSTACLE_PLANE:
+        return "Plane";
+    case SOFT_CONTACT_OBSTACLE_SPHERE:
+        return "Sphere";
+    default:
+        return "NoType";
+    }
+}
+
 }
 }
 
@@ -0,0 +1,230 @@
+#ifndef BIORBD_RIGIDBODY_SOFT_CONTACT_ENGINE_H
+#define BIORBD_RIGIDBODY_SOFT_CONTACT_ENGINE_H
+
+#include <memory>
+#include <vector>
+#include "biorbdConfig.h"
+#include "Utils/Scalar.h"
+#include "RigidBody/RigidBodyEnums.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace utils
+{
+class SpatialVector;
+class Vector3d;
+}
+
+namespace rigidbody
+{
+class Joints;
+class SoftContacts;
+class GeneralizedCoordinates;
+class GeneralizedVelocity;
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Evaluate the forces of all the soft contact spheres of a model against a set of obstacles
+///
+/// The parameters of the spheres, their position in the frame of the rbdl body which moves them
+/// and the rbdl body which receives their force are gathered once, in structure of arrays sorted
+/// by moving body. At each evaluation, the spheres are placed from the kinematics already in the
+/// model, then each obstacle goes through a broadphase, which skips all the spheres of a body when
+/// the bounding sphere of that body is farther than a margin from the obstacle and then each
+/// sphere farther than the margin, and a branchless kernel computes the Hunt-Crossley and
+/// friction forces of the remaining pairs (the same model as SoftContactSphere::computeForce).
+///
+/// By default, the only obstacle is the ground plane (z = 0, normal along z) used by
+/// SoftContactSphere::computeForce. The description of the spheres is gathered again after
+/// invalidate is called (SoftContacts does so when a contact is added or accessed for writing).
+///
+class BIORBD_API SoftContactEngine
+{
+public:
+    ///
+    /// \brief Construct an engine with the ground plane as only obstacle
+    ///
+    SoftContactEngine();
+
+    ///
+    /// \brief Deep copy of the engine
+    /// \return A deep copy of the engine
+    ///
+    SoftContactEngine DeepCopy() const;
+
+    ///
+    /// \brief Deep copy of the engine (the description of the spheres is gathered again on next use)
+    /// \param other The engine to copy
+    ///
+    void DeepCopy(
+        const SoftContactEngine& other);
+
+    ///
+    /// \brief Add a plane obstacle
+    /// \param point A point of the plane in the global reference frame
+    /// \param normal The normal of the plane, pointing to the free side
+    ///
+    void addPlane(
+        const utils::Vector3d& point,
+        const utils::Vector3d& normal);
+
+    ///
+    /// \brief Add a sphere obstacle
+    /// \param center The center of the sphere in the global reference frame
+    /// \param radius The radius of the sphere
+    ///
+    void addSphere(
+        const utils::Vector3d& center,
+        const utils::Scalar& radius);
+
+    ///
+    /// \brief Remove all the obstacles, including the ground plane
+    ///
+    void clearObstacles();
+
+    ///
+    /// \brief Return the number of obstacles
+    /// \return The number of obstacles
+    ///
+    size_t nbObstacles() const;
+
+    ///
+    /// \brief Return the type of an obstacle
+    /// \param idx The index of the obstacle
+    /// \return The type of the obstacle
+    ///
+    SOFT_CONTACT_OBSTACLE obstacleType(
+        size_t idx) const;
+
+    ///
+    /// \brief Set the distance beyond which a sphere is not evaluated against an obstacle
+    /// \param margin The margin (default 0.1 m)
+    ///
+    /// Beyond the default margin, the smoothing of the normal force of SoftContactSphere is
+    /// below 1e-26, so only its 1e-16 floor is dropped.
+    ///
+    void setBroadphaseMargin(
+        const utils::Scalar& margin);
+
+    ///
+    /// \brief Return the distance beyond which a sphere is not evaluated against an obstacle
+    /// \return The margin
+    ///
+    utils::Scalar broadphaseMargin() const;
+
+    ///
+    /// \brief Gather the description of the spheres again on next use
+    ///
+    void invalidate();
+
+    ///
+    /// \brief Add the forces of the soft contacts at the origin to the spatial vector of each rbdl body
+    /// \param model The joint model
+    /// \param contacts The soft contacts of the model
+    /// \param Q The generalized coordinates
+    /// \param QDot The generalized velocities
+    /// \param out The spatial vectors of each rbdl body (the first one is the universe)
+    /// \param updateKin If the kinematics of the model should be computed
+    ///
+    void addForces(
+        Joints& model,
+        const SoftContacts& contacts,
+        const GeneralizedCoordinates& Q,
+        const GeneralizedVelocity& QDot,
+        std::vector<utils::SpatialVector>& out,
+        bool updateKin = true);
+
+    ///
+    /// \brief Return the number of sphere/obstacle pairs which passed the broadphase during the last evaluation
+    /// \return The number of pairs evaluated
+    ///
+    size_t nbPairsEvaluated() const;
+
+protected:
+    ///
+    /// \brief Gather the description of the spheres, sorted by moving rbdl body
+    /// \param model The joint model
+    /// \param contacts The soft contacts of the model
+    ///
+    void build(
+        Joints& model,
+        const SoftContacts& contacts);
+
+    ///
+    /// \brief Select the spheres close enough to an obstacle and compute their normal and penetration
+    /// \param obstacle The index of the obstacle
+    /// \return The number of candidates
+    ///
+    size_t broadphase(
+        size_t obstacle);
+
+    ///
+    /// \brief Compute the force and application point of each candidate
+    /// \param nbCandidates The number of candidates
+    ///
+    void computeCandidateForces(
+        size_t nbCandidates);
+
+    ///
+    /// \brief The columns of the state of the spheres
+    ///
+    enum STATE_FIELD {
+        STATE_X, STATE_Y, STATE_Z, ///< Position of the center
+        STATE_DX, STATE_DY, STATE_DZ, ///< Velocity of the center
+        STATE_WX, STATE_WY, STATE_WZ, ///< Angular velocity
+        NB_STATE_FIELDS
+    };
+
+    ///
+    /// \brief The columns of the sphere/obstacle pairs given to the kernel
+    ///
+    enum PAIR_FIELD {
+        PAIR_X, PAIR_Y, PAIR_Z, ///< Position of the center of the sphere
+        PAIR_DX, PAIR_DY, PAIR_DZ, ///< Velocity of the center of the sphere
+        PAIR_WX, PAIR_WY, PAIR_WZ, ///< Angular velocity of the sphere
+        PAIR_NX, PAIR_NY, PAIR_NZ, ///< Contact normal, pointing from the obstacle to the sphere
+        PAIR_PENETRATION, ///< Penetration of the sphere in the obstacle
+        PAIR_RADIUS, PAIR_STIFFNESS, PAIR_DAMPING, ///< Parameters of the sphere
+        PAIR_MU_STATIC, PAIR_MU_DYNAMIC, PAIR_MU_VISCOUS, PAIR_TRANSITION_VELOCITY, ///< Friction of the sphere
+        PAIR_MX, PAIR_MY, PAIR_MZ, ///< Output moment at the origin
+        PAIR_FX, PAIR_FY, PAIR_FZ, ///< Output force
+        NB_PAIR_FIELDS
+    };
+
+    // Obstacles
+    std::vector<SOFT_CONTACT_OBSTACLE> m_obstacleTypes; ///< The type of each obstacle
+    std::vector<double> m_obstacleData; ///< Point and normal of each plane, center and radius of each sphere (6 per obstacle)
+    double m_margin; ///< The broadphase margin
+
+    // Description of the spheres, sorted by moving body
+    bool m_isBuilt; ///< If the description of the spheres is up to date
+    size_t m_nbBodies; ///< The number of rbdl bodies the description was gathered with
+    std::vector<unsigned int> m_body; ///< The rbdl body which moves each sphere
+    std::vector<unsigned int> m_forceBody; ///< The rbdl body which receives the force of each sphere
+    std::vector<double> m_localX; ///< X of each sphere in the frame of its moving body
+    std::vector<double> m_localY; ///< Y of each sphere in the frame of its moving body
+    std::vector<double> m_localZ; ///< Z of each sphere in the frame of its moving body
+    std::vector<double> m_radius; ///< The radius of each sphere
+    std::vector<double> m_stiffness; ///< The stiffness of each sphere
+    std::vector<double> m_damping; ///< The damping of each sphere
+    std::vector<double> m_muStatic; ///< The static friction coefficient of each sphere
+    std::vector<double> m_muDynamic; ///< The dynamic friction coefficient of each sphere
+    std::vector<double> m_muViscous; ///< The viscous friction coefficient of each sphere
+    std::vector<double> m_transitionVelocity; ///< The friction transition velocity of each sphere
+    std::vector<size_t> m_groupStart; ///< The first sphere of each moving body (plus the total as last element)
+    std::vector<double> m_groupCenter; ///< The center of the bounding sphere of each moving body, in its frame (3 per body)
+    std::vector<double> m_groupRadius; ///< The radius of the bounding sphere of each moving body
+    std::vector<double> m_groupWorldCenter; ///< The center of the bounding sphere of each moving body in the global reference frame (3 per body)
+
+    // State of the spheres and pairs of the current evaluation
+    std::vector<double> m_state; ///< The state of the spheres in the global reference frame (one column of nbSpheres per STATE_FIELD)
+    std::vector<size_t> m_candidates; ///< The sphere of each pair which passed the broadphase
+    std::vector<double> m_pairs; ///< The pairs which passed the broadphase (one column of nbSpheres per PAIR_FIELD)
+    size_t m_nbPairsEvaluated; ///< The number of pairs evaluated during the last evaluation
+};
+#endif
+
+}
+}
+
+#endif // BIORBD_RIGIDBODY_SOFT_CONTACT_ENGINE_H
@@ -10,6 +10,7 @@ namespace BIORBD_NAMESPACE
 {
 namespace utils {
 class String;
+class SpatialVector;
 }
 
 namespace rigidbody
@@ -18,6 +19,7 @@ class GeneralizedCoordinates;
 class GeneralizedVelocity;
 class SoftContactNode;
 class NodeSegment;
+class SoftContactEngine;
 
 ///
 /// \brief Holder for the biorbd contact set
@@ -73,9 +75,19 @@ public:
     /// \param idx The index of the marker
     /// \return The contact of index idx
     ///
+    /// As the contact may be modified, the soft contact engine gathers the contacts again on next use
+    ///
     SoftContactNode& softContact(
         size_t  idx);
 
+    ///
+    /// \brief Return a specified contact
+    /// \param idx The index of the marker
+    /// \return The contact of index idx
+    ///
+    const SoftContactNode& softContact(
+        size_t  idx) const;
+
     ///
     /// \brief Return a specified contact at a given position Q
     /// \param Q The generalized coordinates
@@ -164,8 +176,42 @@ public:
     std::vector<size_t> segmentSoftContactIdx(
             size_t  idx) const;
 
+#ifndef BIORBD_USE_CASADI_MATH
+    ///
+    /// \brief Return the engine which evaluates the forces of all the contacts (to add obstacles or set its broadphase)
+    /// \return The soft contact engine
+    ///
+    SoftContactEngine& softContactEngine();
+
+#ifndef SWIG
+    ///
+    /// \brief Add the forces of all the contacts at the origin to the spatial vector of each rbdl body
+    /// \param Q The generalized coordinates
+    /// \param Qdot The generalized velocities
+    /// \param out The spatial vectors of each rbdl body (the first one is the universe)
+    /// \param updateKin If the model should be updated
+    ///
+    void addSoftContactForces(
+        const GeneralizedCoordinates &Q,
+        const GeneralizedVelocity &Qdot,
+        std::vector<utils::SpatialVector>& out,
+        bool updateKin = true);
+#endif
+#endif
+
 protected:
+    ///
+    /// \brief Give the soft contacts their own copy of what is written during an evaluation
+    ///
+    /// Meant for a shallow copy: the contacts stay shared with the ones they were copied from,
+    /// while the engine, which holds the gathered contacts and the evaluation buffers, is copied.
+    ///
+    void detachEvaluationState();
+
     std::shared_ptr<std::vector<std::shared_ptr<SoftContactNode>>> m_softContacts; ///< The contacts
+#ifndef BIORBD_USE_CASADI_MATH
+    std::shared_ptr<SoftContactEngine> m_softContactEngine; ///< The engine evaluating the forces of all the contacts
+#endif
 
 };
 
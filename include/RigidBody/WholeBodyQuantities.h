@@ -0,0 +1,43 @@
+#ifndef BIORBD_RIGIDBODY_WHOLE_BODY_QUANTITIES_H
+#define BIORBD_RIGIDBODY_WHOLE_BODY_QUANTITIES_H
+
+#include <vector>
+#include "biorbdConfig.h"
+#include "Utils/Scalar.h"
+#include "Utils/Vector3d.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace rigidbody
+{
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief The whole-body quantities filled by Joints::wholeBodyQuantities
+///
+/// The quantities are expressed in the global reference frame. The accelerations are only
+/// filled when the generalized accelerations are given and the per segment quantities are only
+/// filled when requested (they are left untouched otherwise). The vectors are resized to the
+/// number of segments the first time only, so the same structure can be filled at each frame
+/// without reallocation.
+///
+struct BIORBD_API WholeBodyQuantities {
+    utils::Scalar mass; ///< The total mass
+    utils::Vector3d CoM; ///< The position of the center of mass
+    utils::Vector3d CoMdot; ///< The velocity of the center of mass
+    utils::Vector3d CoMddot; ///< The acceleration of the center of mass
+    utils::Vector3d angularMomentum; ///< The angular momentum about the center of mass
+    utils::Scalar kineticEnergy; ///< The kinetic energy
+    utils::Scalar potentialEnergy; ///< The potential energy
+
+    std::vector<utils::Vector3d> segmentsCoM; ///< The position of the center of mass of each segment
+    std::vector<utils::Vector3d> segmentsCoMdot; ///< The velocity of the center of mass of each segment
+    std::vector<utils::Vector3d> segmentsCoMddot; ///< The acceleration of the center of mass of each segment
+    std::vector<utils::Vector3d> segmentsAngularMomentum; ///< The angular momentum of each segment about the center of mass of the model
+};
+#endif
+
+}
+}
+
+#endif // BIORBD_RIGIDBODY_WHOLE_BODY_QUANTITIES_H
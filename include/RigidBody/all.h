@@ -7,8 +7,10 @@
 #include "RigidBody/SegmentCharacteristics.h"
 #include "RigidBody/Mesh.h"
 #include "RigidBody/Contacts.h"
+#include "RigidBody/LoopConstraintSolver.h"
 #include "RigidBody/ExternalForceSet.h"
 #include "RigidBody/SoftContactSphere.h"
+#include "RigidBody/SoftContactEngine.h"
 #include "RigidBody/GeneralizedCoordinates.h"
 #include "RigidBody/GeneralizedVelocity.h"
 #include "RigidBody/GeneralizedAcceleration.h"
@@ -17,10 +19,12 @@
 #include "RigidBody/IMUs.h"
 #include "RigidBody/Joints.h"
 #include "RigidBody/Markers.h"
+#include "RigidBody/BlockJacobian.h"
 #include "RigidBody/NodeSegment.h"
 #include "RigidBody/RotoTransNodes.h"
 #include "RigidBody/MeshFace.h"
 #include "RigidBody/RigidBodyEnums.h"
+#include "RigidBody/WholeBodyQuantities.h"
 #ifdef MODULE_KALMAN
     #include "RigidBody/KalmanRecons.h"
     #include "RigidBody/KalmanReconsIMU.h"
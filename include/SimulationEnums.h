@@ -0,0 +1,64 @@
+#ifndef BIORBD_SIMULATION_ENUMS_H
+#define BIORBD_SIMULATION_ENUMS_H
+
+#include "biorbdConfig.h"
+
+namespace BIORBD_NAMESPACE
+{
+
+///
+/// \brief The time integrators available to the Simulator
+///
+enum INTEGRATOR {
+    INTEGRATOR_SEMI_IMPLICIT_EULER, ///< Fixed step semi-implicit (symplectic) Euler
+    INTEGRATOR_RK4, ///< Fixed step fourth order Runge-Kutta
+    INTEGRATOR_RK45 ///< Adaptive step Runge-Kutta 4(5) of Dormand-Prince
+};
+
+///
+/// \brief INTEGRATOR_toStr returns the integrator name in a string format
+/// \param integrator The integrator to convert to string
+/// \return The name of the integrator
+///
+inline const char* INTEGRATOR_toStr(INTEGRATOR integrator)
+{
+    switch (integrator) {
+    case INTEGRATOR_SEMI_IMPLICIT_EULER:
+        return "SemiImplicitEuler";
+    case INTEGRATOR_RK4:
+        return "RK4";
+    case INTEGRATOR_RK45:
+        return "RK45";
+    default:
+        return "NoType";
+    }
+}
+
+///
+/// \brief The changes of the active rigid contacts detected by the HybridSimulator
+///
+enum CONTACT_EVENT {
+    CONTACT_EVENT_MAKE, ///< The contact touched the ground and became active
+    CONTACT_EVENT_BREAK ///< The contact stopped pushing on the ground and became inactive
+};
+
+///
+/// \brief CONTACT_EVENT_toStr returns the contact event name in a string format
+/// \param event The contact event to convert to string
+/// \return The name of the contact event
+///
+inline const char* CONTACT_EVENT_toStr(CONTACT_EVENT event)
+{
+    switch (event) {
+    case CONTACT_EVENT_MAKE:
+        return "Make";
+    case CONTACT_EVENT_BREAK:
+        return "Break";
+    default:
+        return "NoType";
+    }
+}
+
+}
+
+#endif // BIORBD_SIMULATION_ENUMS_H
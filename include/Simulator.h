@@ -0,0 +1,411 @@
+#ifndef BIORBD_SIMULATOR_H
+#define BIORBD_SIMULATOR_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "biorbdConfig.h"
+#include "SimulationEnums.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include "Utils/Vector.h"
+
+namespace BIORBD_NAMESPACE
+{
+class Model;
+
+namespace utils
+{
+class Matrix;
+}
+
+namespace rigidbody
+{
+class GeneralizedCoordinates;
+class GeneralizedVelocity;
+class GeneralizedTorque;
+class GeneralizedAcceleration;
+}
+
+#ifdef MODULE_MUSCLES
+namespace internal_forces
+{
+namespace muscles
+{
+class Muscle;
+class State;
+class FatigueModel;
+}
+}
+#endif
+
+///
+/// \brief Integrate the forward dynamics of a model over time
+///
+/// The state is packed as [Q, QDot, muscle activations, fatigue states], where the fatigue
+/// states are the active, fatigued and resting fibers of each muscle which has a dynamic fatigue
+/// state. The controls are packed as [Tau, muscle excitations]. They are either given by a
+/// function of the time and of the state, evaluated at each stage of the integrator, or by a table
+/// with one column per interval, held constant over the interval.
+///
+/// The muscles must have an activation dynamics. Rigid contacts and loop constraints are not
+/// enforced (see HybridSimulator for the rigid contacts). Each thread owns a workspace on the model (see Model::workspace) so the rollouts of a
+/// batch are integrated concurrently.
+///
+class BIORBD_API Simulator
+{
+public:
+    ///
+    /// \brief The controls given by a function of the time and of the state
+    ///
+    /// The function receives the time, the state and must fill the controls (nbControls).
+    ///
+    typedef std::function<void(double, const utils::Vector&, utils::Vector&)> ControlFunction;
+
+    ///
+    /// \brief Construct a simulator
+    /// \param model The model to simulate. It must outlive the simulator and must not be modified while in use
+    /// \param integrator The time integrator
+    /// \param nbThreads The number of threads used for the batches. If 0, the number of hardware threads is used
+    ///
+    Simulator(
+        const Model& model,
+        INTEGRATOR integrator = INTEGRATOR_RK4,
+        size_t nbThreads = 0);
+
+    ///
+    /// \brief Destroy the simulator
+    ///
+    virtual ~Simulator();
+
+    ///
+    /// \brief Return the number of threads used for the batches
+    /// \return The number of threads used for the batches
+    ///
+    size_t nbThreads() const;
+
+    ///
+    /// \brief Set the time integrator
+    /// \param integrator The time integrator
+    ///
+    void setIntegrator(
+        INTEGRATOR integrator);
+
+    ///
+    /// \brief Return the time integrator
+    /// \return The time integrator
+    ///
+    INTEGRATOR integrator() const;
+
+    ///
+    /// \brief Set the number of steps per interval of the fixed step integrators
+    /// \param nbSteps The number of steps per interval
+    ///
+    void setNbSteps(
+        size_t nbSteps);
+
+    ///
+    /// \brief Return the number of steps per interval of the fixed step integrators
+    /// \return The number of steps per interval
+    ///
+    size_t nbSteps() const;
+
+    ///
+    /// \brief Set the tolerances of the adaptive integrator
+    /// \param absoluteTolerance The absolute tolerance on each state
+    /// \param relativeTolerance The relative tolerance on each state
+    ///
+    void setTolerances(
+        double absoluteTolerance,
+        double relativeTolerance);
+
+    ///
+    /// \brief Return the absolute tolerance of the adaptive integrator
+    /// \return The absolute tolerance of the adaptive integrator
+    ///
+    double absoluteTolerance() const;
+
+    ///
+    /// \brief Return the relative tolerance of the adaptive integrator
+    /// \return The relative tolerance of the adaptive integrator
+    ///
+    double relativeTolerance() const;
+
+    ///
+    /// \brief Return the size of the state
+    /// \return The size of the state
+    ///
+    size_t nbStates() const;
+
+    ///
+    /// \brief Return the size of the controls
+    /// \return The size of the controls
+    ///
+    size_t nbControls() const;
+
+    ///
+    /// \brief Return the number of muscle activations in the state
+    /// \return The number of muscle activations in the state
+    ///
+    size_t nbActivations() const;
+
+    ///
+    /// \brief Return the number of fatigue states in the state (three per fatigable muscle)
+    /// \return The number of fatigue states in the state
+    ///
+    size_t nbFatigueStates() const;
+
+    ///
+    /// \brief Return the index of the first muscle activation in the state
+    /// \return The index of the first muscle activation in the state
+    ///
+    size_t activationsIndex() const;
+
+    ///
+    /// \brief Return the index of the first fatigue state in the state
+    /// \return The index of the first fatigue state in the state
+    ///
+    size_t fatigueStatesIndex() const;
+
+    ///
+    /// \brief Pack a state from the generalized coordinates and velocities
+    /// \param Q The generalized coordinates
+    /// \param QDot The generalized velocities
+    /// \return The state
+    ///
+    /// The muscle activations and fatigue states are those of the muscles of the model
+    ///
+    utils::Vector state(
+        const rigidbody::GeneralizedCoordinates& Q,
+        const rigidbody::GeneralizedVelocity& QDot) const;
+
+    ///
+    /// \brief Compute the time derivative of the state
+    /// \param x The state
+    /// \param u The controls
+    /// \param xDot The output time derivative of the state (nbStates)
+    ///
+    void dynamics(
+        const utils::Vector& x,
+        const utils::Vector& u,
+        utils::Vector& xDot);
+
+    ///
+    /// \brief Integrate the model with controls held constant over each interval
+    /// \param x0 The initial state
+    /// \param controls The controls (nbControls x nbIntervals)
+    /// \param dt The duration of an interval
+    /// \param states The output states at each node (nbStates x nbIntervals + 1)
+    ///
+    void simulate(
+        const utils::Vector& x0,
+        const utils::Matrix& controls,
+        double dt,
+        utils::Matrix& states);
+
+    ///
+    /// \brief Integrate the model with controls given by a function
+    /// \param x0 The initial state
+    /// \param control The function of the time and of the state which gives the controls
+    /// \param dt The duration of an interval
+    /// \param states The output states at each node (nbStates x nbIntervals + 1)
+    ///
+    void simulate(
+        const utils::Vector& x0,
+        const ControlFunction& control,
+        double dt,
+        utils::Matrix& states);
+
+    ///
+    /// \brief Integrate many rollouts in parallel, with controls held constant over each interval
+    /// \param x0 The initial state of each rollout (nbStates x nbRollouts)
+    /// \param controls The controls of each rollout (nbControls x nbIntervals)
+    /// \param dt The duration of an interval
+    /// \param states The output states of each rollout (nbStates x nbIntervals + 1)
+    ///
+    void simulateBatch(
+        const utils::Matrix& x0,
+        const std::vector<utils::Matrix>& controls,
+        double dt,
+        std::vector<utils::Matrix>& states);
+
+    ///
+    /// \brief Integrate many rollouts in parallel, with controls given by functions
+    /// \param x0 The initial state of each rollout (nbStates x nbRollouts)
+    /// \param controls The control function of each rollout
+    /// \param dt The duration of an interval
+    /// \param states The output states of each rollout (nbStates x nbIntervals + 1)
+    ///
+    /// Each function is called by one thread at a time, but different functions are called
+    /// concurrently
+    ///
+    void simulateBatch(
+        const utils::Matrix& x0,
+        const std::vector<ControlFunction>& controls,
+        double dt,
+        std::vector<utils::Matrix>& states);
+
+protected:
+    ///
+    /// \brief The per thread data
+    ///
+    struct Workspace {
+        Workspace(const Model& model, size_t nbStates, size_t nbControls);
+        std::shared_ptr<Model> model; ///< The workspace on the model
+        std::shared_ptr<rigidbody::GeneralizedCoordinates> Q; ///< The generalized coordinates of the current stage
+        std::shared_ptr<rigidbody::GeneralizedVelocity> QDot; ///< The generalized velocities of the current stage
+        std::shared_ptr<rigidbody::GeneralizedTorque> Tau; ///< The generalized torques of the current stage
+        utils::Vector x; ///< The current state
+        utils::Vector xStage; ///< The state at the current stage
+        utils::Vector xNext; ///< The candidate next state of the adaptive integrator
+        utils::Vector u; ///< The controls of the current stage
+        std::vector<utils::Vector> k; ///< The derivatives of the stages
+        double h; ///< The last step accepted by the adaptive integrator (0 if none)
+#ifdef MODULE_MUSCLES
+        std::vector<std::shared_ptr<internal_forces::muscles::State>> muscleStates; ///< The states of the muscles
+        std::vector<std::shared_ptr<internal_forces::muscles::Muscle>> muscles; ///< The muscles
+        std::vector<std::shared_ptr<internal_forces::muscles::FatigueModel>> fatigueModels; ///< The muscles with a dynamic fatigue state
+        std::vector<size_t> fatigueMuscles; ///< The index of the muscle of each fatigue model
+#endif
+    };
+
+    ///
+    /// \brief Compute the time derivative of the state in a workspace
+    /// \param ws The workspace
+    /// \param x The state
+    /// \param u The controls
+    /// \param xDot The output time derivative of the state
+    ///
+    void dynamics(
+        Workspace& ws,
+        const utils::Vector& x,
+        const utils::Vector& u,
+        utils::Vector& xDot);
+
+    ///
+    /// \brief Compute the generalized accelerations from ws.Q, ws.QDot and ws.Tau
+    /// \param ws The workspace
+    /// \return The generalized accelerations
+    ///
+    virtual rigidbody::GeneralizedAcceleration forwardDynamics(
+        Workspace& ws);
+
+    ///
+    /// \brief Compute the controls at a stage, then the time derivative of the state
+    /// \param ws The workspace
+    /// \param t The time of the stage
+    /// \param x The state of the stage
+    /// \param control The control function
+    /// \param xDot The output time derivative of the state
+    ///
+    void derivative(
+        Workspace& ws,
+        double t,
+        const utils::Vector& x,
+        const ControlFunction& control,
+        utils::Vector& xDot);
+
+    ///
+    /// \brief Integrate ws.x over an interval with the chosen integrator
+    /// \param ws The workspace
+    /// \param t0 The time at the beginning of the interval
+    /// \param dt The duration of the interval
+    /// \param control The control function
+    ///
+    virtual void integrateInterval(
+        Workspace& ws,
+        double t0,
+        double dt,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Take a semi-implicit Euler step on ws.x
+    /// \param ws The workspace
+    /// \param t The time at the beginning of the step
+    /// \param h The step
+    /// \param control The control function
+    ///
+    void stepSemiImplicitEuler(
+        Workspace& ws,
+        double t,
+        double h,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Take a fourth order Runge-Kutta step on ws.x
+    /// \param ws The workspace
+    /// \param t The time at the beginning of the step
+    /// \param h The step
+    /// \param control The control function
+    ///
+    void stepRK4(
+        Workspace& ws,
+        double t,
+        double h,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Integrate ws.x over an interval with adaptive Dormand-Prince steps
+    /// \param ws The workspace
+    /// \param t0 The time at the beginning of the interval
+    /// \param dt The duration of the interval
+    /// \param control The control function
+    ///
+    void integrateRK45(
+        Workspace& ws,
+        double t0,
+        double dt,
+        const ControlFunction& control);
+
+    ///
+    /// \brief Integrate one rollout from ws.x
+    /// \param ws The workspace
+    /// \param control The control function
+    /// \param currentInterval Set to the index of each interval before it is integrated (ignored if nullptr)
+    /// \param dt The duration of an interval
+    /// \param states The output states
+    ///
+    virtual void rollout(
+        Workspace& ws,
+        const ControlFunction& control,
+        size_t* currentInterval,
+        double dt,
+        utils::Matrix& states);
+
+    ///
+    /// \brief Check the dimensions of the initial state and of the output states
+    /// \param x0 The initial state
+    /// \param dt The duration of an interval
+    /// \param states The output states
+    ///
+    void checkDimensions(
+        const utils::Vector& x0,
+        double dt,
+        const utils::Matrix& states) const;
+
+    ///
+    /// \brief Run a job on each rollout with the threads and wait until all of them are done
+    /// \param nbRollouts The number of rollouts
+    /// \param job The function to call on each rollout with the workspace of the calling thread
+    ///
+    /// The first exception thrown by a job is rethrown once all the threads are done.
+    ///
+    void run(
+        size_t nbRollouts,
+        const std::function<void(Workspace&, size_t)>& job);
+
+    const Model& m_model; ///< The model
+    std::vector<Workspace> m_workspaces; ///< One workspace per thread
+    INTEGRATOR m_integrator; ///< The time integrator
+    size_t m_nbSteps; ///< The number of steps per interval of the fixed step integrators
+    double m_absoluteTolerance; ///< The absolute tolerance of the adaptive integrator
+    double m_relativeTolerance; ///< The relative tolerance of the adaptive integrator
+    size_t m_nbActivations; ///< The number of muscle activations in the state
+    size_t m_nbFatigueStates; ///< The number of fatigue states in the state
+};
+
+}
+#endif
+
+#endif // BIORBD_SIMULATOR_H
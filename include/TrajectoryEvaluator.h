@@ -0,0 +1,203 @@
+#ifndef BIORBD_TRAJECTORY_EVALUATOR_H
+#define BIORBD_TRAJECTORY_EVALUATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "biorbdConfig.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+namespace BIORBD_NAMESPACE
+{
+class Model;
+
+namespace utils
+{
+class Matrix;
+}
+
+namespace rigidbody
+{
+class ExternalForceSet;
+class GeneralizedCoordinates;
+class GeneralizedVelocity;
+class GeneralizedAcceleration;
+class GeneralizedTorque;
+}
+
+///
+/// \brief Evaluate the dynamics of a model over all the frames of a trial using a pool of threads
+///
+/// Each frame is one column of the input matrices. Every thread of the pool owns a workspace
+/// on the model (see Model::workspace) so the frames are evaluated concurrently while the model
+/// description is shared. The results are written into matrices that must be preallocated by the caller.
+///
+class BIORBD_API TrajectoryEvaluator
+{
+public:
+    ///
+    /// \brief Construct a trajectory evaluator
+    /// \param model The model to evaluate. It must outlive the evaluator and must not be modified while in use
+    /// \param nbThreads The number of threads of the pool. If 0, the number of hardware threads is used
+    ///
+    TrajectoryEvaluator(
+        const Model& model,
+        size_t nbThreads = 0);
+
+    ///
+    /// \brief Stop the threads of the pool
+    ///
+    virtual ~TrajectoryEvaluator();
+
+    ///
+    /// \brief Return the number of threads of the pool
+    /// \return The number of threads of the pool
+    ///
+    size_t nbThreads() const;
+
+    ///
+    /// \brief Compute the inverse dynamics of all the frames
+    /// \param Q The generalized coordinates (nbQ x nbFrames)
+    /// \param QDot The generalized velocities (nbQdot x nbFrames)
+    /// \param QDDot The generalized accelerations (nbQddot x nbFrames)
+    /// \param Tau The output generalized torques (nbGeneralizedTorque x nbFrames)
+    ///
+    void InverseDynamics(
+        const utils::Matrix& Q,
+        const utils::Matrix& QDot,
+        const utils::Matrix& QDDot,
+        utils::Matrix& Tau);
+
+    ///
+    /// \brief Compute the inverse dynamics of all the frames
+    /// \param Q The generalized coordinates (nbQ x nbFrames)
+    /// \param QDot The generalized velocities (nbQdot x nbFrames)
+    /// \param QDDot The generalized accelerations (nbQddot x nbFrames)
+    /// \param externalForces The external forces of each frame, created on the model
+    /// \param Tau The output generalized torques (nbGeneralizedTorque x nbFrames)
+    ///
+    void InverseDynamics(
+        const utils::Matrix& Q,
+        const utils::Matrix& QDot,
+        const utils::Matrix& QDDot,
+        const std::vector<rigidbody::ExternalForceSet>& externalForces,
+        utils::Matrix& Tau);
+
+    ///
+    /// \brief Compute the non linear effects (Coriolis, centrifugal and gravity) of all the frames
+    /// \param Q The generalized coordinates (nbQ x nbFrames)
+    /// \param QDot The generalized velocities (nbQdot x nbFrames)
+    /// \param Tau The output generalized torques (nbGeneralizedTorque x nbFrames)
+    ///
+    void NonLinearEffect(
+        const utils::Matrix& Q,
+        const utils::Matrix& QDot,
+        utils::Matrix& Tau);
+
+    ///
+    /// \brief Compute the non linear effects (Coriolis, centrifugal and gravity) of all the frames
+    /// \param Q The generalized coordinates (nbQ x nbFrames)
+    /// \param QDot The generalized velocities (nbQdot x nbFrames)
+    /// \param externalForces The external forces of each frame, created on the model
+    /// \param Tau The output generalized torques (nbGeneralizedTorque x nbFrames)
+    ///
+    void NonLinearEffect(
+        const utils::Matrix& Q,
+        const utils::Matrix& QDot,
+        const std::vector<rigidbody::ExternalForceSet>& externalForces,
+        utils::Matrix& Tau);
+
+    ///
+    /// \brief Compute the mass matrix of all the frames
+    /// \param Q The generalized coordinates (nbQ x nbFrames)
+    /// \param massMatrices The output mass matrices, one nbQdot x nbQdot matrix per frame
+    ///
+    void massMatrix(
+        const utils::Matrix& Q,
+        std::vector<utils::Matrix>& massMatrices);
+
+protected:
+    ///
+    /// \brief The per thread data
+    ///
+    struct Workspace {
+        Workspace(const Model& model);
+        std::shared_ptr<Model> model; ///< The workspace on the model
+        std::shared_ptr<rigidbody::GeneralizedCoordinates> Q; ///< The generalized coordinates of the current frame
+        std::shared_ptr<rigidbody::GeneralizedVelocity> QDot; ///< The generalized velocities of the current frame
+        std::shared_ptr<rigidbody::GeneralizedAcceleration> QDDot; ///< The generalized accelerations of the current frame
+        std::shared_ptr<rigidbody::GeneralizedTorque> Tau; ///< The generalized torques of the current frame
+        std::shared_ptr<rigidbody::ExternalForceSet> noExternalForces; ///< An empty force set bound to the workspace
+        std::shared_ptr<rigidbody::ExternalForceSet> externalForces; ///< The force set bound to the workspace which takes the forces of the current frame
+    };
+
+    ///
+    /// \brief Check the dimensions of the kinematics and of the output
+    /// \param Q The generalized coordinates
+    /// \param QDot The generalized velocities (ignored if nullptr)
+    /// \param QDDot The generalized accelerations (ignored if nullptr)
+    /// \param externalForces The external forces (ignored if nullptr)
+    /// \param Tau The output generalized torques
+    ///
+    void checkDimensions(
+        const utils::Matrix& Q,
+        const utils::Matrix* QDot,
+        const utils::Matrix* QDDot,
+        const std::vector<rigidbody::ExternalForceSet>* externalForces,
+        const utils::Matrix& Tau) const;
+
+    ///
+    /// \brief Dispatch the frames to the pool and wait until all of them are done
+    /// \param nbFrames The number of frames
+    /// \param job The function to call on each frame with the workspace of the calling thread
+    ///
+    /// The first exception thrown by a job is rethrown once all the threads are done.
+    ///
+    void run(
+        size_t nbFrames,
+        const std::function<void(Workspace&, size_t)>& job);
+
+    ///
+    /// \brief The loop of a thread of the pool
+    /// \param idx The index of the thread
+    ///
+    void work(
+        size_t idx);
+
+    ///
+    /// \brief Process the frames of the current job until there are none left
+    /// \param idx The index of the thread
+    ///
+    void processFrames(
+        size_t idx);
+
+    const Model& m_model; ///< The model
+    std::vector<Workspace> m_workspaces; ///< One workspace per thread
+    std::vector<std::thread> m_threads; ///< The threads of the pool
+
+    std::mutex m_mutex; ///< Protects the job and the counters below
+    std::condition_variable m_jobReady; ///< Wakes the threads when a job is posted
+    std::condition_variable m_jobDone; ///< Wakes the caller when all the threads are done
+    const std::function<void(Workspace&, size_t)>* m_job; ///< The current job
+    size_t m_nbFrames; ///< The number of frames of the current job
+    std::atomic<size_t> m_nextFrame; ///< The next frame to process
+    size_t m_generation; ///< Incremented each time a job is posted
+    size_t m_nbRunning; ///< The number of threads still working on the current job
+    bool m_stop; ///< If the threads should exit
+    std::exception_ptr m_error; ///< The first exception thrown by the current job
+
+private:
+    TrajectoryEvaluator(const TrajectoryEvaluator&) = delete;
+    TrajectoryEvaluator& operator=(const TrajectoryEvaluator&) = delete;
+};
+
+}
+#endif
+
+#endif // BIORBD_TRAJECTORY_EVALUATOR_H
@@ -0,0 +1,26 @@
+#ifndef BIORBD_UTILS_POINT3D_H
+#define BIORBD_UTILS_POINT3D_H
+
+#include "biorbdConfig.h"
+#include "rbdl/rbdl_math.h"
+
+namespace BIORBD_NAMESPACE
+{
+namespace utils
+{
+
+#ifndef SWIG
+///
+/// \brief Plain point in 3d
+///
+/// Contrary to Vector3d, a Point3d has no name nor parent, so it can be created and copied
+/// without allocating. It is used by the functions which fill preallocated outputs at each
+/// frame.
+///
+typedef RigidBodyDynamics::Math::Vector3d Point3d;
+#endif
+
+}
+}
+
+#endif // BIORBD_UTILS_POINT3D_H
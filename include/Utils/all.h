@@ -10,6 +10,7 @@
 #include "Utils/Scalar.h"
 #include "Utils/Vector3d.h"
 #include "Utils/Path.h"
+#include "Utils/Point3d.h"
 #include "Utils/Quaternion.h"
 #include "Utils/Range.h"
 #include "Utils/Rotation.h"
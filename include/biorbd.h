@@ -7,6 +7,10 @@
 #include "BiorbdModel.h"
 #include "ModelReader.h"
 #include "ModelWriter.h"
+#include "ModelCodeGenerator.h"
+#include "TrajectoryEvaluator.h"
+#include "Simulator.h"
+#include "HybridSimulator.h"
 
 #include "Utils/all.h"
 #include "RigidBody/all.h"
@@ -35,9 +35,31 @@ utils::Path Model::path() const
     return *m_path;
 }
 
+Model* Model::completeModel()
+{
+    return this;
+}
+
 rigidbody::ExternalForceSet Model::externalForceSet(
     bool useLinearForces,
     bool useSoftContacts
 ) {
     return rigidbody::ExternalForceSet(*this, useLinearForces, useSoftContacts);
-}
\ No newline at end of file
+}
+
+Model Model::workspace() const
+{
+    // The copy constructor copies the RBDL caches and shares everything else. Only what is
+    // written during an evaluation is then given to the workspace, the descriptions stay shared
+    Model ws(*this);
+    ws.m_isKinematicsComputed = std::make_shared<bool>(*m_isKinematicsComputed);
+    ws.rigidbody::Contacts::detachEvaluationState();
+    ws.rigidbody::SoftContacts::detachEvaluationState();
+#ifdef MODULE_MUSCLES
+    ws.internal_forces::muscles::Muscles::detachEvaluationState();
+#endif
+#ifdef MODULE_LIGAMENTS
+    ws.internal_forces::ligaments::Ligaments::detachEvaluationState();
+#endif
+    return ws;
+}
@@ -0,0 +1,382 @@
+#define BIORBD_API_EXPORTS
+#include "HybridSimulator.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include "BiorbdModel.h"
+#include "Utils/Error.h"
+#include "Utils/Matrix.h"
+#include "Utils/String.h"
+#include "Utils/Vector3d.h"
+#include "RigidBody/Contacts.h"
+#include "RigidBody/NodeSegment.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+#include "RigidBody/GeneralizedAcceleration.h"
+#include "RigidBody/GeneralizedTorque.h"
+
+using namespace BIORBD_NAMESPACE;
+
+HybridSimulator::HybridSimulator(
+    const Model& model,
+    INTEGRATOR integrator,
+    size_t nbThreads) :
+    Simulator(model, integrator, nbThreads),
+    m_groundHeight(0),
+    m_contactTolerance(1e-6),
+    m_eventTolerance(1e-10),
+    m_maxNbEvents(100),
+    m_nbRigidContacts(model.rigidContacts().size())
+{
+    for (const rigidbody::NodeSegment& contact : model.rigidContacts()) {
+        bool hasZ(false);
+        for (int axis : contact.availableAxesIndices()) {
+            hasZ |= axis == 2;
+        }
+        utils::Error::check(hasZ, "The rigid contact " + contact.Node::name()
+                            + " must be constrained along z to be simulated by the HybridSimulator");
+    }
+
+    for (size_t i=0; i<m_workspaces.size(); ++i) {
+        ContactMode mode;
+        mode.active.resize(m_nbRigidContacts, false);
+        mode.nextActive.resize(m_nbRigidContacts, false);
+        mode.constraints = nullptr;
+        mode.normalRows.resize(m_nbRigidContacts, 0);
+        mode.xStart.resize(static_cast<unsigned int>(nbStates()));
+        mode.gStart.resize(static_cast<unsigned int>(m_nbRigidContacts));
+        mode.gEnd.resize(static_cast<unsigned int>(m_nbRigidContacts));
+        m_modes.push_back(mode);
+    }
+}
+
+void HybridSimulator::setGroundHeight(
+    double height)
+{
+    m_groundHeight = height;
+}
+
+double HybridSimulator::groundHeight() const
+{
+    return m_groundHeight;
+}
+
+void HybridSimulator::setContactTolerance(
+    double tolerance)
+{
+    utils::Error::check(tolerance >= 0, "The contact tolerance must be positive");
+    m_contactTolerance = tolerance;
+}
+
+double HybridSimulator::contactTolerance() const
+{
+    return m_contactTolerance;
+}
+
+void HybridSimulator::setEventTolerance(
+    double tolerance)
+{
+    utils::Error::check(tolerance > 0, "The event tolerance must be positive");
+    m_eventTolerance = tolerance;
+}
+
+double HybridSimulator::eventTolerance() const
+{
+    return m_eventTolerance;
+}
+
+void HybridSimulator::setMaxNbEvents(
+    size_t nbEvents)
+{
+    utils::Error::check(nbEvents > 0, "The maximal number of events must be positive");
+    m_maxNbEvents = nbEvents;
+}
+
+size_t HybridSimulator::maxNbEvents() const
+{
+    return m_maxNbEvents;
+}
+
+size_t HybridSimulator::nbRigidContacts() const
+{
+    return m_nbRigidContacts;
+}
+
+const std::vector<bool>& HybridSimulator::activeContacts() const
+{
+    return m_modes[0].active;
+}
+
+const std::vector<HybridSimulator::Event>& HybridSimulator::events() const
+{
+    return m_modes[0].events;
+}
+
+size_t HybridSimulator::nbConstraintSets() const
+{
+    return m_modes[0].constraintSets.size();
+}
+
+HybridSimulator::ContactMode& HybridSimulator::mode(
+    Workspace& ws)
+{
+    return m_modes[static_cast<size_t>(&ws - m_workspaces.data())];
+}
+
+void HybridSimulator::setActiveContacts(
+    Workspace& ws,
+    const std::vector<bool>& active)
+{
+    ContactMode& m(mode(ws));
+    m.active = active;
+
+    bool hasActive(false);
+    for (size_t i=0; i<m_nbRigidContacts; ++i) {
+        hasActive |= active[i];
+    }
+    if (!hasActive) {
+        m.constraints = nullptr;
+        return;
+    }
+
+    const std::vector<rigidbody::NodeSegment>& contacts(ws.model->rigidContacts());
+    std::shared_ptr<rigidbody::Contacts>& constraints(m.constraintSets[active]);
+    if (!constraints) {
+        // The constraint set is built and bound once, then reused each time these contacts are active
+        constraints = std::make_shared<rigidbody::Contacts>();
+        for (size_t i=0; i<m_nbRigidContacts; ++i) {
+            if (!active[i]) {
+                continue;
+            }
+            const rigidbody::NodeSegment& contact(contacts[i]);
+            utils::String axes;
+            for (int axis : contact.availableAxesIndices()) {
+                axes += "xyz"[axis];
+            }
+            constraints->AddConstraint(
+                static_cast<size_t>(contact.parentId()), contact, axes, contact.Node::name(), contact.parent());
+        }
+        constraints->Bind(*ws.model);
+    }
+    m.constraints = constraints.get();
+
+    // One row per constrained axis, in the order they were added
+    size_t row(0);
+    for (size_t i=0; i<m_nbRigidContacts; ++i) {
+        if (!active[i]) {
+            continue;
+        }
+        for (int axis : contacts[i].availableAxesIndices()) {
+            if (axis == 2) {
+                m.normalRows[i] = row;
+            }
+            ++row;
+        }
+    }
+}
+
+rigidbody::GeneralizedAcceleration HybridSimulator::forwardDynamics(
+    Workspace& ws)
+{
+    ContactMode& m(mode(ws));
+    if (!m.constraints) {
+        return Simulator::forwardDynamics(ws);
+    }
+    return ws.model->ForwardDynamicsConstraintsDirect(*ws.Q, *ws.QDot, *ws.Tau, *m.constraints);
+}
+
+void HybridSimulator::integrateInterval(
+    Workspace& ws,
+    double t0,
+    double dt,
+    const ControlFunction& control)
+{
+    ContactMode& m(mode(ws));
+
+    // The controls may change between intervals, so the event functions are evaluated again
+    eventFunctions(ws, t0, ws.x, control, m.gStart);
+
+    double h(dt / static_cast<double>(m_nbSteps));
+    for (size_t s=0; s<m_nbSteps; ++s) {
+        double t(t0 + static_cast<double>(s) * h);
+        double tEnd(t0 + static_cast<double>(s + 1) * h);
+        for (size_t nbEvents=0; ; ++nbEvents) {
+            utils::Error::check(nbEvents <= m_maxNbEvents,
+                                "Too many contact events in one step, the contacts are chattering");
+            m.xStart = ws.x;
+            double stepSize(tEnd - t);
+            step(ws, t, stepSize, control);
+            eventFunctions(ws, tEnd, ws.x, control, m.gEnd);
+
+            bool crossed(false);
+            for (size_t i=0; i<m_nbRigidContacts; ++i) {
+                crossed |= hasCrossed(m.gStart[i], m.gEnd[i]);
+            }
+            if (!crossed) {
+                m.gStart.swap(m.gEnd);
+                break;
+            }
+
+            // Localize the first event by bisection on the step, from the beginning of the step
+            double lower(0);
+            double upper(stepSize);
+            while (upper - lower > m_eventTolerance) {
+                double middle(0.5 * (lower + upper));
+                ws.x = m.xStart;
+                step(ws, t, middle, control);
+                eventFunctions(ws, t + middle, ws.x, control, m.gEnd);
+                crossed = false;
+                for (size_t i=0; i<m_nbRigidContacts; ++i) {
+                    crossed |= hasCrossed(m.gStart[i], m.gEnd[i]);
+                }
+                if (crossed) {
+                    upper = middle;
+                } else {
+                    lower = middle;
+                }
+            }
+            ws.x = m.xStart;
+            step(ws, t, upper, control);
+            eventFunctions(ws, t + upper, ws.x, control, m.gEnd);
+            t += upper;
+
+            applyEvents(ws, t, control);
+            eventFunctions(ws, t, ws.x, control, m.gStart);
+        }
+    }
+}
+
+void HybridSimulator::rollout(
+    Workspace& ws,
+    const ControlFunction& control,
+    size_t* currentInterval,
+    double dt,
+    utils::Matrix& states)
+{
+    utils::Error::check(m_integrator != INTEGRATOR_RK45,
+                        "The HybridSimulator only integrates with fixed step integrators");
+    ContactMode& m(mode(ws));
+    m.events.clear();
+
+    // The contacts at or below the ground are active from the beginning
+    *ws.Q = ws.x.segment(0, ws.model->nbQ());
+    for (size_t i=0; i<m_nbRigidContacts; ++i) {
+        m.nextActive[i] = ws.model->rigidContact(*ws.Q, i, i == 0)[2] - m_groundHeight
+                          <= m_contactTolerance;
+    }
+    setActiveContacts(ws, m.nextActive);
+    impact(ws);
+    if (currentInterval) {
+        *currentInterval = 0;
+    }
+    releaseTensileContacts(ws, 0, control);
+
+    Simulator::rollout(ws, control, currentInterval, dt, states);
+}
+
+void HybridSimulator::step(
+    Workspace& ws,
+    double t,
+    double h,
+    const ControlFunction& control)
+{
+    if (m_integrator == INTEGRATOR_SEMI_IMPLICIT_EULER) {
+        stepSemiImplicitEuler(ws, t, h, control);
+    } else {
+        stepRK4(ws, t, h, control);
+    }
+}
+
+void HybridSimulator::eventFunctions(
+    Workspace& ws,
+    double t,
+    const utils::Vector& x,
+    const ControlFunction& control,
+    utils::Vector& g)
+{
+    // The dynamics give the forces of the active contacts and update the kinematics
+    ContactMode& m(mode(ws));
+    derivative(ws, t, x, control, ws.k[6]);
+    for (size_t i=0; i<m_nbRigidContacts; ++i) {
+        if (m.active[i]) {
+            g[i] = m.constraints->force[m.normalRows[i]];
+        } else {
+            g[i] = ws.model->rigidContact(*ws.Q, i, false)[2] - m_groundHeight + m_contactTolerance;
+        }
+    }
+}
+
+bool HybridSimulator::hasCrossed(
+    double gStart,
+    double gEnd)
+{
+    return gEnd <= 0 && (gStart > 0 || gEnd < gStart);
+}
+
+void HybridSimulator::applyEvents(
+    Workspace& ws,
+    double t,
+    const ControlFunction& control)
+{
+    ContactMode& m(mode(ws));
+    m.nextActive = m.active;
+    bool isMade(false);
+    for (size_t i=0; i<m_nbRigidContacts; ++i) {
+        if (!hasCrossed(m.gStart[i], m.gEnd[i])) {
+            continue;
+        }
+        m.nextActive[i] = !m.active[i];
+        isMade |= !m.active[i];
+        m.events.push_back({t, i, m.active[i] ? CONTACT_EVENT_BREAK : CONTACT_EVENT_MAKE});
+    }
+    setActiveContacts(ws, m.nextActive);
+
+    if (isMade) {
+        impact(ws);
+    }
+    releaseTensileContacts(ws, t, control);
+}
+
+void HybridSimulator::impact(
+    Workspace& ws)
+{
+    ContactMode& m(mode(ws));
+    if (!m.constraints) {
+        return;
+    }
+
+    size_t nbQ(ws.model->nbQ());
+    size_t nbQdot(ws.model->nbQdot());
+    *ws.Q = ws.x.segment(0, nbQ);
+    *ws.QDot = ws.x.segment(nbQ, nbQdot);
+    ws.x.segment(nbQ, nbQdot) = ws.model->ComputeConstraintImpulsesDirect(*ws.Q, *ws.QDot, *m.constraints);
+}
+
+void HybridSimulator::releaseTensileContacts(
+    Workspace& ws,
+    double t,
+    const ControlFunction& control)
+{
+    ContactMode& m(mode(ws));
+    while (m.constraints) {
+        derivative(ws, t, ws.x, control, ws.k[6]);
+
+        size_t released(m_nbRigidContacts);
+        double mostTensile(0);
+        for (size_t i=0; i<m_nbRigidContacts; ++i) {
+            if (m.active[i] && m.constraints->force[m.normalRows[i]] < mostTensile) {
+                mostTensile = m.constraints->force[m.normalRows[i]];
+                released = i;
+            }
+        }
+        if (released == m_nbRigidContacts) {
+            return;
+        }
+
+        m.nextActive = m.active;
+        m.nextActive[released] = false;
+        m.events.push_back({t, released, CONTACT_EVENT_BREAK});
+        setActiveContacts(ws, m.nextActive);
+    }
+}
+
+#endif
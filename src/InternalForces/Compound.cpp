@@ -64,6 +64,14 @@ void internal_forces::Compound::DeepCopy(const internal_forces::Compound &other)
     *m_force = *other.m_force;
 }
 
+void internal_forces::Compound::detachEvaluationState()
+{
+    if (m_pathChanger->nbWraps() > 0) {
+        m_pathChanger = std::make_shared<internal_forces::PathModifiers>(m_pathChanger->DeepCopy());
+    }
+    m_force = std::make_shared<utils::Scalar>(*m_force);
+}
+
 const utils::String &internal_forces::Compound::name() const
 {
     return *m_name;
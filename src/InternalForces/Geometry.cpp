@@ -3,6 +3,7 @@
 #include <rbdl/Model.h>
 #include <rbdl/Kinematics.h>
 #include "Utils/Error.h"
+#include "Utils/String.h"
 #include "Utils/Matrix.h"
 #include "Utils/RotoTrans.h"
 #include "RigidBody/NodeSegment.h"
@@ -16,6 +17,30 @@
 
 using namespace BIORBD_NAMESPACE;
 
+// Return the rbdl id of the segment a point is attached to. It is looked up by name
+// only if it was not resolved before, in which case it is stored in id
+static unsigned int parentRbdlId(
+    const rigidbody::Joints& model,
+    const utils::Vector3d& point,
+    int& id)
+{
+    if (id < 0) {
+        unsigned int tp(model.GetBodyId(point.parent().c_str()));
+        utils::Error::check(model.IsBodyId(tp),
+                            "The segment " + point.parent() + " of a point was not found in the model");
+        id = static_cast<int>(tp);
+    }
+    return static_cast<unsigned int>(id);
+}
+
+// Return a resolved rbdl id, to be stored with the points
+static unsigned int resolvedRbdlId(
+    int id)
+{
+    utils::Error::check(id >= 0, "The segment of a point was not resolved before its position was computed");
+    return static_cast<unsigned int>(id);
+}
+
 internal_forces::Geometry::Geometry() :
     m_origin(std::make_shared<utils::Vector3d>()),
     m_insertion(std::make_shared<utils::Vector3d>()),
@@ -28,6 +53,10 @@ internal_forces::Geometry::Geometry() :
     m_jacobian(std::make_shared<utils::Matrix>()),
     m_G(std::make_shared<utils::Matrix>()),
     m_jacobianLength(std::make_shared<utils::Matrix>()),
+    m_originParentId(std::make_shared<int>(-1)),
+    m_insertionParentId(std::make_shared<int>(-1)),
+    m_pathModifiersParentId(std::make_shared<std::vector<int>>()),
+    m_pointsParentId(std::make_shared<std::vector<unsigned int>>()),
     m_length(std::make_shared<utils::Scalar>(0)),
     m_velocity(std::make_shared<utils::Scalar>(0)),
     m_isGeometryComputed(std::make_shared<bool>(false)),
@@ -51,6 +80,10 @@ internal_forces::Geometry::Geometry(
     m_jacobian(std::make_shared<utils::Matrix>()),
     m_G(std::make_shared<utils::Matrix>()),
     m_jacobianLength(std::make_shared<utils::Matrix>()),
+    m_originParentId(std::make_shared<int>(-1)),
+    m_insertionParentId(std::make_shared<int>(-1)),
+    m_pathModifiersParentId(std::make_shared<std::vector<int>>()),
+    m_pointsParentId(std::make_shared<std::vector<unsigned int>>()),
     m_length(std::make_shared<utils::Scalar>(0)),
     m_velocity(std::make_shared<utils::Scalar>(0)),
     m_isGeometryComputed(std::make_shared<bool>(false)),
@@ -84,6 +117,10 @@ void internal_forces::Geometry::DeepCopy(const internal_forces::Geometry &other)
     *m_jacobian = *other.m_jacobian;
     *m_G = *other.m_G;
     *m_jacobianLength = *other.m_jacobianLength;
+    *m_originParentId = *other.m_originParentId;
+    *m_insertionParentId = *other.m_insertionParentId;
+    *m_pathModifiersParentId = *other.m_pathModifiersParentId;
+    *m_pointsParentId = *other.m_pointsParentId;
     *m_length = *other.m_length;
     *m_velocity = *other.m_velocity;
     *m_isGeometryComputed = *other.m_isGeometryComputed;
@@ -91,6 +128,36 @@ void internal_forces::Geometry::DeepCopy(const internal_forces::Geometry &other)
     *m_posAndJacoWereForced = *other.m_posAndJacoWereForced;
 }
 
+void internal_forces::Geometry::detachEvaluationState()
+{
+    m_originInGlobal = std::make_shared<utils::Vector3d>(m_originInGlobal->DeepCopy());
+    m_insertionInGlobal = std::make_shared<utils::Vector3d>(m_insertionInGlobal->DeepCopy());
+    std::shared_ptr<std::vector<utils::Vector3d>> pointsInGlobal(
+        std::make_shared<std::vector<utils::Vector3d>>(m_pointsInGlobal->size()));
+    for (size_t i=0; i<m_pointsInGlobal->size(); ++i) {
+        (*pointsInGlobal)[i] = (*m_pointsInGlobal)[i].DeepCopy();
+    }
+    m_pointsInGlobal = pointsInGlobal;
+    std::shared_ptr<std::vector<utils::Vector3d>> pointsInLocal(
+        std::make_shared<std::vector<utils::Vector3d>>(m_pointsInLocal->size()));
+    for (size_t i=0; i<m_pointsInLocal->size(); ++i) {
+        (*pointsInLocal)[i] = (*m_pointsInLocal)[i].DeepCopy();
+    }
+    m_pointsInLocal = pointsInLocal;
+    m_jacobian = std::make_shared<utils::Matrix>(*m_jacobian);
+    m_G = std::make_shared<utils::Matrix>(*m_G);
+    m_jacobianLength = std::make_shared<utils::Matrix>(*m_jacobianLength);
+    m_originParentId = std::make_shared<int>(*m_originParentId);
+    m_insertionParentId = std::make_shared<int>(*m_insertionParentId);
+    m_pathModifiersParentId = std::make_shared<std::vector<int>>(*m_pathModifiersParentId);
+    m_pointsParentId = std::make_shared<std::vector<unsigned int>>(*m_pointsParentId);
+    m_length = std::make_shared<utils::Scalar>(*m_length);
+    m_velocity = std::make_shared<utils::Scalar>(*m_velocity);
+    m_isGeometryComputed = std::make_shared<bool>(*m_isGeometryComputed);
+    m_isVelocityComputed = std::make_shared<bool>(*m_isVelocityComputed);
+    m_posAndJacoWereForced = std::make_shared<bool>(*m_posAndJacoWereForced);
+}
+
 
 // ------ PUBLIC FUNCTIONS ------ //
 void internal_forces::Geometry::updateKinematics(
@@ -179,6 +246,7 @@ void internal_forces::Geometry::setOrigin(
 {
     if (dynamic_cast<const rigidbody::NodeSegment*>(&position)) {
         *m_origin = position;
+        *m_originParentId = -1;
     } else {
         // Preserve the Node information
         m_origin->RigidBodyDynamics::Math::Vector3d::operator=(position);
@@ -194,6 +262,7 @@ void internal_forces::Geometry::setInsertionInLocal(
 {
     if (dynamic_cast<const rigidbody::NodeSegment*>(&position)) {
         *m_insertion = position;
+        *m_insertionParentId = -1;
     } else {
         // Preserve the Node information
         m_insertion->RigidBodyDynamics::Math::Vector3d::operator=(position);
@@ -303,7 +372,7 @@ const utils::Vector3d &internal_forces::Geometry::originInGlobal(
     // Return the position of the marker in function of the given position
     m_originInGlobal->block(0,0,3,
                             1) = RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q,
-                                    model.GetBodyId(m_origin->parent().c_str()), *m_origin,false);
+                                    parentRbdlId(model, *m_origin, *m_originParentId), *m_origin,false);
     return *m_originInGlobal;
 }
 
@@ -313,7 +382,7 @@ const utils::Vector3d &internal_forces::Geometry::insertionInGlobal(
 {
     // Return the position of the marker in function of the given position
     m_insertionInGlobal->block(0,0,3,1) = RigidBodyDynamics::CalcBodyToBaseCoordinates(
-                model, Q, model.GetBodyId(m_insertion->parent().c_str()), *m_insertion,false);
+                model, Q, parentRbdlId(model, *m_insertion, *m_insertionParentId), *m_insertion,false);
     return *m_insertionInGlobal;
 }
 
@@ -323,6 +392,7 @@ void internal_forces::Geometry::setPointsInGlobal(
     utils::Error::check(ptsInGlobal.size() >= 2,
                                 "ptsInGlobal must at least have an origin and an insertion");
     m_pointsInLocal->clear(); // In this mode, we don't need the local, because the Jacobian of the points has to be given as well
+    m_pointsParentId->clear();
     *m_pointsInGlobal = ptsInGlobal;
 }
 
@@ -334,6 +404,13 @@ void internal_forces::Geometry::setPointsInGlobal(
     // Output varible (reset to zero)
     m_pointsInLocal->clear();
     m_pointsInGlobal->clear();
+    m_pointsParentId->clear();
+
+    // The parent of the path modifiers are resolved only once
+    size_t nbObjects(pathModifiers ? pathModifiers->nbObjects() : 0);
+    if (m_pathModifiersParentId->size() != nbObjects) {
+        m_pathModifiersParentId->assign(nbObjects, -1);
+    }
 
     // Do not apply on wrapping objects
     if (pathModifiers->nbWraps()!=0) {
@@ -363,16 +440,21 @@ void internal_forces::Geometry::setPointsInGlobal(
         w.wrapPoints(RT,po_mus,pi_mus,po_wrap, pi_wrap, &a);
 
         // Store the points in local
+        unsigned int wrapId(parentRbdlId(model, w, (*m_pathModifiersParentId)[0]));
         m_pointsInLocal->push_back(originInLocal());
         m_pointsInLocal->push_back(
             utils::Vector3d(RigidBodyDynamics::CalcBodyToBaseCoordinates(
-                                        model, Q, model.GetBodyId(w.parent().c_str()),po_wrap, false),
+                                        model, Q, wrapId,po_wrap, false),
                                     "wrap_o", w.parent()));
         m_pointsInLocal->push_back(
             utils::Vector3d(RigidBodyDynamics::CalcBodyToBaseCoordinates(
-                                        model, Q, model.GetBodyId(w.parent().c_str()),pi_wrap, false),
+                                        model, Q, wrapId,pi_wrap, false),
                                     "wrap_i", w.parent()));
         m_pointsInLocal->push_back(insertionInLocal());
+        m_pointsParentId->push_back(resolvedRbdlId(*m_originParentId));
+        m_pointsParentId->push_back(wrapId);
+        m_pointsParentId->push_back(wrapId);
+        m_pointsParentId->push_back(resolvedRbdlId(*m_insertionParentId));
 
         // Store the points in global
         m_pointsInGlobal->push_back(po_mus);
@@ -386,22 +468,27 @@ void internal_forces::Geometry::setPointsInGlobal(
              && pathModifiers->object(0).typeOfNode() == utils::NODE_TYPE::VIA_POINT) {
         m_pointsInLocal->push_back(originInLocal());
         m_pointsInGlobal->push_back(originInGlobal(model, Q));
+        m_pointsParentId->push_back(resolvedRbdlId(*m_originParentId));
         for (size_t i=0; i<pathModifiers->nbObjects(); ++i) {
             const internal_forces::ViaPoint& node(static_cast<internal_forces::ViaPoint&>
                                                   (pathModifiers->object(i)));
+            unsigned int id(parentRbdlId(model, node, (*m_pathModifiersParentId)[i]));
             m_pointsInLocal->push_back(node);
             m_pointsInGlobal->push_back(RigidBodyDynamics::CalcBodyToBaseCoordinates(model,
-                                        Q,
-                                        model.GetBodyId(node.parent().c_str()), node, false));
+                                        Q, id, node, false));
+            m_pointsParentId->push_back(id);
         }
         m_pointsInLocal->push_back(insertionInLocal());
         m_pointsInGlobal->push_back(insertionInGlobal(model,Q));
+        m_pointsParentId->push_back(resolvedRbdlId(*m_insertionParentId));
 
     } else if (pathModifiers->nbObjects()==0) {
         m_pointsInLocal->push_back(originInLocal());
         m_pointsInLocal->push_back(insertionInLocal());
         m_pointsInGlobal->push_back(originInGlobal(model, Q));
         m_pointsInGlobal->push_back(insertionInGlobal(model,Q));
+        m_pointsParentId->push_back(resolvedRbdlId(*m_originParentId));
+        m_pointsParentId->push_back(resolvedRbdlId(*m_insertionParentId));
     } else {
         utils::Error::raise("Length for this type of object was not implemented");
     }
@@ -468,13 +555,21 @@ void internal_forces::Geometry::jacobian(
     rigidbody::Joints &model,
     const rigidbody::GeneralizedCoordinates &Q)
 {
+#ifdef BIORBD_USE_CASADI_MATH
     for (size_t i=0; i<m_pointsInLocal->size(); ++i) {
         m_G->setZero();
-        RigidBodyDynamics::CalcPointJacobian(model, Q,
-                                             model.GetBodyId((*m_pointsInLocal)[i].parent().c_str()),
+        RigidBodyDynamics::CalcPointJacobian(model, Q, (*m_pointsParentId)[i],
                                              (*m_pointsInLocal)[i], *m_G, false); // False for speed
         m_jacobian->block(3* static_cast<unsigned int>(i),0,3,model.dof_count) = *m_G;
     }
+#else
+    // The jacobian of each body is computed once per kinematics update and shared by all the
+    // points attached to it, whatever muscle or ligament they belong to
+    for (size_t i=0; i<m_pointsInLocal->size(); ++i) {
+        model.pointJacobianFromBody(Q, (*m_pointsParentId)[i], (*m_pointsInLocal)[i],
+                                    *m_jacobian, 3* static_cast<unsigned int>(i));
+    }
+#endif
 }
 
 void internal_forces::Geometry::computeJacobianLength()
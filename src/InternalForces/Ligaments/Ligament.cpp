@@ -97,6 +97,15 @@ void internal_forces::ligaments::Ligament::DeepCopy(const internal_forces::ligam
     *m_damping = *other.m_damping;
 }
 
+void internal_forces::ligaments::Ligament::detachEvaluationState()
+{
+    this->internal_forces::Compound::detachEvaluationState();
+    m_position = std::make_shared<internal_forces::Geometry>(*m_position);
+    m_position->detachEvaluationState();
+    m_Fl = std::make_shared<utils::Scalar>(*m_Fl);
+    m_damping = std::make_shared<utils::Scalar>(*m_damping);
+}
+
 internal_forces::ligaments::LIGAMENT_TYPE internal_forces::ligaments::Ligament::type() const
 {
     return *m_type;
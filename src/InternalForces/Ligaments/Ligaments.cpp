@@ -45,18 +45,40 @@ void internal_forces::ligaments::Ligaments::DeepCopy(
 {
     m_ligaments->resize(other.m_ligaments->size());
     for (size_t i=0; i<other.m_ligaments->size(); ++i) {
-        if ((*other.m_ligaments)[i]->type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_CONSTANT) {
-            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentConstant>((*other.m_ligaments)[i]);
-            return;
-        } else if ((*other.m_ligaments)[i]->type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_LINEAR) {
-            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringLinear>((*other.m_ligaments)[i]);
-            return;
-        } else if ((*other.m_ligaments)[i]->type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_SECOND_ORDER) {
-            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringSecondOrder>((*other.m_ligaments)[i]);
-            return;
+        const internal_forces::ligaments::Ligament& ligament(*(*other.m_ligaments)[i]);
+        if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_CONSTANT) {
+            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentConstant>(
+                                    static_cast<const internal_forces::ligaments::LigamentConstant&>(ligament).DeepCopy());
+        } else if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_LINEAR) {
+            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringLinear>(
+                                    static_cast<const internal_forces::ligaments::LigamentSpringLinear&>(ligament).DeepCopy());
+        } else if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_SECOND_ORDER) {
+            (*m_ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringSecondOrder>(
+                                    static_cast<const internal_forces::ligaments::LigamentSpringSecondOrder&>(ligament).DeepCopy());
+        } else {
+            utils::Error::raise("DeepCopy for this type of ligament is not implemented");
         }
     }
-    *m_ligaments = *other.m_ligaments;
+}
+
+void internal_forces::ligaments::Ligaments::detachEvaluationState()
+{
+    std::shared_ptr<std::vector<std::shared_ptr<internal_forces::ligaments::Ligament>>> ligaments(
+        std::make_shared<std::vector<std::shared_ptr<internal_forces::ligaments::Ligament>>>(m_ligaments->size()));
+    for (size_t i=0; i<m_ligaments->size(); ++i) {
+        const internal_forces::ligaments::Ligament& ligament(*(*m_ligaments)[i]);
+        if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_CONSTANT) {
+            (*ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentConstant>(ligament);
+        } else if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_LINEAR) {
+            (*ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringLinear>(ligament);
+        } else if (ligament.type() == internal_forces::ligaments::LIGAMENT_TYPE::LIGAMENT_SPRING_SECOND_ORDER) {
+            (*ligaments)[i] = std::make_shared<internal_forces::ligaments::LigamentSpringSecondOrder>(ligament);
+        } else {
+            utils::Error::raise("The evaluation state of this type of ligament cannot be detached");
+        }
+        (*ligaments)[i]->detachEvaluationState();
+    }
+    m_ligaments = ligaments;
 }
 
 internal_forces::ligaments::Ligament& internal_forces::ligaments::Ligaments::ligament(size_t idx)
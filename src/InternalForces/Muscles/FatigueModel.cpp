@@ -43,7 +43,21 @@ internal_forces::muscles::FatigueModel::~FatigueModel()
 void internal_forces::muscles::FatigueModel::DeepCopy(const internal_forces::muscles::FatigueModel
         &other)
 {
-    *m_fatigueState = other.m_fatigueState->DeepCopy();
+    if (other.m_fatigueState->getType() ==
+            internal_forces::muscles::STATE_FATIGUE_TYPE::DYNAMIC_XIA) {
+        m_fatigueState = std::make_shared<internal_forces::muscles::FatigueDynamicStateXia>(
+                             static_cast<const internal_forces::muscles::FatigueDynamicStateXia&>
+                             (*other.m_fatigueState).DeepCopy());
+    } else {
+        m_fatigueState = std::make_shared<internal_forces::muscles::FatigueState>
+                         (other.m_fatigueState->DeepCopy());
+    }
+}
+
+void internal_forces::muscles::FatigueModel::detachFatigueState()
+{
+    // The copy is made from the current state before it is replaced
+    DeepCopy(*this);
 }
 
 #ifndef BIORBD_USE_CASADI_MATH
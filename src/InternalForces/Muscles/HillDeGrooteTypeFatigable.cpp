@@ -96,6 +96,12 @@ void internal_forces::muscles::HillDeGrooteTypeFatigable::DeepCopy(
     internal_forces::muscles::FatigueModel::DeepCopy(other);
 }
 
+void internal_forces::muscles::HillDeGrooteTypeFatigable::detachEvaluationState()
+{
+    internal_forces::muscles::HillDeGrooteType::detachEvaluationState();
+    internal_forces::muscles::FatigueModel::detachFatigueState();
+}
+
 void internal_forces::muscles::HillDeGrooteTypeFatigable::computeFlCE(
     const internal_forces::muscles::State &emg)
 {
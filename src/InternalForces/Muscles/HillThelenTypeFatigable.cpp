@@ -96,6 +96,12 @@ void internal_forces::muscles::HillThelenTypeFatigable::DeepCopy(
     internal_forces::muscles::FatigueModel::DeepCopy(other);
 }
 
+void internal_forces::muscles::HillThelenTypeFatigable::detachEvaluationState()
+{
+    internal_forces::muscles::HillThelenType::detachEvaluationState();
+    internal_forces::muscles::FatigueModel::detachFatigueState();
+}
+
 void internal_forces::muscles::HillThelenTypeFatigable::computeFlCE(
     const internal_forces::muscles::State &emg)
 {
@@ -195,6 +195,15 @@ void internal_forces::muscles::HillType::DeepCopy(const internal_forces::muscles
     *m_cste_maxShorteningSpeed = *other.m_cste_maxShorteningSpeed;
 }
 
+void internal_forces::muscles::HillType::detachEvaluationState()
+{
+    internal_forces::muscles::Muscle::detachEvaluationState();
+    m_damping = std::make_shared<utils::Scalar>(*m_damping);
+    m_FlCE = std::make_shared<utils::Scalar>(*m_FlCE);
+    m_FlPE = std::make_shared<utils::Scalar>(*m_FlPE);
+    m_FvCE = std::make_shared<utils::Scalar>(*m_FvCE);
+}
+
 const utils::Scalar& internal_forces::muscles::HillType::force(
     const internal_forces::muscles::State& emg)
 {
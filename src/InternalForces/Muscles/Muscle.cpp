@@ -113,13 +113,42 @@ internal_forces::muscles::Muscle::~Muscle()
     //dtor
 }
 
+// Return a deep copy of a state, of the same dynamic type
+static std::shared_ptr<internal_forces::muscles::State> deepCopyState(
+    const internal_forces::muscles::State& state)
+{
+    if (state.type() == internal_forces::muscles::STATE_TYPE::BUCHANAN) {
+        return std::make_shared<internal_forces::muscles::StateDynamicsBuchanan>(
+                   static_cast<const internal_forces::muscles::StateDynamicsBuchanan&>
+                   (state).DeepCopy());
+    } else if (state.type() == internal_forces::muscles::STATE_TYPE::DE_GROOTE) {
+        return std::make_shared<internal_forces::muscles::StateDynamicsDeGroote>(
+                   static_cast<const internal_forces::muscles::StateDynamicsDeGroote&>
+                   (state).DeepCopy());
+    } else if (state.type() == internal_forces::muscles::STATE_TYPE::DYNAMIC) {
+        return std::make_shared<internal_forces::muscles::StateDynamics>(
+                   static_cast<const internal_forces::muscles::StateDynamics&>
+                   (state).DeepCopy());
+    } else {
+        return std::make_shared<internal_forces::muscles::State>(state.DeepCopy());
+    }
+}
+
 void internal_forces::muscles::Muscle::DeepCopy(const internal_forces::muscles::Muscle &other)
 {
     this->internal_forces::Compound::DeepCopy(other);
     *m_position = other.m_position->DeepCopy();
     *m_type = *other.m_type;
     *m_characteristics = other.m_characteristics->DeepCopy();
-    *m_state = other.m_state->DeepCopy();
+    m_state = deepCopyState(*other.m_state);
+}
+
+void internal_forces::muscles::Muscle::detachEvaluationState()
+{
+    this->internal_forces::Compound::detachEvaluationState();
+    m_position = std::make_shared<internal_forces::muscles::MuscleGeometry>(*m_position);
+    m_position->detachEvaluationState();
+    m_state = deepCopyState(*m_state);
 }
 
 internal_forces::muscles::MUSCLE_TYPE internal_forces::muscles::Muscle::type() const
@@ -0,0 +1,421 @@
+#define BIORBD_API_EXPORTS
+#include "InternalForces/Muscles/MuscleForceEngine.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <cmath>
+#include "Utils/Error.h"
+#include "InternalForces/Muscles/Characteristics.h"
+#include "InternalForces/Muscles/FatigueModel.h"
+#include "InternalForces/Muscles/FatigueState.h"
+#include "InternalForces/Muscles/HillType.h"
+#include "InternalForces/Muscles/MuscleGeometry.h"
+#include "InternalForces/Muscles/Muscles.h"
+#include "InternalForces/Muscles/State.h"
+
+using namespace BIORBD_NAMESPACE;
+
+internal_forces::muscles::MuscleForceEngine::MuscleForceEngine() :
+    m_isBuilt(false),
+    m_nbMuscles(0)
+{
+
+}
+
+internal_forces::muscles::MuscleForceEngine internal_forces::muscles::MuscleForceEngine::DeepCopy() const
+{
+    internal_forces::muscles::MuscleForceEngine copy;
+    copy.DeepCopy(*this);
+    return copy;
+}
+
+void internal_forces::muscles::MuscleForceEngine::DeepCopy(
+    const internal_forces::muscles::MuscleForceEngine &)
+{
+    // The muscles of the copy are not the same objects
+    invalidate();
+}
+
+void internal_forces::muscles::MuscleForceEngine::invalidate()
+{
+    m_isBuilt = false;
+}
+
+size_t internal_forces::muscles::MuscleForceEngine::nbBatchedMuscles() const
+{
+    return m_muscles.size();
+}
+
+void internal_forces::muscles::MuscleForceEngine::build(
+    internal_forces::muscles::Muscles &muscles)
+{
+    // Sort the Hill-type muscles by formulation so each formulation is a contiguous range
+    std::vector<std::vector<size_t>> indices(NB_FORMULATIONS);
+    std::vector<std::vector<internal_forces::muscles::Muscle*>> formulationMuscles(NB_FORMULATIONS);
+    std::vector<std::vector<double>> isPassive(NB_FORMULATIONS);
+    m_otherMuscles.clear();
+    m_otherIndex.clear();
+    for (size_t idx=0; idx<muscles.nbMuscles(); ++idx) {
+        internal_forces::muscles::Muscle& muscle(muscles.muscle(idx));
+        FORMULATION formulation(NB_FORMULATIONS);
+        double passive(1);
+        switch (muscle.type()) {
+        case internal_forces::muscles::MUSCLE_TYPE::HILL:
+            formulation = FORMULATION_HILL;
+            break;
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_ACTIVE:
+            passive = 0;
+            formulation = FORMULATION_THELEN;
+            break;
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN:
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_FATIGABLE:
+            formulation = FORMULATION_THELEN;
+            break;
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_ACTIVE:
+            passive = 0;
+            formulation = FORMULATION_DE_GROOTE;
+            break;
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE:
+        case internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_FATIGABLE:
+            formulation = FORMULATION_DE_GROOTE;
+            break;
+        default:
+            break;
+        }
+        if (formulation == NB_FORMULATIONS || !dynamic_cast<internal_forces::muscles::HillType*>(&muscle)) {
+            m_otherMuscles.push_back(&muscle);
+            m_otherIndex.push_back(idx);
+            continue;
+        }
+        indices[formulation].push_back(idx);
+        formulationMuscles[formulation].push_back(&muscle);
+        isPassive[formulation].push_back(passive);
+    }
+
+    size_t nbBatched(0);
+    m_formulationStart.clear();
+    for (size_t f=0; f<NB_FORMULATIONS; ++f) {
+        m_formulationStart.push_back(static_cast<Eigen::Index>(nbBatched));
+        nbBatched += indices[f].size();
+    }
+    m_formulationStart.push_back(static_cast<Eigen::Index>(nbBatched));
+
+    Eigen::Index n(static_cast<Eigen::Index>(nbBatched));
+    for (auto* a : {&m_isPassive, &m_csteFlCE1, &m_csteFlCE2, &m_csteFvCE1, &m_csteFvCE2,
+                    &m_csteFlPE1, &m_csteFlPE2, &m_csteDamping, &m_maxShorteningSpeed,
+                    &m_length, &m_velocity, &m_activation, &m_activeFibers, &m_optimalLength,
+                    &m_forceIsoMax, &m_pennationAngle, &m_useDamping, &m_normLength,
+                    &m_normVelocity, &m_FlCE, &m_FvCE, &m_FlPE, &m_damping, &m_force,
+                    &m_dFlCEdLength, &m_dFlCEdActivation, &m_dFvCEdVelocity, &m_dFlPEdLength,
+                    &m_dDampingdVelocity}) {
+        a->resize(n);
+    }
+    m_muscles.clear();
+    m_index.clear();
+    m_fatigue.clear();
+    for (size_t f=0; f<NB_FORMULATIONS; ++f) {
+        for (size_t i=0; i<indices[f].size(); ++i) {
+            Eigen::Index k(static_cast<Eigen::Index>(m_muscles.size()));
+            internal_forces::muscles::HillType& muscle(
+                dynamic_cast<internal_forces::muscles::HillType&>(*formulationMuscles[f][i]));
+            m_muscles.push_back(&muscle);
+            m_index.push_back(indices[f][i]);
+            m_fatigue.push_back(dynamic_cast<internal_forces::muscles::FatigueModel*>(&muscle));
+            m_isPassive[k] = isPassive[f][i];
+            m_csteFlCE1[k] = *muscle.m_cste_FlCE_1;
+            m_csteFlCE2[k] = *muscle.m_cste_FlCE_2;
+            m_csteFvCE1[k] = *muscle.m_cste_FvCE_1;
+            m_csteFvCE2[k] = *muscle.m_cste_FvCE_2;
+            m_csteFlPE1[k] = *muscle.m_cste_FlPE_1;
+            m_csteFlPE2[k] = *muscle.m_cste_FlPE_2;
+            m_csteDamping[k] = *muscle.m_cste_damping;
+            m_maxShorteningSpeed[k] = *muscle.m_cste_maxShorteningSpeed;
+        }
+    }
+
+    m_nbMuscles = muscles.nbMuscles();
+    m_isBuilt = true;
+}
+
+void internal_forces::muscles::MuscleForceEngine::computeForces(
+    internal_forces::muscles::Muscles &muscles,
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>> &emg,
+    utils::Vector &forces)
+{
+    evaluate(muscles, emg, forces, false);
+}
+
+void internal_forces::muscles::MuscleForceEngine::computeForceDerivatives(
+    internal_forces::muscles::Muscles &muscles,
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>> &emg,
+    utils::Vector &forces,
+    utils::Vector &dForceActivation,
+    utils::Vector &dForceLength,
+    utils::Vector &dForceVelocity)
+{
+    evaluate(muscles, emg, forces, true);
+    Eigen::Index nbMuscles(static_cast<Eigen::Index>(m_nbMuscles));
+    for (auto* v : {&dForceActivation, &dForceLength, &dForceVelocity}) {
+        if (v->size() != nbMuscles) {
+            v->resize(nbMuscles);
+        }
+    }
+
+    // F = Fmax * cos(pennation) * (a * FlCE * FvCE + FlPE + damping), with a muscle length of
+    // (lmt - tendonSlackLength) / cos(pennation) so the cosine cancels for the length
+    Eigen::Index n(static_cast<Eigen::Index>(m_muscles.size()));
+    for (Eigen::Index k=0; k<n; ++k) {
+        Eigen::Index i(static_cast<Eigen::Index>(m_index[static_cast<size_t>(k)]));
+        double forceIsoMaxCos(m_forceIsoMax[k] * std::cos(m_pennationAngle[k]));
+        dForceActivation[i] = forceIsoMaxCos * m_FvCE[k]
+                              * (m_FlCE[k] + m_activation[k] * m_activeFibers[k] * m_dFlCEdActivation[k]);
+        dForceLength[i] = m_forceIsoMax[k]
+                          * (m_activation[k] * m_activeFibers[k] * m_dFlCEdLength[k] * m_FvCE[k]
+                             + m_isPassive[k] * m_dFlPEdLength[k]);
+        dForceVelocity[i] = forceIsoMaxCos
+                            * (m_activation[k] * m_FlCE[k] * m_dFvCEdVelocity[k]
+                               + m_isPassive[k] * m_useDamping[k] * m_dDampingdVelocity[k]);
+    }
+    for (size_t j=0; j<m_otherMuscles.size(); ++j) {
+        const internal_forces::muscles::Muscle& muscle(*m_otherMuscles[j]);
+        utils::Error::check(muscle.type() == internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR,
+                            utils::String("The force derivatives of ")
+                            + internal_forces::muscles::MUSCLE_TYPE_toStr(muscle.type())
+                            + " muscles are not implemented");
+        Eigen::Index i(static_cast<Eigen::Index>(m_otherIndex[j]));
+        dForceActivation[i] = muscle.characteristics().forceIsoMax();
+        dForceLength[i] = 0;
+        dForceVelocity[i] = 0;
+    }
+}
+
+void internal_forces::muscles::MuscleForceEngine::evaluate(
+    internal_forces::muscles::Muscles &muscles,
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>> &emg,
+    utils::Vector &forces,
+    bool withDerivatives)
+{
+    // Indexing the muscles again (if some were added) invalidates the engine, so it goes first
+    size_t nbMuscles(muscles.nbMuscles());
+    if (!m_isBuilt || m_nbMuscles != nbMuscles) {
+        build(muscles);
+    }
+    utils::Error::check(emg.size() == m_nbMuscles, "There must be one state per muscle");
+    if (forces.size() != static_cast<Eigen::Index>(m_nbMuscles)) {
+        forces.resize(static_cast<Eigen::Index>(m_nbMuscles));
+    }
+
+    // Gather the state and characteristics of the muscles in contiguous columns
+    Eigen::Index n(static_cast<Eigen::Index>(m_muscles.size()));
+    for (Eigen::Index k=0; k<n; ++k) {
+        const internal_forces::muscles::Muscle& muscle(*m_muscles[static_cast<size_t>(k)]);
+        const internal_forces::muscles::Characteristics& characteristics(muscle.characteristics());
+        const internal_forces::muscles::FatigueModel* fatigue(m_fatigue[static_cast<size_t>(k)]);
+        m_length[k] = muscle.position().length();
+        m_velocity[k] = muscle.position().velocity();
+        m_activation[k] = emg[m_index[static_cast<size_t>(k)]]->activation();
+        m_activeFibers[k] = fatigue ? fatigue->fatigueState().activeFibers() : 1.0;
+        m_optimalLength[k] = characteristics.optimalLength();
+        m_forceIsoMax[k] = characteristics.forceIsoMax();
+        m_pennationAngle[k] = characteristics.pennationAngle();
+        m_useDamping[k] = characteristics.useDamping() ? 1.0 : 0.0;
+    }
+
+    // Evaluate the curves of each formulation on its whole range
+    computeHill(m_formulationStart[FORMULATION_HILL],
+                m_formulationStart[FORMULATION_HILL + 1] - m_formulationStart[FORMULATION_HILL],
+                withDerivatives);
+    computeThelen(m_formulationStart[FORMULATION_THELEN],
+                  m_formulationStart[FORMULATION_THELEN + 1] - m_formulationStart[FORMULATION_THELEN],
+                  withDerivatives);
+    computeDeGroote(m_formulationStart[FORMULATION_DE_GROOTE],
+                    m_formulationStart[FORMULATION_DE_GROOTE + 1] - m_formulationStart[FORMULATION_DE_GROOTE],
+                    withDerivatives);
+
+    // Combine the elements as in HillType::getForceFromActivation
+    m_FlCE *= m_activeFibers;
+    m_FlPE *= m_isPassive;
+    m_damping *= m_isPassive * m_useDamping;
+    m_force = m_forceIsoMax * (m_activation * m_FlCE * m_FvCE + m_FlPE + m_damping) * m_pennationAngle.cos();
+
+    // Scatter the forces, also keeping them as the last force of each muscle
+    for (Eigen::Index k=0; k<n; ++k) {
+        size_t i(static_cast<size_t>(k));
+        forces[static_cast<Eigen::Index>(m_index[i])] = m_force[k];
+        *m_muscles[i]->m_force = m_force[k];
+    }
+    for (size_t i=0; i<m_otherMuscles.size(); ++i) {
+        forces[static_cast<Eigen::Index>(m_otherIndex[i])] = m_otherMuscles[i]->force(*emg[m_otherIndex[i]]);
+    }
+}
+
+void internal_forces::muscles::MuscleForceEngine::computeHill(
+    Eigen::Index start,
+    Eigen::Index size,
+    bool withDerivatives)
+{
+    if (size == 0) {
+        return;
+    }
+    auto length(m_length.segment(start, size));
+    auto velocity(m_velocity.segment(start, size));
+    auto activation(m_activation.segment(start, size));
+    auto optimalLength(m_optimalLength.segment(start, size));
+    auto maxSpeed(m_maxShorteningSpeed.segment(start, size));
+    auto fv1(m_csteFvCE1.segment(start, size));
+    auto fv2(m_csteFvCE2.segment(start, size));
+    auto normVelocity(m_normVelocity.segment(start, size));
+
+    // Same as HillType::computeFlCE, computeFvCE, computeFlPE and computeDamping
+    m_normLength.segment(start, size) = length / optimalLength;
+    m_FlCE.segment(start, size) = (-(m_normLength.segment(start, size)
+                                     / (m_csteFlCE1.segment(start, size) * (1 - activation) + 1) - 1).square()
+                                   / m_csteFlCE2.segment(start, size)).exp();
+    normVelocity = velocity / maxSpeed;
+    m_FvCE.segment(start, size) = (velocity <= 0).select(
+                                      (1 - normVelocity.abs()) / (1 + normVelocity.abs() / fv1),
+                                      (1 - 1.33 * normVelocity / fv2) / (1 - normVelocity / fv2));
+    m_FlPE.segment(start, size) = (length > 0).select(
+                                      (m_csteFlPE1.segment(start, size) * (m_normLength.segment(start, size) - 1)
+                                       - m_csteFlPE2.segment(start, size)).exp(), 0.0);
+    m_damping.segment(start, size) = (velocity > 0).select(
+                                         velocity / (optimalLength * maxSpeed) * m_csteDamping.segment(start, size), 0.0);
+    if (!withDerivatives) {
+        return;
+    }
+
+    // With s = csteFlCE1 * (1 - a) + 1, FlCE = exp(-(l / lopt / s - 1)^2 / csteFlCE2)
+    auto normLength(m_normLength.segment(start, size));
+    auto fl1(m_csteFlCE1.segment(start, size));
+    auto dFlCEdLength(m_dFlCEdLength.segment(start, size));
+    dFlCEdLength = m_FlCE.segment(start, size) * -2.0 / m_csteFlCE2.segment(start, size)
+                   * (normLength / (fl1 * (1 - activation) + 1) - 1) / (fl1 * (1 - activation) + 1);
+    m_dFlCEdActivation.segment(start, size) = dFlCEdLength * fl1 * normLength / (fl1 * (1 - activation) + 1);
+    dFlCEdLength /= optimalLength;
+    m_dFvCEdVelocity.segment(start, size) = (velocity <= 0).select(
+            (1 + 1 / fv1) / (1 - normVelocity / fv1).square(),
+            -0.33 / fv2 / (1 - normVelocity / fv2).square()) / maxSpeed;
+    m_dFlPEdLength.segment(start, size) = m_FlPE.segment(start, size) * m_csteFlPE1.segment(start, size) / optimalLength;
+    m_dDampingdVelocity.segment(start, size) = (velocity > 0).select(
+                m_csteDamping.segment(start, size) / (optimalLength * maxSpeed), 0.0);
+}
+
+void internal_forces::muscles::MuscleForceEngine::computeThelen(
+    Eigen::Index start,
+    Eigen::Index size,
+    bool withDerivatives)
+{
+    if (size == 0) {
+        return;
+    }
+    auto velocity(m_velocity.segment(start, size));
+    auto optimalLength(m_optimalLength.segment(start, size));
+    auto maxSpeed(m_maxShorteningSpeed.segment(start, size));
+    auto normLength(m_normLength.segment(start, size));
+    auto normVelocity(m_normVelocity.segment(start, size));
+
+    // Same as HillThelenType::computeFlPE, computeFlCE and computeFvCE
+    const double kpe(5.0);
+    const double e0(0.6);
+    const double kvce(0.06);
+    const double flen(1.6);
+    normLength = m_length.segment(start, size) / optimalLength;
+    m_FlPE.segment(start, size) = (normLength > 1).select(
+                                      ((kpe * (normLength - 1) / e0).exp() - 1) / (std::exp(kpe) - 1), 0.0);
+    m_FlCE.segment(start, size) = (-(normLength - 1).square() / 0.45).exp();
+    normVelocity = velocity / (optimalLength * maxSpeed);
+    m_FvCE.segment(start, size) = (normVelocity > 0).select(
+                                      (1 + normVelocity * flen / kvce) / (1 + normVelocity / kvce), 0.0);
+
+    // Same as HillType::computeDamping
+    m_damping.segment(start, size) = (velocity > 0).select(
+                                         normVelocity * m_csteDamping.segment(start, size), 0.0);
+    if (!withDerivatives) {
+        return;
+    }
+
+    m_dFlPEdLength.segment(start, size) = (normLength > 1).select(
+            (kpe * (normLength - 1) / e0).exp() * kpe / e0 / (std::exp(kpe) - 1) / optimalLength, 0.0);
+    m_dFlCEdLength.segment(start, size) = m_FlCE.segment(start, size) * -2.0 * (normLength - 1) / 0.45 / optimalLength;
+    m_dFlCEdActivation.segment(start, size).setZero();
+    m_dFvCEdVelocity.segment(start, size) = (normVelocity > 0).select(
+            (flen - 1) / kvce / (1 + normVelocity / kvce).square() / (optimalLength * maxSpeed), 0.0);
+    m_dDampingdVelocity.segment(start, size) = (velocity > 0).select(
+                m_csteDamping.segment(start, size) / (optimalLength * maxSpeed), 0.0);
+}
+
+void internal_forces::muscles::MuscleForceEngine::computeDeGroote(
+    Eigen::Index start,
+    Eigen::Index size,
+    bool withDerivatives)
+{
+    if (size == 0) {
+        return;
+    }
+    auto velocity(m_velocity.segment(start, size));
+    auto optimalLength(m_optimalLength.segment(start, size));
+    auto maxSpeed(m_maxShorteningSpeed.segment(start, size));
+    auto normLength(m_normLength.segment(start, size));
+    auto normVelocity(m_normVelocity.segment(start, size));
+
+    // Same as HillDeGrooteType::computeFlPE
+    const double kpe(4);
+    const double e0(0.6);
+    normLength = m_length.segment(start, size) / optimalLength;
+    m_FlPE.segment(start, size) = (normLength > 1).select(
+                                      ((kpe * (normLength - 1) / e0).exp() - 1) / (std::exp(kpe) - 1), 0.0);
+
+    // Same as HillDeGrooteType::computeFvCE (the argument of the log is kept in normVelocity)
+    const double d1(-0.318);
+    const double d2(-8.149);
+    const double d3(-0.374);
+    const double d4(0.886);
+    normVelocity = d2 * velocity / maxSpeed + d3;
+    m_FvCE.segment(start, size) = d1 * (normVelocity + (normVelocity.square() + 1).sqrt()).log() + d4;
+
+    // Same as HillDeGrooteType::computeFlCE
+    const double b11(0.815);
+    const double b21(1.055);
+    const double b31(0.162);
+    const double b41(0.063);
+    const double b12(0.433);
+    const double b22(0.717);
+    const double b32(-0.030);
+    const double b42(0.200);
+    const double b13(0.100);
+    const double b23(1.000);
+    const double b33(0.354);
+    const double b43(0.0);
+    m_FlCE.segment(start, size) =
+        b11 * (-0.5 * (normLength - b21).square() / (b31 + b41 * normLength).square()).exp()
+        + b12 * (-0.5 * (normLength - b22).square() / (b32 + b42 * normLength).square()).exp()
+        + b13 * (-0.5 * (normLength - b23).square() / (b33 + b43 * normLength).square()).exp();
+
+    // Same as HillType::computeDamping
+    m_damping.segment(start, size) = (velocity > 0).select(
+                                         velocity / (optimalLength * maxSpeed) * m_csteDamping.segment(start, size), 0.0);
+    if (!withDerivatives) {
+        return;
+    }
+
+    m_dFlPEdLength.segment(start, size) = (normLength > 1).select(
+            (kpe * (normLength - 1) / e0).exp() * kpe / e0 / (std::exp(kpe) - 1) / optimalLength, 0.0);
+
+    // The derivative of asinh(w) is 1 / sqrt(w^2 + 1)
+    m_dFvCEdVelocity.segment(start, size) = d1 * d2 / maxSpeed / (normVelocity.square() + 1).sqrt();
+
+    // Each gaussian b1 * exp(-0.5 * ((ln - b2) / (b3 + b4 * ln))^2) has the derivative
+    // -b1 * exp(...) * (ln - b2) * (b3 + b4 * b2) / (b3 + b4 * ln)^3
+    m_dFlCEdLength.segment(start, size) =
+        (-b11 * (-0.5 * (normLength - b21).square() / (b31 + b41 * normLength).square()).exp()
+         * (normLength - b21) * (b31 + b41 * b21) / (b31 + b41 * normLength).cube()
+         - b12 * (-0.5 * (normLength - b22).square() / (b32 + b42 * normLength).square()).exp()
+         * (normLength - b22) * (b32 + b42 * b22) / (b32 + b42 * normLength).cube()
+         - b13 * (-0.5 * (normLength - b23).square() / (b33 + b43 * normLength).square()).exp()
+         * (normLength - b23) * (b33 + b43 * b23) / (b33 + b43 * normLength).cube())
+        / optimalLength;
+    m_dFlCEdActivation.segment(start, size).setZero();
+    m_dDampingdVelocity.segment(start, size) = (velocity > 0).select(
+                m_csteDamping.segment(start, size) / (optimalLength * maxSpeed), 0.0);
+}
+
+#endif
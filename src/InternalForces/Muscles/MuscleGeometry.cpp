@@ -51,6 +51,13 @@ void internal_forces::muscles::MuscleGeometry::DeepCopy(const internal_forces::m
     *m_muscleTendonLength = *other.m_muscleTendonLength;
 }
 
+void internal_forces::muscles::MuscleGeometry::detachEvaluationState()
+{
+    internal_forces::Geometry::detachEvaluationState();
+    m_muscleLength = std::make_shared<utils::Scalar>(*m_muscleLength);
+    m_muscleTendonLength = std::make_shared<utils::Scalar>(*m_muscleTendonLength);
+}
+
 
 // ------ PUBLIC FUNCTIONS ------ //
 void internal_forces::muscles::MuscleGeometry::updateKinematics(
@@ -137,6 +144,27 @@ void internal_forces::muscles::MuscleGeometry::updateKinematics(
     _updateKinematics(Qdot, &characteristics);
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void internal_forces::muscles::MuscleGeometry::updateKinematics(
+    const utils::Scalar& musculoTendonLength,
+    const utils::Matrix& jacobianLength,
+    const internal_forces::muscles::Characteristics& characteristics,
+    const rigidbody::GeneralizedVelocity* Qdot)
+{
+    *m_muscleTendonLength = musculoTendonLength;
+    *m_muscleLength = (musculoTendonLength - characteristics.tendonSlackLength())/std::cos(characteristics.pennationAngle());
+    *m_jacobianLength = jacobianLength;
+    *m_isGeometryComputed = true;
+
+    if (Qdot != nullptr) {
+        velocity(*Qdot);
+        *m_isVelocityComputed = true;
+    } else {
+        *m_isVelocityComputed = false;
+    }
+}
+#endif
+
 const utils::Scalar& internal_forces::muscles::MuscleGeometry::length() const
 {
     utils::Error::check(*m_isGeometryComputed,
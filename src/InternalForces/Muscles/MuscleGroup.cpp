@@ -18,7 +18,8 @@ internal_forces::muscles::MuscleGroup::MuscleGroup() :
     m_mus(std::make_shared<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>>()),
     m_name(std::make_shared<utils::String>()),
     m_originName(std::make_shared<utils::String>()),
-    m_insertName(std::make_shared<utils::String>())
+    m_insertName(std::make_shared<utils::String>()),
+    m_isMuscleTableOutdated(std::make_shared<bool>(true))
 {
 
 }
@@ -28,7 +29,8 @@ internal_forces::muscles::MuscleGroup::MuscleGroup(const internal_forces::muscle
     m_mus(other.m_mus),
     m_name(other.m_name),
     m_originName(other.m_originName),
-    m_insertName(other.m_insertName)
+    m_insertName(other.m_insertName),
+    m_isMuscleTableOutdated(other.m_isMuscleTableOutdated)
 {
 
 }
@@ -40,7 +42,8 @@ internal_forces::muscles::MuscleGroup::MuscleGroup(
     m_mus(std::make_shared<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>>()),
     m_name(std::make_shared<utils::String>(name)),
     m_originName(std::make_shared<utils::String>(originName)),
-    m_insertName(std::make_shared<utils::String>(insertionName))
+    m_insertName(std::make_shared<utils::String>(insertionName)),
+    m_isMuscleTableOutdated(std::make_shared<bool>(true))
 {
 }
 
@@ -61,48 +64,74 @@ void internal_forces::muscles::MuscleGroup::DeepCopy(
 {
     m_mus->resize(other.m_mus->size());
     for (size_t i=0; i<other.m_mus->size(); ++i) {
-        if ((*other.m_mus)[i]->type() ==
-                internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::IdealizedActuator>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() == internal_forces::muscles::MUSCLE_TYPE::HILL) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillType>((*other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenType>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteType>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_ACTIVE) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenActiveOnlyType>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_FATIGABLE) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenTypeFatigable>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_ACTIVE) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteActiveOnlyType>((
-                              *other.m_mus)[i]);
-        } else if ((*other.m_mus)[i]->type() ==
-                   internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_FATIGABLE) {
-            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteTypeFatigable>((
-                              *other.m_mus)[i]);
+        const internal_forces::muscles::Muscle& muscle(*(*other.m_mus)[i]);
+        if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::IdealizedActuator>(
+                              static_cast<const internal_forces::muscles::IdealizedActuator&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillType>(
+                              static_cast<const internal_forces::muscles::HillType&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenType>(
+                              static_cast<const internal_forces::muscles::HillThelenType&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteType>(
+                              static_cast<const internal_forces::muscles::HillDeGrooteType&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_ACTIVE) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenActiveOnlyType>(
+                              static_cast<const internal_forces::muscles::HillThelenActiveOnlyType&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_FATIGABLE) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillThelenTypeFatigable>(
+                              static_cast<const internal_forces::muscles::HillThelenTypeFatigable&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_ACTIVE) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteActiveOnlyType>(
+                              static_cast<const internal_forces::muscles::HillDeGrooteActiveOnlyType&>(muscle).DeepCopy());
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_FATIGABLE) {
+            (*m_mus)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteTypeFatigable>(
+                              static_cast<const internal_forces::muscles::HillDeGrooteTypeFatigable&>(muscle).DeepCopy());
         } else {
             utils::Error::raise("DeepCopy was not prepared to copy " +
                                         utils::String(
-                                            internal_forces::muscles::MUSCLE_TYPE_toStr((*other.m_mus)[i]->type())) + " type");
+                                            internal_forces::muscles::MUSCLE_TYPE_toStr(muscle.type())) + " type");
         }
     }
-    *m_mus = *other.m_mus;
     *m_name = *other.m_name;
     *m_originName = *other.m_originName;
     *m_insertName = *other.m_insertName;
 }
 
+void internal_forces::muscles::MuscleGroup::detachEvaluationState()
+{
+    std::shared_ptr<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>> muscles(
+        std::make_shared<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>>(m_mus->size()));
+    for (size_t i=0; i<m_mus->size(); ++i) {
+        const internal_forces::muscles::Muscle& muscle(*(*m_mus)[i]);
+        if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::IdealizedActuator>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillType>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillThelenType>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteType>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_ACTIVE) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillThelenActiveOnlyType>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_FATIGABLE) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillThelenTypeFatigable>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_ACTIVE) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteActiveOnlyType>(muscle);
+        } else if (muscle.type() == internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_FATIGABLE) {
+            (*muscles)[i] = std::make_shared<internal_forces::muscles::HillDeGrooteTypeFatigable>(muscle);
+        } else {
+            utils::Error::raise("The evaluation state of the " +
+                                utils::String(internal_forces::muscles::MUSCLE_TYPE_toStr(muscle.type())) +
+                                " type cannot be detached");
+        }
+        (*muscles)[i]->detachEvaluationState();
+    }
+    m_mus = muscles;
+}
+
 void internal_forces::muscles::MuscleGroup::addMuscle(
     const utils::String &name,
     internal_forces::muscles::MUSCLE_TYPE type,
@@ -325,6 +354,7 @@ void internal_forces::muscles::MuscleGroup::addMuscle(
     } else {
         utils::Error::raise("Muscle type not found");
     }
+    *m_isMuscleTableOutdated = true;
     return;
 }
 
@@ -0,0 +1,303 @@
+#define BIORBD_API_EXPORTS
+#include "InternalForces/Muscles/MuscleSurrogate.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include "Utils/Error.h"
+#include "Utils/String.h"
+#include "Utils/Range.h"
+#include "Utils/Vector3d.h"
+#include "RigidBody/Joints.h"
+#include "RigidBody/Segment.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "InternalForces/PathModifiers.h"
+#include "InternalForces/Muscles/Muscle.h"
+#include "InternalForces/Muscles/MuscleGeometry.h"
+
+using namespace BIORBD_NAMESPACE;
+
+// Append all the exponents of total degree up to remaining for the dof from dof onward
+static void addMonomials(
+    std::vector<unsigned int>& exponents,
+    std::vector<unsigned int>& current,
+    size_t dof,
+    unsigned int remaining)
+{
+    if (dof == current.size()) {
+        exponents.insert(exponents.end(), current.begin(), current.end());
+        return;
+    }
+    for (unsigned int e=0; e<=remaining; ++e) {
+        current[dof] = e;
+        addMonomials(exponents, current, dof+1, remaining-e);
+    }
+    current[dof] = 0;
+}
+
+// Mark the dof which move the segment a point is attached to
+static void countDofChain(
+    const rigidbody::Joints& model,
+    const utils::Vector3d& point,
+    std::vector<size_t>& count)
+{
+    unsigned int id(model.GetBodyId(point.parent().c_str()));
+    utils::Error::check(model.IsBodyId(id),
+                        "The segment " + point.parent() + " of a muscle point was not found");
+    for (size_t dof : model.getDofChain(id)) {
+        ++count[dof];
+    }
+}
+
+internal_forces::muscles::MuscleSurrogate::MuscleSurrogate() :
+    m_isFitted(false),
+    m_degree(0),
+    m_nbQ(0),
+    m_maxError(0),
+    m_rmsError(0),
+    m_maxJacobianError(0)
+{
+
+}
+
+internal_forces::muscles::MuscleSurrogate internal_forces::muscles::MuscleSurrogate::DeepCopy() const
+{
+    internal_forces::muscles::MuscleSurrogate copy;
+    copy.DeepCopy(*this);
+    return copy;
+}
+
+void internal_forces::muscles::MuscleSurrogate::DeepCopy(
+    const internal_forces::muscles::MuscleSurrogate &other)
+{
+    m_isFitted = other.m_isFitted;
+    m_degree = other.m_degree;
+    m_nbQ = other.m_nbQ;
+    m_dofs = other.m_dofs;
+    m_center = other.m_center;
+    m_halfRange = other.m_halfRange;
+    m_exponents = other.m_exponents;
+    m_coefficients = other.m_coefficients;
+    m_maxError = other.m_maxError;
+    m_rmsError = other.m_rmsError;
+    m_maxJacobianError = other.m_maxJacobianError;
+}
+
+void internal_forces::muscles::MuscleSurrogate::fit(
+    rigidbody::Joints &model,
+    internal_forces::muscles::Muscle &muscle,
+    unsigned int degree,
+    size_t nbSamples,
+    unsigned int seed)
+{
+    utils::Error::check(model.nbQ() == model.nbDof(),
+                        "Muscle surrogates are not implemented for models with quaternions");
+    m_isFitted = false;
+    m_degree = degree;
+    m_nbQ = model.nbQ();
+
+    // The dof which move all the points move the path rigidly, so the length does not depend on them
+    const internal_forces::muscles::MuscleGeometry& geometry(muscle.position());
+    const internal_forces::PathModifiers& pathModifiers(muscle.pathModifier());
+    std::vector<size_t> count(m_nbQ, 0);
+    countDofChain(model, geometry.originInLocal(), count);
+    countDofChain(model, geometry.insertionInLocal(), count);
+    for (size_t i=0; i<pathModifiers.nbObjects(); ++i) {
+        countDofChain(model, pathModifiers.object(i), count);
+    }
+    size_t nbPoints(2 + pathModifiers.nbObjects());
+    m_dofs.clear();
+    for (size_t i=0; i<m_nbQ; ++i) {
+        if (count[i] > 0 && count[i] < nbPoints) {
+            m_dofs.push_back(i);
+        }
+    }
+    Eigen::Index nbDofs(static_cast<Eigen::Index>(m_dofs.size()));
+
+    // The ranges of the dof, in the order of the generalized coordinates. The segments added
+    // without ranges take the default range of their dof
+    std::vector<utils::Range> ranges;
+    for (size_t i=0; i<model.nbSegment(); ++i) {
+        const rigidbody::Segment& segment(model.segment(i));
+        const std::vector<utils::Range>& segmentRanges(segment.QRanges());
+        bool hasRanges(segmentRanges.size() == segment.nbDof());
+        for (size_t j=0; j<segment.nbDof(); ++j) {
+            ranges.push_back(hasRanges ? segmentRanges[j] : utils::Range());
+        }
+    }
+    utils::Error::check(ranges.size() == m_nbQ,
+                        "The dof of the segments do not match the generalized coordinates");
+    m_center.resize(nbDofs);
+    m_halfRange.resize(nbDofs);
+    for (Eigen::Index k=0; k<nbDofs; ++k) {
+        const utils::Range& range(ranges[m_dofs[static_cast<size_t>(k)]]);
+        m_center[k] = (range.max() + range.min()) / 2;
+        m_halfRange[k] = (range.max() - range.min()) / 2;
+        utils::Error::check(m_halfRange[k] > 0,
+                            "The range of a dof spanned by a muscle must not be empty");
+    }
+
+    std::vector<unsigned int> current(m_dofs.size(), 0);
+    m_exponents.clear();
+    addMonomials(m_exponents, current, 0, m_degree);
+    Eigen::Index nbMonomials(nbDofs > 0 ?
+                             static_cast<Eigen::Index>(m_exponents.size()) / nbDofs : 1);
+    if (nbSamples == 0) {
+        nbSamples = std::max(static_cast<size_t>(20 * nbMonomials), static_cast<size_t>(100));
+    }
+    utils::Error::check(nbSamples >= static_cast<size_t>(nbMonomials),
+                        "There must be at least as many samples as coefficients in the surrogate");
+    Eigen::Index nbRows(static_cast<Eigen::Index>(nbSamples));
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> distribution(-1, 1);
+    rigidbody::GeneralizedCoordinates Q(model);
+    Q.setZero();
+
+    // Least squares fit of the coefficients
+    utils::Matrix A(nbRows, nbMonomials);
+    utils::Vector b(nbRows);
+    for (Eigen::Index s=0; s<nbRows; ++s) {
+        for (Eigen::Index k=0; k<nbDofs; ++k) {
+            Q[static_cast<Eigen::Index>(m_dofs[static_cast<size_t>(k)])] =
+                m_center[k] + m_halfRange[k] * distribution(generator);
+        }
+        muscle.updateOrientations(model, Q, 2);
+        b[s] = muscle.position().musculoTendonLength();
+
+        computePowers(Q);
+        for (Eigen::Index m=0; m<nbMonomials; ++m) {
+            double value(1);
+            for (Eigen::Index k=0; k<nbDofs; ++k) {
+                value *= m_powers(m_exponents[static_cast<size_t>(m*nbDofs + k)], k);
+            }
+            A(s, m) = value;
+        }
+    }
+    m_coefficients = A.colPivHouseholderQr().solve(b);
+    m_isFitted = true;
+
+    // Measure the errors on samples which were not used by the fit
+    utils::Scalar length;
+    utils::Matrix jacobianLength;
+    m_maxError = 0;
+    m_rmsError = 0;
+    m_maxJacobianError = 0;
+    for (Eigen::Index s=0; s<nbRows; ++s) {
+        for (Eigen::Index k=0; k<nbDofs; ++k) {
+            Q[static_cast<Eigen::Index>(m_dofs[static_cast<size_t>(k)])] =
+                m_center[k] + m_halfRange[k] * distribution(generator);
+        }
+        muscle.updateOrientations(model, Q, 2);
+        evaluate(Q, length, jacobianLength);
+
+        double error(std::fabs(length - muscle.position().musculoTendonLength()));
+        m_maxError = std::max(m_maxError, error);
+        m_rmsError += error * error;
+        m_maxJacobianError = std::max(m_maxJacobianError,
+                                      (jacobianLength - muscle.position().jacobianLength()).cwiseAbs().maxCoeff());
+    }
+    m_rmsError = std::sqrt(m_rmsError / static_cast<double>(nbRows));
+}
+
+void internal_forces::muscles::MuscleSurrogate::evaluate(
+    const rigidbody::GeneralizedCoordinates &Q,
+    utils::Scalar &length,
+    utils::Matrix &jacobianLength)
+{
+    utils::Error::check(m_isFitted, "The muscle surrogate must be fitted before being evaluated");
+
+    Eigen::Index nbDofs(static_cast<Eigen::Index>(m_dofs.size()));
+    Eigen::Index nbMonomials(static_cast<Eigen::Index>(m_coefficients.size()));
+    computePowers(Q);
+
+    length = 0;
+    m_gradient.setZero(nbDofs);
+    for (Eigen::Index m=0; m<nbMonomials; ++m) {
+        const unsigned int* exponents(m_exponents.data() + m*nbDofs);
+        double value(m_coefficients[m]);
+        for (Eigen::Index k=0; k<nbDofs; ++k) {
+            value *= m_powers(exponents[k], k);
+        }
+        length += value;
+
+        for (Eigen::Index k=0; k<nbDofs; ++k) {
+            if (exponents[k] == 0) {
+                continue;
+            }
+            double partial(m_coefficients[m] * exponents[k] * m_powers(exponents[k] - 1, k));
+            for (Eigen::Index j=0; j<nbDofs; ++j) {
+                if (j != k) {
+                    partial *= m_powers(exponents[j], j);
+                }
+            }
+            m_gradient[k] += partial;
+        }
+    }
+
+    Eigen::Index nbQ(static_cast<Eigen::Index>(m_nbQ));
+    if (jacobianLength.rows() != 1 || jacobianLength.cols() != nbQ) {
+        jacobianLength.resize(1, nbQ);
+    }
+    jacobianLength.setZero();
+    for (Eigen::Index k=0; k<nbDofs; ++k) {
+        jacobianLength(0, static_cast<Eigen::Index>(m_dofs[static_cast<size_t>(k)])) =
+            m_gradient[k] / m_halfRange[k];
+    }
+}
+
+bool internal_forces::muscles::MuscleSurrogate::isFitted() const
+{
+    return m_isFitted;
+}
+
+const std::vector<size_t>& internal_forces::muscles::MuscleSurrogate::dofs() const
+{
+    return m_dofs;
+}
+
+unsigned int internal_forces::muscles::MuscleSurrogate::degree() const
+{
+    return m_degree;
+}
+
+const utils::Vector& internal_forces::muscles::MuscleSurrogate::coefficients() const
+{
+    return m_coefficients;
+}
+
+double internal_forces::muscles::MuscleSurrogate::maxError() const
+{
+    return m_maxError;
+}
+
+double internal_forces::muscles::MuscleSurrogate::rmsError() const
+{
+    return m_rmsError;
+}
+
+double internal_forces::muscles::MuscleSurrogate::maxJacobianError() const
+{
+    return m_maxJacobianError;
+}
+
+void internal_forces::muscles::MuscleSurrogate::computePowers(
+    const rigidbody::GeneralizedCoordinates &Q)
+{
+    Eigen::Index nbDofs(static_cast<Eigen::Index>(m_dofs.size()));
+    Eigen::Index degree(static_cast<Eigen::Index>(m_degree));
+    if (m_powers.rows() != degree + 1 || m_powers.cols() != nbDofs) {
+        m_powers.resize(degree + 1, nbDofs);
+    }
+    for (Eigen::Index k=0; k<nbDofs; ++k) {
+        double x((Q[static_cast<Eigen::Index>(m_dofs[static_cast<size_t>(k)])] - m_center[k])
+                 / m_halfRange[k]);
+        m_powers(0, k) = 1;
+        for (Eigen::Index e=1; e<=degree; ++e) {
+            m_powers(e, k) = m_powers(e-1, k) * x;
+        }
+    }
+}
+
+#endif
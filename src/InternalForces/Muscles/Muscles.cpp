@@ -9,18 +9,37 @@
 #include "RigidBody/GeneralizedTorque.h"
 #include "InternalForces/Muscles/Muscle.h"
 #include "InternalForces/Muscles/MuscleGroup.h"
+#include "InternalForces/Muscles/MuscleForceEngine.h"
+#include "InternalForces/Muscles/MuscleSurrogate.h"
+#include "InternalForces/Muscles/MuscleGeometry.h"
 #include "InternalForces/Muscles/StateDynamics.h"
 
 using namespace BIORBD_NAMESPACE;
 
 internal_forces::muscles::Muscles::Muscles() :
-    m_mus(std::make_shared<std::vector<internal_forces::muscles::MuscleGroup>>())
+    m_mus(std::make_shared<std::vector<internal_forces::muscles::MuscleGroup>>()),
+    m_isMuscleTableOutdated(std::make_shared<bool>(true)),
+    m_muscleTable(std::make_shared<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>>()),
+    m_muscleGroupTable(std::make_shared<std::vector<size_t>>())
+#ifndef BIORBD_USE_CASADI_MATH
+    ,m_muscleForceEngine(std::make_shared<internal_forces::muscles::MuscleForceEngine>()),
+    m_muscleSurrogates(std::make_shared<std::vector<internal_forces::muscles::MuscleSurrogate>>()),
+    m_useMuscleSurrogates(std::make_shared<bool>(false))
+#endif
 {
 
 }
 
 internal_forces::muscles::Muscles::Muscles(const internal_forces::muscles::Muscles &other) :
-    m_mus(other.m_mus)
+    m_mus(other.m_mus),
+    m_isMuscleTableOutdated(other.m_isMuscleTableOutdated),
+    m_muscleTable(other.m_muscleTable),
+    m_muscleGroupTable(other.m_muscleGroupTable)
+#ifndef BIORBD_USE_CASADI_MATH
+    ,m_muscleForceEngine(other.m_muscleForceEngine),
+    m_muscleSurrogates(other.m_muscleSurrogates),
+    m_useMuscleSurrogates(other.m_useMuscleSurrogates)
+#endif
 {
 
 }
@@ -42,8 +61,43 @@ void internal_forces::muscles::Muscles::DeepCopy(const internal_forces::muscles:
 {
     m_mus->resize(other.m_mus->size());
     for (size_t i=0; i<other.m_mus->size(); ++i) {
-        (*m_mus)[i] = (*other.m_mus)[i];
+        (*m_mus)[i] = (*other.m_mus)[i].DeepCopy();
+        (*m_mus)[i].m_isMuscleTableOutdated = m_isMuscleTableOutdated;
+    }
+    *m_isMuscleTableOutdated = true;
+#ifndef BIORBD_USE_CASADI_MATH
+    m_muscleForceEngine->DeepCopy(*other.m_muscleForceEngine);
+    m_muscleSurrogates->resize(other.m_muscleSurrogates->size());
+    for (size_t i=0; i<other.m_muscleSurrogates->size(); ++i) {
+        (*m_muscleSurrogates)[i] = (*other.m_muscleSurrogates)[i].DeepCopy();
+    }
+    *m_useMuscleSurrogates = *other.m_useMuscleSurrogates;
+#endif
+}
+
+void internal_forces::muscles::Muscles::detachEvaluationState()
+{
+    // The muscles of the groups are indexed again with the detached muscles
+    std::shared_ptr<std::vector<internal_forces::muscles::MuscleGroup>> groups(
+        std::make_shared<std::vector<internal_forces::muscles::MuscleGroup>>(*m_mus));
+    m_isMuscleTableOutdated = std::make_shared<bool>(true);
+    for (auto& group : *groups) {
+        group.detachEvaluationState();
+        group.m_isMuscleTableOutdated = m_isMuscleTableOutdated;
     }
+    m_mus = groups;
+    m_muscleTable = std::make_shared<std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>>();
+    m_muscleGroupTable = std::make_shared<std::vector<size_t>>();
+#ifndef BIORBD_USE_CASADI_MATH
+    m_muscleForceEngine = std::make_shared<internal_forces::muscles::MuscleForceEngine>();
+    std::shared_ptr<std::vector<internal_forces::muscles::MuscleSurrogate>> surrogates(
+        std::make_shared<std::vector<internal_forces::muscles::MuscleSurrogate>>(m_muscleSurrogates->size()));
+    for (size_t i=0; i<m_muscleSurrogates->size(); ++i) {
+        (*surrogates)[i] = (*m_muscleSurrogates)[i].DeepCopy();
+    }
+    m_muscleSurrogates = surrogates;
+    m_useMuscleSurrogates = std::make_shared<bool>(*m_useMuscleSurrogates);
+#endif
 }
 
 
@@ -58,6 +112,28 @@ void internal_forces::muscles::Muscles::addMuscleGroup(
     }
 
     m_mus->push_back(internal_forces::muscles::MuscleGroup(name, originName, insertionName));
+    m_mus->back().m_isMuscleTableOutdated = m_isMuscleTableOutdated;
+    *m_isMuscleTableOutdated = true;
+}
+
+void internal_forces::muscles::Muscles::updateMuscleTable() const
+{
+    if (!*m_isMuscleTableOutdated) {
+        return;
+    }
+
+    m_muscleTable->clear();
+    m_muscleGroupTable->clear();
+    for (size_t i=0; i<m_mus->size(); ++i) {
+        for (const auto& muscle : (*m_mus)[i].muscles()) {
+            m_muscleTable->push_back(muscle);
+            m_muscleGroupTable->push_back(i);
+        }
+    }
+    *m_isMuscleTableOutdated = false;
+#ifndef BIORBD_USE_CASADI_MATH
+    m_muscleForceEngine->invalidate();
+#endif
 }
 
 int internal_forces::muscles::Muscles::getMuscleGroupId(const utils::String
@@ -70,38 +146,40 @@ int internal_forces::muscles::Muscles::getMuscleGroupId(const utils::String
     return -1;
 }
 
-const std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>
+const std::vector<std::shared_ptr<internal_forces::muscles::Muscle>>&
         internal_forces::muscles::Muscles::muscles() const
 {
-    std::vector<std::shared_ptr<internal_forces::muscles::Muscle>> m;
-    for (auto group : muscleGroups()) {
-        for (auto muscle : group.muscles()) {
-            m.push_back(muscle);
-        }
-    }
-    return m;
+    updateMuscleTable();
+    return *m_muscleTable;
 }
 
 const internal_forces::muscles::Muscle &internal_forces::muscles::Muscles::muscle(
     size_t idx) const
 {
-    for (auto g : muscleGroups()) {
-        if (idx >= g.nbMuscles()) {
-            idx -= g.nbMuscles();
-        } else {
-            return g.muscle(idx);
-        }
-    }
-    utils::Error::raise("idx is higher than the number of muscles");
+    utils::Error::check(idx<nbMuscles(), "idx is higher than the number of muscles");
+    return *(*m_muscleTable)[idx];
+}
+
+internal_forces::muscles::Muscle &internal_forces::muscles::Muscles::muscle(
+    size_t idx)
+{
+    utils::Error::check(idx<nbMuscles(), "idx is higher than the number of muscles");
+    return *(*m_muscleTable)[idx];
+}
+
+size_t internal_forces::muscles::Muscles::muscleGroupIndex(
+    size_t idx) const
+{
+    utils::Error::check(idx<nbMuscles(), "idx is higher than the number of muscles");
+    return (*m_muscleGroupTable)[idx];
 }
 
 std::vector<utils::String> internal_forces::muscles::Muscles::muscleNames() const
 {
+    updateMuscleTable();
     std::vector<utils::String> names;
-    for (auto group : muscleGroups()) {
-        for (auto muscle : group.muscles()) {
-            names.push_back(muscle->name());
-        }
+    for (const auto& muscle : *m_muscleTable) {
+        names.push_back(muscle->name());
     }
     return names;
 }
@@ -191,14 +269,11 @@ utils::Vector internal_forces::muscles::Muscles::activationDot(
 {
     utils::Vector activationDot(nbMuscleTotal());
 
-    size_t cmp(0);
-    for (size_t i=0; i<nbMuscleGroups(); ++i)
-        for (size_t j=0; j<muscleGroup(i).nbMuscles(); ++j) {
-            // Recueillir dérivées d'activtion
-            activationDot(static_cast<unsigned int>(cmp)) =
-                muscleGroup(i).muscle(j).activationDot(*emg[cmp], areadyNormalized);
-            ++cmp;
-        }
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        // Recueillir dérivées d'activtion
+        activationDot(static_cast<unsigned int>(i)) =
+            (*m_muscleTable)[i]->activationDot(*emg[i], areadyNormalized);
+    }
 
     return activationDot;
 }
@@ -209,18 +284,124 @@ utils::Vector internal_forces::muscles::Muscles::muscleForces(
     // Output variable
     utils::Vector forces(nbMuscleTotal());
 
-    size_t cmpMus(0);
-    for (size_t i=0; i<m_mus->size(); ++i) { // muscle group
-        for (size_t j=0; j<(*m_mus)[i].nbMuscles(); ++j) {
-            forces(static_cast<unsigned int>(cmpMus), 0) = ((*m_mus)[i].muscle(j).force(*emg[cmpMus]));
-            ++cmpMus;
-        }
+#ifdef BIORBD_USE_CASADI_MATH
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        forces(static_cast<unsigned int>(i), 0) = (*m_muscleTable)[i]->force(*emg[i]);
     }
+#else
+    m_muscleForceEngine->computeForces(*this, emg, forces);
+#endif
 
     // The forces
     return forces;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void internal_forces::muscles::Muscles::muscleForces(
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>>& emg,
+    utils::Vector& forces)
+{
+    m_muscleForceEngine->computeForces(*this, emg, forces);
+}
+
+void internal_forces::muscles::Muscles::muscleForceDerivatives(
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>>& emg,
+    utils::Vector& forces,
+    utils::Vector& dForceActivation,
+    utils::Vector& dForceLength,
+    utils::Vector& dForceVelocity)
+{
+    m_muscleForceEngine->computeForceDerivatives(
+        *this, emg, forces, dForceActivation, dForceLength, dForceVelocity);
+}
+
+utils::Matrix internal_forces::muscles::Muscles::muscularJointTorqueActivationJacobian(
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>>& emg)
+{
+    utils::Vector forces, dForceActivation, dForceLength, dForceVelocity;
+    muscleForceDerivatives(emg, forces, dForceActivation, dForceLength, dForceVelocity);
+    return -(musclesLengthJacobian().transpose() * dForceActivation.asDiagonal());
+}
+
+utils::Matrix internal_forces::muscles::Muscles::muscularJointTorqueQJacobianAtConstantMomentArms(
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>>& emg)
+{
+    utils::Vector forces, dForceActivation, dForceLength, dForceVelocity;
+    muscleForceDerivatives(emg, forces, dForceActivation, dForceLength, dForceVelocity);
+    const utils::Matrix& jaco(musclesLengthJacobian());
+    return -(jaco.transpose() * dForceLength.asDiagonal() * jaco);
+}
+
+utils::Matrix internal_forces::muscles::Muscles::muscularJointTorqueQdotJacobian(
+    const std::vector<std::shared_ptr<internal_forces::muscles::State>>& emg)
+{
+    utils::Vector forces, dForceActivation, dForceLength, dForceVelocity;
+    muscleForceDerivatives(emg, forces, dForceActivation, dForceLength, dForceVelocity);
+    const utils::Matrix& jaco(musclesLengthJacobian());
+    return -(jaco.transpose() * dForceVelocity.asDiagonal() * jaco);
+}
+
+internal_forces::muscles::MuscleForceEngine& internal_forces::muscles::Muscles::muscleForceEngine()
+{
+    return *m_muscleForceEngine;
+}
+
+void internal_forces::muscles::Muscles::fitMuscleSurrogates(
+    unsigned int degree,
+    size_t nbSamples)
+{
+    // Assuming that this is also a Joints type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+
+    updateMuscleTable();
+    m_muscleSurrogates->resize(m_muscleTable->size());
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        (*m_muscleSurrogates)[i].fit(model, *(*m_muscleTable)[i], degree, nbSamples,
+                                     static_cast<unsigned int>(i));
+    }
+}
+
+void internal_forces::muscles::Muscles::useMuscleSurrogates(
+    bool useSurrogates)
+{
+    if (useSurrogates) {
+        utils::Error::check(m_muscleSurrogates->size() == nbMuscles(),
+                            "The muscle surrogates must be fitted (via fitMuscleSurrogates) before being used");
+    }
+    *m_useMuscleSurrogates = useSurrogates;
+}
+
+bool internal_forces::muscles::Muscles::isUsingMuscleSurrogates() const
+{
+    return *m_useMuscleSurrogates;
+}
+
+const internal_forces::muscles::MuscleSurrogate& internal_forces::muscles::Muscles::muscleSurrogate(
+    size_t idx) const
+{
+    utils::Error::check(idx<m_muscleSurrogates->size(),
+                        "Idx for muscle surrogate is too high, or the surrogates were not fitted");
+    return (*m_muscleSurrogates)[idx];
+}
+
+void internal_forces::muscles::Muscles::updateMusclesFromSurrogates(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity* QDot)
+{
+    updateMuscleTable();
+    utils::Error::check(m_muscleSurrogates->size() == m_muscleTable->size(),
+                        "The muscle surrogates must be fitted again after a muscle was added");
+
+    utils::Scalar length;
+    utils::Matrix jacobianLength;
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        internal_forces::muscles::Muscle& muscle(*(*m_muscleTable)[i]);
+        (*m_muscleSurrogates)[i].evaluate(Q, length, jacobianLength);
+        muscle.m_position->updateKinematics(length, jacobianLength, *muscle.m_characteristics, QDot);
+    }
+}
+#endif
+
 utils::Vector internal_forces::muscles::Muscles::muscleForces(
     const std::vector<std::shared_ptr<internal_forces::muscles::State>> &emg,
     const rigidbody::GeneralizedCoordinates& Q,
@@ -243,12 +424,10 @@ utils::Matrix internal_forces::muscles::Muscles::musclesLengthJacobian()
     const rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 
     utils::Matrix tp(nbMuscleTotal(), model.nbDof());
-    size_t cmpMus(0);
-    for (size_t i=0; i<nbMuscleGroups(); ++i)
-        for (size_t j=0; j<((*m_mus)[i]).nbMuscles(); ++j) {
-            tp.block(static_cast<unsigned int>(cmpMus++),0,1, static_cast<unsigned int>(model.nbDof())) = 
-                ((*m_mus)[i]).muscle(j).position().jacobianLength();
-        }
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        tp.block(static_cast<unsigned int>(i),0,1, static_cast<unsigned int>(model.nbDof())) =
+            (*m_muscleTable)[i]->position().jacobianLength();
+    }
 
     return tp;
 
@@ -270,11 +449,8 @@ size_t internal_forces::muscles::Muscles::nbMuscleTotal() const
 
 size_t internal_forces::muscles::Muscles::nbMuscles() const
 {
-    size_t total(0);
-    for (size_t grp=0; grp<m_mus->size(); ++grp) { // muscular group
-        total += (*m_mus)[grp].nbMuscles();
-    }
-    return total;
+    updateMuscleTable();
+    return m_muscleTable->size();
 }
 
 void internal_forces::muscles::Muscles::updateMuscles(
@@ -282,6 +458,13 @@ void internal_forces::muscles::Muscles::updateMuscles(
     const rigidbody::GeneralizedVelocity& QDot,
     bool updateKin)
 {
+#ifndef BIORBD_USE_CASADI_MATH
+    if (*m_useMuscleSurrogates) {
+        updateMusclesFromSurrogates(Q, &QDot);
+        return;
+    }
+#endif
+
     // Assuming that this is also a Joints type (via BiorbdModel)
     rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 
@@ -297,20 +480,27 @@ void internal_forces::muscles::Muscles::updateMuscles(
     }
 #endif
 
-    for (auto group : *m_mus) // muscle group
-        for (size_t j=0; j<group.nbMuscles(); ++j) {
-            group.muscle(j).updateOrientations(model, Q, QDot, updateKinTP);
+    updateMuscleTable();
+    for (const auto& muscle : *m_muscleTable) {
+        muscle->updateOrientations(model, Q, QDot, updateKinTP);
 #ifndef BIORBD_USE_CASADI_MATH
-            if (updateKinTP){
-                updateKinTP=1;
-            }
-#endif
+        if (updateKinTP){
+            updateKinTP=1;
         }
+#endif
+    }
 }
 void internal_forces::muscles::Muscles::updateMuscles(
     const rigidbody::GeneralizedCoordinates& Q,
     bool updateKin)
 {
+#ifndef BIORBD_USE_CASADI_MATH
+    if (*m_useMuscleSurrogates) {
+        updateMusclesFromSurrogates(Q, nullptr);
+        return;
+    }
+#endif
+
     // Assuming that this is also a Joints type (via BiorbdModel)
     rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
                                        (*this);
@@ -328,36 +518,36 @@ void internal_forces::muscles::Muscles::updateMuscles(
 #endif
 
     // Update all the muscles
-    for (auto group : *m_mus) // muscle group
-        for (size_t j=0; j<group.nbMuscles(); ++j) {
-            group.muscle(j).updateOrientations(model, Q,updateKinTP);
+    updateMuscleTable();
+    for (const auto& muscle : *m_muscleTable) {
+        muscle->updateOrientations(model, Q,updateKinTP);
 #ifndef BIORBD_USE_CASADI_MATH
-            if (updateKinTP){
-                updateKinTP=1;
-            }
-#endif
+        if (updateKinTP){
+            updateKinTP=1;
         }
+#endif
+    }
 }
 void internal_forces::muscles::Muscles::updateMuscles(
     std::vector<std::vector<utils::Vector3d>>& musclePointsInGlobal,
     std::vector<utils::Matrix> &jacoPointsInGlobal,
     const rigidbody::GeneralizedVelocity& QDot)
 {
-    size_t cmpMuscle = 0;
-    for (auto group : *m_mus) // muscle  group
-        for (size_t j=0; j<group.nbMuscles(); ++j) {
-            group.muscle(j).updateOrientations(musclePointsInGlobal[cmpMuscle],
-                                               jacoPointsInGlobal[cmpMuscle], QDot);
-            ++cmpMuscle;
-        }
+    updateMuscleTable();
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        (*m_muscleTable)[i]->updateOrientations(musclePointsInGlobal[i],
+                                                jacoPointsInGlobal[i], QDot);
+    }
 }
 
 std::vector<std::shared_ptr<internal_forces::muscles::State>>
         internal_forces::muscles::Muscles::stateSet()
 {
+    updateMuscleTable();
     std::vector<std::shared_ptr<internal_forces::muscles::State>> out;
-    for (size_t i=0; i<nbMuscles(); ++i) {
-        out.push_back(muscle(i).m_state);
+    out.reserve(m_muscleTable->size());
+    for (const auto& muscle : *m_muscleTable) {
+        out.push_back(muscle->m_state);
     }
     return out;
 }
@@ -367,11 +557,9 @@ void internal_forces::muscles::Muscles::updateMuscles(
     std::vector<utils::Matrix> &jacoPointsInGlobal)
 {
     // Updater all the muscles
-    size_t cmpMuscle = 0;
-    for (auto group : *m_mus) // muscle group
-        for (size_t j=0; j<group.nbMuscles(); ++j) {
-            group.muscle(j).updateOrientations(musclePointsInGlobal[cmpMuscle],
-                                               jacoPointsInGlobal[cmpMuscle]);
-            ++cmpMuscle;
-        }
+    updateMuscleTable();
+    for (size_t i=0; i<m_muscleTable->size(); ++i) {
+        (*m_muscleTable)[i]->updateOrientations(musclePointsInGlobal[i],
+                                                jacoPointsInGlobal[i]);
+    }
 }
@@ -264,34 +264,18 @@ bool internal_forces::muscles::StaticOptimizationIpopt::eval_jac_g(
         if (new_x) {
             dispatch(x);
         }
-        const rigidbody::GeneralizedTorque& GeneralizedTorqueMusc(
-            m_model.muscularJointTorque(*m_states));
+        // The torque is linear in the forces, so the analytical derivatives of the forces with
+        // respect to the activations give the whole jacobian from one evaluation of the forces
+        const utils::Matrix& jacobianActivation(
+            m_model.muscularJointTorqueActivationJacobian(*m_states));
         unsigned int k(0);
         for( unsigned int j = 0; j < *m_nbMus; ++j ) {
-            std::vector<std::shared_ptr<internal_forces::muscles::State>> stateEpsilon;
-            for (unsigned int i = 0; i < *m_nbMus; ++i) {
-                unsigned int delta(0);
-                if (i == j) {
-                    delta = 1;
-                }
-                stateEpsilon.push_back(
-                    std::make_shared<internal_forces::muscles::State>(
-                        internal_forces::muscles::State(0, (*m_activations)[i]+delta* *m_eps)));
-            }
-            const rigidbody::GeneralizedTorque& GeneralizedTorqueCalculEpsilon(
-                m_model.muscularJointTorque(stateEpsilon));
             for( unsigned int i = 0; i < static_cast<unsigned int>(m); i++ ) {
-                values[k++] = (GeneralizedTorqueCalculEpsilon[i]-GeneralizedTorqueMusc[i])/
-                              *m_eps;
+                values[k++] = jacobianActivation(i, j);
                 if (*m_verbose >= 3) {
                     std::cout << std::setprecision (20) << std::endl;
                     std::cout << "values[" << k-1 << "]: " << values[k-1] << std::endl;
-                    std::cout << "GeneralizedTorqueCalculEpsilon[" << i << "]: " <<
-                              GeneralizedTorqueCalculEpsilon[i] << std::endl;
-                    std::cout << "GeneralizedTorqueMusc[" << i << "]: " << GeneralizedTorqueMusc[i]
-                              << std::endl;
                 }
-
             }
         }
         for( unsigned int j = 0; j < *m_nbTorqueResidual; j++ ) {
@@ -30,8 +30,19 @@ void internal_forces::PathModifiers::DeepCopy(const
 {
     m_obj->resize(other.m_obj->size());
     for (size_t i=0; i<other.m_obj->size(); ++i) {
-        (*m_obj)[i] = std::make_shared<utils::Vector3d>();
-        *(*m_obj)[i] = (*other.m_obj)[i]->DeepCopy();
+        const utils::Vector3d& obj(*(*other.m_obj)[i]);
+        if (obj.typeOfNode() == utils::NODE_TYPE::WRAPPING_SPHERE) {
+            (*m_obj)[i] = std::make_shared<internal_forces::WrappingSphere>(
+                              static_cast<const internal_forces::WrappingSphere&>(obj).DeepCopy());
+        } else if (obj.typeOfNode() == utils::NODE_TYPE::WRAPPING_HALF_CYLINDER) {
+            (*m_obj)[i] = std::make_shared<internal_forces::WrappingHalfCylinder>(
+                              static_cast<const internal_forces::WrappingHalfCylinder&>(obj).DeepCopy());
+        } else if (obj.typeOfNode() == utils::NODE_TYPE::VIA_POINT) {
+            (*m_obj)[i] = std::make_shared<internal_forces::ViaPoint>(
+                              static_cast<const internal_forces::ViaPoint&>(obj).DeepCopy());
+        } else {
+            (*m_obj)[i] = std::make_shared<utils::Vector3d>(obj.DeepCopy());
+        }
     }
     *m_nbWraps = *other.m_nbWraps;
     *m_nbVia = *other.m_nbVia;
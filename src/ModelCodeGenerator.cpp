@@ -0,0 +1,400 @@
+#define BIORBD_API_EXPORTS
+#include "ModelCodeGenerator.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "BiorbdModel.h"
+#include "Utils/Error.h"
+#include "Utils/Path.h"
+#include "Utils/String.h"
+#include "RigidBody/NodeSegment.h"
+#include "RigidBody/Segment.h"
+
+using namespace BIORBD_NAMESPACE;
+
+// Write a number with all its significant digits
+static std::string toCode(
+    double value)
+{
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+    return out.str();
+}
+
+static std::string toCode(
+    const RigidBodyDynamics::Math::Vector3d& v)
+{
+    return "Eigen::Vector3d(" + toCode(v(0)) + ", " + toCode(v(1)) + ", " + toCode(v(2)) + ")";
+}
+
+static std::string toCode(
+    const RigidBodyDynamics::Math::Matrix3d& m)
+{
+    std::string out("(Eigen::Matrix3d() << ");
+    for (unsigned int i=0; i<3; ++i) {
+        for (unsigned int j=0; j<3; ++j) {
+            out += toCode(m(i, j)) + (i == 2 && j == 2 ? "" : ", ");
+        }
+    }
+    return out + ").finished()";
+}
+
+// Return the index of the axis if v is a unit axis of the frame, -1 otherwise
+static int unitAxis(
+    const RigidBodyDynamics::Math::Vector3d& v)
+{
+    for (int i=0; i<3; ++i) {
+        if (v(i) == 1 && v((i+1) % 3) == 0 && v((i+2) % 3) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Rotate the frame R of an angle Q[q] about its axis
+static void writeElementalRotation(
+    std::ostream& out,
+    const std::string& R,
+    int axis,
+    unsigned int q)
+{
+    // R * Rx(q) only changes the y and z columns of R, and so on
+    int i((axis + 1) % 3);
+    int j((axis + 2) % 3);
+    out << "    {\n"
+        << "        const double c(std::cos(Q(" << q << "))), s(std::sin(Q(" << q << ")));\n"
+        << "        const Eigen::Vector3d a(" << R << ".col(" << i << ")), b(" << R << ".col(" << j << "));\n"
+        << "        " << R << ".col(" << i << ") = c * a + s * b;\n"
+        << "        " << R << ".col(" << j << ") = c * b - s * a;\n"
+        << "    }\n";
+}
+
+// Place the frame f relatively to its parent frame
+static void writePlacement(
+    std::ostream& out,
+    size_t f,
+    size_t parent,
+    const RigidBodyDynamics::Math::SpatialTransform& X)
+{
+    RigidBodyDynamics::Math::Matrix3d rot(X.E.transpose());
+    bool isIdentity(rot.isIdentity(0));
+    bool isZero(X.r.isZero(0));
+    std::string R("s.R[" + std::to_string(f) + "]");
+    std::string p("s.p[" + std::to_string(f) + "]");
+    std::string Rparent("s.R[" + std::to_string(parent) + "]");
+    std::string pparent("s.p[" + std::to_string(parent) + "]");
+
+    if (parent == 0) {
+        out << "    " << R << " = " << (isIdentity ? "Eigen::Matrix3d::Identity()" : toCode(rot)) << ";\n";
+        out << "    " << p << " = " << toCode(X.r) << ";\n";
+    } else {
+        out << "    " << R << " = " << Rparent << (isIdentity ? "" : " * " + toCode(rot)) << ";\n";
+        out << "    " << p << " = " << pparent << (isZero ? "" : " + " + Rparent + " * " + toCode(X.r)) << ";\n";
+    }
+}
+
+void CodeGenerator::writeKinematicsKernels(
+    Model &model,
+    const utils::Path& pathToWrite,
+    const utils::String& kernelsNamespace)
+{
+    utils::String code(kinematicsKernels(model, kernelsNamespace));
+
+    // Manage the case where the destination folder does not exist
+    if(!pathToWrite.isFolderExist()) {
+        pathToWrite.createFolder();
+    }
+
+    std::ofstream file;
+    file.open(pathToWrite.relativePath().c_str());
+    utils::Error::check(file.is_open(), "Could not open " + pathToWrite.relativePath() + " for writing");
+    file << code;
+}
+
+utils::String CodeGenerator::kinematicsKernels(
+    Model &model,
+    const utils::String& kernelsNamespace)
+{
+    size_t nbBodies(model.mBodies.size());
+    size_t nbFrames(nbBodies + model.mFixedBodies.size());
+    unsigned int nbQ(model.q_size);
+    utils::Error::check(model.q_size == model.qdot_size,
+                        "The kinematics kernels cannot be generated for models with quaternions");
+
+    // For each dof, the body which it moves and if it is a rotation
+    std::vector<size_t> dofBody(nbQ);
+    std::vector<bool> dofIsRotation(nbQ);
+
+    // Frame of any rbdl body identification (movable bodies, then fixed bodies)
+    auto frame = [&](unsigned int id) {
+        return id >= model.fixed_body_discriminator ?
+               nbBodies + (id - model.fixed_body_discriminator) : static_cast<size_t>(id);
+    };
+    auto movableBody = [&](size_t f) {
+        return f >= nbBodies ?
+               static_cast<size_t>(model.mFixedBodies[f - nbBodies].mMovableParent) : f;
+    };
+    // All the dof (in increasing order) which move a movable body
+    auto dofOfChain = [&](size_t body) {
+        std::vector<unsigned int> dofs;
+        for (size_t b = body; b != 0; b = model.lambda[b]) {
+            const RigidBodyDynamics::Joint& joint(model.mJoints[b]);
+            for (int k = static_cast<int>(joint.mDoFCount) - 1; k >= 0; --k) {
+                dofs.insert(dofs.begin(), joint.q_index + static_cast<unsigned int>(k));
+            }
+        }
+        return dofs;
+    };
+
+    std::ostringstream fk;
+    for (size_t i=1; i<nbBodies; ++i) {
+        const RigidBodyDynamics::Joint& joint(model.mJoints[i]);
+        unsigned int q(joint.q_index);
+        std::string R("s.R[" + std::to_string(i) + "]");
+        std::string p("s.p[" + std::to_string(i) + "]");
+        fk << "\n    // " << model.GetBodyName(static_cast<unsigned int>(i)) << "\n";
+        writePlacement(fk, i, model.lambda[i], model.X_T[i]);
+
+        switch (joint.mJointType) {
+        case RigidBodyDynamics::JointTypeRevolute:
+        case RigidBodyDynamics::JointTypeRevoluteX:
+        case RigidBodyDynamics::JointTypeRevoluteY:
+        case RigidBodyDynamics::JointTypeRevoluteZ: {
+            RigidBodyDynamics::Math::Vector3d axis(joint.mJointAxes[0].block(0, 0, 3, 1));
+            int k(unitAxis(axis));
+            fk << "    s.origin[" << q << "] = " << p << ";\n";
+            if (k >= 0) {
+                fk << "    s.axis[" << q << "] = " << R << ".col(" << k << ");\n";
+                writeElementalRotation(fk, R, k, q);
+            } else {
+                fk << "    s.axis[" << q << "] = " << R << " * " << toCode(axis) << ";\n";
+                fk << "    " << R << " = " << R << " * Eigen::AngleAxisd(Q(" << q << "), "
+                   << toCode(axis) << ").toRotationMatrix();\n";
+            }
+            dofBody[q] = i;
+            dofIsRotation[q] = true;
+            break;
+        }
+        case RigidBodyDynamics::JointTypePrismatic: {
+            RigidBodyDynamics::Math::Vector3d axis(joint.mJointAxes[0].block(3, 0, 3, 1));
+            int k(unitAxis(axis));
+            fk << "    s.axis[" << q << "] = " << R
+               << (k >= 0 ? ".col(" + std::to_string(k) + ")" : " * " + toCode(axis)) << ";\n";
+            fk << "    " << p << " += Q(" << q << ") * s.axis[" << q << "];\n";
+            dofBody[q] = i;
+            dofIsRotation[q] = false;
+            break;
+        }
+        case RigidBodyDynamics::JointTypeTranslationXYZ:
+            for (unsigned int k=0; k<3; ++k) {
+                fk << "    s.axis[" << q+k << "] = " << R << ".col(" << k << ");\n";
+                dofBody[q+k] = i;
+                dofIsRotation[q+k] = false;
+            }
+            fk << "    " << p << " += " << R << " * Q.segment<3>(" << q << ");\n";
+            break;
+        case RigidBodyDynamics::JointTypeEulerXYZ:
+        case RigidBodyDynamics::JointTypeEulerZYX: {
+            bool isXYZ(joint.mJointType == RigidBodyDynamics::JointTypeEulerXYZ);
+            for (unsigned int k=0; k<3; ++k) {
+                int axis(isXYZ ? static_cast<int>(k) : 2 - static_cast<int>(k));
+                fk << "    s.origin[" << q+k << "] = " << p << ";\n";
+                fk << "    s.axis[" << q+k << "] = " << R << ".col(" << axis << ");\n";
+                writeElementalRotation(fk, R, axis, q+k);
+                dofBody[q+k] = i;
+                dofIsRotation[q+k] = true;
+            }
+            break;
+        }
+        default:
+            utils::Error::raise("The joint of " + utils::String(model.GetBodyName(static_cast<unsigned int>(i)))
+                                + " is not supported by the kinematics kernels generator");
+        }
+    }
+    for (size_t i=0; i<model.mFixedBodies.size(); ++i) {
+        const RigidBodyDynamics::FixedBody& body(model.mFixedBodies[i]);
+        fk << "\n    // " << model.GetBodyName(static_cast<unsigned int>(model.fixed_body_discriminator + i)) << "\n";
+        writePlacement(fk, nbBodies + i, body.mMovableParent, body.mParentTransform);
+    }
+
+    // Segments
+    std::ostringstream jcs;
+    for (size_t i=0; i<model.nbSegment(); ++i) {
+        size_t f(frame(static_cast<unsigned int>(model.segment(i).id())));
+        jcs << "    // " << model.segment(i).name() << "\n"
+            << "    jcs[" << i << "].setIdentity();\n"
+            << "    jcs[" << i << "].block<3, 3>(0, 0) = s.R[" << f << "];\n"
+            << "    jcs[" << i << "].block<3, 1>(0, 3) = s.p[" << f << "];\n";
+    }
+
+    // Markers
+    std::ostringstream markers, markersJacobian;
+    for (size_t i=0; i<model.nbMarkers(); ++i) {
+        const rigidbody::NodeSegment& node(model.marker(i, false));
+        size_t f(frame(model.getParentRbdlId(node)));
+        std::string position("s.p[" + std::to_string(f) + "] + s.R[" + std::to_string(f) + "] * "
+                             + toCode(model.marker(i, true)));
+        markers << "    out.col(" << i << ") = " << position << "; // " << node.name() << "\n";
+
+        markersJacobian << "    {\n"
+                        << "        // " << node.name() << "\n"
+                        << "        const Eigen::Vector3d x(" << position << ");\n";
+        for (unsigned int q : dofOfChain(movableBody(f))) {
+            markersJacobian << "        out.block<3, 1>(" << 3*i << ", " << q << ") = s.axis[" << q << "]"
+                            << (dofIsRotation[q] ? ".cross(x - s.origin[" + std::to_string(q) + "])" : "")
+                            << ";\n";
+        }
+        markersJacobian << "    }\n";
+    }
+
+    // Mass matrix (composite rigid body algorithm, expressed at the global origin)
+    std::ostringstream mass;
+    for (size_t b=1; b<nbBodies; ++b) {
+        const RigidBodyDynamics::Body& body(model.mBodies[b]);
+        std::string idx(std::to_string(b));
+        if (body.mMass == 0 && body.mInertia.isZero(0)) {
+            mass << "    m[" << idx << "] = 0;\n"
+                 << "    h[" << idx << "].setZero();\n"
+                 << "    I[" << idx << "].setZero();\n";
+        } else {
+            mass << "    {\n"
+                 << "        const Eigen::Vector3d c(s.p[" << idx << "] + s.R[" << idx << "] * "
+                 << toCode(body.mCenterOfMass) << ");\n"
+                 << "        m[" << idx << "] = " << toCode(body.mMass) << ";\n"
+                 << "        h[" << idx << "] = m[" << idx << "] * c;\n"
+                 << "        I[" << idx << "] = s.R[" << idx << "] * " << toCode(body.mInertia)
+                 << " * s.R[" << idx << "].transpose()\n"
+                 << "                + m[" << idx << "] * (c.squaredNorm() * Eigen::Matrix3d::Identity() - c * c.transpose());\n"
+                 << "    }\n";
+        }
+    }
+    for (size_t b=nbBodies-1; b>0; --b) {
+        if (model.lambda[b] != 0) {
+            std::string idx(std::to_string(b));
+            std::string parent(std::to_string(model.lambda[b]));
+            mass << "    m[" << parent << "] += m[" << idx << "];\n"
+                 << "    h[" << parent << "] += h[" << idx << "];\n"
+                 << "    I[" << parent << "] += I[" << idx << "];\n";
+        }
+    }
+    for (unsigned int q=0; q<nbQ; ++q) {
+        if (dofIsRotation[q]) {
+            mass << "    S[" << q << "] << s.axis[" << q << "], s.origin[" << q << "].cross(s.axis[" << q << "]);\n";
+        } else {
+            mass << "    S[" << q << "] << Eigen::Vector3d::Zero(), s.axis[" << q << "];\n";
+        }
+    }
+    for (unsigned int q=0; q<nbQ; ++q) {
+        std::string b(std::to_string(dofBody[q]));
+        mass << "    {\n"
+             << "        const Eigen::Vector3d w(S[" << q << "].head<3>()), v(S[" << q << "].tail<3>());\n"
+             << "        Eigen::Matrix<double, 6, 1> F;\n"
+             << "        F << I[" << b << "] * w + h[" << b << "].cross(v), m[" << b << "] * v + w.cross(h[" << b << "]);\n";
+        for (unsigned int j : dofOfChain(dofBody[q])) {
+            if (j > q) {
+                break;
+            }
+            mass << "        M(" << q << ", " << j << ") = " << (j == q ? "" : "M(" + std::to_string(j) + ", " + std::to_string(q) + ") = ")
+                 << "S[" << j << "].dot(F);\n";
+        }
+        mass << "    }\n";
+    }
+
+    std::string guard(kernelsNamespace.toupper() + "_H");
+    std::ostringstream out;
+    out << "// Kinematics kernels generated by biorbd, do not edit\n"
+        << "#ifndef " << guard << "\n"
+        << "#define " << guard << "\n\n"
+        << "#include <array>\n"
+        << "#include <cmath>\n"
+        << "#include <Eigen/Dense>\n\n"
+        << "namespace " << kernelsNamespace << "\n{\n"
+        << "constexpr int nbQ = " << nbQ << ";\n"
+        << "constexpr int nbSegments = " << model.nbSegment() << ";\n"
+        << "constexpr int nbMarkers = " << model.nbMarkers() << ";\n"
+        << "constexpr int nbBodies = " << nbBodies << ";\n"
+        << "constexpr int nbFrames = " << nbFrames << ";\n\n"
+        << "typedef Eigen::Matrix<double, nbQ, 1> VectorQ;\n"
+        << "typedef Eigen::Matrix<double, 3, nbMarkers> MatrixMarkers;\n"
+        << "typedef Eigen::Matrix<double, 3 * nbMarkers, nbQ> MatrixMarkersJacobian;\n"
+        << "typedef Eigen::Matrix<double, nbQ, nbQ> MatrixMass;\n"
+        << "typedef std::array<Eigen::Matrix4d, nbSegments> ArrayJCS;\n\n"
+        << "///\n"
+        << "/// \\brief The frames and the axes of the model at a given Q\n"
+        << "///\n"
+        << "struct State {\n"
+        << "    std::array<Eigen::Matrix3d, nbFrames> R; ///< The orientation of each frame in global\n"
+        << "    std::array<Eigen::Vector3d, nbFrames> p; ///< The origin of each frame in global\n"
+        << "    std::array<Eigen::Vector3d, nbQ> axis; ///< The axis of each dof in global\n"
+        << "    std::array<Eigen::Vector3d, nbQ> origin; ///< A point on the axis of each rotation in global\n"
+        << "};\n\n"
+        << "///\n"
+        << "/// \\brief Compute the frames and the axes of the model\n"
+        << "/// \\param Q The generalized coordinates\n"
+        << "/// \\param s The state to fill\n"
+        << "///\n"
+        << "inline void forwardKinematics(const VectorQ& Q, State& s)\n{\n"
+        << "    s.R[0].setIdentity();\n"
+        << "    s.p[0].setZero();\n"
+        << fk.str()
+        << "}\n\n"
+        << "///\n"
+        << "/// \\brief Compute the joint coordinate systems of the segments in global\n"
+        << "/// \\param s The state computed by forwardKinematics\n"
+        << "/// \\param jcs The output homogeneous matrices\n"
+        << "///\n"
+        << "inline void globalJCS(const State& s, ArrayJCS& jcs)\n{\n"
+        << jcs.str()
+        << "}\n\n"
+        << "///\n"
+        << "/// \\brief Compute the position of the markers in global (with their axes removed)\n"
+        << "/// \\param s The state computed by forwardKinematics\n"
+        << "/// \\param out The output positions (one marker per column)\n"
+        << "///\n"
+        << "inline void markers(const State& s, MatrixMarkers& out)\n{\n"
+        << (model.nbMarkers() ? "" : "    (void)s;\n    (void)out;\n")
+        << markers.str()
+        << "}\n\n"
+        << "///\n"
+        << "/// \\brief Compute the jacobian of the markers (with their axes removed)\n"
+        << "/// \\param s The state computed by forwardKinematics\n"
+        << "/// \\param out The output jacobian (three rows per marker)\n"
+        << "///\n"
+        << "inline void markersJacobian(const State& s, MatrixMarkersJacobian& out)\n{\n"
+        << (model.nbMarkers() ? "" : "    (void)s;\n")
+        << "    out.setZero();\n"
+        << markersJacobian.str()
+        << "}\n\n"
+        << "///\n"
+        << "/// \\brief Compute the mass matrix\n"
+        << "/// \\param s The state computed by forwardKinematics\n"
+        << "/// \\param M The output mass matrix\n"
+        << "///\n"
+        << "inline void massMatrix(const State& s, MatrixMass& M)\n{\n"
+        << "    // Mass, first moment of mass and inertia about the global origin of each subtree\n"
+        << "    std::array<double, nbBodies> m;\n"
+        << "    std::array<Eigen::Vector3d, nbBodies> h;\n"
+        << "    std::array<Eigen::Matrix3d, nbBodies> I;\n"
+        << "    // Motion subspace of each dof at the global origin\n"
+        << "    std::array<Eigen::Matrix<double, 6, 1>, nbQ> S;\n"
+        << "    M.setZero();\n"
+        << mass.str()
+        << "}\n\n"
+        << "inline void globalJCS(const VectorQ& Q, ArrayJCS& jcs)\n{\n"
+        << "    State s;\n    forwardKinematics(Q, s);\n    globalJCS(s, jcs);\n}\n\n"
+        << "inline void markers(const VectorQ& Q, MatrixMarkers& out)\n{\n"
+        << "    State s;\n    forwardKinematics(Q, s);\n    markers(s, out);\n}\n\n"
+        << "inline void markersJacobian(const VectorQ& Q, MatrixMarkersJacobian& out)\n{\n"
+        << "    State s;\n    forwardKinematics(Q, s);\n    markersJacobian(s, out);\n}\n\n"
+        << "inline void massMatrix(const VectorQ& Q, MatrixMass& M)\n{\n"
+        << "    State s;\n    forwardKinematics(Q, s);\n    massMatrix(s, M);\n}\n\n"
+        << "}\n\n"
+        << "#endif // " << guard << "\n";
+    return out.str();
+}
+#endif
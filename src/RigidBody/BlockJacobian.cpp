@@ -0,0 +1,148 @@
+#define BIORBD_API_EXPORTS
+#include "RigidBody/BlockJacobian.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include "Utils/Error.h"
+#include "Utils/Matrix.h"
+#include "Utils/Vector.h"
+
+using namespace BIORBD_NAMESPACE;
+
+rigidbody::BlockJacobian::BlockJacobian(
+    size_t nbQ) :
+    m_nbQ(std::make_shared<size_t>(nbQ)),
+    m_columns(std::make_shared<std::vector<std::vector<size_t>>>()),
+    m_blocks(std::make_shared<std::vector<utils::Matrix>>())
+{
+
+}
+
+rigidbody::BlockJacobian::BlockJacobian(
+    size_t nbQ,
+    const std::vector<std::vector<size_t>>& columns) :
+    m_nbQ(std::make_shared<size_t>(nbQ)),
+    m_columns(std::make_shared<std::vector<std::vector<size_t>>>(columns)),
+    m_blocks(std::make_shared<std::vector<utils::Matrix>>())
+{
+    for (const auto& col : columns) {
+        for (size_t j : col) {
+            utils::Error::check(j < nbQ, "The column pattern exceeds the number of columns");
+        }
+        m_blocks->push_back(utils::Matrix::Zero(3, static_cast<unsigned int>(col.size())));
+    }
+}
+
+rigidbody::BlockJacobian rigidbody::BlockJacobian::DeepCopy() const
+{
+    rigidbody::BlockJacobian copy;
+    copy.DeepCopy(*this);
+    return copy;
+}
+
+void rigidbody::BlockJacobian::DeepCopy(
+    const rigidbody::BlockJacobian &other)
+{
+    *m_nbQ = *other.m_nbQ;
+    *m_columns = *other.m_columns;
+    *m_blocks = *other.m_blocks;
+}
+
+size_t rigidbody::BlockJacobian::nbPoints() const
+{
+    return m_columns->size();
+}
+
+size_t rigidbody::BlockJacobian::nbQ() const
+{
+    return *m_nbQ;
+}
+
+size_t rigidbody::BlockJacobian::nbNonZeros() const
+{
+    size_t n(0);
+    for (const auto& col : *m_columns) {
+        n += 3 * col.size();
+    }
+    return n;
+}
+
+const std::vector<size_t>& rigidbody::BlockJacobian::columns(
+    size_t idx) const
+{
+    utils::Error::check(idx < nbPoints(), "Idx for the point is too high");
+    return (*m_columns)[idx];
+}
+
+const utils::Matrix& rigidbody::BlockJacobian::block(
+    size_t idx) const
+{
+    utils::Error::check(idx < nbPoints(), "Idx for the point is too high");
+    return (*m_blocks)[idx];
+}
+
+utils::Matrix& rigidbody::BlockJacobian::block(
+    size_t idx)
+{
+    utils::Error::check(idx < nbPoints(), "Idx for the point is too high");
+    return (*m_blocks)[idx];
+}
+
+utils::Matrix rigidbody::BlockJacobian::dense(
+    size_t idx) const
+{
+    const std::vector<size_t>& col(columns(idx));
+    const utils::Matrix& b((*m_blocks)[idx]);
+    utils::Matrix out(utils::Matrix::Zero(3, static_cast<unsigned int>(*m_nbQ)));
+    for (size_t j=0; j<col.size(); ++j) {
+        out.col(static_cast<unsigned int>(col[j])) = b.col(static_cast<unsigned int>(j));
+    }
+    return out;
+}
+
+utils::Matrix rigidbody::BlockJacobian::dense() const
+{
+    utils::Matrix out(utils::Matrix::Zero(
+                          static_cast<unsigned int>(3 * nbPoints()), static_cast<unsigned int>(*m_nbQ)));
+    for (size_t i=0; i<nbPoints(); ++i) {
+        const std::vector<size_t>& col((*m_columns)[i]);
+        const utils::Matrix& b((*m_blocks)[i]);
+        for (size_t j=0; j<col.size(); ++j) {
+            out.block(static_cast<unsigned int>(3*i), static_cast<unsigned int>(col[j]), 3, 1)
+                = b.col(static_cast<unsigned int>(j));
+        }
+    }
+    return out;
+}
+
+utils::Vector rigidbody::BlockJacobian::multiply(
+    const utils::Vector& v) const
+{
+    utils::Error::check(static_cast<size_t>(v.size()) == *m_nbQ,
+                        "Wrong size for the vector to multiply");
+    utils::Vector out(utils::Vector::Zero(static_cast<unsigned int>(3 * nbPoints())));
+    for (size_t i=0; i<nbPoints(); ++i) {
+        const std::vector<size_t>& col((*m_columns)[i]);
+        const utils::Matrix& b((*m_blocks)[i]);
+        for (size_t j=0; j<col.size(); ++j) {
+            out.segment(static_cast<unsigned int>(3*i), 3) += b.col(static_cast<unsigned int>(j)) * v(col[j]);
+        }
+    }
+    return out;
+}
+
+utils::Vector rigidbody::BlockJacobian::transposeMultiply(
+    const utils::Vector& f) const
+{
+    utils::Error::check(static_cast<size_t>(f.size()) == 3 * nbPoints(),
+                        "Wrong size for the vector to multiply");
+    utils::Vector out(utils::Vector::Zero(static_cast<unsigned int>(*m_nbQ)));
+    for (size_t i=0; i<nbPoints(); ++i) {
+        const std::vector<size_t>& col((*m_columns)[i]);
+        const utils::Matrix& b((*m_blocks)[i]);
+        for (size_t j=0; j<col.size(); ++j) {
+            out(col[j]) += b.col(static_cast<unsigned int>(j)).dot(f.segment(static_cast<unsigned int>(3*i), 3));
+        }
+    }
+    return out;
+}
+#endif
@@ -2,7 +2,6 @@
 #include "RigidBody/Contacts.h"
 
 #include <rbdl/Kinematics.h>
-#include "BiorbdModel.h"
 #include "Utils/String.h"
 #include "Utils/Error.h"
 #include "Utils/Vector3d.h"
@@ -13,6 +12,7 @@
 
 #include "RigidBody/ExternalForceSet.h"
 #include "RigidBody/Joints.h"
+#include "RigidBody/LoopConstraintSolver.h"
 #include "RigidBody/NodeSegment.h"
 #include "RigidBody/Segment.h"
 #include "RigidBody/GeneralizedCoordinates.h"
@@ -28,7 +28,11 @@ rigidbody::Contacts::Contacts() :
     m_nbreConstraint(std::make_shared<size_t>(0)),
     m_isBinded(std::make_shared<bool>(false)),
     m_rigidContacts(std::make_shared<std::vector<rigidbody::NodeSegment>>()),
-    m_nbLoopConstraint(std::make_shared<size_t>(0))
+    m_nbLoopConstraint(std::make_shared<size_t>(0)),
+    m_constraintSolver(std::make_shared<rigidbody::CONSTRAINT_SOLVER>(rigidbody::CONSTRAINT_SOLVER_DIRECT))
+#ifndef BIORBD_USE_CASADI_MATH
+    ,m_loopConstraintSolver(std::make_shared<rigidbody::LoopConstraintSolver>())
+#endif
 {
 
 }
@@ -48,6 +52,19 @@ void rigidbody::Contacts::DeepCopy(const rigidbody::Contacts
     *m_nbreConstraint = *other.m_nbreConstraint;
     *m_isBinded = *other.m_isBinded;
     *m_rigidContacts = *other.m_rigidContacts;
+    *m_constraintSolver = *other.m_constraintSolver;
+#ifndef BIORBD_USE_CASADI_MATH
+    m_loopConstraintSolver->DeepCopy(*other.m_loopConstraintSolver);
+#endif
+}
+
+void rigidbody::Contacts::detachEvaluationState()
+{
+    m_constraintSolver = std::make_shared<rigidbody::CONSTRAINT_SOLVER>(*m_constraintSolver);
+#ifndef BIORBD_USE_CASADI_MATH
+    m_loopConstraintSolver = std::make_shared<rigidbody::LoopConstraintSolver>(
+                                 m_loopConstraintSolver->DeepCopy());
+#endif
 }
 
 size_t rigidbody::Contacts::AddConstraint(
@@ -151,8 +168,9 @@ std::vector< utils::SpatialVector > rigidbody::Contacts::calcLoopConstraintForce
     const rigidbody::GeneralizedTorque& Tau
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return calcLoopConstraintForces(Q, Qdot, Tau, forceSet);
+    // Assuming that this is also a Joints type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    return calcLoopConstraintForces(Q, Qdot, Tau, model.defaultExternalForces());
 }
 std::vector< utils::SpatialVector > rigidbody::Contacts::calcLoopConstraintForces(
     const rigidbody::GeneralizedCoordinates &Q,
@@ -161,6 +179,7 @@ std::vector< utils::SpatialVector > rigidbody::Contacts::calcLoopConstraintForce
     rigidbody::ExternalForceSet &externalForces
 )
 {
+#ifdef BIORBD_USE_CASADI_MATH
     // all in the world frame
     bool resolveAllInRootFrame = true;
 
@@ -170,9 +189,9 @@ std::vector< utils::SpatialVector > rigidbody::Contacts::calcLoopConstraintForce
     std::vector< RigidBodyDynamics::Math::SpatialTransform > updatedConstraintBodyFramesOutput;
 
     // retrieve the model and the contacts
-    rigidbody::Contacts CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
+    rigidbody::Contacts& CS = getConstraints();
     rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
-    model.ForwardDynamicsConstraintsDirect(Q, Qdot, Tau, CS, externalForces);
+    model.ForwardDynamicsConstraints(Q, Qdot, Tau, externalForces);
 
     std::vector< utils::SpatialVector > output;
     for (int i=0; i<static_cast<int>(*m_nbLoopConstraint); i++) {
@@ -196,9 +215,53 @@ std::vector< utils::SpatialVector > rigidbody::Contacts::calcLoopConstraintForce
         output.push_back(updatedConstraintForcesOutput[0]);
     }
     return output;
+#else
+    rigidbody::GeneralizedAcceleration Qddot(dynamic_cast<rigidbody::Joints &>(*this));
+    std::vector< utils::SpatialVector > output;
+    calcLoopConstraintForces(Q, Qdot, Tau, externalForces, Qddot, output);
+    return output;
+#endif
+}
+
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Contacts::calcLoopConstraintForces(
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &Qdot,
+    const rigidbody::GeneralizedTorque &Tau,
+    rigidbody::ExternalForceSet &externalForces,
+    rigidbody::GeneralizedAcceleration &Qddot,
+    std::vector< utils::SpatialVector > &forces)
+{
+    // retrieve the model and the contacts
+    rigidbody::Contacts& CS = getConstraints();
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 
+    // The forces are extracted from the multipliers of the solve of the dynamics
+    if (*m_constraintSolver == rigidbody::CONSTRAINT_SOLVER_DIRECT) {
+        m_loopConstraintSolver->forwardDynamics(
+            model, CS, Q, Qdot, Tau, externalForces.computeRbdlSpatialVectorsInPlace(Q, Qdot, true), Qddot);
+    } else {
+        Qddot = model.ForwardDynamicsConstraints(Q, Qdot, Tau, externalForces);
+    }
+    m_loopConstraintSolver->loopConstraintForces(model, CS, Q, Qdot, forces);
 }
 
+rigidbody::LoopConstraintSolver& rigidbody::Contacts::loopConstraintSolver()
+{
+    return *m_loopConstraintSolver;
+}
+
+bool rigidbody::Contacts::projectOnConstraints(
+    rigidbody::GeneralizedCoordinates &Q,
+    rigidbody::GeneralizedVelocity &Qdot,
+    double tolerance,
+    unsigned int maxNbIterations)
+{
+    return m_loopConstraintSolver->project(
+               dynamic_cast<rigidbody::Joints &>(*this), getConstraints(), Q, Qdot, tolerance, maxNbIterations);
+}
+#endif
+
 
 rigidbody::Contacts::~Contacts()
 {
@@ -217,6 +280,17 @@ rigidbody::Contacts &rigidbody::Contacts::getConstraints()
     return *this;
 }
 
+void rigidbody::Contacts::setConstraintSolver(
+    rigidbody::CONSTRAINT_SOLVER solver)
+{
+    *m_constraintSolver = solver;
+}
+
+rigidbody::CONSTRAINT_SOLVER rigidbody::Contacts::constraintSolver() const
+{
+    return *m_constraintSolver;
+}
+
 bool rigidbody::Contacts::hasContacts() const
 {
     if (*m_nbreConstraint>0) return
@@ -278,15 +352,16 @@ rigidbody::Contacts::constraintsInGlobal(
     std::vector<utils::Vector3d> tp;
 
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
     // On each control, apply the rotation and save the position
     for (size_t i=0; i<contactConstraints.size(); ++i) {
         for (size_t j=0; j<contactConstraints[i]->getConstraintSize(); ++j) {
             tp.push_back(RigidBodyDynamics::CalcBodyToBaseCoordinates(
                              model, Q, contactConstraints[i]->getBodyIds()[0],
-                             contactConstraints[i]->getBodyFrames()[0].r, updateKin));
-#ifndef BIORBD_USE_CASADI_MATH
-            updateKin = false;
-#endif
+                             contactConstraints[i]->getBodyFrames()[0].r, false));
         }
     }
 
@@ -299,17 +374,20 @@ utils::Vector3d rigidbody::Contacts::rigidContact(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
 
     const rigidbody::NodeSegment& c = rigidContact(idx);
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
     // Calculate the acceleration of the contact
     return RigidBodyDynamics::CalcBodyToBaseCoordinates(
-            model, Q, c.parentId(), c, updateKin);
+            model, Q, c.parentId(), c, false);
 }
 
 std::vector<utils::Vector3d>
@@ -326,14 +404,15 @@ rigidbody::Contacts::rigidContacts(
     // Output variable
     std::vector<utils::Vector3d> tp;
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
     // On each control, apply the rotation and save the position
     for (const rigidbody::NodeSegment& c : *m_rigidContacts) {
         tp.push_back(RigidBodyDynamics::CalcBodyToBaseCoordinates(
-            model, Q, c.parentId(), c, updateKin)
+            model, Q, c.parentId(), c, false)
         );
-#ifndef BIORBD_USE_CASADI_MATH
-        updateKin = false;
-#endif
     }
 
     return tp;
@@ -346,17 +425,20 @@ utils::Vector3d rigidbody::Contacts::rigidContactVelocity(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
 
     const rigidbody::NodeSegment& c = rigidContact(idx);
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
+
     // Calculate the acceleration of the contact
     return RigidBodyDynamics::CalcPointVelocity(
-            model, Q, Qdot, c.parentId(), c, updateKin);
+            model, Q, Qdot, c.parentId(), c, false);
 }
 
 std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsVelocity(
@@ -365,8 +447,7 @@ std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsVelocity(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
@@ -374,14 +455,15 @@ std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsVelocity(
     // Output variable
     std::vector<utils::Vector3d> tp;
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
+
     // On each control, apply the Q, Qdot, Qddot and save the acceleration
     for (const rigidbody::NodeSegment& c : *m_rigidContacts) {
         tp.push_back(RigidBodyDynamics::CalcPointVelocity(
-            model, Q, Qdot, c.parentId(), c, updateKin)
+            model, Q, Qdot, c.parentId(), c, false)
         );
-#ifndef BIORBD_USE_CASADI_MATH
-    updateKin = false;
-#endif
     }
 
     return tp;
@@ -395,17 +477,20 @@ utils::Vector3d rigidbody::Contacts::rigidContactAcceleration(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
 
     const rigidbody::NodeSegment& c = rigidContact(idx);
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
+
     // Calculate the acceleration of the contact
     return RigidBodyDynamics::CalcPointAcceleration(
-            model, Q, Qdot, Qddot, c.parentId(), c, updateKin);
+            model, Q, Qdot, Qddot, c.parentId(), c, false);
 }
 
 std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsAcceleration(
@@ -415,8 +500,7 @@ std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsAcceleration(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
@@ -424,14 +508,15 @@ std::vector<utils::Vector3d> rigidbody::Contacts::rigidContactsAcceleration(
     // Output variable
     std::vector<utils::Vector3d> tp;
 
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
+
     // On each control, apply the Q, Qdot, Qddot and save the acceleration
     for (const rigidbody::NodeSegment& c : *m_rigidContacts) {
         tp.push_back(RigidBodyDynamics::CalcPointAcceleration(
-            model, Q, Qdot, Qddot, c.parentId(), c, updateKin)
+            model, Q, Qdot, Qddot, c.parentId(), c, false)
         );
-#ifndef BIORBD_USE_CASADI_MATH
-    updateKin = false;
-#endif
     }
 
     return tp;
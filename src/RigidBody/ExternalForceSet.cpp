@@ -29,24 +29,62 @@ rigidbody::ExternalForceSet::ExternalForceSet(
     m_useTranslationalForces(useTranslationalForces),
     m_useSoftContacts(useSoftContacts),
     m_externalForces(std::vector<utils::SpatialVector>()),
+    m_hasForcesAtOrigin(false),
+    m_spatialVectors(std::vector<utils::SpatialVector>()),
+    m_rbdlSpatialVectors(std::vector<RigidBodyDynamics::Math::SpatialVector>()),
     m_externalForcesInLocal(rigidbody::ExternalForceSet::LocalForcesInternal()),
     m_translationalForces(std::vector<std::pair<utils::Vector3d, rigidbody::NodeSegment>>())
 {
     setZero();
 }
 
+rigidbody::ExternalForceSet::ExternalForceSet(
+    const rigidbody::ExternalForceSet& other,
+    Model& model
+) :
+    m_model(model),
+    m_useTranslationalForces(other.m_useTranslationalForces),
+    m_useSoftContacts(other.m_useSoftContacts),
+    m_externalForces(other.m_externalForces),
+    m_hasForcesAtOrigin(other.m_hasForcesAtOrigin),
+    m_spatialVectors(std::vector<utils::SpatialVector>()),
+    m_rbdlSpatialVectors(std::vector<RigidBodyDynamics::Math::SpatialVector>()),
+    m_externalForcesInLocal(other.m_externalForcesInLocal),
+    m_translationalForces(other.m_translationalForces)
+{
+    utils::Error::check(m_model.nbSegment() == other.m_model.nbSegment(),
+                        "The model must share the description of the one the ExternalForceSet was created on");
+}
+
+void rigidbody::ExternalForceSet::setForces(
+    const rigidbody::ExternalForceSet& other
+)
+{
+    utils::Error::check(m_model.nbSegment() == other.m_model.nbSegment(),
+                        "The model must share the description of the one the ExternalForceSet was created on");
+    m_useTranslationalForces = other.m_useTranslationalForces;
+    m_useSoftContacts = other.m_useSoftContacts;
+    m_externalForces = other.m_externalForces;
+    m_hasForcesAtOrigin = other.m_hasForcesAtOrigin;
+    m_externalForcesInLocal = other.m_externalForcesInLocal;
+    m_translationalForces = other.m_translationalForces;
+}
+
 rigidbody::ExternalForceSet::~ExternalForceSet(){
 
 }
 
+const Model& rigidbody::ExternalForceSet::model() const
+{
+    return m_model;
+}
+
 void rigidbody::ExternalForceSet::add(
     const utils::String& segmentName,
     const utils::SpatialVector& vector
 ) 
 {
-    // Add 1 since 0 is used for the base ground 
-    size_t dofIndex = m_model.segment(segmentName).getLastDofIndexInGeneralizedCoordinates(m_model) + 1;
-    m_externalForces[dofIndex] += vector; 
+    addToBody(bodyIndex(segmentName), vector);
 }
 
 void rigidbody::ExternalForceSet::add(
@@ -55,11 +93,46 @@ void rigidbody::ExternalForceSet::add(
     const utils::Vector3d& pointOfApplication
 )
 {
-    utils::SpatialVector atOrigin = transportAtOrigin(
-        vector, 
-        rigidbody::NodeSegment(utils::Vector3d(pointOfApplication, segmentName, segmentName))
-    );
-    add(segmentName, atOrigin);
+    addToBody(bodyIndex(segmentName), vector, pointOfApplication);
+}
+
+size_t rigidbody::ExternalForceSet::bodyIndex(
+    const utils::String& segmentName
+) const
+{
+    // Forces are applied on the rbdl body that holds the mass of the segment
+    return m_model.segment(segmentName).findFirstSegmentWithDof(m_model).id();
+}
+
+void rigidbody::ExternalForceSet::addToBody(
+    size_t bodyIndex,
+    const utils::SpatialVector& vector
+)
+{
+    m_externalForces[bodyIndex] += vector;
+    m_hasForcesAtOrigin = true;
+}
+
+void rigidbody::ExternalForceSet::addToBody(
+    size_t bodyIndex,
+    const utils::SpatialVector& vector,
+    const utils::Vector3d& pointOfApplication
+)
+{
+#ifdef BIORBD_USE_CASADI_MATH
+    addToBody(bodyIndex, transportAtOrigin(vector, rigidbody::NodeSegment(pointOfApplication)));
+#else
+    // Transport to Origin (Bour's formula) without building a node: M + p x F
+    utils::SpatialVector& out(m_externalForces[bodyIndex]);
+    const utils::Vector3d& p(pointOfApplication);
+    out(0) += vector(0) + p(1) * vector(5) - p(2) * vector(4);
+    out(1) += vector(1) + p(2) * vector(3) - p(0) * vector(5);
+    out(2) += vector(2) + p(0) * vector(4) - p(1) * vector(3);
+    out(3) += vector(3);
+    out(4) += vector(4);
+    out(5) += vector(5);
+    m_hasForcesAtOrigin = true;
+#endif
 }
 
 void rigidbody::ExternalForceSet::addInSegmentReferenceFrame(
@@ -114,11 +187,39 @@ std::vector<RigidBodyDynamics::Math::SpatialVector> rigidbody::ExternalForceSet:
     bool updateKin
 ) {
     std::vector<utils::SpatialVector> tp(computeSpatialVectors(Q, QDot, updateKin));
-    std::vector<RigidBodyDynamics::Math::SpatialVector> out;
-    for (const auto& value : tp) {
-        out.push_back(value);
+    return std::vector<RigidBodyDynamics::Math::SpatialVector>(tp.begin(), tp.end());
+}
+
+std::vector<RigidBodyDynamics::Math::SpatialVector> rigidbody::ExternalForceSet::computeRbdlSpatialVectorsPerBody(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    bool updateKin
+) {
+    fillSpatialVectors(Q, QDot, updateKin, m_spatialVectors);
+    return std::vector<RigidBodyDynamics::Math::SpatialVector>(
+               m_spatialVectors.begin(), m_spatialVectors.end());
+}
+
+std::vector<RigidBodyDynamics::Math::SpatialVector>* rigidbody::ExternalForceSet::computeRbdlSpatialVectorsInPlace(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    bool updateKin
+) {
+    // No buffer at all is cheaper for rbdl than a buffer of zeros
+    if (!m_hasForcesAtOrigin && !hasExternalForceInLocalReferenceFrame()
+            && m_translationalForces.size() == 0
+            && (!m_useSoftContacts || m_model.nbSoftContacts() == 0)) {
+        return nullptr;
     }
-    return out;
+
+    fillSpatialVectors(Q, QDot, updateKin, m_spatialVectors);
+    if (m_rbdlSpatialVectors.size() != m_spatialVectors.size()) {
+        m_rbdlSpatialVectors.resize(m_spatialVectors.size());
+    }
+    for (size_t i = 0; i < m_spatialVectors.size(); ++i) {
+        m_rbdlSpatialVectors[i] = m_spatialVectors[i];
+    }
+    return &m_rbdlSpatialVectors;
 }
 
 std::vector<utils::SpatialVector> rigidbody::ExternalForceSet::computeSpatialVectors() {
@@ -141,23 +242,55 @@ std::vector<utils::SpatialVector> rigidbody::ExternalForceSet::computeSpatialVec
     const rigidbody::GeneralizedVelocity& QDot,
     bool updateKin    
 ) 
+{
+    fillSpatialVectors(Q, QDot, updateKin, m_spatialVectors);
+
+    // Dispatch the forces of the bodies on the last dof of their segment
+    // (the first one is associated with the universe)
+    std::vector<utils::SpatialVector> out(1, utils::SpatialVector(0., 0., 0., 0., 0., 0.));
+    for (size_t i = 0; i < m_model.nbSegment(); ++i) {
+        const rigidbody::Segment& segment(m_model.segment(i));
+        for (size_t j = 0; j < segment.nbDof(); ++j) {
+            out.push_back(utils::SpatialVector(0., 0., 0., 0., 0., 0.));
+        }
+        if (segment.nbDof() > 0) {
+            out.back() = m_spatialVectors[segment.id()];
+        }
+    }
+    return out;
+}
+
+void rigidbody::ExternalForceSet::fillSpatialVectors(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    bool updateKin,
+    std::vector<utils::SpatialVector>& out
+)
 {
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
-    if (updateKin) {
+    // Bodies added to the model after the set was created receive no force
+    if (m_externalForces.size() != m_model.mBodies.size()) {
+        m_externalForces.resize(m_model.mBodies.size(), utils::SpatialVector(0., 0., 0., 0., 0., 0.));
+    }
+
+    // Forces already expressed at the origin do not need the kinematics
+    bool needKinematics(hasExternalForceInLocalReferenceFrame()
+                        || m_translationalForces.size() > 0 || m_useSoftContacts);
+    if (updateKin && needKinematics) {
         m_model.UpdateKinematicsCustom(&Q, m_useSoftContacts ? &QDot : nullptr, nullptr);
     }
 
-    std::vector<utils::SpatialVector> out;
-    for (const auto& value : m_externalForces) {
-        out.push_back(value);
+    if (out.size() != m_externalForces.size()) {
+        out.resize(m_externalForces.size());
+    }
+    for (size_t i = 0; i < m_externalForces.size(); ++i) {
+        out[i] = m_externalForces[i];
     }
     if (hasExternalForceInLocalReferenceFrame()) combineLocalReferenceFrameForces(Q, out);
     if (m_useTranslationalForces) combineTranslationalForces(Q, out);
     if (m_useSoftContacts) combineSoftContactForces(Q, QDot, out);
-
-    return out;
 }
 
 
@@ -169,17 +302,11 @@ void rigidbody::ExternalForceSet::setZero()
 {
     m_externalForces.clear();
 
-    // Null Spatial vector nul to fill the final table
+    // Null Spatial vector nul to fill the final table, one per rbdl body
+    // (the first one is associated with the universe)
     utils::SpatialVector sv_zero(0., 0., 0., 0., 0., 0.);
-    m_externalForces.push_back(sv_zero); // The first one is associated with the universe
-
-    // Dispatch the forces
-    for (size_t i = 0; i < m_model.nbSegment(); ++i) {
-        size_t nDof(m_model.segment(i).nbDof());
-        for (size_t i = 0; i < nDof; ++i) {
-            m_externalForces.push_back(sv_zero); // Put a sv_zero on each DoF
-        }
-    }
+    m_externalForces.resize(m_model.mBodies.size(), sv_zero);
+    m_hasForcesAtOrigin = false;
 
     // Reset other elements of the class too
     m_translationalForces.clear();
@@ -229,9 +356,9 @@ updateKin = true;
         utils::Vector3d momentInGrf(vector.moment());
         momentInGrf.applyRT(rotationInGrf);
 
-        // Transport the force to the global reference frame (Add 1 to account for the undeclared root)
-        size_t dofIndex = m_model.segment(node.parent()).getLastDofIndexInGeneralizedCoordinates(m_model) + 1;
-        out[dofIndex] += transportAtOrigin(utils::SpatialVector(momentInGrf, forceInGrf), pointOfApplication);
+        // Transport the force to the global reference frame
+        size_t bodyIndex = m_model.segment(node.parent()).findFirstSegmentWithDof(m_model).id();
+        out[bodyIndex] += transportAtOrigin(utils::SpatialVector(momentInGrf, forceInGrf), pointOfApplication);
     }
     return;
 }
@@ -255,7 +382,7 @@ void rigidbody::ExternalForceSet::combineTranslationalForces(
     for (auto& e : m_translationalForces) {    
         const rigidbody::NodeSegment& pointOfApplication = e.second;
         const rigidbody::Segment& segment(m_model.segment(pointOfApplication.parent()));
-        size_t dofIndex = segment.getLastDofIndexInGeneralizedCoordinates(m_model) + 1;
+        size_t bodyIndex = segment.findFirstSegmentWithDof(m_model).id();
 
         const utils::Vector3d& force = e.first;
         rigidbody::NodeSegment pointOfApplicationInGlobal(
@@ -270,8 +397,8 @@ void rigidbody::ExternalForceSet::combineTranslationalForces(
             pointOfApplication.parentId()
         );
             
-        // Add the force to the force vector (do not subtract 1 because 0 is the base)
-        out[dofIndex] += transportForceAtOrigin(force, pointOfApplicationInGlobal);
+        // Add the force to the force vector (0 is the base)
+        out[bodyIndex] += transportForceAtOrigin(force, pointOfApplicationInGlobal);
     }
 }
 
@@ -291,15 +418,20 @@ void rigidbody::ExternalForceSet::combineSoftContactForces(
 
     // Do not waste time computing forces on empty vector
     if (m_model.nbSoftContacts() == 0) return;
-    
+
+#ifdef BIORBD_USE_CASADI_MATH
     for (size_t j = 0; j < m_model.nbSoftContacts(); j++) {
         rigidbody::SoftContactNode& contact(m_model.softContact(j));
         const rigidbody::Segment& segment(m_model.segment(contact.parent()));
-        size_t dofIndex = segment.getLastDofIndexInGeneralizedCoordinates(m_model) + 1;
+        size_t bodyIndex = segment.findFirstSegmentWithDof(m_model).id();
 
-        // Add the force to the force vector (do not subtract 1 because 0 is the base)
-        out[dofIndex] += contact.computeForceAtOrigin(m_model, Q, QDot, updateKin);
+        // Add the force to the force vector (0 is the base)
+        out[bodyIndex] += contact.computeForceAtOrigin(m_model, Q, QDot, updateKin);
     }
+#else
+    // The engine resolves the bodies of the contacts once and evaluates them all in a batch
+    m_model.addSoftContactForces(Q, QDot, out, updateKin);
+#endif
 }
 
 utils::SpatialVector rigidbody::ExternalForceSet::transportForceAtOrigin(
@@ -1,10 +1,11 @@
 #define BIORBD_API_EXPORTS
 #include "RigidBody/Joints.h"
 
+#include <algorithm>
 #include <rbdl/rbdl_utils.h>
 #include <rbdl/Kinematics.h>
 #include <rbdl/Dynamics.h>
-#include "BiorbdModel.h"
+#include <rbdl/rbdl_mathutils.h>
 #include "Utils/Error.h"
 #include "Utils/Matrix.h"
 #include "Utils/Matrix3d.h"
@@ -14,6 +15,7 @@
 #include "Utils/Scalar.h"
 #include "Utils/SpatialVector.h"
 #include "Utils/String.h"
+#include "Utils/Vector.h"
 
 #include "RigidBody/ExternalForceSet.h"
 #include "RigidBody/GeneralizedCoordinates.h"
@@ -28,6 +30,7 @@
 #include "RigidBody/SegmentCharacteristics.h"
 #include "RigidBody/Contacts.h"
 #include "RigidBody/SoftContacts.h"
+#include "RigidBody/WholeBodyQuantities.h"
 
 
 using namespace BIORBD_NAMESPACE;
@@ -42,6 +45,27 @@ rigidbody::Joints::Joints() :
     m_nbQddot(std::make_shared<size_t>(0)),
     m_nRotAQuat(std::make_shared<size_t>(0)),
     m_isKinematicsComputed(std::make_shared<bool>(false)),
+    m_kinematicsQ(std::make_shared<utils::Vector>()),
+    m_kinematicsQdot(std::make_shared<utils::Vector>()),
+    m_kinematicsQddot(std::make_shared<utils::Vector>()),
+    m_kinematicsLevel(std::make_shared<int>(0)),
+    m_nbKinematicsUpdates(std::make_shared<size_t>(0)),
+    m_nbKinematicsUpdatesElided(std::make_shared<size_t>(0)),
+    m_nbKinematicsBodiesUpdated(std::make_shared<size_t>(0)),
+    m_kinematicsDirtyDof(std::make_shared<std::vector<bool>>()),
+    m_kinematicsDirtyBodies(std::make_shared<std::vector<bool>>()),
+    m_defaultExternalForces(nullptr),
+    m_dofSubTreesStart(std::make_shared<std::vector<size_t>>(1, 0)),
+    m_dofSubTrees(std::make_shared<std::vector<size_t>>()),
+#ifndef BIORBD_USE_CASADI_MATH
+    m_massMatrixInverseF(std::make_shared<std::vector<RigidBodyDynamics::Math::MatrixNd>>()),
+    m_freeFloatingBaseQDDot(std::make_shared<utils::Vector>()),
+    m_freeFloatingBaseTau(std::make_shared<utils::Vector>()),
+    m_freeFloatingBaseMassMatrix(std::make_shared<utils::Matrix>()),
+    m_bodyJacobians(std::make_shared<std::vector<RigidBodyDynamics::Math::MatrixNd>>()),
+    m_isBodyJacobianComputed(std::make_shared<std::vector<bool>>()),
+    m_nbBodyJacobiansComputed(std::make_shared<size_t>(0)),
+#endif
     m_totalMass(std::make_shared<utils::Scalar>(0))
 {
     // Redefining gravity so it is on z by default
@@ -58,6 +82,29 @@ rigidbody::Joints::Joints(const rigidbody::Joints &other) :
     m_nbQddot(other.m_nbQddot),
     m_nRotAQuat(other.m_nRotAQuat),
     m_isKinematicsComputed(other.m_isKinematicsComputed),
+    // The rbdl kinematics are copied, so is what they were computed with
+    m_kinematicsQ(std::make_shared<utils::Vector>(*other.m_kinematicsQ)),
+    m_kinematicsQdot(std::make_shared<utils::Vector>(*other.m_kinematicsQdot)),
+    m_kinematicsQddot(std::make_shared<utils::Vector>(*other.m_kinematicsQddot)),
+    m_kinematicsLevel(std::make_shared<int>(*other.m_kinematicsLevel)),
+    m_nbKinematicsUpdates(std::make_shared<size_t>(*other.m_nbKinematicsUpdates)),
+    m_nbKinematicsUpdatesElided(std::make_shared<size_t>(*other.m_nbKinematicsUpdatesElided)),
+    m_nbKinematicsBodiesUpdated(std::make_shared<size_t>(*other.m_nbKinematicsBodiesUpdated)),
+    m_kinematicsDirtyDof(std::make_shared<std::vector<bool>>()),
+    m_kinematicsDirtyBodies(std::make_shared<std::vector<bool>>()),
+    // The default external forces refer to the model they were created with
+    m_defaultExternalForces(nullptr),
+    m_dofSubTreesStart(other.m_dofSubTreesStart),
+    m_dofSubTrees(other.m_dofSubTrees),
+#ifndef BIORBD_USE_CASADI_MATH
+    m_massMatrixInverseF(std::make_shared<std::vector<RigidBodyDynamics::Math::MatrixNd>>()),
+    m_freeFloatingBaseQDDot(std::make_shared<utils::Vector>()),
+    m_freeFloatingBaseTau(std::make_shared<utils::Vector>()),
+    m_freeFloatingBaseMassMatrix(std::make_shared<utils::Matrix>()),
+    m_bodyJacobians(std::make_shared<std::vector<RigidBodyDynamics::Math::MatrixNd>>()),
+    m_isBodyJacobianComputed(std::make_shared<std::vector<bool>>()),
+    m_nbBodyJacobiansComputed(std::make_shared<size_t>(0)),
+#endif
     m_totalMass(other.m_totalMass)
 {
 
@@ -89,7 +136,20 @@ void rigidbody::Joints::DeepCopy(const rigidbody::Joints &other)
     *m_nbQddot = *other.m_nbQddot;
     *m_nRotAQuat = *other.m_nRotAQuat;
     *m_isKinematicsComputed = *other.m_isKinematicsComputed;
+    *m_kinematicsQ = *other.m_kinematicsQ;
+    *m_kinematicsQdot = *other.m_kinematicsQdot;
+    *m_kinematicsQddot = *other.m_kinematicsQddot;
+    *m_kinematicsLevel = *other.m_kinematicsLevel;
+    *m_nbKinematicsUpdates = *other.m_nbKinematicsUpdates;
+    *m_nbKinematicsUpdatesElided = *other.m_nbKinematicsUpdatesElided;
+    *m_nbKinematicsBodiesUpdated = *other.m_nbKinematicsBodiesUpdated;
+    m_defaultExternalForces = nullptr;
+    *m_dofSubTreesStart = *other.m_dofSubTreesStart;
+    *m_dofSubTrees = *other.m_dofSubTrees;
     *m_totalMass = *other.m_totalMass;
+#ifndef BIORBD_USE_CASADI_MATH
+    invalidateBodyJacobians();
+#endif
 }
 
 size_t rigidbody::Joints::nbGeneralizedTorque() const
@@ -173,6 +233,8 @@ size_t rigidbody::Joints::AddSegment(
     *m_totalMass +=
         characteristics.mMass; // Add the segment mass to the total body mass
     m_segments->push_back(tp);
+    updateDofSubTrees();
+    kinematicsUpdatedByRbdl(); // The new bodies have no kinematics
     return 0;
 }
 size_t rigidbody::Joints::AddSegment(
@@ -199,6 +261,8 @@ size_t rigidbody::Joints::AddSegment(
     *m_totalMass +=
         characteristics.mMass; // Add the segment mass to the total body mass
     m_segments->push_back(tp);
+    updateDofSubTrees();
+    kinematicsUpdatedByRbdl(); // The new bodies have no kinematics
     return 0;
 }
 
@@ -263,6 +327,16 @@ int rigidbody::Joints::getBodyRbdlId(
     return GetBodyId(segmentName.c_str());
 }
 
+unsigned int rigidbody::Joints::getParentRbdlId(
+        const rigidbody::NodeSegment &node) const
+{
+    // Rbdl bodies are only appended to the model, so an id stays valid once resolved
+    if (node.parentId() >= 0) {
+        return static_cast<unsigned int>(node.parentId());
+    }
+    return GetBodyId(node.parent().c_str());
+}
+
 int rigidbody::Joints::getBodyRbdlIdToBiorbdId(
         const int idx) const
 {
@@ -280,79 +354,55 @@ size_t rigidbody::Joints::getBodyBiorbdIdToRbdlId(
 
 std::vector<std::vector<size_t> > rigidbody::Joints::getDofSubTrees()
 {
-    // initialize subTrees
     std::vector<std::vector<size_t> > subTrees;
-    std::vector<size_t> subTree_empty;
-    for (size_t j=0; j<this->mu.size(); ++j) {
-        subTrees.push_back(subTree_empty);
+    for (size_t i=0; i<m_dofSubTreesStart->size() - 1; ++i) {
+        subTrees.push_back(std::vector<size_t>(
+                               m_dofSubTrees->begin() + (*m_dofSubTreesStart)[i],
+                               m_dofSubTrees->begin() + (*m_dofSubTreesStart)[i+1]));
     }
+    return subTrees;
+}
 
-    // Get all dof without parent
-    std::vector<size_t> dof_with_no_parent_id;
-    for (size_t i=1; i<this->mu.size(); ++i) { // begin at 1 because 0 is its own parent in rbdl.
-      if (this->lambda[i]==0) {
-          dof_with_no_parent_id.push_back(i);
-      }
-    }
-
-    // Get all subtrees of dofs without parents
-    for (size_t i=0; i<dof_with_no_parent_id.size(); ++i) {
-        size_t dof_id = dof_with_no_parent_id[i];
-
-        // initialize subTrees_temp
-        std::vector<std::vector<size_t> > subTrees_temp;
-        for (size_t j=0; j<this->mu.size(); ++j) {
-          subTrees_temp.push_back(subTree_empty);
+void rigidbody::Joints::updateDofSubTrees()
+{
+    // The children of a body always come after it, so the subtrees are filled from the leaves.
+    // The dof of a body come first, followed by the subtrees of its children
+    std::vector<std::vector<size_t> > subTrees(this->mBodies.size());
+    for (size_t i=this->mBodies.size() - 1; i>0; --i) {
+        for (size_t k = 0; k < this->mJoints[i].mDoFCount; ++k) {
+            subTrees[i].push_back(this->mJoints[i].q_index + k);
         }
-
-        std::vector<std::vector<size_t> > subTrees_temp_filled = recursiveDofSubTrees(subTrees_temp, dof_id);
-        for (size_t j=0; j<subTrees_temp.size(); ++j) {
-            if (subTrees_temp_filled[j].empty()) {
-                continue;
-            }
-            else
-            {
-                subTrees[j].insert(subTrees[j].end(),
-                                     subTrees_temp_filled[j].begin(),
-                                     subTrees_temp_filled[j].end());
-            }
+        for (unsigned int child : this->mu[i]) {
+            subTrees[i].insert(subTrees[i].end(), subTrees[child].begin(), subTrees[child].end());
         }
-
     }
 
-    subTrees.erase(subTrees.begin());
-
-    return  subTrees;
+    m_dofSubTreesStart->assign(1, 0);
+    m_dofSubTrees->clear();
+    for (size_t i=1; i<subTrees.size(); ++i) {
+        m_dofSubTrees->insert(m_dofSubTrees->end(), subTrees[i].begin(), subTrees[i].end());
+        m_dofSubTreesStart->push_back(m_dofSubTrees->size());
+    }
 }
 
-std::vector<std::vector<size_t> > rigidbody::Joints::recursiveDofSubTrees(
-        std::vector<std::vector<size_t> >subTrees,
-        size_t idx)
+std::vector<size_t> rigidbody::Joints::getDofChain(
+    unsigned int rbdlId) const
 {
-    size_t q_index_i = this->mJoints[idx].q_index;
-    subTrees[idx].push_back(q_index_i);
-
-    std::vector<std::vector<size_t> > subTrees_filled;
-    subTrees_filled = subTrees;
-
-    std::vector<unsigned int> child_idx = this->mu[idx];
-
-    if (child_idx.size() > 0){
-       for (size_t i=0; i<child_idx.size(); ++i) {
-            size_t cur_child_id = child_idx[i];
-            subTrees_filled = recursiveDofSubTrees(subTrees_filled, cur_child_id);
-            std::vector<size_t> subTree_child = subTrees_filled[cur_child_id];
-
-            subTrees_filled[idx].insert(subTrees_filled[idx].end(),
-                                 subTree_child.begin(),
-                                 subTree_child.end());
-      }
+    if (rbdlId >= fixed_body_discriminator) {
+        rbdlId = mFixedBodies[rbdlId - fixed_body_discriminator].mMovableParent;
     }
 
-    return subTrees_filled;
+    // Walk up to the root, the dof of a parent always come before those of its children
+    std::vector<size_t> dofs;
+    for (unsigned int i = rbdlId; i != 0; i = lambda[i]) {
+        for (unsigned int k = mJoints[i].mDoFCount; k > 0; --k) {
+            dofs.push_back(mJoints[i].q_index + k - 1);
+        }
+    }
+    std::reverse(dofs.begin(), dofs.end());
+    return dofs;
 }
 
-
 std::vector<utils::RotoTrans> rigidbody::Joints::allGlobalJCS(
     const rigidbody::GeneralizedCoordinates &Q, 
     bool updateKin
@@ -375,6 +425,38 @@ const
     return out;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::allGlobalJCS(
+    const rigidbody::GeneralizedCoordinates &Q,
+    std::vector<utils::RotoTrans>& jcsOut,
+    bool updateKin)
+{
+    if (jcsOut.size() != m_segments->size()) {
+        jcsOut.resize(m_segments->size());
+    }
+    if (updateKin) {
+        UpdateKinematicsCustom (&Q, nullptr, nullptr);
+    }
+
+    // Same as CalcBodyWorldTransformation, without building intermediate RotoTransNode
+    for (size_t i=0; i<m_segments->size(); ++i) {
+        size_t id((*m_segments)[i].id());
+        utils::RotoTrans& jcs(jcsOut[i]);
+        jcs.setIdentity();
+        if (id >= this->fixed_body_discriminator) {
+            const RigidBodyDynamics::FixedBody& body(
+                this->mFixedBodies[id - this->fixed_body_discriminator]);
+            const RigidBodyDynamics::Math::SpatialTransform& parent(this->X_base[body.mMovableParent]);
+            jcs.block<3, 3>(0, 0) = parent.E.transpose() * body.mParentTransform.E.transpose();
+            jcs.block<3, 1>(0, 3) = parent.r + parent.E.transpose() * body.mParentTransform.r;
+        } else {
+            jcs.block<3, 3>(0, 0) = this->X_base[id].E.transpose();
+            jcs.block<3, 1>(0, 3) = this->X_base[id].r;
+        }
+    }
+}
+#endif
+
 utils::RotoTrans rigidbody::Joints::globalJCS(
     const rigidbody::GeneralizedCoordinates &Q,
     const utils::String &name)
@@ -634,9 +716,13 @@ utils::Vector3d rigidbody::Joints::segmentAngularVelocity(
     const utils::String& segmentName(segment(idx).name());
     size_t id(static_cast<size_t>(this->GetBodyId(segmentName.c_str())));
 
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot);
+    }
+
     // Calculate the velocity of the point
     return RigidBodyDynamics::CalcPointVelocity6D(
-                *this, Q, Qdot, static_cast<unsigned int>(id), utils::Vector3d(0, 0, 0), updateKin).block(0, 0, 3, 1);
+                *this, Q, Qdot, static_cast<unsigned int>(id), utils::Vector3d(0, 0, 0), false).block(0, 0, 3, 1);
 }
 
 utils::Vector3d rigidbody::Joints::CoM(
@@ -675,22 +761,61 @@ utils::Matrix rigidbody::Joints::massMatrix (
 #endif
     RigidBodyDynamics::Math::MatrixNd massMatrix(static_cast<unsigned int>(nbQ()), static_cast<unsigned int>(nbQ()));
     massMatrix.setZero();
-    RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, massMatrix, updateKin);
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
+    RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, massMatrix, false);
     return massMatrix;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::massMatrix (
+    const rigidbody::GeneralizedCoordinates &Q,
+    utils::Matrix &massMatrix,
+    bool updateKin)
+{
+    if (massMatrix.rows() != this->dof_count || massMatrix.cols() != this->dof_count) {
+        massMatrix.resize(this->dof_count, this->dof_count);
+    }
+    massMatrix.setZero();
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
+    RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, massMatrix, false);
+}
+#endif
+
 utils::Matrix rigidbody::Joints::massMatrixInverse (
     const rigidbody::GeneralizedCoordinates &Q,
     bool updateKin)
 {
+#ifndef BIORBD_USE_CASADI_MATH
+    utils::Matrix Minv(this->dof_count, this->dof_count);
+    massMatrixInverse(Q, Minv, updateKin);
+    return Minv;
+#else
     int i = 0; // for loop purpose
     int j = 0; // for loop purpose
     RigidBodyDynamics::Math::MatrixNd Minv(this->dof_count, this->dof_count);
     Minv.setZero();
 
-#ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
-#endif
+    // The recursive algorithm below assumes one dof per rbdl body. Segments
+    // mapped onto multi-dof joints (translations xyz, Euler sequences or
+    // quaternions) fall back on the inverse of the mass matrix
+    for (size_t k = 1; k < this->mJoints.size(); ++k) {
+        if (this->mJoints[k].mDoFCount > 1) {
+            RigidBodyDynamics::Math::MatrixNd M(this->dof_count, this->dof_count);
+            M.setZero();
+            if (updateKin) {
+                UpdateKinematicsCustom(&Q);
+            }
+            RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, M, false);
+            auto linsol = casadi::Linsol("linsol", "symbolicqr", M.sparsity());
+            return linsol.solve(M, casadi::MX::eye(static_cast<casadi_int>(this->dof_count)));
+        }
+    }
+
     if (updateKin) {
         UpdateKinematicsCustom(&Q, nullptr, nullptr);
     }
@@ -741,16 +866,9 @@ utils::Matrix rigidbody::Joints::massMatrixInverse (
                 - this->U[i]
                 * (this->U[i] / this->d[i]).transpose();
 
-#ifdef BIORBD_USE_CASADI_MATH
           this->IA[lambda]
             += this->X_lambda[i].toMatrixTranspose()
             * Ia * this->X_lambda[i].toMatrix();
-
-#else
-          this->IA[lambda].noalias()
-            += this->X_lambda[i].toMatrixTranspose()
-            * Ia * this->X_lambda[i].toMatrix();
-#endif
         }
     }
     // End Backward Pass
@@ -801,7 +919,161 @@ utils::Matrix rigidbody::Joints::massMatrixInverse (
     }
 
     return Minv;
+#endif
+}
+
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::massMatrixInverse (
+    const rigidbody::GeneralizedCoordinates &Q,
+    utils::Matrix &Minv,
+    bool updateKin)
+{
+    unsigned int nbDof(this->dof_count);
+    if (Minv.rows() != nbDof || Minv.cols() != nbDof) {
+        Minv.resize(nbDof, nbDof);
+    }
+    Minv.setZero();
+
+    // The recursive algorithm below handles the rbdl joints of one dof and those of three dof
+    // (translations xyz, Euler sequences or quaternions). The others fall back on the
+    // inverse of the mass matrix
+    for (size_t k = 1; k < this->mJoints.size(); ++k) {
+        if (this->mJoints[k].mJointType == RigidBodyDynamics::JointTypeCustom
+                || (this->mJoints[k].mDoFCount != 1 && this->mJoints[k].mDoFCount != 3)) {
+            RigidBodyDynamics::Math::MatrixNd M(nbDof, nbDof);
+            M.setZero();
+            if (updateKin) {
+                UpdateKinematicsCustom(&Q);
+            }
+            RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, M, false);
+            Minv = M.llt().solve(utils::Matrix::Identity(nbDof, nbDof));
+            return;
+        }
+    }
+
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
+
+    // F (6 x n) of each body, only reallocated if the model changed
+    std::vector<RigidBodyDynamics::Math::MatrixNd>& F(*m_massMatrixInverseF);
+    if (F.size() != this->mBodies.size() - 1 || (F.size() > 0 && F[0].cols() != nbDof)) {
+        F.assign(this->mBodies.size() - 1, RigidBodyDynamics::Math::MatrixNd::Zero(6, nbDof));
+    } else {
+        for (auto& f : F) {
+            f.setZero();
+        }
+    }
+
+    // First Forward Pass
+    for (unsigned int i = 1; i < this->mBodies.size(); i++) {
+        this->I[i].setSpatialMatrix(this->IA[i]);
+    }
+    // End First Forward Pass
+
+    // Backward Pass
+    for (unsigned int i = static_cast<unsigned int>(this->mBodies.size() - 1); i > 0; i--) {
+        unsigned int q_index_i = this->mJoints[i].q_index;
+        unsigned int lambda = this->lambda[i];
+        const size_t* subTree = m_dofSubTrees->data() + (*m_dofSubTreesStart)[i-1];
+        size_t nbSubTree = (*m_dofSubTreesStart)[i] - (*m_dofSubTreesStart)[i-1];
+        RigidBodyDynamics::Math::MatrixNd& F_i = F[i-1];
+
+        RigidBodyDynamics::Math::SpatialMatrix Ia;
+        if (this->mJoints[i].mDoFCount == 1) {
+            this->U[i] = this->IA[i] * this->S[i];
+            this->d[i] = this->S[i].dot(this->U[i]);
+
+            // Minv[i,subtree] = Dinv[i] * (1 - S[i]^T * F[i,:,subtree])
+            Minv(q_index_i, q_index_i) = 1.0 / this->d[i];
+            for (size_t j = 0; j < nbSubTree; j++) {
+                Minv(q_index_i, subTree[j]) -= this->S[i].dot(F_i.col(subTree[j])) / this->d[i];
+            }
+            if (lambda != 0) {
+                for (size_t j = 0; j < nbSubTree; j++) {
+                    F_i.col(subTree[j]) += this->U[i] * Minv(q_index_i, subTree[j]);
+                }
+                Ia = this->IA[i] - this->U[i] * (this->U[i] / this->d[i]).transpose();
+            }
+        } else {
+            this->multdof3_U[i] = this->IA[i] * this->multdof3_S[i];
+            this->multdof3_Dinv[i] =
+                (this->multdof3_S[i].transpose() * this->multdof3_U[i]).inverse();
+
+            Minv.block<3, 3>(q_index_i, q_index_i) = this->multdof3_Dinv[i];
+            for (size_t j = 0; j < nbSubTree; j++) {
+                Minv.block<3, 1>(q_index_i, subTree[j]) -= this->multdof3_Dinv[i]
+                        * (this->multdof3_S[i].transpose() * F_i.col(subTree[j]));
+            }
+            if (lambda != 0) {
+                for (size_t j = 0; j < nbSubTree; j++) {
+                    F_i.col(subTree[j]) += this->multdof3_U[i] * Minv.block<3, 1>(q_index_i, subTree[j]);
+                }
+                Ia = this->IA[i] - this->multdof3_U[i] * this->multdof3_Dinv[i]
+                     * this->multdof3_U[i].transpose();
+            }
+        }
+
+        if (lambda != 0) {
+            RigidBodyDynamics::Math::SpatialMatrix X_T(this->X_lambda[i].toMatrixTranspose());
+            RigidBodyDynamics::Math::MatrixNd& F_lambda = F[lambda-1];
+            for (size_t j = 0; j < nbSubTree; j++) {
+                F_lambda.col(subTree[j]) += X_T * F_i.col(subTree[j]);
+            }
+            this->IA[lambda].noalias() += X_T * Ia * this->X_lambda[i].toMatrix();
+        }
+    }
+    // End Backward Pass
+
+    // Second Forward Pass
+    for (unsigned int i = 1; i < this->mBodies.size(); i++) {
+        unsigned int q_index_i = this->mJoints[i].q_index;
+        unsigned int lambda = this->lambda[i];
+        RigidBodyDynamics::Math::MatrixNd& F_i = F[i-1];
+        RigidBodyDynamics::Math::SpatialMatrix X(this->X_lambda[i].toMatrix());
+
+        if (this->mJoints[i].mDoFCount == 1) {
+            if (lambda != 0) {
+                // Minv[i,i:] -= Dinv[i] * U[i]^T * X * F[lambda,:,i:]
+                RigidBodyDynamics::Math::SpatialVector XT_U(X.transpose() * this->U[i]);
+                for (unsigned int j = q_index_i; j < nbDof; j++) {
+                    Minv(q_index_i, j) -= XT_U.dot(F[lambda-1].col(j)) / this->d[i];
+                }
+            }
+            // F[i,:,i:] = S[i] * Minv[i,i:]
+            for (unsigned int j = q_index_i; j < nbDof; j++) {
+                F_i.col(j) = this->S[i] * Minv(q_index_i, j);
+            }
+        } else {
+            if (lambda != 0) {
+                RigidBodyDynamics::Math::Matrix63 XT_U(X.transpose() * this->multdof3_U[i]);
+                for (unsigned int j = q_index_i; j < nbDof; j++) {
+                    Minv.block<3, 1>(q_index_i, j) -= this->multdof3_Dinv[i]
+                            * (XT_U.transpose() * F[lambda-1].col(j));
+                }
+            }
+            for (unsigned int j = q_index_i; j < nbDof; j++) {
+                F_i.col(j) = this->multdof3_S[i] * Minv.block<3, 1>(q_index_i, j);
+            }
+        }
+
+        // F[i,:,i:] += X * F[lambda,:,i:]
+        if (lambda != 0) {
+            for (unsigned int j = q_index_i; j < nbDof; j++) {
+                F_i.col(j) += X * F[lambda-1].col(j);
+            }
+        }
+    }
+    // End of Second Forward Pass
+
+    // Fill in full matrix (currently only upper triangular)
+    for (unsigned int j = 0; j < nbDof; j++) {
+        for (unsigned int i = j + 1; i < nbDof; i++) {
+            Minv(i, j) = Minv(j, i);
+        }
+    }
 }
+#endif
 
 utils::Vector3d rigidbody::Joints::CoMdot(
     const rigidbody::GeneralizedCoordinates &Q,
@@ -816,13 +1088,15 @@ utils::Vector3d rigidbody::Joints::CoMdot(
 
     // CoMdot = sum(mass_seg * Jacobian * qdot)/mass totale
     utils::Matrix Jac(utils::Matrix(3,this->dof_count));
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
     for (const auto& segment : *m_segments) {
         Jac.setZero();
         RigidBodyDynamics::CalcPointJacobian(
             *this, Q, GetBodyId(segment.name().c_str()),
-            segment.characteristics().mCenterOfMass, Jac, updateKin);
+            segment.characteristics().mCenterOfMass, Jac, false);
         com_dot += ((Jac*Qdot) * segment.characteristics().mMass);
-        updateKin = false;
     }
     // Divide by total mass
     com_dot = com_dot/mass();
@@ -841,9 +1115,12 @@ utils::Vector3d rigidbody::Joints::CoMddot(
 #endif
     utils::Scalar mass;
     RigidBodyDynamics::Math::Vector3d com, com_ddot;
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass(
         *this, Q, Qdot, &Qddot, mass, com, nullptr, &com_ddot,
-        nullptr, nullptr, updateKin);
+        nullptr, nullptr, false);
 
 
     // Return the acceleration of CoM
@@ -863,13 +1140,15 @@ utils::Matrix rigidbody::Joints::CoMJacobian(
 
     // CoMdot = sum(mass_seg * Jacobian * qdot)/mass total
     utils::Matrix Jac(utils::Matrix::Zero(3,this->dof_count));
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
     for (auto segment : *m_segments) {
         Jac.setZero();
         RigidBodyDynamics::CalcPointJacobian(
             *this, Q, GetBodyId(segment.name().c_str()),
-            segment.characteristics().mCenterOfMass, Jac, updateKin);
+            segment.characteristics().mCenterOfMass, Jac, false);
         JacTotal += segment.characteristics().mMass*Jac;
-        updateKin = false;
     }
 
     // Divide by total mass
@@ -893,6 +1172,26 @@ rigidbody::Joints::CoMbySegment(
     return out;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::CoMbySegment(
+    const rigidbody::GeneralizedCoordinates &Q,
+    std::vector<utils::Point3d>& comOut,
+    bool updateKin)
+{
+    if (comOut.size() != m_segments->size()) {
+        comOut.resize(m_segments->size());
+    }
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
+    for (size_t i=0; i<m_segments->size(); ++i) {
+        comOut[i] = RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                        *this, Q, static_cast<unsigned int>((*m_segments)[i].id()),
+                        (*m_segments)[i].characteristics().mCenterOfMass, false);
+    }
+}
+#endif
+
 utils::Matrix rigidbody::Joints::CoMbySegmentInMatrix(
     const rigidbody::GeneralizedCoordinates &Q,
     bool updateKin)
@@ -916,9 +1215,12 @@ utils::Vector3d rigidbody::Joints::CoMbySegment(
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
     return RigidBodyDynamics::CalcBodyToBaseCoordinates(
                *this, Q, static_cast<unsigned int>((*m_segments)[idx].id()),
-               (*m_segments)[idx].characteristics().mCenterOfMass, updateKin);
+               (*m_segments)[idx].characteristics().mCenterOfMass, false);
 }
 
 
@@ -948,9 +1250,12 @@ utils::Vector3d rigidbody::Joints::CoMdotBySegment(
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot);
+    }
     return CalcPointVelocity(
                *this, Q, Qdot, static_cast<unsigned int>((*m_segments)[idx].id()),
-               (*m_segments)[idx].characteristics().mCenterOfMass,updateKin);
+               (*m_segments)[idx].characteristics().mCenterOfMass, false);
 }
 
 
@@ -982,9 +1287,12 @@ utils::Vector3d rigidbody::Joints::CoMddotBySegment(
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
     return RigidBodyDynamics::CalcPointAcceleration(
                *this, Q, Qdot, Qddot, static_cast<unsigned int>((*m_segments)[idx].id()),
-               (*m_segments)[idx].characteristics().mCenterOfMass,updateKin);
+               (*m_segments)[idx].characteristics().mCenterOfMass, false);
 }
 
 std::vector<std::vector<utils::Vector3d>>
@@ -1053,6 +1361,36 @@ rigidbody::Joints::meshPointsInMatrix(
     }
     return all_points;
 }
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::meshPoints(
+    const rigidbody::GeneralizedCoordinates &Q,
+    std::vector<std::vector<utils::Point3d>>& pointsOut,
+    bool updateKin)
+{
+    if (pointsOut.size() != m_segments->size()) {
+        pointsOut.resize(m_segments->size());
+    }
+    if (updateKin) {
+        UpdateKinematicsCustom (&Q);
+    }
+
+    for (size_t i=0; i<m_segments->size(); ++i) {
+        const rigidbody::Mesh& mesh((*m_segments)[i].characteristics().mesh());
+        std::vector<utils::Point3d>& points(pointsOut[i]);
+        if (points.size() != mesh.nbVertex()) {
+            points.resize(mesh.nbVertex());
+        }
+
+        // The vertices are expressed in the JCS of the segment
+        unsigned int id(static_cast<unsigned int>((*m_segments)[i].id()));
+        for (size_t j=0; j<mesh.nbVertex(); ++j) {
+            points[j] = RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                            *this, Q, id, mesh.point(j), false);
+        }
+    }
+}
+#endif
+
 std::vector<utils::Vector3d> rigidbody::Joints::meshPoints(
     const std::vector<utils::RotoTrans> &RT,
     size_t i) const
@@ -1114,9 +1452,12 @@ utils::Vector3d rigidbody::Joints::CalcAngularMomentum (
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass(
         *this, Q, Qdot, nullptr, mass, com, nullptr, nullptr,
-        &angularMomentum, nullptr, updateKin);
+        &angularMomentum, nullptr, false);
     return angularMomentum;
 }
 
@@ -1135,9 +1476,12 @@ utils::Vector3d rigidbody::Joints::CalcAngularMomentum (
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass(
         *this, Q, Qdot, &Qddot, mass, com, nullptr, nullptr,
-        &angularMomentum, nullptr, updateKin);
+        &angularMomentum, nullptr, false);
 
     return angularMomentum;
 }
@@ -1154,9 +1498,12 @@ rigidbody::Joints::CalcSegmentsAngularMomentum (
 
     utils::Scalar mass;
     RigidBodyDynamics::Math::Vector3d com;
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass (
         *this, Q, Qdot, nullptr, mass, com, nullptr,
-        nullptr, nullptr, nullptr, updateKin);
+        nullptr, nullptr, nullptr, false);
     RigidBodyDynamics::Math::SpatialTransform X_to_COM (
         RigidBodyDynamics::Math::Xtrans(com));
 
@@ -1195,9 +1542,12 @@ rigidbody::Joints::CalcSegmentsAngularMomentum (
 
     utils::Scalar mass;
     RigidBodyDynamics::Math::Vector3d com;
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass (*this, Q, Qdot, &Qddot, mass, com,
             nullptr, nullptr, nullptr, nullptr,
-            updateKin);
+            false);
     RigidBodyDynamics::Math::SpatialTransform X_to_COM (
         RigidBodyDynamics::Math::Xtrans(com));
 
@@ -1223,6 +1573,103 @@ rigidbody::Joints::CalcSegmentsAngularMomentum (
     return h_segment;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::wholeBodyQuantities(
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &Qdot,
+    const rigidbody::GeneralizedAcceleration *Qddot,
+    rigidbody::WholeBodyQuantities& out,
+    bool perSegment,
+    bool updateKin)
+{
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot, Qddot);
+    }
+    size_t nbSegments(m_segments->size());
+    if (perSegment) {
+        if (out.segmentsCoM.size() != nbSegments) {
+            out.segmentsCoM.resize(nbSegments);
+            out.segmentsCoMdot.resize(nbSegments);
+            out.segmentsAngularMomentum.resize(nbSegments);
+        }
+        if (Qddot && out.segmentsCoMddot.size() != nbSegments) {
+            out.segmentsCoMddot.resize(nbSegments);
+        }
+    }
+
+    // Sum the mass weighted positions, velocities and accelerations of the segment centers of
+    // mass, the kinetic energy and the angular momentum about the origin
+    utils::Scalar mass(0);
+    utils::Scalar kineticEnergy(0);
+    RigidBodyDynamics::Math::Vector3d mp(0, 0, 0);
+    RigidBodyDynamics::Math::Vector3d mpdot(0, 0, 0);
+    RigidBodyDynamics::Math::Vector3d mpddot(0, 0, 0);
+    RigidBodyDynamics::Math::Vector3d h(0, 0, 0);
+    for (size_t i=0; i<nbSegments; ++i) {
+        const rigidbody::SegmentCharacteristics& characteristics((*m_segments)[i].characteristics());
+        unsigned int id(static_cast<unsigned int>((*m_segments)[i].id()));
+
+        // A segment without dof is merged by rbdl into the body it is fixed to, which gives its velocity
+        unsigned int movableId(id);
+        if (IsFixedBodyId(id)) {
+            movableId = mFixedBodies[id - fixed_body_discriminator].mMovableParent;
+        }
+        const RigidBodyDynamics::Math::Matrix3d& movableE(X_base[movableId].E);
+        const RigidBodyDynamics::Math::Vector3d& movableR(X_base[movableId].r);
+
+        RigidBodyDynamics::Math::Vector3d p(RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                *this, Q, id, characteristics.mCenterOfMass, false));
+        RigidBodyDynamics::Math::Vector3d omega(movableE.transpose() * v[movableId].head<3>());
+        RigidBodyDynamics::Math::Vector3d pdot(
+            movableE.transpose() * v[movableId].tail<3>() + omega.cross(p - movableR));
+
+        // Angular momentum of the segment about its own center of mass
+        RigidBodyDynamics::Math::Matrix3d E(RigidBodyDynamics::CalcBodyWorldOrientation(*this, Q, id, false));
+        RigidBodyDynamics::Math::Vector3d omegaLocal(E * omega);
+        RigidBodyDynamics::Math::Vector3d Iomega(characteristics.mInertia * omegaLocal);
+
+        const utils::Scalar& m(characteristics.mMass);
+        mass += m;
+        mp += m * p;
+        mpdot += m * pdot;
+        h += E.transpose() * Iomega + m * p.cross(pdot);
+        kineticEnergy += 0.5 * (m * pdot.dot(pdot) + omegaLocal.dot(Iomega));
+
+        if (Qddot) {
+            RigidBodyDynamics::Math::Vector3d pddot(
+                movableE.transpose() * (a[movableId].tail<3>() + a[movableId].head<3>().cross(movableE * (p - movableR)))
+                + omega.cross(pdot));
+            mpddot += m * pddot;
+            if (perSegment) {
+                out.segmentsCoMddot[i] = pddot;
+            }
+        }
+        if (perSegment) {
+            out.segmentsCoM[i] = p;
+            out.segmentsCoMdot[i] = pdot;
+            out.segmentsAngularMomentum[i] = E.transpose() * Iomega;
+        }
+    }
+
+    out.mass = mass;
+    out.CoM = mp / mass;
+    out.CoMdot = mpdot / mass;
+    if (Qddot) {
+        out.CoMddot = mpddot / mass;
+    }
+    out.angularMomentum = h - mass * out.CoM.cross(out.CoMdot);
+    out.kineticEnergy = kineticEnergy;
+    out.potentialEnergy = -mass * out.CoM.dot(gravity);
+
+    if (perSegment) {
+        for (size_t i=0; i<nbSegments; ++i) {
+            out.segmentsAngularMomentum[i] += (*m_segments)[i].characteristics().mMass
+                                              * (out.segmentsCoM[i] - out.CoM).cross(out.segmentsCoMdot[i]);
+        }
+    }
+}
+#endif
+
 size_t rigidbody::Joints::nbQuat() const
 {
     return *m_nRotAQuat;
@@ -1277,7 +1724,10 @@ utils::Scalar rigidbody::Joints::KineticEnergy(
         const rigidbody::GeneralizedVelocity &QDot,
         bool updateKin)
 {
-    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, updateKin);
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &QDot);
+    }
+    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, false);
 }
 
 
@@ -1285,7 +1735,10 @@ utils::Scalar rigidbody::Joints::PotentialEnergy(
         const rigidbody::GeneralizedCoordinates &Q,
         bool updateKin)
 {
-    return RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, updateKin);
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q);
+    }
+    return RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, false);
 }
 
 utils::Scalar rigidbody::Joints::Lagrangian(
@@ -1293,7 +1746,10 @@ utils::Scalar rigidbody::Joints::Lagrangian(
         const rigidbody::GeneralizedVelocity &QDot,
         bool updateKin)
 {
-    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, updateKin) - RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, updateKin);
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &QDot);
+    }
+    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, false) - RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, false);
 }
 
 
@@ -1302,7 +1758,10 @@ utils::Scalar rigidbody::Joints::TotalEnergy(
         const rigidbody::GeneralizedVelocity &QDot,
         bool updateKin)
 {
-    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, updateKin) + RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, updateKin);;
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &QDot);
+    }
+    return RigidBodyDynamics::Utils::CalcKineticEnergy(*this, Q, QDot, false) + RigidBodyDynamics::Utils::CalcPotentialEnergy(*this, Q, false);
 }
 
 rigidbody::GeneralizedTorque rigidbody::Joints::InverseDynamics(
@@ -1311,8 +1770,7 @@ rigidbody::GeneralizedTorque rigidbody::Joints::InverseDynamics(
     const rigidbody::GeneralizedAcceleration& QDDot
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return InverseDynamics(Q, QDot, QDDot, forceSet);
+    return InverseDynamics(Q, QDot, QDDot, defaultExternalForces());
 }
 rigidbody::GeneralizedTorque rigidbody::Joints::InverseDynamics(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1322,18 +1780,35 @@ rigidbody::GeneralizedTorque rigidbody::Joints::InverseDynamics(
 )
 {
     rigidbody::GeneralizedTorque Tau(nbGeneralizedTorque());
-    auto fExt = externalForces.computeRbdlSpatialVectors(Q, QDot);
-    RigidBodyDynamics::InverseDynamics(*this, Q, QDot, QDDot, Tau, &fExt);
+    auto fExt = externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot);
+    RigidBodyDynamics::InverseDynamics(*this, Q, QDot, QDDot, Tau, fExt);
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
     return Tau;
 }
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::InverseDynamics(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedAcceleration& QDDot,
+    rigidbody::ExternalForceSet& externalForces,
+    rigidbody::GeneralizedTorque& Tau
+)
+{
+    if (static_cast<size_t>(Tau.size()) != nbGeneralizedTorque()) {
+        Tau.resize(static_cast<unsigned int>(nbGeneralizedTorque()));
+    }
+    RigidBodyDynamics::InverseDynamics(
+        *this, Q, QDot, QDDot, Tau, externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot));
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
+}
+#endif
 
 rigidbody::GeneralizedTorque rigidbody::Joints::NonLinearEffect(
     const rigidbody::GeneralizedCoordinates& Q,
     const rigidbody::GeneralizedVelocity& QDot
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return NonLinearEffect(Q, QDot, forceSet);
+    return NonLinearEffect(Q, QDot, defaultExternalForces());
 }
 rigidbody::GeneralizedTorque rigidbody::Joints::NonLinearEffect(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1342,10 +1817,27 @@ rigidbody::GeneralizedTorque rigidbody::Joints::NonLinearEffect(
 )
 {
     rigidbody::GeneralizedTorque Tau(*this);
-    auto fExt = externalForces.computeRbdlSpatialVectors(Q, QDot);
-    RigidBodyDynamics::NonlinearEffects(*this, Q, QDot, Tau, &fExt);
+    auto fExt = externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot);
+    RigidBodyDynamics::NonlinearEffects(*this, Q, QDot, Tau, fExt);
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
     return Tau;
 }
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::NonLinearEffect(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    rigidbody::ExternalForceSet& externalForces,
+    rigidbody::GeneralizedTorque& Tau
+)
+{
+    if (static_cast<size_t>(Tau.size()) != nbGeneralizedTorque()) {
+        Tau.resize(static_cast<unsigned int>(nbGeneralizedTorque()));
+    }
+    RigidBodyDynamics::NonlinearEffects(
+        *this, Q, QDot, Tau, externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot));
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
+}
+#endif
 
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamics(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1353,8 +1845,7 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamics(
     const rigidbody::GeneralizedTorque& Tau
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return ForwardDynamics(Q, QDot, Tau, forceSet);
+    return ForwardDynamics(Q, QDot, Tau, defaultExternalForces());
 }
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamics(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1364,16 +1855,296 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamics(
 )
 {
     rigidbody::GeneralizedAcceleration QDDot(*this);
-    auto fExt = externalForces.computeRbdlSpatialVectors(Q, QDot, true);
-    RigidBodyDynamics::ForwardDynamics(*this, Q, QDot, Tau, QDDot, &fExt);
+    auto fExt = externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot, true);
+    RigidBodyDynamics::ForwardDynamics(*this, Q, QDot, Tau, QDDot, fExt);
+    kinematicsUpdatedByRbdl(&Q, &QDot);
     return QDDot;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Fill the motion subspace of a joint and its first and second derivatives with respect
+/// to the coordinates of the joint
+/// \param model The model, with its motion subspaces computed at Q
+/// \param j The rbdl index of the joint
+/// \param Q The Generalized Coordinates
+/// \param S The motion subspace, only the first mDoFCount columns are used
+/// \param dS The derivative of S with respect to each coordinate of the joint
+/// \param ddS The second derivative of S with respect to each pair of coordinates of the joint
+///
+/// Only the Euler sequences have a motion subspace which depends on Q. Their velocity product
+/// c_J is dS/dt * QDot, which is how rbdl computes it
+///
+static void motionSubspaceDerivatives(
+    const RigidBodyDynamics::Model& model,
+    unsigned int j,
+    const RigidBodyDynamics::Math::VectorNd& Q,
+    RigidBodyDynamics::Math::Matrix63& S,
+    RigidBodyDynamics::Math::Matrix63 dS[3],
+    RigidBodyDynamics::Math::Matrix63 ddS[3][3])
+{
+    const RigidBodyDynamics::Joint& joint(model.mJoints[j]);
+    for (unsigned int k = 0; k < 3; ++k) {
+        dS[k].setZero();
+        for (unsigned int m = 0; m < 3; ++m) {
+            ddS[k][m].setZero();
+        }
+    }
+    S.setZero();
+    if (joint.mDoFCount == 1) {
+        S.col(0) = model.S[j];
+        return;
+    }
+    S = model.multdof3_S[j];
+    if (joint.mJointType != RigidBodyDynamics::JointTypeEulerZYX
+            && joint.mJointType != RigidBodyDynamics::JointTypeEulerXYZ) {
+        return;
+    }
+
+    double s1(std::sin(Q[joint.q_index + 1]));
+    double c1(std::cos(Q[joint.q_index + 1]));
+    double s2(std::sin(Q[joint.q_index + 2]));
+    double c2(std::cos(Q[joint.q_index + 2]));
+    if (joint.mJointType == RigidBodyDynamics::JointTypeEulerZYX) {
+        // S = [-s1, 0, 1; c1*s2, c2, 0; c1*c2, -s2, 0]
+        dS[1](0, 0) = -c1;
+        dS[1](1, 0) = -s1 * s2;
+        dS[1](2, 0) = -s1 * c2;
+        dS[2](1, 0) = c1 * c2;
+        dS[2](1, 1) = -s2;
+        dS[2](2, 0) = -c1 * s2;
+        dS[2](2, 1) = -c2;
+
+        ddS[1][1](0, 0) = s1;
+        ddS[1][1](1, 0) = -c1 * s2;
+        ddS[1][1](2, 0) = -c1 * c2;
+        ddS[1][2](1, 0) = -s1 * c2;
+        ddS[1][2](2, 0) = s1 * s2;
+        ddS[2][2](1, 0) = -c1 * s2;
+        ddS[2][2](1, 1) = -c2;
+        ddS[2][2](2, 0) = -c1 * c2;
+        ddS[2][2](2, 1) = s2;
+    } else {
+        // S = [c1*c2, s2, 0; -c1*s2, c2, 0; s1, 0, 1]
+        dS[1](0, 0) = -s1 * c2;
+        dS[1](1, 0) = s1 * s2;
+        dS[1](2, 0) = c1;
+        dS[2](0, 0) = -c1 * s2;
+        dS[2](0, 1) = c2;
+        dS[2](1, 0) = -c1 * c2;
+        dS[2](1, 1) = -s2;
+
+        ddS[1][1](0, 0) = -c1 * c2;
+        ddS[1][1](1, 0) = c1 * s2;
+        ddS[1][1](2, 0) = -s1;
+        ddS[1][2](0, 0) = s1 * s2;
+        ddS[1][2](1, 0) = s1 * c2;
+        ddS[2][2](0, 0) = -c1 * c2;
+        ddS[2][2](0, 1) = -s2;
+        ddS[2][2](1, 0) = c1 * s2;
+        ddS[2][2](1, 1) = -c2;
+    }
+    ddS[2][1] = ddS[1][2];
+}
+
+void rigidbody::Joints::InverseDynamicsDerivatives(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedAcceleration& QDDot,
+    utils::Matrix& dTau_dQ,
+    utils::Matrix& dTau_dQDot,
+    utils::Matrix& dTau_dQDDot)
+{
+    inverseDynamicsDerivatives(Q, QDot, QDDot, dTau_dQ, dTau_dQDot);
+
+    // The torques are linear in the accelerations
+    if (dTau_dQDDot.rows() != this->dof_count || dTau_dQDDot.cols() != this->dof_count) {
+        dTau_dQDDot.resize(this->dof_count, this->dof_count);
+    }
+    dTau_dQDDot.setZero();
+    RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, dTau_dQDDot, false);
+}
+
+void rigidbody::Joints::ForwardDynamicsDerivatives(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedTorque& Tau,
+    utils::Matrix& dQDDot_dQ,
+    utils::Matrix& dQDDot_dQDot,
+    utils::Matrix& dQDDot_dTau)
+{
+    checkGeneralizedDimensions(&Q, &QDot, nullptr, &Tau);
+    rigidbody::GeneralizedAcceleration QDDot(*this);
+    RigidBodyDynamics::ForwardDynamics(*this, Q, QDot, Tau, QDDot);
+
+    utils::Matrix dTau_dQ(this->dof_count, this->dof_count);
+    utils::Matrix dTau_dQDot(this->dof_count, this->dof_count);
+    inverseDynamicsDerivatives(Q, QDot, QDDot, dTau_dQ, dTau_dQDot);
+
+    // dQDDot = Minv * (dTau - dID)
+    massMatrixInverse(Q, dQDDot_dTau, false);
+    if (dQDDot_dQ.rows() != this->dof_count || dQDDot_dQ.cols() != this->dof_count) {
+        dQDDot_dQ.resize(this->dof_count, this->dof_count);
+    }
+    if (dQDDot_dQDot.rows() != this->dof_count || dQDDot_dQDot.cols() != this->dof_count) {
+        dQDDot_dQDot.resize(this->dof_count, this->dof_count);
+    }
+    dQDDot_dQ.noalias() = -dQDDot_dTau * dTau_dQ;
+    dQDDot_dQDot.noalias() = -dQDDot_dTau * dTau_dQDot;
+}
+
+void rigidbody::Joints::inverseDynamicsDerivatives(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedAcceleration& QDDot,
+    utils::Matrix& dTau_dQ,
+    utils::Matrix& dTau_dQDot)
+{
+    checkGeneralizedDimensions(&Q, &QDot, &QDDot);
+    if (*m_nRotAQuat != 0) {
+        utils::Error::raise("The dynamics derivatives do not support quaternions");
+    }
+    // Assuming that this may also be a SoftContacts type (via BiorbdModel)
+    const rigidbody::SoftContacts* softContacts(dynamic_cast<const rigidbody::SoftContacts*>(this));
+    if (softContacts && softContacts->nbSoftContacts() != 0) {
+        utils::Error::raise("The dynamics derivatives do not support soft contacts");
+    }
+    for (unsigned int j = 1; j < this->mBodies.size(); ++j) {
+        if (this->mJoints[j].mJointType == RigidBodyDynamics::JointTypeCustom) {
+            utils::Error::raise("The dynamics derivatives do not support custom joints");
+        }
+    }
+    unsigned int nbDof(this->dof_count);
+    for (utils::Matrix* out : {&dTau_dQ, &dTau_dQDot}) {
+        if (out->rows() != nbDof || out->cols() != nbDof) {
+            out->resize(nbDof, nbDof);
+        }
+        out->setZero();
+    }
+
+    // The nominal pass leaves v, a (with the gravity) and the total f of each body in the model
+    RigidBodyDynamics::Math::VectorNd Tau(nbDof);
+    RigidBodyDynamics::InverseDynamics(*this, Q, QDot, QDDot, Tau);
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
+
+    size_t nbBodies(this->mBodies.size());
+    std::vector<RigidBodyDynamics::Math::SpatialVector> dv(nbBodies);
+    std::vector<RigidBodyDynamics::Math::SpatialVector> da(nbBodies);
+    std::vector<RigidBodyDynamics::Math::SpatialVector> df(nbBodies);
+    std::vector<bool> isMoved(nbBodies);
+    RigidBodyDynamics::Math::Matrix63 S;
+    RigidBodyDynamics::Math::Matrix63 dS[3];
+    RigidBodyDynamics::Math::Matrix63 ddS[3][3];
+
+    for (unsigned int j = 1; j < nbBodies; ++j) {
+        const RigidBodyDynamics::Joint& joint(this->mJoints[j]);
+        unsigned int lambda_j(this->lambda[j]);
+        motionSubspaceDerivatives(*this, j, Q, S, dS, ddS);
+        RigidBodyDynamics::Math::Vector3d qdot_j(RigidBodyDynamics::Math::Vector3d::Zero());
+        RigidBodyDynamics::Math::Vector3d qddot_j(RigidBodyDynamics::Math::Vector3d::Zero());
+        for (unsigned int m = 0; m < joint.mDoFCount; ++m) {
+            qdot_j[m] = QDot[joint.q_index + m];
+            qddot_j[m] = QDDot[joint.q_index + m];
+        }
+        RigidBodyDynamics::Math::Matrix63 Sdot(RigidBodyDynamics::Math::Matrix63::Zero());
+        for (unsigned int m = 0; m < joint.mDoFCount; ++m) {
+            Sdot += qdot_j[m] * dS[m];
+        }
+        RigidBodyDynamics::Math::SpatialVector Xv(this->X_lambda[j].apply(this->v[lambda_j]));
+        RigidBodyDynamics::Math::SpatialVector Xa(this->X_lambda[j].apply(this->a[lambda_j]));
+        RigidBodyDynamics::Math::SpatialVector Iv(this->I[j] * this->v[j]);
+
+        for (unsigned int k = 0; k < joint.mDoFCount; ++k) {
+            unsigned int col(joint.q_index + k);
+            RigidBodyDynamics::Math::SpatialVector S_k(S.col(k));
+
+            for (bool wrtQ : {true, false}) {
+                utils::Matrix& out(wrtQ ? dTau_dQ : dTau_dQDot);
+
+                // Derivatives of the velocity, acceleration and force of the body of the dof
+                RigidBodyDynamics::Math::SpatialVector dv_J;
+                RigidBodyDynamics::Math::SpatialVector dc_J;
+                if (wrtQ) {
+                    // d(X_lambda)/dq_k = -S_k x X_lambda
+                    dv_J = dS[k] * qdot_j;
+                    dc_J.setZero();
+                    for (unsigned int m = 0; m < joint.mDoFCount; ++m) {
+                        dc_J += qdot_j[m] * (ddS[m][k] * qdot_j);
+                    }
+                    dv[j] = -RigidBodyDynamics::Math::crossm(S_k, Xv) + dv_J;
+                    da[j] = -RigidBodyDynamics::Math::crossm(S_k, Xa) + dS[k] * qddot_j;
+                } else {
+                    dv_J = S_k;
+                    dc_J = dS[k] * qdot_j + Sdot.col(k);
+                    dv[j] = dv_J;
+                    da[j].setZero();
+                }
+                da[j] += dc_J
+                         + RigidBodyDynamics::Math::crossm(dv[j], this->v_J[j])
+                         + RigidBodyDynamics::Math::crossm(this->v[j], dv_J);
+                df[j] = this->I[j] * da[j]
+                        + RigidBodyDynamics::Math::crossf(dv[j], Iv)
+                        + RigidBodyDynamics::Math::crossf(this->v[j], this->I[j] * dv[j]);
+
+                // Only the subtree of the dof moves differently
+                for (size_t i = 0; i < nbBodies; ++i) {
+                    isMoved[i] = i == j;
+                    if (i != j) {
+                        df[i].setZero();
+                    }
+                }
+                for (unsigned int i = j + 1; i < nbBodies; ++i) {
+                    unsigned int lambda_i(this->lambda[i]);
+                    if (!isMoved[lambda_i]) {
+                        continue;
+                    }
+                    isMoved[i] = true;
+                    dv[i] = this->X_lambda[i].apply(dv[lambda_i]);
+                    da[i] = this->X_lambda[i].apply(da[lambda_i])
+                            + RigidBodyDynamics::Math::crossm(dv[i], this->v_J[i]);
+                    df[i] = this->I[i] * da[i]
+                            + RigidBodyDynamics::Math::crossf(dv[i], this->I[i] * this->v[i])
+                            + RigidBodyDynamics::Math::crossf(this->v[i], this->I[i] * dv[i]);
+                }
+
+                // The forces are brought back to the root, the ancestors of the body included
+                for (unsigned int i = static_cast<unsigned int>(nbBodies - 1); i > 0; --i) {
+                    unsigned int q_index_i(this->mJoints[i].q_index);
+                    if (this->mJoints[i].mDoFCount == 1) {
+                        out(q_index_i, col) = this->S[i].dot(df[i]);
+                    } else {
+                        out.block<3, 1>(q_index_i, col) = this->multdof3_S[i].transpose() * df[i];
+                    }
+                    if (wrtQ && i == j) {
+                        // d(S)/dq_k^T * f
+                        out.block(q_index_i, col, joint.mDoFCount, 1) +=
+                            dS[k].leftCols(joint.mDoFCount).transpose() * this->f[j];
+                    }
+                    if (this->lambda[i] != 0) {
+                        df[this->lambda[i]] += this->X_lambda[i].applyTranspose(df[i]);
+                        if (wrtQ && i == j) {
+                            // d(X_lambda^T)/dq_k * f = X_lambda^T * (S_k x* f)
+                            df[this->lambda[i]] += this->X_lambda[i].applyTranspose(
+                                                       RigidBodyDynamics::Math::crossf(S_k, this->f[j]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsFreeFloatingBase(
     const rigidbody::GeneralizedCoordinates& Q,
     const rigidbody::GeneralizedVelocity& QDot,
     const rigidbody::GeneralizedAcceleration& QJointsDDot)
 {
+#ifndef BIORBD_USE_CASADI_MATH
+    rigidbody::GeneralizedAcceleration QRootDDot(this->nbRoot());
+    ForwardDynamicsFreeFloatingBase(Q, QDot, QJointsDDot, QRootDDot);
+    return QRootDDot;
+#else
 
     utils::Error::check(QJointsDDot.size() == this->nbQddot() - this->nbRoot(),
                         "Size of QDDotJ must be equal to number of QDDot - number of root coordinates.");
@@ -1391,15 +2162,117 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsFreeFloatin
 
     MassMatrixNlEffects = InverseDynamics(Q, QDot, QDDot);
 
-#ifdef BIORBD_USE_CASADI_MATH
     auto linsol = casadi::Linsol("linsol", "symbolicqr", massMatrixRoot.sparsity());
     QRootDDot = linsol.solve(massMatrixRoot, -MassMatrixNlEffects.block(0, 0, static_cast<unsigned int>(this->nbRoot()), 1));
-#else
-    QRootDDot = massMatrixRoot.llt().solve(-MassMatrixNlEffects.block(0, 0, static_cast<unsigned int>(this->nbRoot()), 1));
-#endif
 
     return QRootDDot;
+#endif
+}
+
+#ifndef BIORBD_USE_CASADI_MATH
+///
+/// \brief Return one column of the motion subspace of a joint of one or three dof
+/// \param model The model, with its motion subspaces computed at Q
+/// \param j The rbdl index of the joint
+/// \param c The column
+/// \return The column of the motion subspace
+///
+static RigidBodyDynamics::Math::SpatialVector motionSubspaceColumn(
+    const RigidBodyDynamics::Model& model,
+    unsigned int j,
+    unsigned int c)
+{
+    if (model.mJoints[j].mDoFCount == 1) {
+        return model.S[j];
+    }
+    return model.multdof3_S[j].col(c);
+}
+
+void rigidbody::Joints::ForwardDynamicsFreeFloatingBase(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedAcceleration& QJointsDDot,
+    rigidbody::GeneralizedAcceleration& QRootDDot)
+{
+    utils::Error::check(QJointsDDot.size() == this->nbQddot() - this->nbRoot(),
+                        "Size of QDDotJ must be equal to number of QDDot - number of root coordinates.");
+
+    utils::Error::check(this->nbRoot() > 0, "Must have a least one degree of freedom on root.");
+
+    unsigned int nbRoot(static_cast<unsigned int>(this->nbRoot()));
+    unsigned int nbDof(this->dof_count);
+    if (QRootDDot.size() != nbRoot) {
+        QRootDDot.resize(nbRoot);
+    }
+
+    // Inverse dynamics with null root accelerations, the root rows are the root nonlinear effects
+    utils::Vector& QDDot(*m_freeFloatingBaseQDDot);
+    utils::Vector& Tau(*m_freeFloatingBaseTau);
+    if (QDDot.size() != nbDof) {
+        QDDot.resize(nbDof);
+        Tau.resize(nbDof);
+    }
+    QDDot.head(nbRoot).setZero();
+    QDDot.tail(nbDof - nbRoot) = QJointsDDot;
+    auto fExt = defaultExternalForces().computeRbdlSpatialVectorsInPlace(Q, QDot);
+    RigidBodyDynamics::InverseDynamics(*this, Q, QDot, QDDot, Tau, fExt);
+    kinematicsUpdatedByRbdl(&Q, &QDot); // The accelerations include the gravity
+
+    // Root block of the mass matrix, from the composite inertias and the X_lambda of the pass above
+    utils::Matrix& massMatrixRoot(*m_freeFloatingBaseMassMatrix);
+    if (massMatrixRoot.rows() != nbRoot) {
+        massMatrixRoot.resize(nbRoot, nbRoot);
+    }
+    bool isRecursive(true);
+    for (unsigned int i = 1; i < this->mBodies.size(); ++i) {
+        this->Ic[i] = this->I[i];
+        if (this->mJoints[i].q_index < nbRoot
+                && (this->mJoints[i].mJointType == RigidBodyDynamics::JointTypeCustom
+                    || (this->mJoints[i].mDoFCount != 1 && this->mJoints[i].mDoFCount != 3))) {
+            isRecursive = false;
+        }
+    }
+    if (isRecursive) {
+        for (unsigned int i = static_cast<unsigned int>(this->mBodies.size() - 1); i > 0; --i) {
+            unsigned int lambda = this->lambda[i];
+            if (lambda != 0) {
+                this->Ic[lambda] = this->Ic[lambda] + this->X_lambda[i].applyTranspose(this->Ic[i]);
+            }
+            unsigned int q_index_i = this->mJoints[i].q_index;
+            if (q_index_i >= nbRoot) {
+                continue;
+            }
+
+            // The ancestors of a root body are root bodies too
+            for (unsigned int c = 0; c < this->mJoints[i].mDoFCount; ++c) {
+                RigidBodyDynamics::Math::SpatialVector F(this->Ic[i] * motionSubspaceColumn(*this, i, c));
+                unsigned int j = i;
+                while (true) {
+                    unsigned int q_index_j = this->mJoints[j].q_index;
+                    for (unsigned int cj = 0; cj < this->mJoints[j].mDoFCount; ++cj) {
+                        double M_ij(F.dot(motionSubspaceColumn(*this, j, cj)));
+                        massMatrixRoot(q_index_i + c, q_index_j + cj) = M_ij;
+                        massMatrixRoot(q_index_j + cj, q_index_i + c) = M_ij;
+                    }
+                    if (this->lambda[j] == 0) {
+                        break;
+                    }
+                    F = this->X_lambda[j].applyTranspose(F);
+                    j = this->lambda[j];
+                }
+            }
+        }
+    } else {
+        RigidBodyDynamics::Math::MatrixNd M(RigidBodyDynamics::Math::MatrixNd::Zero(nbDof, nbDof));
+        RigidBodyDynamics::CompositeRigidBodyAlgorithm(*this, Q, M, false);
+        massMatrixRoot = M.topLeftCorner(nbRoot, nbRoot);
+    }
+
+    QRootDDot = -Tau.head(nbRoot);
+    Eigen::LLT<Eigen::Ref<Eigen::MatrixXd>> llt(massMatrixRoot);
+    llt.solveInPlace(QRootDDot);
 }
+#endif
 
 
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraintsDirect(
@@ -1408,8 +2281,9 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints
     const rigidbody::GeneralizedTorque& Tau
 )
 {
-    rigidbody::Contacts CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
-    return ForwardDynamicsConstraintsDirect(Q, QDot, Tau, CS);
+    return computeForwardDynamicsConstraints(
+               Q, QDot, Tau, dynamic_cast<rigidbody::Contacts*>(this)->getConstraints(),
+               defaultExternalForces(), rigidbody::CONSTRAINT_SOLVER_DIRECT);
 }
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraintsDirect(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1418,8 +2292,9 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints
     rigidbody::ExternalForceSet& externalForces
 )
 {
-    rigidbody::Contacts CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
-    return this->ForwardDynamicsConstraintsDirect(Q, QDot, Tau, CS, externalForces);
+    return computeForwardDynamicsConstraints(
+               Q, QDot, Tau, dynamic_cast<rigidbody::Contacts*>(this)->getConstraints(),
+               externalForces, rigidbody::CONSTRAINT_SOLVER_DIRECT);
 }
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraintsDirect(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1428,8 +2303,8 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints
     rigidbody::Contacts& CS
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return ForwardDynamicsConstraintsDirect(Q, QDot, Tau, CS, forceSet);
+    return computeForwardDynamicsConstraints(
+               Q, QDot, Tau, CS, defaultExternalForces(), rigidbody::CONSTRAINT_SOLVER_DIRECT);
 }
 rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraintsDirect(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1438,6 +2313,39 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints
     rigidbody::Contacts& CS,
     rigidbody::ExternalForceSet& externalForces
 )
+{
+    return computeForwardDynamicsConstraints(
+               Q, QDot, Tau, CS, externalForces, rigidbody::CONSTRAINT_SOLVER_DIRECT);
+}
+
+rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedTorque& Tau
+)
+{
+    return ForwardDynamicsConstraints(Q, QDot, Tau, defaultExternalForces());
+}
+rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedTorque& Tau,
+    rigidbody::ExternalForceSet& externalForces
+)
+{
+    rigidbody::Contacts& CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
+    return computeForwardDynamicsConstraints(
+               Q, QDot, Tau, CS, externalForces, CS.constraintSolver());
+}
+
+rigidbody::GeneralizedAcceleration rigidbody::Joints::computeForwardDynamicsConstraints(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot,
+    const rigidbody::GeneralizedTorque& Tau,
+    rigidbody::Contacts& CS,
+    rigidbody::ExternalForceSet& externalForces,
+    rigidbody::CONSTRAINT_SOLVER solver
+)
 {
 #ifdef BIORBD_USE_CASADI_MATH
     bool updateKin = true;
@@ -1447,19 +2355,49 @@ rigidbody::GeneralizedAcceleration rigidbody::Joints::ForwardDynamicsConstraints
 #endif
 
     rigidbody::GeneralizedAcceleration QDDot(*this);
-    auto fExt = externalForces.computeRbdlSpatialVectors(Q, QDot, true);
-    RigidBodyDynamics::ForwardDynamicsConstraintsDirect(*this, Q, QDot, Tau, CS, QDDot, updateKin, &fExt);
+    auto fExt = externalForces.computeRbdlSpatialVectorsInPlace(Q, QDot, true);
+    switch (solver) {
+    case rigidbody::CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE:
+        RigidBodyDynamics::ForwardDynamicsConstraintsRangeSpaceSparse(
+            *this, Q, QDot, Tau, CS, QDDot, updateKin, fExt);
+        break;
+    case rigidbody::CONSTRAINT_SOLVER_NULL_SPACE:
+        RigidBodyDynamics::ForwardDynamicsConstraintsNullSpace(
+            *this, Q, QDot, Tau, CS, QDDot, updateKin, fExt);
+        break;
+    default:
+        RigidBodyDynamics::ForwardDynamicsConstraintsDirect(
+            *this, Q, QDot, Tau, CS, QDDot, updateKin, fExt);
+    }
+    kinematicsUpdatedByRbdl(&Q, &QDot);
     return QDDot;
 }
 
+BIORBD_NAMESPACE::Model* rigidbody::Joints::completeModel()
+{
+    return nullptr;
+}
+
+rigidbody::ExternalForceSet& rigidbody::Joints::defaultExternalForces()
+{
+    // A model assigned from another one also gets its default external forces
+    if (!m_defaultExternalForces
+            || static_cast<const rigidbody::Joints*>(&m_defaultExternalForces->model()) != this) {
+        BIORBD_NAMESPACE::Model* model(completeModel());
+        utils::Error::check(model != nullptr,
+                            "The default external forces need the joints to be part of a Model");
+        m_defaultExternalForces = std::make_shared<rigidbody::ExternalForceSet>(*model);
+    }
+    return *m_defaultExternalForces;
+}
+
 utils::Vector rigidbody::Joints::ContactForcesFromForwardDynamicsConstraintsDirect(
     const rigidbody::GeneralizedCoordinates& Q,
     const rigidbody::GeneralizedVelocity& QDot,
     const rigidbody::GeneralizedTorque& Tau
 )
 {
-    rigidbody::ExternalForceSet forceSet(static_cast<BIORBD_NAMESPACE::Model&>(*this));
-    return ContactForcesFromForwardDynamicsConstraintsDirect(Q, QDot, Tau, forceSet);
+    return ContactForcesFromForwardDynamicsConstraintsDirect(Q, QDot, Tau, defaultExternalForces());
 }
 utils::Vector rigidbody::Joints::ContactForcesFromForwardDynamicsConstraintsDirect(
     const rigidbody::GeneralizedCoordinates& Q,
@@ -1468,7 +2406,7 @@ utils::Vector rigidbody::Joints::ContactForcesFromForwardDynamicsConstraintsDire
     rigidbody::ExternalForceSet& externalForces
 )
 {
-    rigidbody::Contacts CS = dynamic_cast<rigidbody::Contacts*> (this)->getConstraints();
+    rigidbody::Contacts& CS = dynamic_cast<rigidbody::Contacts*> (this)->getConstraints();
     this->ForwardDynamicsConstraintsDirect(Q, QDot, Tau, CS, externalForces);
     return CS.getForce();
 }
@@ -1478,18 +2416,50 @@ rigidbody::GeneralizedVelocity rigidbody::Joints::ComputeConstraintImpulsesDirec
     const rigidbody::GeneralizedVelocity& QDotPre
 )
 {
-    rigidbody::Contacts CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
+    return ComputeConstraintImpulsesDirect(
+               Q, QDotPre, dynamic_cast<rigidbody::Contacts*>(this)->getConstraints());
+}
+rigidbody::GeneralizedVelocity rigidbody::Joints::ComputeConstraintImpulsesDirect(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDotPre,
+    rigidbody::Contacts& CS
+)
+{
     if (CS.nbContacts() == 0) {
         return QDotPre;
     } else {
-        CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
-
         rigidbody::GeneralizedVelocity QDotPost(*this);
         RigidBodyDynamics::ComputeConstraintImpulsesDirect(*this, Q, QDotPre, CS, QDotPost);
+        kinematicsUpdatedByRbdl(&Q);
         return QDotPost;
     }
 }
 
+rigidbody::GeneralizedVelocity rigidbody::Joints::ComputeConstraintImpulses(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDotPre
+)
+{
+    rigidbody::Contacts& CS = dynamic_cast<rigidbody::Contacts*>(this)->getConstraints();
+    if (CS.nbContacts() == 0) {
+        return QDotPre;
+    }
+
+    rigidbody::GeneralizedVelocity QDotPost(*this);
+    switch (CS.constraintSolver()) {
+    case rigidbody::CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE:
+        RigidBodyDynamics::ComputeConstraintImpulsesRangeSpaceSparse(*this, Q, QDotPre, CS, QDotPost);
+        break;
+    case rigidbody::CONSTRAINT_SOLVER_NULL_SPACE:
+        RigidBodyDynamics::ComputeConstraintImpulsesNullSpace(*this, Q, QDotPre, CS, QDotPost);
+        break;
+    default:
+        RigidBodyDynamics::ComputeConstraintImpulsesDirect(*this, Q, QDotPre, CS, QDotPost);
+    }
+    kinematicsUpdatedByRbdl(&Q);
+    return QDotPost;
+}
+
 utils::Matrix3d rigidbody::Joints::bodyInertia (
         const rigidbody::GeneralizedCoordinates &q,
         bool updateKin)
@@ -1533,9 +2503,12 @@ utils::Vector3d rigidbody::Joints::bodyAngularVelocity (
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
+    if (updateKin) {
+        UpdateKinematicsCustom(&Q, &Qdot);
+    }
     RigidBodyDynamics::Utils::CalcCenterOfMass(
         *this, Q, Qdot, nullptr, mass, com, nullptr, nullptr,
-        &angularMomentum, nullptr, updateKin);
+        &angularMomentum, nullptr, false);
     utils::Matrix3d body_inertia = bodyInertia (Q, updateKin);
         
 #ifdef BIORBD_USE_CASADI_MATH
@@ -1580,9 +2553,238 @@ void rigidbody::Joints::UpdateKinematicsCustom(
     const rigidbody::GeneralizedAcceleration *Qddot)
 {
     checkGeneralizedDimensions(Q, Qdot, Qddot);
+#ifdef BIORBD_USE_CASADI_MATH
+    // Symbolic states cannot be compared, the kinematics are always updated
     RigidBodyDynamics::UpdateKinematicsCustom(*this, Q, Qdot, Qddot);
+    ++*m_nbKinematicsUpdates;
+#else
+    // The update is only skipped if nothing changed. Otherwise rbdl is given every level it was
+    // asked for, as the velocities and accelerations are computed from the positions (jcalc
+    // dereferences Q whenever Qdot is given)
+    bool positionsChanged(Q && (*m_kinematicsLevel < 1 || !isSameState(*Q, *m_kinematicsQ)));
+    bool changed(positionsChanged);
+    if (Qdot) {
+        changed = changed || *m_kinematicsLevel < 2 || !isSameState(*Qdot, *m_kinematicsQdot);
+    }
+    if (Qddot) {
+        changed = changed || *m_kinematicsLevel < 3 || !isSameState(*Qddot, *m_kinematicsQddot);
+    }
+    if (!changed) {
+        ++*m_nbKinematicsUpdatesElided;
+        return;
+    }
+
+    if (Q && !Qdot && !Qddot && *m_kinematicsLevel >= 1) {
+        // Only the positions changed, so only the subtrees of the dof which changed are updated
+        m_kinematicsDirtyDof->assign(static_cast<size_t>(Q->size()), false);
+        for (unsigned int i=0; i<Q->size(); ++i) {
+            (*m_kinematicsDirtyDof)[i] = (*Q)[i] != (*m_kinematicsQ)[i];
+        }
+        updateDirtySubtrees(*Q);
+    } else {
+        RigidBodyDynamics::UpdateKinematicsCustom(*this, Q, Qdot, Qddot);
+        if (Q) {
+            *m_nbKinematicsBodiesUpdated += mBodies.size() - 1;
+            if (positionsChanged) {
+                invalidateBodyJacobians();
+            }
+        }
+    }
+    ++*m_nbKinematicsUpdates;
+
+    // Whatever depends on a level which was updated without being updated itself is now stale
+    if (Q) {
+        *m_kinematicsQ = *Q;
+        *m_kinematicsLevel = 1;
+    }
+    if (Qdot) {
+        if (*m_kinematicsLevel >= 1) {
+            *m_kinematicsQdot = *Qdot;
+            *m_kinematicsLevel = 2;
+        }
+    } else if (Q) {
+        *m_kinematicsLevel = std::min(*m_kinematicsLevel, 1);
+    }
+    if (Qddot) {
+        if (*m_kinematicsLevel >= 2) {
+            *m_kinematicsQddot = *Qddot;
+            *m_kinematicsLevel = 3;
+        }
+    } else if (Q || Qdot) {
+        *m_kinematicsLevel = std::min(*m_kinematicsLevel, 2);
+    }
+#endif
+    *m_isKinematicsComputed = true;
+}
+
+void rigidbody::Joints::kinematicsUpdatedByRbdl(
+    const rigidbody::GeneralizedCoordinates *Q,
+    const rigidbody::GeneralizedVelocity *Qdot)
+{
+    *m_kinematicsLevel = 0;
+#ifndef BIORBD_USE_CASADI_MATH
+    invalidateBodyJacobians();
+    if (Q) {
+        *m_kinematicsQ = *Q;
+        *m_kinematicsLevel = 1;
+        if (Qdot) {
+            *m_kinematicsQdot = *Qdot;
+            *m_kinematicsLevel = 2;
+        }
+    }
+#endif
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+void rigidbody::Joints::UpdateKinematicsSubtrees(
+    const rigidbody::GeneralizedCoordinates &Q,
+    const std::vector<size_t>& changedDof)
+{
+    if (*m_kinematicsLevel < 1) {
+        UpdateKinematicsCustom(&Q);
+        return;
+    }
+    checkGeneralizedDimensions(&Q);
+
+    m_kinematicsDirtyDof->assign(static_cast<size_t>(Q.size()), false);
+    for (size_t dof : changedDof) {
+        if (dof >= m_kinematicsDirtyDof->size()) {
+            utils::Error::raise("The changed dof " + std::to_string(dof) + " does not exist");
+        }
+        (*m_kinematicsDirtyDof)[dof] = true;
+    }
+    updateDirtySubtrees(Q);
+    ++*m_nbKinematicsUpdates;
+    *m_kinematicsQ = Q;
+    *m_kinematicsLevel = 1;
+    *m_isKinematicsComputed = true;
+}
+
+const RigidBodyDynamics::Math::MatrixNd& rigidbody::Joints::bodyJacobian(
+    const rigidbody::GeneralizedCoordinates &Q,
+    unsigned int rbdlId)
+{
+    if (rbdlId >= fixed_body_discriminator) {
+        rbdlId = mFixedBodies[rbdlId - fixed_body_discriminator].mMovableParent;
+    }
+
+    // The jacobians are only reallocated if the model changed
+    std::vector<RigidBodyDynamics::Math::MatrixNd>& jacobians(*m_bodyJacobians);
+    if (jacobians.size() != mBodies.size()) {
+        jacobians.assign(mBodies.size(), RigidBodyDynamics::Math::MatrixNd::Zero(6, qdot_size));
+        m_isBodyJacobianComputed->assign(mBodies.size(), false);
+    }
+
+    RigidBodyDynamics::Math::MatrixNd& G(jacobians[rbdlId]);
+    if (!(*m_isBodyJacobianComputed)[rbdlId]) {
+        if (G.cols() != static_cast<Eigen::Index>(qdot_size)) {
+            G.resize(6, qdot_size);
+        }
+        G.setZero();
+        RigidBodyDynamics::CalcPointJacobian6D(*this, Q, rbdlId,
+                                               RigidBodyDynamics::Math::Vector3d::Zero(), G, false);
+        (*m_isBodyJacobianComputed)[rbdlId] = true;
+        ++*m_nbBodyJacobiansComputed;
+    }
+    return G;
+}
+
+void rigidbody::Joints::pointJacobianFromBody(
+    const rigidbody::GeneralizedCoordinates &Q,
+    unsigned int rbdlId,
+    const utils::Vector3d &pointInLocal,
+    utils::Matrix &jacobian,
+    unsigned int firstRow)
+{
+    const RigidBodyDynamics::Math::MatrixNd& G(bodyJacobian(Q, rbdlId));
+    unsigned int movableId(rbdlId >= fixed_body_discriminator ?
+                           mFixedBodies[rbdlId - fixed_body_discriminator].mMovableParent : rbdlId);
+
+    // The velocity of the point is the one of the origin plus w x r, r going from the origin to the point
+    RigidBodyDynamics::Math::Vector3d r(
+        RigidBodyDynamics::CalcBodyToBaseCoordinates(*this, Q, rbdlId, pointInLocal, false)
+        - X_base[movableId].r);
+    jacobian.block(firstRow, 0, 3, G.cols()) = G.bottomRows(3)
+            - RigidBodyDynamics::Math::VectorCrossMatrix(r) * G.topRows(3);
+}
+
+size_t rigidbody::Joints::nbBodyJacobiansComputed() const
+{
+    return *m_nbBodyJacobiansComputed;
+}
+
+void rigidbody::Joints::invalidateBodyJacobians()
+{
+    m_isBodyJacobianComputed->assign(m_isBodyJacobianComputed->size(), false);
+}
+
+void rigidbody::Joints::updateDirtySubtrees(
+    const rigidbody::GeneralizedCoordinates &Q)
+{
+    // The parents come before their children, so a body is dirty if one of its dof changed
+    // or if its parent is dirty
+    m_kinematicsDirtyBodies->assign(mBodies.size(), false);
+    for (unsigned int i=1; i<mBodies.size(); ++i) {
+        const RigidBodyDynamics::Joint& joint(mJoints[i]);
+        bool dirty((*m_kinematicsDirtyBodies)[lambda[i]]);
+        for (unsigned int k=0; k<joint.mDoFCount && !dirty; ++k) {
+            dirty = (*m_kinematicsDirtyDof)[joint.q_index + k];
+        }
+        if (!dirty && joint.mJointType == RigidBodyDynamics::JointTypeSpherical) {
+            dirty = (*m_kinematicsDirtyDof)[multdof3_w_index[i]];
+        }
+        if (!dirty) {
+            continue;
+        }
+
+        // Same as the positions part of RigidBodyDynamics::UpdateKinematicsCustom
+        (*m_kinematicsDirtyBodies)[i] = true;
+        if (i < m_isBodyJacobianComputed->size()) {
+            (*m_isBodyJacobianComputed)[i] = false;
+        }
+        RigidBodyDynamics::jcalc_X_lambda_S(*this, i, Q);
+        if (lambda[i] != 0) {
+            X_base[i] = X_lambda[i] * X_base[lambda[i]];
+        } else {
+            X_base[i] = X_lambda[i];
+        }
+        ++*m_nbKinematicsBodiesUpdated;
+    }
+}
+#endif
+
+size_t rigidbody::Joints::nbKinematicsUpdates() const
+{
+    return *m_nbKinematicsUpdates;
+}
+
+size_t rigidbody::Joints::nbKinematicsUpdatesElided() const
+{
+    return *m_nbKinematicsUpdatesElided;
+}
+
+size_t rigidbody::Joints::nbKinematicsBodiesUpdated() const
+{
+    return *m_nbKinematicsBodiesUpdated;
+}
+
+void rigidbody::Joints::resetKinematicsUpdatesCounters()
+{
+    *m_nbKinematicsUpdates = 0;
+    *m_nbKinematicsUpdatesElided = 0;
+    *m_nbKinematicsBodiesUpdated = 0;
+}
+
+#ifndef BIORBD_USE_CASADI_MATH
+bool rigidbody::Joints::isSameState(
+    const utils::Vector &current,
+    const utils::Vector &previous)
+{
+    return current.size() == previous.size()
+           && std::equal(current.data(), current.data() + current.size(), previous.data());
+}
+#endif
+
 void rigidbody::Joints::CalcMatRotJacobian(
     const rigidbody::GeneralizedCoordinates &Q,
     size_t segmentIdx,
@@ -1631,9 +2833,11 @@ void rigidbody::Joints::CalcMatRotJacobian(
             unsigned int q_index = this->mJoints[j].q_index;
             // If it's not a DoF in translation (3 4 5 in this->S)
 #ifdef BIORBD_USE_CASADI_MATH
-            if (this->S[j].is_zero() && this->S[j](4).is_zero() && this->S[j](5).is_zero())
+            if (this->mJoints[j].mJointType != RigidBodyDynamics::JointTypeTranslationXYZ
+                    && this->S[j].is_zero() && this->S[j](4).is_zero() && this->S[j](5).is_zero())
 #else
-            if (this->S[j](3)!=1.0 && this->S[j](4)!=1.0 && this->S[j](5)!=1.0)
+            if (this->mJoints[j].mJointType != RigidBodyDynamics::JointTypeTranslationXYZ
+                    && this->S[j](3)!=1.0 && this->S[j](4)!=1.0 && this->S[j](5)!=1.0)
 #endif
             {
                 RigidBodyDynamics::Math::SpatialTransform X_base = this->X_base[j];
@@ -1684,28 +2888,25 @@ void rigidbody::Joints::checkGeneralizedDimensions(
     const rigidbody::GeneralizedTorque *torque)
 {
 #ifndef SKIP_ASSERT
-    if (Q) {
-        utils::Error::check(
-            Q->size() == nbQ(),
+    // The messages are only built on failure, this is called in loops which must not allocate
+    if (Q && Q->size() != nbQ()) {
+        utils::Error::raise(
             "Wrong size for the Generalized Coordiates, " + 
             utils::String("expected ") + std::to_string(nbQ()) + " got " + std::to_string(Q->size()));
     }
-    if (Qdot) {
-        utils::Error::check(
-            Qdot->size() == nbQdot(),
+    if (Qdot && Qdot->size() != nbQdot()) {
+        utils::Error::raise(
             "Wrong size for the Generalized Velocities, " +
             utils::String("expected ") + std::to_string(nbQdot()) + " got " + std::to_string(Qdot->size()));
     }
-    if (Qddot) {
-        utils::Error::check(
-            Qddot->size() == nbQddot(),
+    if (Qddot && Qddot->size() != nbQddot()) {
+        utils::Error::raise(
             "Wrong size for the Generalized Accelerations, " +
             utils::String("expected ") + std::to_string(nbQddot()) + " got " + std::to_string(Qddot->size()));
     }
 
-    if (torque) {
-        utils::Error::check(
-            torque->size() == nbGeneralizedTorque(),
+    if (torque && torque->size() != nbGeneralizedTorque()) {
+        utils::Error::raise(
             "Wrong size for the Generalized Torques, " +
             utils::String("expected ") + std::to_string(nbGeneralizedTorque()) + " got " + std::to_string(torque->size()));
     }
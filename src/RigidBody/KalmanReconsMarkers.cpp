@@ -10,6 +10,7 @@
 #include "RigidBody/GeneralizedVelocity.h"
 #include "RigidBody/GeneralizedAcceleration.h"
 #include "RigidBody/NodeSegment.h"
+#include "RigidBody/BlockJacobian.h"
 
 #include <math.h>
 
@@ -19,6 +20,10 @@ rigidbody::KalmanReconsMarkers::KalmanReconsMarkers() :
     rigidbody::KalmanRecons(),
     m_PpInitial(std::make_shared<utils::Matrix>()),
     m_firstIteration(std::make_shared<bool>(true))
+#ifndef BIORBD_USE_CASADI_MATH
+    ,
+    m_jacobian(std::make_shared<rigidbody::BlockJacobian>())
+#endif
 {
 
 }
@@ -29,6 +34,10 @@ rigidbody::KalmanReconsMarkers::KalmanReconsMarkers(
     rigidbody::KalmanRecons(model, model.nbTechnicalMarkers()*3, params),
     m_PpInitial(std::make_shared<utils::Matrix>()),
     m_firstIteration(std::make_shared<bool>(true))
+#ifndef BIORBD_USE_CASADI_MATH
+    ,
+    m_jacobian(std::make_shared<rigidbody::BlockJacobian>())
+#endif
 {
 
     // Initialize the filter
@@ -50,6 +59,9 @@ void rigidbody::KalmanReconsMarkers::DeepCopy(const
     rigidbody::KalmanRecons::DeepCopy(other);
     *m_PpInitial = *other.m_PpInitial;
     *m_firstIteration = *other.m_firstIteration;
+#ifndef BIORBD_USE_CASADI_MATH
+    *m_jacobian = other.m_jacobian->DeepCopy();
+#endif
 }
 
 void rigidbody::KalmanReconsMarkers::initialize()
@@ -158,8 +170,16 @@ void rigidbody::KalmanReconsMarkers::reconstructFrame(
     const std::vector<rigidbody::NodeSegment>& zest_tp(
         model.technicalMarkers(Q_tp, removeAxes, false));
     // Jacobian
+#ifdef BIORBD_USE_CASADI_MATH
     const  std::vector<utils::Matrix>& J_tp(model.technicalMarkersJacobian(
                 Q_tp, removeAxes, false));
+#else
+    // Only the dof each marker depends on are computed and copied
+    if (m_jacobian->nbPoints() != model.nbTechnicalMarkers()) {
+        *m_jacobian = model.technicalMarkersJacobianPattern();
+    }
+    model.technicalMarkersJacobian(Q_tp, *m_jacobian, removeAxes, false);
+#endif
     // Create only one matrix for zest and Jacobian
     utils::Matrix H(utils::Matrix::Zero(*m_nMeasure,
                             *m_nbDof*3)); // 3*nMarkers => X,Y,Z ; 3*nbDof => Q, Qdot, Qddot
@@ -176,7 +196,14 @@ void rigidbody::KalmanReconsMarkers::reconstructFrame(
                 !isnan(Tobs(i*3)*Tobs(i*3) + Tobs(i*3+1)*Tobs(i*3+1) + Tobs(i*3+2)*Tobs(
                            i*3+2))) {
 #endif
+#ifdef BIORBD_USE_CASADI_MATH
             H.block(i*3,0,3,*m_nbDof) = J_tp[i];
+#else
+            for (size_t j=0; j<m_jacobian->columns(i).size(); ++j) {
+                H.block(i*3, static_cast<unsigned int>(m_jacobian->columns(i)[j]), 3, 1)
+                    = m_jacobian->block(i).col(static_cast<unsigned int>(j));
+            }
+#endif
             zest.block(i*3, 0, 3, 1) = zest_tp[i];
         } else {
             occlusionIdx.push_back(i);
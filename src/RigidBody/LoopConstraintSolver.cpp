@@ -0,0 +1,162 @@
+#define BIORBD_API_EXPORTS
+#include "RigidBody/LoopConstraintSolver.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <rbdl/Dynamics.h>
+#include "Utils/Error.h"
+#include "Utils/SpatialVector.h"
+#include "RigidBody/Joints.h"
+#include "RigidBody/Contacts.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+#include "RigidBody/GeneralizedAcceleration.h"
+#include "RigidBody/GeneralizedTorque.h"
+
+using namespace BIORBD_NAMESPACE;
+
+rigidbody::LoopConstraintSolver::LoopConstraintSolver() :
+    m_alpha(0),
+    m_beta(0),
+    m_isFactorized(false),
+    m_nbFactorizations(0)
+{
+
+}
+
+rigidbody::LoopConstraintSolver rigidbody::LoopConstraintSolver::DeepCopy() const
+{
+    rigidbody::LoopConstraintSolver copy;
+    copy.DeepCopy(*this);
+    return copy;
+}
+
+void rigidbody::LoopConstraintSolver::DeepCopy(
+    const rigidbody::LoopConstraintSolver &other)
+{
+    m_alpha = other.m_alpha;
+    m_beta = other.m_beta;
+    m_isFactorized = false;
+}
+
+void rigidbody::LoopConstraintSolver::setBaumgarteStabilization(
+    double alpha,
+    double beta)
+{
+    utils::Error::check(alpha >= 0 && beta >= 0,
+                        "The parameters of the Baumgarte stabilization must be positive");
+    m_alpha = alpha;
+    m_beta = beta;
+}
+
+double rigidbody::LoopConstraintSolver::baumgarteAlpha() const
+{
+    return m_alpha;
+}
+
+double rigidbody::LoopConstraintSolver::baumgarteBeta() const
+{
+    return m_beta;
+}
+
+void rigidbody::LoopConstraintSolver::forwardDynamics(
+    rigidbody::Joints &model,
+    rigidbody::Contacts &CS,
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &QDot,
+    const rigidbody::GeneralizedTorque &Tau,
+    std::vector<RigidBodyDynamics::Math::SpatialVector>* fExt,
+    rigidbody::GeneralizedAcceleration &QDDot)
+{
+    Eigen::Index nbDof(static_cast<Eigen::Index>(model.dof_count));
+    Eigen::Index nbConstraints(static_cast<Eigen::Index>(CS.size()));
+
+    model.UpdateKinematicsCustom(&Q, &QDot);
+    RigidBodyDynamics::CalcConstrainedSystemVariables(model, Q, QDot, Tau, CS, false, fExt);
+
+    if ((m_alpha > 0 || m_beta > 0) && CS.hasLoopConstraints()) {
+        m_positionError.resize(nbConstraints);
+        m_velocityError.resize(nbConstraints);
+        RigidBodyDynamics::CalcConstraintsPositionError(model, Q, CS, m_positionError, false);
+        RigidBodyDynamics::CalcConstraintsVelocityError(model, Q, QDot, CS, m_velocityError, false);
+        for (const auto& loop : CS.loopConstraints) {
+            Eigen::Index first(static_cast<Eigen::Index>(loop->getConstraintIndex()));
+            Eigen::Index size(static_cast<Eigen::Index>(loop->getConstraintSize()));
+            CS.gamma.segment(first, size) -= 2 * m_alpha * m_velocityError.segment(first, size)
+                                             + m_beta * m_beta * m_positionError.segment(first, size);
+        }
+    }
+
+    // The system only changes with the generalized coordinates, so it is factorized again only then
+    Eigen::Index nbRows(nbDof + nbConstraints);
+    CS.A.resize(nbRows, nbRows);
+    CS.A.topLeftCorner(nbDof, nbDof) = CS.H;
+    CS.A.topRightCorner(nbDof, nbConstraints) = CS.G.transpose();
+    CS.A.bottomLeftCorner(nbConstraints, nbDof) = CS.G;
+    CS.A.bottomRightCorner(nbConstraints, nbConstraints).setZero();
+    if (!m_isFactorized || m_system.rows() != nbRows || m_system != CS.A) {
+        m_system = CS.A;
+        m_factorization.compute(m_system);
+        m_isFactorized = true;
+        ++m_nbFactorizations;
+    }
+
+    m_rhs.resize(nbRows);
+    m_rhs.head(nbDof) = Tau - CS.C;
+    m_rhs.tail(nbConstraints) = CS.gamma;
+    m_solution = m_factorization.solve(m_rhs);
+
+    if (QDDot.size() != nbDof) {
+        QDDot.resize(nbDof);
+    }
+    QDDot = m_solution.head(nbDof);
+    CS.force = -m_solution.tail(nbConstraints);
+    model.kinematicsUpdatedByRbdl(&Q, &QDot);
+}
+
+void rigidbody::LoopConstraintSolver::loopConstraintForces(
+    rigidbody::Joints &model,
+    rigidbody::Contacts &CS,
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &QDot,
+    std::vector<utils::SpatialVector> &forces)
+{
+    forces.resize(CS.nbLoopConstraints());
+    for (size_t i=0; i<CS.nbLoopConstraints(); ++i) {
+        // The vectors keep their capacity from one call to the other
+        CS.calcForces(static_cast<unsigned int>(i), model, Q, QDot,
+                      m_bodyIds, m_bodyFrames, m_forces, true, false);
+
+        // The force in the global reference frame applied on the predecessor segment
+        forces[i] = m_forces[0];
+    }
+}
+
+bool rigidbody::LoopConstraintSolver::project(
+    rigidbody::Joints &model,
+    rigidbody::Contacts &CS,
+    rigidbody::GeneralizedCoordinates &Q,
+    rigidbody::GeneralizedVelocity &QDot,
+    double tolerance,
+    unsigned int maxNbIterations)
+{
+    if (m_weights.size() != static_cast<Eigen::Index>(model.dof_count)) {
+        m_weights = utils::Vector::Ones(static_cast<Eigen::Index>(model.dof_count));
+    }
+
+    bool hasConverged(RigidBodyDynamics::CalcAssemblyQ(
+                          model, Q, CS, Q, m_weights, tolerance, maxNbIterations));
+    if (hasConverged) {
+        RigidBodyDynamics::CalcAssemblyQDot(model, Q, QDot, CS, QDot, m_weights);
+    }
+
+    // The kinematics were left at the last iterate
+    model.kinematicsUpdatedByRbdl();
+    return hasConverged;
+}
+
+size_t rigidbody::LoopConstraintSolver::nbFactorizations() const
+{
+    return m_nbFactorizations;
+}
+
+#endif
@@ -4,16 +4,36 @@
 #include <rbdl/Model.h>
 #include <rbdl/Kinematics.h>
 #include "Utils/String.h"
+#include "Utils/Error.h"
 #include "Utils/Matrix.h"
 #include "RigidBody/GeneralizedCoordinates.h"
 #include "RigidBody/GeneralizedVelocity.h"
 #include "RigidBody/GeneralizedAcceleration.h"
 #include "RigidBody/Joints.h"
+#include "RigidBody/BlockJacobian.h"
 #include "RigidBody/NodeSegment.h"
 #include "RigidBody/Segment.h"
 
 using namespace BIORBD_NAMESPACE;
 
+#ifndef BIORBD_USE_CASADI_MATH
+// Position of a node in its parent reference frame, without building a new NodeSegment
+static utils::Point3d localPosition(
+    const rigidbody::NodeSegment& node,
+    bool removeAxis)
+{
+    utils::Point3d pos(node);
+    if (removeAxis) {
+        for (unsigned int i=0; i<3; ++i) {
+            if (node.isAxisRemoved(i)) {
+                pos(i) = 0;
+            }
+        }
+    }
+    return pos;
+}
+#endif
+
 rigidbody::Markers::Markers() :
     m_marks(std::make_shared<std::vector<rigidbody::NodeSegment>>())
 {
@@ -57,6 +77,14 @@ void rigidbody::Markers::addMarker(
     const utils::String& axesToRemove,
     int id)
 {
+    // Resolve the parent once so it is not looked up by name at each evaluation
+    const rigidbody::Joints* model = dynamic_cast<const rigidbody::Joints*>(this);
+    if (id < 0 && model) {
+        unsigned int parentId(model->GetBodyId(parentName.c_str()));
+        if (model->IsBodyId(parentId)) {
+            id = static_cast<int>(parentId);
+        }
+    }
     rigidbody::NodeSegment tp(pos, name, parentName, technical, anatomical,
                                       axesToRemove, id);
     m_marks->push_back(tp);
@@ -94,14 +122,17 @@ rigidbody::NodeSegment rigidbody::Markers::marker(
     updateKin = true;
 #endif
 
-    unsigned int id = model.GetBodyId(n.parent().c_str());
+    unsigned int id = model.getParentRbdlId(n);
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
     if (removeAxis) {
         return rigidbody::NodeSegment(
                    RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, n.removeAxes(),
-                           updateKin));
+                           false));
     } else {
         return rigidbody::NodeSegment(
-                   RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, n, updateKin));
+                   RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, n, false));
     }
 }
 
@@ -123,9 +154,12 @@ rigidbody::NodeSegment rigidbody::Markers::marker(
     // Retrieve the position of the marker in the local reference
     const rigidbody::NodeSegment& pos = marker(idx, removeAxis);
 
-    unsigned int id = model.GetBodyId(node.parent().c_str());
+    unsigned int id = model.getParentRbdlId(node);
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
     return rigidbody::NodeSegment(
-               RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, pos, updateKin));
+               RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, pos, false));
 }
 
 // Get a marker
@@ -167,6 +201,146 @@ std::vector<rigidbody::NodeSegment> rigidbody::Markers::markers(
     return pos;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+// Get all the markers of all the frames of a trial
+void rigidbody::Markers::markers(
+    const utils::Matrix &Q,
+    utils::Matrix &markersOut,
+    bool removeAxis)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+
+    unsigned int nbMarks(static_cast<unsigned int>(nbMarkers()));
+    unsigned int nbFrames(static_cast<unsigned int>(Q.cols()));
+    utils::Error::check(static_cast<size_t>(Q.rows()) == model.nbQ(),
+                        "Q must have nbQ rows");
+    utils::Error::check(
+        static_cast<unsigned int>(markersOut.rows()) == 3 * nbMarks
+        && static_cast<unsigned int>(markersOut.cols()) == nbFrames,
+        "markersOut must be preallocated to (3 * nbMarkers) x nbFrames");
+
+    // Everything that does not depend on the frame is prepared once
+    std::vector<RigidBodyDynamics::Math::Vector3d> positions(nbMarks);
+    std::vector<unsigned int> ids(nbMarks);
+    for (unsigned int i=0; i<nbMarks; ++i) {
+        positions[i] = marker(i, removeAxis);
+        ids[i] = model.getParentRbdlId((*m_marks)[i]);
+    }
+    rigidbody::GeneralizedCoordinates Qframe(model);
+
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        Qframe = Q.col(f);
+        model.UpdateKinematicsCustom(&Qframe, nullptr, nullptr);
+        for (unsigned int i=0; i<nbMarks; ++i) {
+            markersOut.block<3, 1>(3*i, f) =
+                RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                    model, Qframe, ids[i], positions[i], false);
+        }
+    }
+}
+
+void rigidbody::Markers::markers(
+    const rigidbody::GeneralizedCoordinates &Q,
+    std::vector<utils::Point3d>& markersOut,
+    bool removeAxis,
+    bool updateKin)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    if (markersOut.size() != nbMarkers()) {
+        markersOut.resize(nbMarkers());
+    }
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
+    for (size_t i=0; i<nbMarkers(); ++i) {
+        const rigidbody::NodeSegment& node((*m_marks)[i]);
+        markersOut[i] = RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                            model, Q, model.getParentRbdlId(node), localPosition(node, removeAxis), false);
+    }
+}
+
+void rigidbody::Markers::technicalMarkers(
+    const rigidbody::GeneralizedCoordinates &Q,
+    std::vector<utils::Point3d>& markersOut,
+    bool removeAxis,
+    bool updateKin)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    size_t nbTechnical(0);
+    for (size_t i=0; i<nbMarkers(); ++i) {
+        if ((*m_marks)[i].isTechnical()) {
+            ++nbTechnical;
+        }
+    }
+    if (markersOut.size() != nbTechnical) {
+        markersOut.resize(nbTechnical);
+    }
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
+    size_t k(0);
+    for (size_t i=0; i<nbMarkers(); ++i) {
+        const rigidbody::NodeSegment& node((*m_marks)[i]);
+        if (node.isTechnical()) {
+            markersOut[k++] = RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                                  model, Q, model.getParentRbdlId(node), localPosition(node, removeAxis), false);
+        }
+    }
+}
+
+void rigidbody::Markers::markersVelocity(
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &Qdot,
+    std::vector<utils::Point3d>& markersOut,
+    bool removeAxis,
+    bool updateKin)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    if (markersOut.size() != nbMarkers()) {
+        markersOut.resize(nbMarkers());
+    }
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
+
+    for (size_t i=0; i<nbMarkers(); ++i) {
+        const rigidbody::NodeSegment& node((*m_marks)[i]);
+        markersOut[i] = RigidBodyDynamics::CalcPointVelocity(
+                            model, Q, Qdot, model.getParentRbdlId(node), localPosition(node, removeAxis), false);
+    }
+}
+
+void rigidbody::Markers::markerAcceleration(
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &Qdot,
+    const rigidbody::GeneralizedAcceleration &Qddot,
+    std::vector<utils::Point3d>& markersOut,
+    bool removeAxis,
+    bool updateKin)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    if (markersOut.size() != nbMarkers()) {
+        markersOut.resize(nbMarkers());
+    }
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
+
+    for (size_t i=0; i<nbMarkers(); ++i) {
+        const rigidbody::NodeSegment& node((*m_marks)[i]);
+        markersOut[i] = RigidBodyDynamics::CalcPointAcceleration(
+                            model, Q, Qdot, Qddot, model.getParentRbdlId(node), localPosition(node, removeAxis), false);
+    }
+}
+#endif
+
 // Get a marker's velocity
 rigidbody::NodeSegment rigidbody::Markers::markerVelocity(
     const rigidbody::GeneralizedCoordinates &Q,
@@ -187,9 +361,12 @@ rigidbody::NodeSegment rigidbody::Markers::markerVelocity(
     const rigidbody::NodeSegment& pos(marker(idx, removeAxis));
 
     // Calculate the velocity of the point
-    unsigned int id(model.GetBodyId(node.parent().c_str()));
+    unsigned int id(model.getParentRbdlId(node));
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
     return rigidbody::NodeSegment(RigidBodyDynamics::CalcPointVelocity(
-            model, Q, Qdot, id, pos, updateKin));
+            model, Q, Qdot, id, pos, false));
 }
 
 // Get a marker's velocity
@@ -212,9 +389,12 @@ rigidbody::NodeSegment rigidbody::Markers::markerAngularVelocity(
     const rigidbody::NodeSegment& pos(marker(idx, removeAxis));
 
     // Calculate the velocity of the point
-    unsigned int id(model.GetBodyId(node.parent().c_str()));
+    unsigned int id(model.getParentRbdlId(node));
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
     return rigidbody::NodeSegment(
-                RigidBodyDynamics::CalcPointVelocity6D(model, Q, Qdot, id, pos, updateKin).block(0, 0, 3, 1)
+                RigidBodyDynamics::CalcPointVelocity6D(model, Q, Qdot, id, pos, false).block(0, 0, 3, 1)
             );
 }
 
@@ -261,8 +441,7 @@ rigidbody::NodeSegment rigidbody::Markers::markerAcceleration(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
@@ -273,10 +452,13 @@ rigidbody::NodeSegment rigidbody::Markers::markerAcceleration(
     const rigidbody::NodeSegment& pos(marker(idx, removeAxis));
 
     // Calculate the acceleration of the point
-    unsigned int id(model.GetBodyId(node.parent().c_str()));
+    unsigned int id(model.getParentRbdlId(node));
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot, &Qddot);
+    }
     return rigidbody::NodeSegment(RigidBodyDynamics::CalcPointAcceleration(
             model, Q, Qdot, Qddot, id, pos,
-            updateKin));
+            false));
 }
 
 std::vector<rigidbody::NodeSegment>
@@ -432,8 +614,7 @@ utils::Matrix rigidbody::Markers::markersJacobian(
     bool updateKin)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
@@ -441,7 +622,10 @@ utils::Matrix rigidbody::Markers::markersJacobian(
 
     // Calculate the Jacobien of this Tag
     unsigned int id = model.GetBodyId(parentName.c_str());
-    RigidBodyDynamics::CalcPointJacobian(model, Q, id, p, G, updateKin);
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+    RigidBodyDynamics::CalcPointJacobian(model, Q, id, p, G, false);
 
     return G;
 }
@@ -477,9 +661,11 @@ bool rigidbody::Markers::inverseKinematics(
     }
 
     // Call the base function
-    return RigidBodyDynamics::InverseKinematics(
+    bool success(RigidBodyDynamics::InverseKinematics(
                dynamic_cast<rigidbody::Joints &>(*this),
-               Qinit, body_id, body_pointEigen, markersInRbdl, Q);
+               Qinit, body_id, body_pointEigen, markersInRbdl, Q));
+    model.kinematicsUpdatedByRbdl(); // The iterations left the kinematics at an unknown state
+    return success;
 }
 #endif
 
@@ -491,13 +677,15 @@ std::vector<utils::Matrix> rigidbody::Markers::markersJacobian(
     bool lookForTechnical)
 {
     // Assuming that this is also a joint type (via BiorbdModel)
-    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>
-                                       (*this);
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
 #ifdef BIORBD_USE_CASADI_MATH
     updateKin = true;
 #endif
 
     std::vector<utils::Matrix> G;
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
 
     for (size_t idx=0; idx<nbMarkers(); ++idx) {
         // Actual marker
@@ -510,11 +698,8 @@ std::vector<utils::Matrix> rigidbody::Markers::markersJacobian(
         utils::Matrix G_tp(utils::Matrix::Zero(3, static_cast<unsigned int>(model.nbQ())));
 
         // Calculate the Jacobian of this Tag
-        unsigned int id = model.GetBodyId(node.parent().c_str());
-        RigidBodyDynamics::CalcPointJacobian(model, Q, id, pos, G_tp, updateKin);
-#ifndef BIORBD_USE_CASADI_MATH
-        updateKin = false;
-#endif
+        unsigned int id = model.getParentRbdlId(node);
+        RigidBodyDynamics::CalcPointJacobian(model, Q, id, pos, G_tp, false);
 
         G.push_back(G_tp);
     }
@@ -522,6 +707,108 @@ std::vector<utils::Matrix> rigidbody::Markers::markersJacobian(
     return G;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+rigidbody::BlockJacobian rigidbody::Markers::markersJacobianPattern()
+{
+    return markersJacobianPattern(false);
+}
+
+rigidbody::BlockJacobian rigidbody::Markers::technicalMarkersJacobianPattern()
+{
+    return markersJacobianPattern(true);
+}
+
+void rigidbody::Markers::markersJacobian(
+    const rigidbody::GeneralizedCoordinates &Q,
+    rigidbody::BlockJacobian& jacobian,
+    bool removeAxis,
+    bool updateKin)
+{
+    markersJacobian(Q, jacobian, removeAxis, updateKin, false);
+}
+
+void rigidbody::Markers::technicalMarkersJacobian(
+    const rigidbody::GeneralizedCoordinates &Q,
+    rigidbody::BlockJacobian& jacobian,
+    bool removeAxis,
+    bool updateKin)
+{
+    markersJacobian(Q, jacobian, removeAxis, updateKin, true);
+}
+
+rigidbody::BlockJacobian rigidbody::Markers::markersJacobianPattern(
+    bool lookForTechnical)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    const rigidbody::Joints &model = dynamic_cast<const rigidbody::Joints &>(*this);
+
+    std::vector<std::vector<size_t>> columns;
+    for (size_t idx=0; idx<nbMarkers(); ++idx) {
+        const rigidbody::NodeSegment& node((*m_marks)[idx]);
+        if (lookForTechnical && !node.isTechnical()) {
+            continue;
+        }
+        columns.push_back(model.getDofChain(model.getParentRbdlId(node)));
+    }
+    return rigidbody::BlockJacobian(model.nbQ(), columns);
+}
+
+void rigidbody::Markers::markersJacobian(
+    const rigidbody::GeneralizedCoordinates &Q,
+    rigidbody::BlockJacobian& jacobian,
+    bool removeAxis,
+    bool updateKin,
+    bool lookForTechnical)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    utils::Error::check(
+        jacobian.nbPoints() == (lookForTechnical ? nbTechnicalMarkers() : nbMarkers())
+        && jacobian.nbQ() == model.nbQ(),
+        "The jacobian does not have the structure of the markers of the model");
+
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+
+    size_t k(0);
+    for (size_t idx=0; idx<nbMarkers(); ++idx) {
+        const rigidbody::NodeSegment& node((*m_marks)[idx]);
+        if (lookForTechnical && !node.isTechnical()) {
+            continue;
+        }
+
+        // Same as RigidBodyDynamics::CalcPointJacobian, but only on the dof of the ancestors
+        unsigned int id(model.getParentRbdlId(node));
+        const RigidBodyDynamics::Math::SpatialTransform pointTrans(
+            RigidBodyDynamics::Math::Matrix3d::Identity(),
+            RigidBodyDynamics::CalcBodyToBaseCoordinates(
+                model, Q, id, marker(idx, removeAxis), false));
+        if (id >= model.fixed_body_discriminator) {
+            id = model.mFixedBodies[id - model.fixed_body_discriminator].mMovableParent;
+        }
+
+        // The dof are walked from the marker to the root, so the block is filled from its end
+        utils::Matrix& block(jacobian.block(k));
+        unsigned int col(static_cast<unsigned int>(block.cols()));
+        for (unsigned int j = id; j != 0; j = model.lambda[j]) {
+            const RigidBodyDynamics::Joint& joint(model.mJoints[j]);
+            const RigidBodyDynamics::Math::SpatialTransform X(
+                pointTrans * model.X_base[j].inverse());
+            col -= joint.mDoFCount;
+            if (joint.mDoFCount == 1) {
+                block.block(0, col, 3, 1) = X.apply(model.S[j]).block(3, 0, 3, 1);
+            } else if (joint.mDoFCount == 3) {
+                block.block(0, col, 3, 3) = (X.toMatrix() * model.multdof3_S[j]).block(3, 0, 3, 3);
+            } else {
+                utils::Error::raise("The jacobian of the markers only supports joints of 1 or 3 dof");
+            }
+        }
+        ++k;
+    }
+}
+#endif
+
 size_t rigidbody::Markers::nbTechnicalMarkers()
 {
     size_t nTechMarkers = 0;
@@ -467,18 +467,11 @@ void rigidbody::Segment::fillSequence()
 void rigidbody::Segment::setDofCharacteristicsOnLastBody()
 {
     m_dofCharacteristics->clear();
-
-    if (*m_nbDof!=0) {
-        m_dofCharacteristics->resize(*m_nbDof);
-        for (size_t i=0; i<*m_nbDof-1; i++) {
-            (*m_dofCharacteristics)[i] = rigidbody::SegmentCharacteristics();
-        }
-
-        (*m_dofCharacteristics)[*m_nbDof-1] = *m_characteristics;
-    } else {
-        m_dofCharacteristics->resize(1);
-        (*m_dofCharacteristics)[0] = *m_characteristics;
+    m_dofCharacteristics->resize(m_dof->size());
+    for (size_t i=0; i<m_dof->size()-1; i++) {
+        (*m_dofCharacteristics)[i] = rigidbody::SegmentCharacteristics();
     }
+    (*m_dofCharacteristics)[m_dof->size()-1] = *m_characteristics;
 }
 
 void rigidbody::Segment::setJointAxis()
@@ -489,71 +482,87 @@ void rigidbody::Segment::setJointAxis()
     axis[1]  = utils::Vector3d(0,1,0); // axe y
     axis[2]  = utils::Vector3d(0,0,1); // axe z
 
-    // Declaration of DoFs in translation
     m_dof->clear();
-    if (*m_nbDof != 0) {
-        m_dof->resize(*m_nbDof);
+    if (*m_nbDof == 0) {
+        m_dof->push_back(RigidBodyDynamics::Joint(
+                             RigidBodyDynamics::JointTypeFixed));
+        return;
+    }
+
+    // Declaration of DoFs in translation. A full xyz sequence is a single
+    // RBDL joint, otherwise each axis is chained on its own (virtual) body
+    if (!m_seqT->tolower().compare("xyz")) {
+        m_dof->push_back(RigidBodyDynamics::Joint(
+                             RigidBodyDynamics::JointTypeTranslationXYZ));
+    } else {
         for (size_t i=0; i<*m_nbDofTrans; i++)
-            (*m_dof)[i] = RigidBodyDynamics::Joint(
-                              RigidBodyDynamics::JointTypePrismatic,
-                              axis[(*m_dofPosition)[i]]);
-
-        // Declaration of the DoFs in rotation
-        if (*m_isQuaternion)
-            (*m_dof)[*m_nbDofTrans] = RigidBodyDynamics::Joint(
-                                          RigidBodyDynamics::JointTypeSpherical);
-        else
-            for (size_t i=*m_nbDofTrans; i<*m_nbDofRot+*m_nbDofTrans; i++)
-                (*m_dof)[i] = RigidBodyDynamics::Joint(
-                                  RigidBodyDynamics::JointTypeRevolute,
-                                  axis[(*m_dofPosition)[i]]);
+            m_dof->push_back(RigidBodyDynamics::Joint(
+                                 RigidBodyDynamics::JointTypePrismatic,
+                                 axis[(*m_dofPosition)[i]]));
+    }
+
+    // Declaration of the DoFs in rotation. The Euler sequences RBDL knows
+    // about are a single joint, otherwise each axis is chained on its own body
+    if (*m_isQuaternion) {
+        m_dof->push_back(RigidBodyDynamics::Joint(
+                             RigidBodyDynamics::JointTypeSpherical));
+    } else if (!m_seqR->tolower().compare("xyz")) {
+        m_dof->push_back(RigidBodyDynamics::Joint(
+                             RigidBodyDynamics::JointTypeEulerXYZ));
+    } else if (!m_seqR->tolower().compare("zyx")) {
+        m_dof->push_back(RigidBodyDynamics::Joint(
+                             RigidBodyDynamics::JointTypeEulerZYX));
     } else {
-        m_dof->resize(1);
-        (*m_dof)[0] = RigidBodyDynamics::Joint
-                      (RigidBodyDynamics::JointTypeFixed);
+        for (size_t i=*m_nbDofTrans; i<*m_nbDofRot+*m_nbDofTrans; i++)
+            m_dof->push_back(RigidBodyDynamics::Joint(
+                                 RigidBodyDynamics::JointTypeRevolute,
+                                 axis[(*m_dofPosition)[i]]));
     }
 }
 
 void rigidbody::Segment::setJoints(
     rigidbody::Joints& model)
 {
-    setDofCharacteristicsOnLastBody(); // Apply the segment caracteristics only to the last segment
     setJointAxis(); // Choose the axis order in relation to the selected sequence
+    setDofCharacteristicsOnLastBody(); // Apply the segment caracteristics only to the last segment
 
 
     RigidBodyDynamics::Math::SpatialTransform zero (
         utils::Matrix3d::Identity(),
         RigidBodyDynamics::Math::Vector3d(0,0,0));
     // Create the articulations (intra segment)
-    m_idxDof->clear();
-
-    if (*m_nbDof==0) {
-        m_idxDof->resize(1);
-    } else {
-        m_idxDof->resize(*m_nbDof);
-    }
+    size_t nbBodies(m_dof->size());
+    std::vector<unsigned int> idxBodies(nbBodies);
 
     unsigned int parent_id(model.GetBodyId(parent().c_str()));
 
     if (parent_id == std::numeric_limits<unsigned int>::max()) {
         parent_id = 0;
     }
-    if (*m_nbDof==0)
-        (*m_idxDof)[0] = model.AddBody(parent_id, *m_cor, (*m_dof)[0], (*m_dofCharacteristics)[0], name());
-    else if (*m_nbDof == 1)
-        (*m_idxDof)[0] = model.AddBody(parent_id, *m_cor, (*m_dof)[0], (*m_dofCharacteristics)[0], name());
+    if (nbBodies == 1)
+        idxBodies[0] = model.AddBody(parent_id, *m_cor, (*m_dof)[0], (*m_dofCharacteristics)[0], name());
     else {
-        (*m_idxDof)[0] = model.AddBody(parent_id, *m_cor, (*m_dof)[0], (*m_dofCharacteristics)[0]);
-        for (size_t i=1; i<*m_nbDof; i++)
-            if (i!=*m_nbDof-1)
-                (*m_idxDof)[i] = model.AddBody(
-                    static_cast<unsigned int>((*m_idxDof)[i-1]), zero, (*m_dof)[i], (*m_dofCharacteristics)[i]
+        idxBodies[0] = model.AddBody(parent_id, *m_cor, (*m_dof)[0], (*m_dofCharacteristics)[0]);
+        for (size_t i=1; i<nbBodies; i++)
+            if (i!=nbBodies-1)
+                idxBodies[i] = model.AddBody(
+                    idxBodies[i-1], zero, (*m_dof)[i], (*m_dofCharacteristics)[i]
                 );
             else
-                (*m_idxDof)[i] = model.AddBody(
-                    static_cast<unsigned int>((*m_idxDof)[i-1]), zero, (*m_dof)[i],(*m_dofCharacteristics)[i], name()
+                idxBodies[i] = model.AddBody(
+                    idxBodies[i-1], zero, (*m_dof)[i],(*m_dofCharacteristics)[i], name()
                 );
     }
+
+    // Each dof refers to the body that carries it (a multi-dof joint carries the whole sequence)
+    m_idxDof->clear();
+    for (size_t i=0; i<nbBodies; i++) {
+        RigidBodyDynamics::JointType type((*m_dof)[i].mJointType);
+        size_t nbDofOfBody(type == RigidBodyDynamics::JointTypeTranslationXYZ
+                           || type == RigidBodyDynamics::JointTypeEulerXYZ
+                           || type == RigidBodyDynamics::JointTypeEulerZYX ? 3 : 1);
+        m_idxDof->insert(m_idxDof->end(), nbDofOfBody, idxBodies[i]);
+    }
     *m_idxInModel = static_cast<int>(model.I.size() - 1);
 }
 
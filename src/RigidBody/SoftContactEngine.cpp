@@ -0,0 +1,410 @@
+#define BIORBD_API_EXPORTS
+#include "RigidBody/SoftContactEngine.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <rbdl/Kinematics.h>
+#include "Utils/Error.h"
+#include "Utils/SpatialVector.h"
+#include "Utils/String.h"
+#include "Utils/UtilsEnum.h"
+#include "Utils/Vector3d.h"
+#include "RigidBody/Joints.h"
+#include "RigidBody/Segment.h"
+#include "RigidBody/SoftContacts.h"
+#include "RigidBody/SoftContactSphere.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+
+using namespace BIORBD_NAMESPACE;
+
+rigidbody::SoftContactEngine::SoftContactEngine() :
+    m_margin(0.1),
+    m_isBuilt(false),
+    m_nbBodies(0),
+    m_nbPairsEvaluated(0)
+{
+    addPlane(utils::Vector3d(0, 0, 0), utils::Vector3d(0, 0, 1));
+}
+
+rigidbody::SoftContactEngine rigidbody::SoftContactEngine::DeepCopy() const
+{
+    rigidbody::SoftContactEngine copy;
+    copy.DeepCopy(*this);
+    return copy;
+}
+
+void rigidbody::SoftContactEngine::DeepCopy(
+    const rigidbody::SoftContactEngine &other)
+{
+    m_obstacleTypes = other.m_obstacleTypes;
+    m_obstacleData = other.m_obstacleData;
+    m_margin = other.m_margin;
+    invalidate();
+}
+
+void rigidbody::SoftContactEngine::addPlane(
+    const utils::Vector3d &point,
+    const utils::Vector3d &normal)
+{
+    utils::Scalar norm(normal.norm());
+    utils::Error::check(norm > 0, "The normal of a plane obstacle must not be null");
+    m_obstacleTypes.push_back(SOFT_CONTACT_OBSTACLE_PLANE);
+    m_obstacleData.insert(m_obstacleData.end(), {
+        point[0], point[1], point[2], normal[0] / norm, normal[1] / norm, normal[2] / norm});
+}
+
+void rigidbody::SoftContactEngine::addSphere(
+    const utils::Vector3d &center,
+    const utils::Scalar &radius)
+{
+    utils::Error::check(radius > 0, "The radius of a sphere obstacle must be positive");
+    m_obstacleTypes.push_back(SOFT_CONTACT_OBSTACLE_SPHERE);
+    m_obstacleData.insert(m_obstacleData.end(), {
+        center[0], center[1], center[2], radius, 0, 0});
+}
+
+void rigidbody::SoftContactEngine::clearObstacles()
+{
+    m_obstacleTypes.clear();
+    m_obstacleData.clear();
+}
+
+size_t rigidbody::SoftContactEngine::nbObstacles() const
+{
+    return m_obstacleTypes.size();
+}
+
+rigidbody::SOFT_CONTACT_OBSTACLE rigidbody::SoftContactEngine::obstacleType(
+    size_t idx) const
+{
+    utils::Error::check(idx < m_obstacleTypes.size(), "The obstacle doesn't exist");
+    return m_obstacleTypes[idx];
+}
+
+void rigidbody::SoftContactEngine::setBroadphaseMargin(
+    const utils::Scalar &margin)
+{
+    utils::Error::check(margin >= 0, "The broadphase margin must be positive");
+    m_margin = margin;
+}
+
+utils::Scalar rigidbody::SoftContactEngine::broadphaseMargin() const
+{
+    return m_margin;
+}
+
+void rigidbody::SoftContactEngine::invalidate()
+{
+    m_isBuilt = false;
+}
+
+size_t rigidbody::SoftContactEngine::nbPairsEvaluated() const
+{
+    return m_nbPairsEvaluated;
+}
+
+void rigidbody::SoftContactEngine::build(
+    rigidbody::Joints &model,
+    const rigidbody::SoftContacts &contacts)
+{
+    // Resolve once, for each sphere, its moving body, the body receiving its force and its
+    // position in the frame of the moving body (the spheres on a segment without dof are moved
+    // by the body that segment is fixed to)
+    size_t nbSpheres(contacts.nbSoftContacts());
+    std::vector<unsigned int> body(nbSpheres);
+    std::vector<unsigned int> forceBody(nbSpheres);
+    std::vector<RigidBodyDynamics::Math::Vector3d> local(nbSpheres);
+    for (size_t i=0; i<nbSpheres; ++i) {
+        const rigidbody::SoftContactNode& contact(contacts.softContact(i));
+        utils::Error::check(contact.typeOfNode() == utils::NODE_TYPE::SOFT_CONTACT_SPHERE,
+                            "The soft contact engine only supports spheres");
+        unsigned int id(model.getParentRbdlId(contact));
+        local[i] = contact;
+        if (model.IsFixedBodyId(id)) {
+            const RigidBodyDynamics::FixedBody& fixedBody(model.mFixedBodies[id - model.fixed_body_discriminator]);
+            local[i] = fixedBody.mParentTransform.r + fixedBody.mParentTransform.E.transpose() * local[i];
+            id = fixedBody.mMovableParent;
+        }
+        body[i] = id;
+        forceBody[i] = static_cast<unsigned int>(
+                           model.segment(contact.parent()).findFirstSegmentWithDof(model).id());
+    }
+
+    // Sort the spheres by moving body so each body is a contiguous group
+    std::vector<size_t> order(nbSpheres);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&body](size_t a, size_t b) {
+        return body[a] < body[b];
+    });
+
+    for (auto* v : {&m_localX, &m_localY, &m_localZ, &m_radius, &m_stiffness, &m_damping,
+                    &m_muStatic, &m_muDynamic, &m_muViscous, &m_transitionVelocity}) {
+        v->resize(nbSpheres);
+    }
+    m_body.resize(nbSpheres);
+    m_forceBody.resize(nbSpheres);
+    m_groupStart.clear();
+    for (size_t k=0; k<nbSpheres; ++k) {
+        size_t i(order[k]);
+        const rigidbody::SoftContactSphere& sphere(
+            dynamic_cast<const rigidbody::SoftContactSphere&>(contacts.softContact(i)));
+        if (k == 0 || body[i] != m_body[k-1]) {
+            m_groupStart.push_back(k);
+        }
+        m_body[k] = body[i];
+        m_forceBody[k] = forceBody[i];
+        m_localX[k] = local[i][0];
+        m_localY[k] = local[i][1];
+        m_localZ[k] = local[i][2];
+        m_radius[k] = sphere.radius();
+        m_stiffness[k] = sphere.stiffness();
+        m_damping[k] = sphere.damping();
+        m_muStatic[k] = sphere.muStatic();
+        m_muDynamic[k] = sphere.muDynamic();
+        m_muViscous[k] = sphere.muViscous();
+        m_transitionVelocity[k] = sphere.transitionVelocity();
+    }
+    m_groupStart.push_back(nbSpheres);
+
+    // Bounding sphere of each group, centered on the mean of its spheres
+    size_t nbGroups(m_groupStart.size() - 1);
+    m_groupCenter.assign(3 * nbGroups, 0);
+    m_groupRadius.assign(nbGroups, 0);
+    for (size_t g=0; g<nbGroups; ++g) {
+        double* center(&m_groupCenter[3 * g]);
+        double nb(static_cast<double>(m_groupStart[g+1] - m_groupStart[g]));
+        for (size_t k=m_groupStart[g]; k<m_groupStart[g+1]; ++k) {
+            center[0] += m_localX[k] / nb;
+            center[1] += m_localY[k] / nb;
+            center[2] += m_localZ[k] / nb;
+        }
+        for (size_t k=m_groupStart[g]; k<m_groupStart[g+1]; ++k) {
+            double dist(std::sqrt((m_localX[k] - center[0]) * (m_localX[k] - center[0])
+                                  + (m_localY[k] - center[1]) * (m_localY[k] - center[1])
+                                  + (m_localZ[k] - center[2]) * (m_localZ[k] - center[2])));
+            m_groupRadius[g] = std::max(m_groupRadius[g], dist + m_radius[k]);
+        }
+    }
+
+    m_groupWorldCenter.resize(3 * nbGroups);
+    m_state.resize(NB_STATE_FIELDS * nbSpheres);
+    m_candidates.resize(nbSpheres);
+    m_pairs.resize(NB_PAIR_FIELDS * nbSpheres);
+    m_nbBodies = model.mBodies.size();
+    m_isBuilt = true;
+}
+
+void rigidbody::SoftContactEngine::addForces(
+    rigidbody::Joints &model,
+    const rigidbody::SoftContacts &contacts,
+    const rigidbody::GeneralizedCoordinates &Q,
+    const rigidbody::GeneralizedVelocity &QDot,
+    std::vector<utils::SpatialVector> &out,
+    bool updateKin)
+{
+    if (!m_isBuilt || m_nbBodies != model.mBodies.size()
+            || m_body.size() != contacts.nbSoftContacts()) {
+        build(model, contacts);
+    }
+    utils::Error::check(out.size() == model.mBodies.size(),
+                        "There must be one spatial vector per rbdl body");
+    m_nbPairsEvaluated = 0;
+    size_t nbSpheres(m_body.size());
+    if (nbSpheres == 0) {
+        return;
+    }
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &QDot);
+    }
+
+    // Place the spheres from the kinematics of their moving body
+    double* state(m_state.data());
+    for (size_t g=0; g+1<m_groupStart.size(); ++g) {
+        unsigned int b(m_body[m_groupStart[g]]);
+        const RigidBodyDynamics::Math::Matrix3d& E(model.X_base[b].E);
+        const RigidBodyDynamics::Math::Vector3d& r(model.X_base[b].r);
+        RigidBodyDynamics::Math::Vector3d omega(E.transpose() * model.v[b].head<3>());
+        RigidBodyDynamics::Math::Vector3d vOrigin(E.transpose() * model.v[b].tail<3>());
+        RigidBodyDynamics::Math::Vector3d center(r + E.transpose() * RigidBodyDynamics::Math::Vector3d(
+                    m_groupCenter[3 * g], m_groupCenter[3 * g + 1], m_groupCenter[3 * g + 2]));
+        for (size_t j=0; j<3; ++j) {
+            m_groupWorldCenter[3 * g + j] = center[j];
+        }
+        for (size_t k=m_groupStart[g]; k<m_groupStart[g+1]; ++k) {
+            RigidBodyDynamics::Math::Vector3d arm(
+                E.transpose() * RigidBodyDynamics::Math::Vector3d(m_localX[k], m_localY[k], m_localZ[k]));
+            RigidBodyDynamics::Math::Vector3d velocity(vOrigin + omega.cross(arm));
+            for (size_t j=0; j<3; ++j) {
+                state[(STATE_X + j) * nbSpheres + k] = r[j] + arm[j];
+                state[(STATE_DX + j) * nbSpheres + k] = velocity[j];
+                state[(STATE_WX + j) * nbSpheres + k] = omega[j];
+            }
+        }
+    }
+
+    for (size_t o=0; o<m_obstacleTypes.size(); ++o) {
+        size_t nbCandidates(broadphase(o));
+        if (nbCandidates == 0) {
+            continue;
+        }
+        m_nbPairsEvaluated += nbCandidates;
+        computeCandidateForces(nbCandidates);
+
+        const double* pairs(m_pairs.data());
+        for (size_t c=0; c<nbCandidates; ++c) {
+            utils::SpatialVector& f(out[m_forceBody[m_candidates[c]]]);
+            for (size_t j=0; j<3; ++j) {
+                f[j] += pairs[(PAIR_MX + j) * nbSpheres + c];
+                f[3 + j] += pairs[(PAIR_FX + j) * nbSpheres + c];
+            }
+        }
+    }
+}
+
+size_t rigidbody::SoftContactEngine::broadphase(
+    size_t obstacle)
+{
+    size_t nbSpheres(m_body.size());
+    const double* state(m_state.data());
+    double* pairs(m_pairs.data());
+    const double* data(&m_obstacleData[6 * obstacle]);
+    bool isPlane(m_obstacleTypes[obstacle] == SOFT_CONTACT_OBSTACLE_PLANE);
+
+    // Signed distance from the surface of the obstacle to a point and the outward normal at that point
+    auto distance = [&](const double* p, double* n) {
+        double d[3] = {p[0] - data[0], p[1] - data[1], p[2] - data[2]};
+        if (isPlane) {
+            n[0] = data[3];
+            n[1] = data[4];
+            n[2] = data[5];
+            return d[0] * data[3] + d[1] * data[4] + d[2] * data[5];
+        }
+        double norm(std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        if (norm > 0) {
+            n[0] = d[0] / norm;
+            n[1] = d[1] / norm;
+            n[2] = d[2] / norm;
+        } else {
+            n[0] = 0;
+            n[1] = 0;
+            n[2] = 1;
+        }
+        return norm - data[3];
+    };
+
+    size_t nbCandidates(0);
+    double normal[3];
+    for (size_t g=0; g+1<m_groupStart.size(); ++g) {
+        // Skip the whole body when its bounding sphere is far enough
+        if (distance(&m_groupWorldCenter[3 * g], normal) - m_groupRadius[g] > m_margin) {
+            continue;
+        }
+        for (size_t k=m_groupStart[g]; k<m_groupStart[g+1]; ++k) {
+            double x[3] = {state[STATE_X * nbSpheres + k], state[STATE_Y * nbSpheres + k], state[STATE_Z * nbSpheres + k]};
+            double penetration(m_radius[k] - distance(x, normal));
+            if (-penetration > m_margin) {
+                continue;
+            }
+
+            // Gather the pair in contiguous columns for the kernel
+            size_t c(nbCandidates++);
+            m_candidates[c] = k;
+            for (size_t j=0; j<static_cast<size_t>(NB_STATE_FIELDS); ++j) {
+                pairs[(PAIR_X + j) * nbSpheres + c] = state[(STATE_X + j) * nbSpheres + k];
+            }
+            for (size_t j=0; j<3; ++j) {
+                pairs[(PAIR_NX + j) * nbSpheres + c] = normal[j];
+            }
+            pairs[PAIR_PENETRATION * nbSpheres + c] = penetration;
+            pairs[PAIR_RADIUS * nbSpheres + c] = m_radius[k];
+            pairs[PAIR_STIFFNESS * nbSpheres + c] = m_stiffness[k];
+            pairs[PAIR_DAMPING * nbSpheres + c] = m_damping[k];
+            pairs[PAIR_MU_STATIC * nbSpheres + c] = m_muStatic[k];
+            pairs[PAIR_MU_DYNAMIC * nbSpheres + c] = m_muDynamic[k];
+            pairs[PAIR_MU_VISCOUS * nbSpheres + c] = m_muViscous[k];
+            pairs[PAIR_TRANSITION_VELOCITY * nbSpheres + c] = m_transitionVelocity[k];
+        }
+    }
+    return nbCandidates;
+}
+
+void rigidbody::SoftContactEngine::computeCandidateForces(
+    size_t nbCandidates)
+{
+    // Same model as SoftContactSphere::computeForce, written without branches over contiguous
+    // columns so the loop can be vectorized
+    size_t nbSpheres(m_body.size());
+    double* pairs(m_pairs.data());
+    const double* px(pairs + PAIR_X * nbSpheres);
+    const double* py(pairs + PAIR_Y * nbSpheres);
+    const double* pz(pairs + PAIR_Z * nbSpheres);
+    const double* vx(pairs + PAIR_DX * nbSpheres);
+    const double* vy(pairs + PAIR_DY * nbSpheres);
+    const double* vz(pairs + PAIR_DZ * nbSpheres);
+    const double* wx(pairs + PAIR_WX * nbSpheres);
+    const double* wy(pairs + PAIR_WY * nbSpheres);
+    const double* wz(pairs + PAIR_WZ * nbSpheres);
+    const double* nx(pairs + PAIR_NX * nbSpheres);
+    const double* ny(pairs + PAIR_NY * nbSpheres);
+    const double* nz(pairs + PAIR_NZ * nbSpheres);
+    const double* penetration(pairs + PAIR_PENETRATION * nbSpheres);
+    const double* radius(pairs + PAIR_RADIUS * nbSpheres);
+    const double* stiffness(pairs + PAIR_STIFFNESS * nbSpheres);
+    const double* damping(pairs + PAIR_DAMPING * nbSpheres);
+    const double* muStatic(pairs + PAIR_MU_STATIC * nbSpheres);
+    const double* muDynamic(pairs + PAIR_MU_DYNAMIC * nbSpheres);
+    const double* muViscous(pairs + PAIR_MU_VISCOUS * nbSpheres);
+    const double* transitionVelocity(pairs + PAIR_TRANSITION_VELOCITY * nbSpheres);
+    double* mx(pairs + PAIR_MX * nbSpheres);
+    double* my(pairs + PAIR_MY * nbSpheres);
+    double* mz(pairs + PAIR_MZ * nbSpheres);
+    double* fx(pairs + PAIR_FX * nbSpheres);
+    double* fy(pairs + PAIR_FY * nbSpheres);
+    double* fz(pairs + PAIR_FZ * nbSpheres);
+
+    const double eps(1e-16);
+    const double bv(50);
+    const double bd(300);
+    for (size_t c=0; c<nbCandidates; ++c) {
+        // Decomposition into normal and tangent velocities
+        double normalVelocity(vx[c] * nx[c] + vy[c] * ny[c] + vz[c] * nz[c]);
+        double tx(vx[c] - normalVelocity * nx[c] + radius[c] * (ny[c] * wz[c] - nz[c] * wy[c]));
+        double ty(vy[c] - normalVelocity * ny[c] + radius[c] * (nz[c] * wx[c] - nx[c] * wz[c]));
+        double tz(vz[c] - normalVelocity * nz[c] + radius[c] * (nx[c] * wy[c] - ny[c] * wx[c]));
+        double delta(penetration[c]);
+        double deltaDot(-normalVelocity);
+
+        // Smoothed Hunt-Crossley normal force
+        double fslope((0.5 + 0.5 * std::tanh(bd * delta) + eps)
+                      * (0.5 + 0.5 * std::tanh(bv * (deltaDot + 2. / 3. / damping[c]) + eps)));
+        double deltaAbs(std::sqrt(delta * delta));
+        double forceFactor(4. / 3. * stiffness[c] * std::sqrt(radius[c])
+                           * std::sqrt(deltaAbs * deltaAbs * deltaAbs));
+        double normalForce(forceFactor * (1. + 1.5 * damping[c] * deltaDot) * fslope);
+
+        // Friction
+        double tangentVelocityNorm(std::sqrt(tx * tx + ty * ty + tz * tz + 1e-5));
+        double frictionVelocity(tangentVelocityNorm / transitionVelocity[c]);
+        double denominator(0.25 * frictionVelocity * frictionVelocity + 0.75);
+        double forceFriction(normalForce * muDynamic[c] * std::tanh(4. * frictionVelocity)
+                             + normalForce * (muStatic[c] - muDynamic[c]) * frictionVelocity
+                             / (denominator * denominator)
+                             + normalForce * muViscous[c] * tangentVelocityNorm);
+        double frictionFactor(-forceFriction / tangentVelocityNorm);
+        fx[c] = normalForce * nx[c] + frictionFactor * tx;
+        fy[c] = normalForce * ny[c] + frictionFactor * ty;
+        fz[c] = normalForce * nz[c] + frictionFactor * tz;
+
+        // Moment at the origin of the force applied at the contact point
+        double ax(px[c] - delta * nx[c]);
+        double ay(py[c] - delta * ny[c]);
+        double az(pz[c] - delta * nz[c]);
+        mx[c] = ay * fz[c] - az * fy[c];
+        my[c] = az * fx[c] - ax * fz[c];
+        mz[c] = ax * fy[c] - ay * fx[c];
+    }
+}
+#endif
@@ -84,7 +84,7 @@ utils::SpatialVector rigidbody::SoftContactNode::computeForceAtOrigin(
     updateKin = false;
 #endif
 
-    unsigned int id = model.GetBodyId(parent().c_str());
+    unsigned int id = model.getParentRbdlId(*this);
     utils::Vector3d x(RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, *this, updateKin));
     utils::Vector3d dx(rigidbody::NodeSegment(RigidBodyDynamics::CalcPointVelocity(model, Q, QDot, id, *this, updateKin)));
     utils::Vector3d angularVelocity(RigidBodyDynamics::CalcPointVelocity6D(model, Q, QDot, id, utils::Vector3d(0, 0, 0), updateKin).block(0, 0, 3, 1));
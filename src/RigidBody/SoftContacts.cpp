@@ -8,6 +8,7 @@
 #include "RigidBody/GeneralizedCoordinates.h"
 #include "RigidBody/GeneralizedVelocity.h"
 #include "RigidBody/Segment.h"
+#include "RigidBody/SoftContactEngine.h"
 
 #include "Utils/UtilsEnum.h"
 #include "Utils/String.h"
@@ -17,6 +18,9 @@ using namespace BIORBD_NAMESPACE;
 
 rigidbody::SoftContacts::SoftContacts():
     m_softContacts(std::make_shared<std::vector<std::shared_ptr<SoftContactNode>>>())
+#ifndef BIORBD_USE_CASADI_MATH
+    ,m_softContactEngine(std::make_shared<rigidbody::SoftContactEngine>())
+#endif
 {
 
 }
@@ -40,6 +44,17 @@ void rigidbody::SoftContacts::DeepCopy(
         }
         (*m_softContacts)[i]->DeepCopy(*((*other.m_softContacts)[i]));
     }
+#ifndef BIORBD_USE_CASADI_MATH
+    m_softContactEngine->DeepCopy(*other.m_softContactEngine);
+#endif
+}
+
+void rigidbody::SoftContacts::detachEvaluationState()
+{
+#ifndef BIORBD_USE_CASADI_MATH
+    m_softContactEngine = std::make_shared<rigidbody::SoftContactEngine>(
+                              m_softContactEngine->DeepCopy());
+#endif
 }
 
 utils::String rigidbody::SoftContacts::softContactName(
@@ -65,10 +80,22 @@ void rigidbody::SoftContacts::addSoftContact(
     } else {
         utils::Error::raise(utils::String("The ") + contact.typeOfNode() + " does not exist");
     }
+#ifndef BIORBD_USE_CASADI_MATH
+    m_softContactEngine->invalidate();
+#endif
 }
 
 rigidbody::SoftContactNode& rigidbody::SoftContacts::softContact(
         size_t idx)
+{
+#ifndef BIORBD_USE_CASADI_MATH
+    m_softContactEngine->invalidate();
+#endif
+    return *(*m_softContacts)[idx];
+}
+
+const rigidbody::SoftContactNode& rigidbody::SoftContacts::softContact(
+        size_t idx) const
 {
     return *(*m_softContacts)[idx];
 }
@@ -83,9 +110,12 @@ rigidbody::NodeSegment rigidbody::SoftContacts::softContact(
     updateKin = true;
 #endif
 
-    const rigidbody::SoftContactNode& sc(softContact(idx));
-    unsigned int id = model.GetBodyId(sc.parent().c_str());
-    return rigidbody::NodeSegment(RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, sc, updateKin));
+    const rigidbody::SoftContactNode& sc(*(*m_softContacts)[idx]);
+    unsigned int id = model.getParentRbdlId(sc);
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q);
+    }
+    return rigidbody::NodeSegment(RigidBodyDynamics::CalcBodyToBaseCoordinates(model, Q, id, sc, false));
 }
 
 std::vector<rigidbody::NodeSegment> rigidbody::SoftContacts::softContacts(
@@ -114,11 +144,14 @@ rigidbody::NodeSegment rigidbody::SoftContacts::softContactVelocity(
     updateKin = true;
 #endif
 
-    const rigidbody::SoftContactNode& sc(softContact(idx));
-    unsigned int id(model.GetBodyId(sc.parent().c_str()));
+    const rigidbody::SoftContactNode& sc(*(*m_softContacts)[idx]);
+    unsigned int id(model.getParentRbdlId(sc));
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
     // Calculate the velocity of the point
     return rigidbody::NodeSegment(
-        RigidBodyDynamics::CalcPointVelocity(model, Q, Qdot, id, sc, updateKin)
+        RigidBodyDynamics::CalcPointVelocity(model, Q, Qdot, id, sc, false)
     );
 }
 
@@ -134,12 +167,15 @@ rigidbody::NodeSegment rigidbody::SoftContacts::softContactAngularVelocity(
     updateKin = true;
 #endif
 
-    const rigidbody::SoftContactNode& sc(softContact(idx));
+    const rigidbody::SoftContactNode& sc(*(*m_softContacts)[idx]);
 
     // Calculate the velocity of the point
-    unsigned int id(model.GetBodyId(sc.parent().c_str()));
+    unsigned int id(model.getParentRbdlId(sc));
+    if (updateKin) {
+        model.UpdateKinematicsCustom(&Q, &Qdot);
+    }
     return rigidbody::NodeSegment(
-        RigidBodyDynamics::CalcPointVelocity6D(model, Q, Qdot, id, sc, updateKin).block(0, 0, 3, 1)
+        RigidBodyDynamics::CalcPointVelocity6D(model, Q, Qdot, id, sc, false).block(0, 0, 3, 1)
     );
 }
 
@@ -194,3 +230,20 @@ std::vector<size_t> rigidbody::SoftContacts::segmentSoftContactIdx(
     return indices;
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+rigidbody::SoftContactEngine& rigidbody::SoftContacts::softContactEngine()
+{
+    return *m_softContactEngine;
+}
+
+void rigidbody::SoftContacts::addSoftContactForces(
+        const rigidbody::GeneralizedCoordinates &Q,
+        const rigidbody::GeneralizedVelocity &Qdot,
+        std::vector<utils::SpatialVector>& out,
+        bool updateKin)
+{
+    // Assuming that this is also a joint type (via BiorbdModel)
+    rigidbody::Joints &model = dynamic_cast<rigidbody::Joints &>(*this);
+    m_softContactEngine->addForces(model, *this, Q, Qdot, out, updateKin);
+}
+#endif
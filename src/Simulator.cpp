@@ -0,0 +1,589 @@
+#define BIORBD_API_EXPORTS
+#include "Simulator.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "BiorbdModel.h"
+#include "Utils/Error.h"
+#include "Utils/Matrix.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+#include "RigidBody/GeneralizedAcceleration.h"
+#include "RigidBody/GeneralizedTorque.h"
+
+#ifdef MODULE_MUSCLES
+#include "InternalForces/Muscles/Muscle.h"
+#include "InternalForces/Muscles/StateDynamics.h"
+#include "InternalForces/Muscles/FatigueModel.h"
+#include "InternalForces/Muscles/FatigueDynamicState.h"
+#endif
+
+using namespace BIORBD_NAMESPACE;
+
+// Maximal number of steps the adaptive integrator can take over one interval
+static const size_t maxNbAdaptiveSteps(100000);
+
+// Butcher tableau of Dormand-Prince. The seventh stage is evaluated at the fifth order
+// solution, so it is the first stage of the next step
+static const double dpC[7] = {0., 1./5., 3./10., 4./5., 8./9., 1., 1.};
+static const double dpA[7][6] = {
+    {0., 0., 0., 0., 0., 0.},
+    {1./5., 0., 0., 0., 0., 0.},
+    {3./40., 9./40., 0., 0., 0., 0.},
+    {44./45., -56./15., 32./9., 0., 0., 0.},
+    {19372./6561., -25360./2187., 64448./6561., -212./729., 0., 0.},
+    {9017./3168., -355./33., 46732./5247., 49./176., -5103./18656., 0.},
+    {35./384., 0., 500./1113., 125./192., -2187./6784., 11./84.}
+};
+// Difference between the fifth and the fourth order solutions
+static const double dpE[7] = {
+    71./57600., 0., -71./16695., 71./1920., -17253./339200., 22./525., -1./40.
+};
+
+Simulator::Workspace::Workspace(
+    const Model& model,
+    size_t nbStates,
+    size_t nbControls) :
+    model(std::make_shared<Model>(model.workspace())),
+    Q(std::make_shared<rigidbody::GeneralizedCoordinates>(model)),
+    QDot(std::make_shared<rigidbody::GeneralizedVelocity>(model)),
+    Tau(std::make_shared<rigidbody::GeneralizedTorque>(model)),
+    x(nbStates),
+    xStage(nbStates),
+    xNext(nbStates),
+    u(nbControls),
+    k(7, utils::Vector(nbStates)),
+    h(0)
+{
+#ifdef MODULE_MUSCLES
+    muscleStates = this->model->stateSet();
+    muscles = this->model->muscles();
+    for (size_t m=0; m<muscles.size(); ++m) {
+        utils::Error::check(
+            std::dynamic_pointer_cast<internal_forces::muscles::StateDynamics>(muscleStates[m]) != nullptr,
+            "The muscle " + muscles[m]->name() + " has no activation dynamics and cannot be simulated");
+
+        std::shared_ptr<internal_forces::muscles::FatigueModel> fatigueModel(
+            std::dynamic_pointer_cast<internal_forces::muscles::FatigueModel>(muscles[m]));
+        if (fatigueModel && dynamic_cast<const internal_forces::muscles::FatigueDynamicState*>
+                (&fatigueModel->fatigueState())) {
+            fatigueModels.push_back(fatigueModel);
+            fatigueMuscles.push_back(m);
+        }
+    }
+#endif
+}
+
+Simulator::Simulator(
+    const Model& model,
+    INTEGRATOR integrator,
+    size_t nbThreads) :
+    m_model(model),
+    m_integrator(integrator),
+    m_nbSteps(1),
+    m_absoluteTolerance(1e-6),
+    m_relativeTolerance(1e-6),
+    m_nbActivations(0),
+    m_nbFatigueStates(0)
+{
+    if (nbThreads == 0) {
+        nbThreads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                             static_cast<size_t>(1));
+    }
+
+#ifdef MODULE_MUSCLES
+    m_nbActivations = model.nbMuscles();
+    for (const auto& muscle : model.muscles()) {
+        std::shared_ptr<internal_forces::muscles::FatigueModel> fatigueModel(
+            std::dynamic_pointer_cast<internal_forces::muscles::FatigueModel>(muscle));
+        if (fatigueModel && dynamic_cast<const internal_forces::muscles::FatigueDynamicState*>
+                (&fatigueModel->fatigueState())) {
+            m_nbFatigueStates += 3;
+        }
+    }
+#endif
+
+    for (size_t i=0; i<nbThreads; ++i) {
+        m_workspaces.push_back(Workspace(model, nbStates(), nbControls()));
+    }
+}
+
+Simulator::~Simulator()
+{
+
+}
+
+size_t Simulator::nbThreads() const
+{
+    return m_workspaces.size();
+}
+
+void Simulator::setIntegrator(
+    INTEGRATOR integrator)
+{
+    m_integrator = integrator;
+}
+
+INTEGRATOR Simulator::integrator() const
+{
+    return m_integrator;
+}
+
+void Simulator::setNbSteps(
+    size_t nbSteps)
+{
+    utils::Error::check(nbSteps > 0, "The number of steps per interval must be positive");
+    m_nbSteps = nbSteps;
+}
+
+size_t Simulator::nbSteps() const
+{
+    return m_nbSteps;
+}
+
+void Simulator::setTolerances(
+    double absoluteTolerance,
+    double relativeTolerance)
+{
+    utils::Error::check(absoluteTolerance > 0 && relativeTolerance >= 0,
+                        "The absolute tolerance must be positive and the relative tolerance must not be negative");
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+
+double Simulator::absoluteTolerance() const
+{
+    return m_absoluteTolerance;
+}
+
+double Simulator::relativeTolerance() const
+{
+    return m_relativeTolerance;
+}
+
+size_t Simulator::nbStates() const
+{
+    return m_model.nbQ() + m_model.nbQdot() + m_nbActivations + m_nbFatigueStates;
+}
+
+size_t Simulator::nbControls() const
+{
+    return m_model.nbGeneralizedTorque() + m_nbActivations;
+}
+
+size_t Simulator::nbActivations() const
+{
+    return m_nbActivations;
+}
+
+size_t Simulator::nbFatigueStates() const
+{
+    return m_nbFatigueStates;
+}
+
+size_t Simulator::activationsIndex() const
+{
+    return m_model.nbQ() + m_model.nbQdot();
+}
+
+size_t Simulator::fatigueStatesIndex() const
+{
+    return activationsIndex() + m_nbActivations;
+}
+
+utils::Vector Simulator::state(
+    const rigidbody::GeneralizedCoordinates& Q,
+    const rigidbody::GeneralizedVelocity& QDot) const
+{
+    utils::Error::check(static_cast<size_t>(Q.size()) == m_model.nbQ(), "Q must have nbQ elements");
+    utils::Error::check(static_cast<size_t>(QDot.size()) == m_model.nbQdot(),
+                        "QDot must have nbQdot elements");
+
+    utils::Vector x(nbStates());
+    x.segment(0, m_model.nbQ()) = Q;
+    x.segment(m_model.nbQ(), m_model.nbQdot()) = QDot;
+#ifdef MODULE_MUSCLES
+    size_t idxActivation(activationsIndex());
+    size_t idxFatigue(fatigueStatesIndex());
+    for (const auto& muscle : m_model.muscles()) {
+        x[idxActivation++] = muscle->state().activation();
+        std::shared_ptr<internal_forces::muscles::FatigueModel> fatigueModel(
+            std::dynamic_pointer_cast<internal_forces::muscles::FatigueModel>(muscle));
+        if (fatigueModel && dynamic_cast<const internal_forces::muscles::FatigueDynamicState*>
+                (&fatigueModel->fatigueState())) {
+            const internal_forces::muscles::FatigueState& fatigue(fatigueModel->fatigueState());
+            x[idxFatigue++] = fatigue.activeFibers();
+            x[idxFatigue++] = fatigue.fatiguedFibers();
+            x[idxFatigue++] = fatigue.restingFibers();
+        }
+    }
+#endif
+    return x;
+}
+
+void Simulator::dynamics(
+    const utils::Vector& x,
+    const utils::Vector& u,
+    utils::Vector& xDot)
+{
+    utils::Error::check(static_cast<size_t>(x.size()) == nbStates(), "x must have nbStates elements");
+    utils::Error::check(static_cast<size_t>(u.size()) == nbControls(),
+                        "u must have nbControls elements");
+    xDot.resize(static_cast<unsigned int>(nbStates()));
+    dynamics(m_workspaces[0], x, u, xDot);
+}
+
+void Simulator::simulate(
+    const utils::Vector& x0,
+    const utils::Matrix& controls,
+    double dt,
+    utils::Matrix& states)
+{
+    checkDimensions(x0, dt, states);
+    utils::Error::check(static_cast<size_t>(controls.rows()) == nbControls()
+                        && controls.cols() == states.cols() - 1,
+                        "The controls must be nbControls x nbIntervals");
+
+    Workspace& ws(m_workspaces[0]);
+    size_t interval(0);
+    ControlFunction control([&controls, &interval](double, const utils::Vector&, utils::Vector& u) {
+        u = controls.col(interval);
+    });
+    ws.x = x0;
+    rollout(ws, control, &interval, dt, states);
+}
+
+void Simulator::simulate(
+    const utils::Vector& x0,
+    const ControlFunction& control,
+    double dt,
+    utils::Matrix& states)
+{
+    checkDimensions(x0, dt, states);
+
+    Workspace& ws(m_workspaces[0]);
+    ws.x = x0;
+    rollout(ws, control, nullptr, dt, states);
+}
+
+void Simulator::simulateBatch(
+    const utils::Matrix& x0,
+    const std::vector<utils::Matrix>& controls,
+    double dt,
+    std::vector<utils::Matrix>& states)
+{
+    utils::Error::check(static_cast<size_t>(x0.cols()) == controls.size()
+                        && controls.size() == states.size(),
+                        "There must be one initial state, one control table and one output per rollout");
+    for (size_t r=0; r<controls.size(); ++r) {
+        checkDimensions(x0.col(r), dt, states[r]);
+        utils::Error::check(static_cast<size_t>(controls[r].rows()) == nbControls()
+                            && controls[r].cols() == states[r].cols() - 1,
+                            "The controls must be nbControls x nbIntervals");
+    }
+
+    run(controls.size(), [&](Workspace& ws, size_t r) {
+        size_t interval(0);
+        const utils::Matrix& table(controls[r]);
+        ControlFunction control([&table, &interval](double, const utils::Vector&, utils::Vector& u) {
+            u = table.col(interval);
+        });
+        ws.x = x0.col(r);
+        rollout(ws, control, &interval, dt, states[r]);
+    });
+}
+
+void Simulator::simulateBatch(
+    const utils::Matrix& x0,
+    const std::vector<ControlFunction>& controls,
+    double dt,
+    std::vector<utils::Matrix>& states)
+{
+    utils::Error::check(static_cast<size_t>(x0.cols()) == controls.size()
+                        && controls.size() == states.size(),
+                        "There must be one initial state, one control function and one output per rollout");
+    for (size_t r=0; r<controls.size(); ++r) {
+        checkDimensions(x0.col(r), dt, states[r]);
+    }
+
+    run(controls.size(), [&](Workspace& ws, size_t r) {
+        ws.x = x0.col(r);
+        rollout(ws, controls[r], nullptr, dt, states[r]);
+    });
+}
+
+void Simulator::dynamics(
+    Workspace& ws,
+    const utils::Vector& x,
+    const utils::Vector& u,
+    utils::Vector& xDot)
+{
+    Model& model(*ws.model);
+    size_t nbQ(model.nbQ());
+    size_t nbQdot(model.nbQdot());
+    size_t nbTau(model.nbGeneralizedTorque());
+
+    *ws.Q = x.segment(0, nbQ);
+    *ws.QDot = x.segment(nbQ, nbQdot);
+    *ws.Tau = u.segment(0, nbTau);
+
+#ifdef MODULE_MUSCLES
+    if (m_nbActivations) {
+        size_t idxActivation(activationsIndex());
+        for (size_t m=0; m<m_nbActivations; ++m) {
+            internal_forces::muscles::State& state(*ws.muscleStates[m]);
+            state.setExcitation(u[nbTau + m], true);
+            state.setActivation(x[idxActivation + m], true);
+            xDot[idxActivation + m] = ws.muscles[m]->activationDot(state, true);
+        }
+
+        // The fatigue states must be set before the forces, which depend on the active fibers
+        size_t idxFatigue(fatigueStatesIndex());
+        for (size_t f=0; f<ws.fatigueModels.size(); ++f) {
+            internal_forces::muscles::FatigueModel& fatigueModel(*ws.fatigueModels[f]);
+            // The stages of the integrators may slightly overshoot the bounds of the fibers
+            fatigueModel.fatigueState().setState(
+                x[idxFatigue], std::min(std::max(x[idxFatigue + 1], 0.), 1.), x[idxFatigue + 2], true);
+            fatigueModel.computeTimeDerivativeState(
+                static_cast<const internal_forces::muscles::StateDynamics&>(
+                    *ws.muscleStates[ws.fatigueMuscles[f]]));
+            const internal_forces::muscles::FatigueDynamicState& fatigue(
+                static_cast<const internal_forces::muscles::FatigueDynamicState&>(
+                    fatigueModel.fatigueState()));
+            xDot[idxFatigue++] = fatigue.activeFibersDot();
+            xDot[idxFatigue++] = fatigue.fatiguedFibersDot();
+            xDot[idxFatigue++] = fatigue.restingFibersDot();
+        }
+
+        *ws.Tau += model.muscularJointTorque(ws.muscleStates, *ws.Q, *ws.QDot);
+    }
+#endif
+
+    if (model.nbQuat()) {
+        xDot.segment(0, nbQ) = model.computeQdot(*ws.Q, *ws.QDot);
+    } else {
+        xDot.segment(0, nbQ) = *ws.QDot;
+    }
+    xDot.segment(nbQ, nbQdot) = forwardDynamics(ws);
+}
+
+rigidbody::GeneralizedAcceleration Simulator::forwardDynamics(
+    Workspace& ws)
+{
+    return ws.model->ForwardDynamics(*ws.Q, *ws.QDot, *ws.Tau);
+}
+
+void Simulator::derivative(
+    Workspace& ws,
+    double t,
+    const utils::Vector& x,
+    const ControlFunction& control,
+    utils::Vector& xDot)
+{
+    control(t, x, ws.u);
+    if (static_cast<size_t>(ws.u.size()) != nbControls()) {
+        utils::Error::raise("The control function must give nbControls elements");
+    }
+    dynamics(ws, x, ws.u, xDot);
+}
+
+void Simulator::integrateInterval(
+    Workspace& ws,
+    double t0,
+    double dt,
+    const ControlFunction& control)
+{
+    if (m_integrator == INTEGRATOR_RK45) {
+        integrateRK45(ws, t0, dt, control);
+        return;
+    }
+
+    double h(dt / static_cast<double>(m_nbSteps));
+    for (size_t s=0; s<m_nbSteps; ++s) {
+        double t(t0 + static_cast<double>(s) * h);
+        if (m_integrator == INTEGRATOR_SEMI_IMPLICIT_EULER) {
+            stepSemiImplicitEuler(ws, t, h, control);
+        } else {
+            stepRK4(ws, t, h, control);
+        }
+    }
+}
+
+void Simulator::stepSemiImplicitEuler(
+    Workspace& ws,
+    double t,
+    double h,
+    const ControlFunction& control)
+{
+    size_t nbQ(ws.model->nbQ());
+    size_t nbQdot(ws.model->nbQdot());
+    utils::Vector& xDot(ws.k[0]);
+    derivative(ws, t, ws.x, control, xDot);
+
+    // The velocities (and the muscle states) are updated first, the positions then move
+    // with the updated velocities
+    ws.xStage = ws.x;
+    ws.x.tail(ws.x.size() - nbQ) += h * xDot.tail(xDot.size() - nbQ);
+    if (ws.model->nbQuat()) {
+        *ws.Q = ws.xStage.segment(0, nbQ);
+        *ws.QDot = ws.x.segment(nbQ, nbQdot);
+        ws.x.segment(0, nbQ) += h * ws.model->computeQdot(*ws.Q, *ws.QDot);
+    } else {
+        ws.x.segment(0, nbQ) += h * ws.x.segment(nbQ, nbQdot);
+    }
+}
+
+void Simulator::stepRK4(
+    Workspace& ws,
+    double t,
+    double h,
+    const ControlFunction& control)
+{
+    derivative(ws, t, ws.x, control, ws.k[0]);
+    ws.xStage = ws.x + 0.5 * h * ws.k[0];
+    derivative(ws, t + 0.5 * h, ws.xStage, control, ws.k[1]);
+    ws.xStage = ws.x + 0.5 * h * ws.k[1];
+    derivative(ws, t + 0.5 * h, ws.xStage, control, ws.k[2]);
+    ws.xStage = ws.x + h * ws.k[2];
+    derivative(ws, t + h, ws.xStage, control, ws.k[3]);
+    ws.x += h / 6. * (ws.k[0] + 2. * ws.k[1] + 2. * ws.k[2] + ws.k[3]);
+}
+
+void Simulator::integrateRK45(
+    Workspace& ws,
+    double t0,
+    double dt,
+    const ControlFunction& control)
+{
+    double t(t0);
+    double tEnd(t0 + dt);
+    double h(ws.h > 0 && ws.h < dt ? ws.h : dt);
+    double minStep(1e-12 * dt);
+
+    // The controls may change between intervals, so the first stage is always evaluated
+    derivative(ws, t, ws.x, control, ws.k[0]);
+    for (size_t nbSteps=0; t < tEnd; ++nbSteps) {
+        if (nbSteps >= maxNbAdaptiveSteps) {
+            utils::Error::raise("The adaptive integrator exceeded the maximal number of steps of an interval");
+        }
+        bool isLastStep(h >= tEnd - t);
+        double step(isLastStep ? tEnd - t : h);
+
+        for (size_t s=1; s<7; ++s) {
+            utils::Vector& xStage(s == 6 ? ws.xNext : ws.xStage);
+            xStage = ws.x;
+            for (size_t j=0; j<s; ++j) {
+                if (dpA[s][j] != 0.) {
+                    xStage += step * dpA[s][j] * ws.k[j];
+                }
+            }
+            derivative(ws, t + dpC[s] * step, xStage, control, ws.k[s]);
+        }
+
+        // Scaled root mean square of the local error
+        double error(0);
+        for (Eigen::Index i=0; i<ws.x.size(); ++i) {
+            double e(0);
+            for (size_t j=0; j<7; ++j) {
+                e += dpE[j] * ws.k[j][i];
+            }
+            double scale(m_absoluteTolerance + m_relativeTolerance
+                         * std::max(std::fabs(ws.x[i]), std::fabs(ws.xNext[i])));
+            error += (step * e / scale) * (step * e / scale);
+        }
+        error = std::sqrt(error / static_cast<double>(std::max(ws.x.size(), static_cast<Eigen::Index>(1))));
+
+        double factor(error == 0. ? 5. : std::min(5., std::max(0.2, 0.9 * std::pow(error, -0.2))));
+        if (error <= 1.) {
+            t = isLastStep ? tEnd : t + step;
+            ws.x.swap(ws.xNext);
+            ws.k[0].swap(ws.k[6]);
+            // A step shortened to reach the end of the interval says nothing of the next step
+            if (!isLastStep || step >= h) {
+                h = step * factor;
+            }
+        } else {
+            h = step * std::min(factor, 1.);
+            if (h < minStep) {
+                utils::Error::raise("The step of the adaptive integrator became too small");
+            }
+        }
+    }
+    ws.h = h;
+}
+
+void Simulator::rollout(
+    Workspace& ws,
+    const ControlFunction& control,
+    size_t* currentInterval,
+    double dt,
+    utils::Matrix& states)
+{
+    ws.h = 0;
+    states.col(0) = ws.x;
+    for (size_t i=0; i<static_cast<size_t>(states.cols()) - 1; ++i) {
+        if (currentInterval) {
+            *currentInterval = i;
+        }
+        integrateInterval(ws, static_cast<double>(i) * dt, dt, control);
+        states.col(i + 1) = ws.x;
+    }
+}
+
+void Simulator::checkDimensions(
+    const utils::Vector& x0,
+    double dt,
+    const utils::Matrix& states) const
+{
+    utils::Error::check(static_cast<size_t>(x0.size()) == nbStates(),
+                        "The initial state must have nbStates elements");
+    utils::Error::check(dt > 0, "The duration of an interval must be positive");
+    utils::Error::check(static_cast<size_t>(states.rows()) == nbStates() && states.cols() >= 1,
+                        "The states must be preallocated to nbStates x nbIntervals + 1");
+}
+
+void Simulator::run(
+    size_t nbRollouts,
+    const std::function<void(Workspace&, size_t)>& job)
+{
+    std::atomic<size_t> nextRollout(0);
+    std::mutex mutex;
+    std::exception_ptr error;
+    auto work = [&](size_t idx) {
+        for (size_t r = nextRollout++; r < nbRollouts; r = nextRollout++) {
+            try {
+                job(m_workspaces[idx], r);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                nextRollout = nbRollouts;
+            }
+        }
+    };
+
+    // The caller works as the first thread
+    size_t nbWorkers(std::min(m_workspaces.size(), nbRollouts));
+    std::vector<std::thread> threads;
+    for (size_t i=1; i<nbWorkers; ++i) {
+        threads.push_back(std::thread(work, i));
+    }
+    if (nbWorkers) {
+        work(0);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif
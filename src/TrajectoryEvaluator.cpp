@@ -0,0 +1,262 @@
+#define BIORBD_API_EXPORTS
+#include "TrajectoryEvaluator.h"
+
+#ifndef BIORBD_USE_CASADI_MATH
+#include <algorithm>
+
+#include "BiorbdModel.h"
+#include "Utils/Error.h"
+#include "Utils/Matrix.h"
+#include "RigidBody/ExternalForceSet.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+#include "RigidBody/GeneralizedAcceleration.h"
+#include "RigidBody/GeneralizedTorque.h"
+
+using namespace BIORBD_NAMESPACE;
+
+TrajectoryEvaluator::Workspace::Workspace(
+    const Model& model) :
+    model(std::make_shared<Model>(model.workspace())),
+    Q(std::make_shared<rigidbody::GeneralizedCoordinates>(model)),
+    QDot(std::make_shared<rigidbody::GeneralizedVelocity>(model)),
+    QDDot(std::make_shared<rigidbody::GeneralizedAcceleration>(model)),
+    Tau(std::make_shared<rigidbody::GeneralizedTorque>(model)),
+    noExternalForces(std::make_shared<rigidbody::ExternalForceSet>(*this->model)),
+    externalForces(std::make_shared<rigidbody::ExternalForceSet>(*this->model))
+{
+
+}
+
+TrajectoryEvaluator::TrajectoryEvaluator(
+    const Model& model,
+    size_t nbThreads) :
+    m_model(model),
+    m_job(nullptr),
+    m_nbFrames(0),
+    m_nextFrame(0),
+    m_generation(0),
+    m_nbRunning(0),
+    m_stop(false)
+{
+    if (nbThreads == 0) {
+        nbThreads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                             static_cast<size_t>(1));
+    }
+    for (size_t i=0; i<nbThreads; ++i) {
+        m_workspaces.push_back(Workspace(model));
+    }
+
+    // With only one thread, the frames are evaluated by the caller
+    if (nbThreads > 1) {
+        for (size_t i=0; i<nbThreads; ++i) {
+            m_threads.push_back(std::thread(&TrajectoryEvaluator::work, this, i));
+        }
+    }
+}
+
+TrajectoryEvaluator::~TrajectoryEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobReady.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+size_t TrajectoryEvaluator::nbThreads() const
+{
+    return m_workspaces.size();
+}
+
+void TrajectoryEvaluator::InverseDynamics(
+    const utils::Matrix& Q,
+    const utils::Matrix& QDot,
+    const utils::Matrix& QDDot,
+    utils::Matrix& Tau)
+{
+    checkDimensions(Q, &QDot, &QDDot, nullptr, Tau);
+    run(static_cast<size_t>(Q.cols()), [&](Workspace& ws, size_t f) {
+        *ws.Q = Q.col(f);
+        *ws.QDot = QDot.col(f);
+        *ws.QDDot = QDDot.col(f);
+        ws.model->InverseDynamics(*ws.Q, *ws.QDot, *ws.QDDot, *ws.noExternalForces, *ws.Tau);
+        Tau.col(f) = *ws.Tau;
+    });
+}
+
+void TrajectoryEvaluator::InverseDynamics(
+    const utils::Matrix& Q,
+    const utils::Matrix& QDot,
+    const utils::Matrix& QDDot,
+    const std::vector<rigidbody::ExternalForceSet>& externalForces,
+    utils::Matrix& Tau)
+{
+    checkDimensions(Q, &QDot, &QDDot, &externalForces, Tau);
+    run(static_cast<size_t>(Q.cols()), [&](Workspace& ws, size_t f) {
+        *ws.Q = Q.col(f);
+        *ws.QDot = QDot.col(f);
+        *ws.QDDot = QDDot.col(f);
+        ws.externalForces->setForces(externalForces[f]);
+        ws.model->InverseDynamics(*ws.Q, *ws.QDot, *ws.QDDot, *ws.externalForces, *ws.Tau);
+        Tau.col(f) = *ws.Tau;
+    });
+}
+
+void TrajectoryEvaluator::NonLinearEffect(
+    const utils::Matrix& Q,
+    const utils::Matrix& QDot,
+    utils::Matrix& Tau)
+{
+    checkDimensions(Q, &QDot, nullptr, nullptr, Tau);
+    run(static_cast<size_t>(Q.cols()), [&](Workspace& ws, size_t f) {
+        *ws.Q = Q.col(f);
+        *ws.QDot = QDot.col(f);
+        ws.model->NonLinearEffect(*ws.Q, *ws.QDot, *ws.noExternalForces, *ws.Tau);
+        Tau.col(f) = *ws.Tau;
+    });
+}
+
+void TrajectoryEvaluator::NonLinearEffect(
+    const utils::Matrix& Q,
+    const utils::Matrix& QDot,
+    const std::vector<rigidbody::ExternalForceSet>& externalForces,
+    utils::Matrix& Tau)
+{
+    checkDimensions(Q, &QDot, nullptr, &externalForces, Tau);
+    run(static_cast<size_t>(Q.cols()), [&](Workspace& ws, size_t f) {
+        *ws.Q = Q.col(f);
+        *ws.QDot = QDot.col(f);
+        ws.externalForces->setForces(externalForces[f]);
+        ws.model->NonLinearEffect(*ws.Q, *ws.QDot, *ws.externalForces, *ws.Tau);
+        Tau.col(f) = *ws.Tau;
+    });
+}
+
+void TrajectoryEvaluator::massMatrix(
+    const utils::Matrix& Q,
+    std::vector<utils::Matrix>& massMatrices)
+{
+    utils::Error::check(static_cast<size_t>(Q.rows()) == m_model.nbQ(),
+                        "Q must have nbQ rows");
+    utils::Error::check(massMatrices.size() == static_cast<size_t>(Q.cols()),
+                        "There must be one mass matrix per frame");
+    for (const auto& massMatrix : massMatrices) {
+        utils::Error::check(
+            static_cast<size_t>(massMatrix.rows()) == m_model.nbQdot()
+            && static_cast<size_t>(massMatrix.cols()) == m_model.nbQdot(),
+            "The mass matrices must be preallocated to nbQdot x nbQdot");
+    }
+    run(static_cast<size_t>(Q.cols()), [&](Workspace& ws, size_t f) {
+        *ws.Q = Q.col(f);
+        ws.model->massMatrix(*ws.Q, massMatrices[f]);
+    });
+}
+
+void TrajectoryEvaluator::checkDimensions(
+    const utils::Matrix& Q,
+    const utils::Matrix* QDot,
+    const utils::Matrix* QDDot,
+    const std::vector<rigidbody::ExternalForceSet>* externalForces,
+    const utils::Matrix& Tau) const
+{
+    utils::Error::check(static_cast<size_t>(Q.rows()) == m_model.nbQ(),
+                        "Q must have nbQ rows");
+    if (QDot) {
+        utils::Error::check(static_cast<size_t>(QDot->rows()) == m_model.nbQdot()
+                            && QDot->cols() == Q.cols(),
+                            "QDot must have nbQdot rows and the same number of frames as Q");
+    }
+    if (QDDot) {
+        utils::Error::check(static_cast<size_t>(QDDot->rows()) == m_model.nbQddot()
+                            && QDDot->cols() == Q.cols(),
+                            "QDDot must have nbQddot rows and the same number of frames as Q");
+    }
+    if (externalForces) {
+        utils::Error::check(externalForces->size() == static_cast<size_t>(Q.cols()),
+                            "There must be one ExternalForceSet per frame");
+    }
+    utils::Error::check(static_cast<size_t>(Tau.rows()) == m_model.nbGeneralizedTorque()
+                        && Tau.cols() == Q.cols(),
+                        "Tau must be preallocated to nbGeneralizedTorque x nbFrames");
+}
+
+void TrajectoryEvaluator::run(
+    size_t nbFrames,
+    const std::function<void(Workspace&, size_t)>& job)
+{
+    if (nbFrames == 0) {
+        return;
+    }
+    if (m_threads.empty()) {
+        for (size_t f=0; f<nbFrames; ++f) {
+            job(m_workspaces[0], f);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job = &job;
+    m_nbFrames = nbFrames;
+    m_nextFrame = 0;
+    m_error = nullptr;
+    m_nbRunning = m_threads.size();
+    ++m_generation;
+    m_jobReady.notify_all();
+    m_jobDone.wait(lock, [this]() {
+        return m_nbRunning == 0;
+    });
+    m_job = nullptr;
+
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void TrajectoryEvaluator::work(
+    size_t idx)
+{
+    size_t generation(0);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobReady.wait(lock, [&]() {
+                return m_stop || m_generation != generation;
+            });
+            if (m_stop) {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        processFrames(idx);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_nbRunning == 0) {
+                m_jobDone.notify_one();
+            }
+        }
+    }
+}
+
+void TrajectoryEvaluator::processFrames(
+    size_t idx)
+{
+    for (size_t f = m_nextFrame++; f < m_nbFrames; f = m_nextFrame++) {
+        try {
+            (*m_job)(m_workspaces[idx], f);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+            m_nextFrame = m_nbFrames;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <gtest/gtest.h>
+
+#include "BiorbdModel.h"
+#include "biorbdConfig.h"
+#include "Utils/Matrix.h"
+#include "Utils/Matrix3d.h"
+#include "Utils/Point3d.h"
+#include "Utils/Rotation.h"
+#include "Utils/RotoTrans.h"
+#include "Utils/SpatialVector.h"
+#include "Utils/Vector3d.h"
+
+#include "RigidBody/ExternalForceSet.h"
+#include "RigidBody/GeneralizedCoordinates.h"
+#include "RigidBody/GeneralizedVelocity.h"
+#include "RigidBody/GeneralizedAcceleration.h"
+#include "RigidBody/GeneralizedTorque.h"
+#include "RigidBody/SegmentCharacteristics.h"
+
+using namespace BIORBD_NAMESPACE;
+
+// These tests replace the global operator new of their own executable, so they do not
+// interfere with the other tests
+
+static std::string modelPathForAllocations("models/pyomecaman.bioMod");
+
+// Count the allocations made through operator new (strings, shared_ptr, std containers)
+static std::atomic<bool> countAllocations(false);
+static std::atomic<size_t> nbAllocations(0);
+void* operator new(std::size_t size)
+{
+    if (countAllocations) {
+        ++nbAllocations;
+    }
+    void* ptr(std::malloc(size ? size : 1));
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+///
+/// \brief Count the allocations made during its lifetime
+///
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+        nbAllocations = 0;
+        countAllocations = true;
+    }
+    ~AllocationCounter()
+    {
+        countAllocations = false;
+    }
+    size_t stop()
+    {
+        countAllocations = false;
+        return nbAllocations.load();
+    }
+};
+
+TEST(Allocations, massMatrixInverse)
+{
+    // A free floating root (xyz/xyz) carrying two branches, one of which is an Euler sequence
+    Model model;
+    rigidbody::SegmentCharacteristics characteristics(
+        5, utils::Vector3d(0.1, 0.05, -0.2), utils::Matrix3d(0.1, 0, 0, 0, 0.2, 0, 0, 0, 0.3));
+    utils::RotoTrans offset(utils::Rotation(), utils::Vector3d(0.1, 0.2, -0.3));
+    model.AddSegment("Root", "root", "xyz", "xyz", {}, {}, {}, characteristics, utils::RotoTrans());
+    model.AddSegment("Arm", "Root", "", "x", {}, {}, {}, characteristics, offset);
+    model.AddSegment("Leg", "Root", "", "zyx", {}, {}, {}, characteristics, offset);
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i) - 0.4;
+    }
+
+    // Once the output and the workspace are allocated, nothing else is
+    utils::Matrix Minv;
+    model.massMatrixInverse(Q, Minv);
+    AllocationCounter counter;
+    model.massMatrixInverse(Q, Minv);
+    EXPECT_EQ(counter.stop(), 0u);
+}
+
+TEST(Allocations, markersPreallocatedOutputs)
+{
+    Model model(modelPathForAllocations);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    rigidbody::GeneralizedAcceleration Qddot(model);
+    Q.setZero();
+    Qdot.setZero();
+    Qddot.setZero();
+
+    // The first call sizes the outputs
+    std::vector<utils::Point3d> markers, technical, velocities, accelerations, coms;
+    std::vector<utils::RotoTrans> jcs;
+    std::vector<std::vector<utils::Point3d>> meshes;
+    model.markers(Q, markers);
+    model.technicalMarkers(Q, technical);
+    model.markersVelocity(Q, Qdot, velocities);
+    model.markerAcceleration(Q, Qdot, Qddot, accelerations);
+    model.CoMbySegment(Q, coms);
+    model.allGlobalJCS(Q, jcs);
+    model.meshPoints(Q, meshes);
+
+    // Then the frames are evaluated without allocating
+    AllocationCounter counter;
+    for (unsigned int f=0; f<10; ++f) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = 0.1 * static_cast<double>(f + i);
+            Qdot[i] = 0.2 * static_cast<double>(f) - 0.1 * static_cast<double>(i);
+            Qddot[i] = 0.3 * static_cast<double>(i) - 0.05 * static_cast<double>(f);
+        }
+        model.markers(Q, markers);
+        model.technicalMarkers(Q, technical, true, false);
+        model.markersVelocity(Q, Qdot, velocities);
+        model.markerAcceleration(Q, Qdot, Qddot, accelerations);
+        model.CoMbySegment(Q, coms);
+        model.allGlobalJCS(Q, jcs);
+        model.meshPoints(Q, meshes);
+    }
+    EXPECT_EQ(counter.stop(), 0u);
+}
+
+TEST(Allocations, externalForceSetInPlace)
+{
+    Model model(modelPathForAllocations);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedAcceleration QDDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    Q.setZero();
+    QDot.setZero();
+    QDDot.setZero();
+
+    // The set is bound to the model once and the feet are resolved once
+    rigidbody::ExternalForceSet forcePlates(model);
+    size_t right(forcePlates.bodyIndex("PiedD"));
+    size_t left(forcePlates.bodyIndex("PiedG"));
+    forcePlates.addToBody(right, utils::SpatialVector(0., 0., 0., 0., 0., 1.));
+    model.InverseDynamics(Q, QDot, QDDot, forcePlates, Tau);
+
+    for (unsigned int f=0; f<10; ++f) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = 0.1 * static_cast<double>(f + i);
+            QDot[i] = 0.2 * static_cast<double>(f) - 0.1 * static_cast<double>(i);
+            QDDot[i] = 0.3 * static_cast<double>(i) - 0.05 * static_cast<double>(f);
+        }
+        double t(static_cast<double>(f));
+        utils::SpatialVector grfRight(0.1 * t, -0.2, 0.3, 10. * t, -20., 700. + t);
+        utils::SpatialVector grfLeft(-0.1, 0.2 * t, 0., -5., 15. * t, 650. - t);
+        utils::Vector3d copRight(0.1 + 0.01 * t, -0.1, 0.);
+        utils::Vector3d copLeft(-0.1, 0.2 - 0.02 * t, 0.);
+
+        // Each frame of the force plates is applied without allocating
+        AllocationCounter counter;
+        forcePlates.setZero();
+        forcePlates.addToBody(right, grfRight, copRight);
+        forcePlates.addToBody(left, grfLeft, copLeft);
+        model.InverseDynamics(Q, QDot, QDDot, forcePlates, Tau);
+        EXPECT_EQ(counter.stop(), 0u);
+    }
+}
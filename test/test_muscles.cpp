@@ -1,8 +1,10 @@
 #include <iostream>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include <rbdl/Dynamics.h>
 #include "BiorbdModel.h"
+#include "Simulator.h"
 #include "biorbdConfig.h"
 #include "Utils/Matrix.h"
 #include "RigidBody/GeneralizedCoordinates.h"
@@ -2570,6 +2572,15 @@ TEST(Muscles, errors)
 
     EXPECT_THROW(muscles.muscleGroup(1), std::runtime_error);
     EXPECT_THROW(muscles.muscleGroup("nameNoExists"), std::runtime_error);
+
+    // A point attached to a segment which does not exist
+    internal_forces::muscles::MuscleGeometry geometry(
+        utils::Vector3d(0, 0, 0, "origin", "segmentNoExists"),
+        utils::Vector3d(0, 0, 1, "insertion", "segmentNoExists"));
+    rigidbody::GeneralizedCoordinates Q(model);
+    Q.setZero();
+    EXPECT_THROW(geometry.updateKinematics(model, model.muscle(0).characteristics(), &Q),
+                 std::runtime_error);
 }
 
 TEST(Muscles, deepCopy)
@@ -2598,6 +2609,108 @@ TEST(Muscles, deepCopy)
     EXPECT_STREQ(deepCopyLater.muscleGroup(0).name().c_str(), "newMuscleGroupName");
 }
 
+TEST(Muscles, muscleTable)
+{
+    Model model(modelPathForMuscleForce);
+    size_t nbMuscles(model.nbMuscles());
+    std::vector<utils::String> names(model.muscleNames());
+    ASSERT_EQ(names.size(), nbMuscles);
+    for (size_t i=0; i<nbMuscles; ++i) {
+        internal_forces::muscles::MuscleGroup& group(model.muscleGroup(model.muscleGroupIndex(i)));
+        EXPECT_STREQ(model.muscle(i).name().c_str(), names[i].c_str());
+        EXPECT_NE(group.muscleID(names[i]), -1);
+        EXPECT_EQ(model.stateSet()[i].get(), &model.muscles()[i]->state());
+    }
+    EXPECT_THROW(model.muscle(nbMuscles), std::runtime_error);
+
+    // A muscle added to a group (even through a copy of the group) is indexed in the order of the groups
+    internal_forces::muscles::MuscleGroup group(model.muscleGroup(0));
+    group.addMuscle("newIdealizedActuator",
+                    internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR,
+                    group.muscle(0).position(),
+                    group.muscle(0).characteristics(),
+                    internal_forces::muscles::STATE_FATIGUE_TYPE::SIMPLE_STATE_FATIGUE);
+    size_t nbMusclesGroup0(model.muscleGroup(0).nbMuscles());
+    EXPECT_EQ(model.nbMuscles(), nbMuscles + 1);
+    EXPECT_EQ(model.stateSet().size(), nbMuscles + 1);
+    EXPECT_STREQ(model.muscle(nbMusclesGroup0 - 1).name().c_str(), "newIdealizedActuator");
+    EXPECT_EQ(model.muscleGroupIndex(nbMusclesGroup0 - 1), 0);
+    EXPECT_STREQ(model.muscle(nbMusclesGroup0).name().c_str(), names[nbMusclesGroup0 - 1].c_str());
+
+    // A deep copy indexes its own muscles
+    internal_forces::muscles::Muscles copy(
+        static_cast<internal_forces::muscles::Muscles&>(model).DeepCopy());
+    copy.muscleGroup(0).addMuscle("otherIdealizedActuator",
+                                  internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR,
+                                  group.muscle(0).position(),
+                                  group.muscle(0).characteristics(),
+                                  internal_forces::muscles::STATE_FATIGUE_TYPE::SIMPLE_STATE_FATIGUE);
+    EXPECT_EQ(copy.nbMuscles(), nbMuscles + 2);
+    EXPECT_EQ(model.nbMuscles(), nbMuscles + 1);
+    EXPECT_NE(&copy.muscle(0), &model.muscle(0));
+}
+
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Muscles, surrogates)
+{
+    Model model(modelPathForMuscleForce);
+    EXPECT_THROW(model.useMuscleSurrogates(true), std::runtime_error);
+    model.fitMuscleSurrogates(8);
+
+    for (size_t i=0; i<model.nbMuscles(); ++i) {
+        const internal_forces::muscles::MuscleSurrogate& surrogate(model.muscleSurrogate(i));
+        EXPECT_TRUE(surrogate.isFitted());
+        EXPECT_EQ(surrogate.degree(), 8u);
+        EXPECT_GT(surrogate.dofs().size(), 0u);
+        EXPECT_LT(surrogate.maxError(), 1e-2);
+        EXPECT_LE(surrogate.rmsError(), surrogate.maxError());
+    }
+
+    // The surrogates stay within their error bounds away from the samples of the fit
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    std::vector<utils::Scalar> lengths(model.nbMuscles());
+    std::vector<utils::Matrix> jacobians(model.nbMuscles());
+    for (unsigned int k=0; k<5; ++k) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = -2.5 + 1.1 * k + 0.3 * i;
+            QDot[i] = 0.5 - 0.2 * i;
+        }
+
+        model.useMuscleSurrogates(false);
+        model.updateMuscles(Q, QDot, true);
+        for (size_t i=0; i<model.nbMuscles(); ++i) {
+            lengths[i] = model.muscle(i).position().musculoTendonLength();
+            jacobians[i] = model.muscle(i).position().jacobianLength();
+        }
+
+        model.useMuscleSurrogates(true);
+        EXPECT_TRUE(model.isUsingMuscleSurrogates());
+        model.updateMuscles(Q, QDot, true);
+        for (size_t i=0; i<model.nbMuscles(); ++i) {
+            const internal_forces::muscles::MuscleSurrogate& surrogate(model.muscleSurrogate(i));
+            const internal_forces::muscles::MuscleGeometry& position(model.muscle(i).position());
+            EXPECT_NEAR(position.musculoTendonLength(), lengths[i], 2 * surrogate.maxError() + 1e-10);
+            for (unsigned int j=0; j<model.nbQ(); ++j) {
+                EXPECT_NEAR(position.jacobianLength()(0, j), jacobians[i](0, j),
+                            2 * surrogate.maxJacobianError() + 1e-10);
+            }
+            EXPECT_NEAR(position.velocity(), (position.jacobianLength() * QDot)[0], requiredPrecision);
+        }
+    }
+
+    // The surrogates are shared by the shallow copies and copied by the deep copies
+    Model shallowCopy(model);
+    EXPECT_TRUE(shallowCopy.isUsingMuscleSurrogates());
+    EXPECT_EQ(&shallowCopy.muscleSurrogate(0), &model.muscleSurrogate(0));
+    internal_forces::muscles::Muscles deepCopy(
+        static_cast<internal_forces::muscles::Muscles&>(model).DeepCopy());
+    EXPECT_TRUE(deepCopy.isUsingMuscleSurrogates());
+    EXPECT_NE(&deepCopy.muscleSurrogate(0), &model.muscleSurrogate(0));
+    EXPECT_EQ(deepCopy.muscleSurrogate(0).coefficients(), model.muscleSurrogate(0).coefficients());
+}
+#endif
+
 TEST(WrappingHalfCylinder, unitTest)
 {
     {
@@ -2798,6 +2911,243 @@ TEST(MuscleForce, torqueFromMuscles)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(MuscleForce, concurrentWorkspaces)
+{
+    Model model(modelPathForMuscleForce);
+    const size_t nbThreads(16);
+    const size_t nbFrames(8);
+    const size_t nbRepetitions(20);
+
+    // Serial reference on the model itself
+    std::vector<rigidbody::GeneralizedCoordinates> Qs;
+    std::vector<utils::Vector> forcesExpected;
+    std::vector<rigidbody::GeneralizedAcceleration> qddotExpected;
+    for (size_t f=0; f<nbFrames; ++f) {
+        rigidbody::GeneralizedCoordinates Q(model);
+        rigidbody::GeneralizedVelocity QDot(model);
+        Q = Q.setOnes() * (static_cast<double>(f) + 1) / 10;
+        QDot = QDot.setOnes() / 10;
+        std::vector<std::shared_ptr<internal_forces::muscles::State>> states;
+        for (size_t i=0; i<model.nbMuscleTotal(); ++i) {
+            states.push_back(std::make_shared<internal_forces::muscles::StateDynamics>(0, 0.2));
+        }
+        model.updateMuscles(Q, QDot, true);
+        forcesExpected.push_back(model.muscleForces(states));
+        rigidbody::GeneralizedTorque Tau(model.muscularJointTorque(states));
+        qddotExpected.push_back(model.ForwardDynamics(Q, QDot, Tau));
+        Qs.push_back(Q);
+    }
+
+    // Every thread owns a workspace and goes through the frames in a different order
+    std::vector<Model> workspaces;
+    for (size_t t=0; t<nbThreads; ++t) {
+        workspaces.push_back(model.workspace());
+    }
+    std::vector<std::vector<utils::Vector>> forces(nbThreads,
+            std::vector<utils::Vector>(nbFrames));
+    std::vector<std::vector<rigidbody::GeneralizedAcceleration>> qddot(nbThreads,
+            std::vector<rigidbody::GeneralizedAcceleration>(nbFrames));
+    std::vector<std::thread> threads;
+    for (size_t t=0; t<nbThreads; ++t) {
+        threads.push_back(std::thread([&, t]() {
+            Model& ws(workspaces[t]);
+            std::vector<std::shared_ptr<internal_forces::muscles::State>> states;
+            for (size_t i=0; i<ws.nbMuscleTotal(); ++i) {
+                states.push_back(std::make_shared<internal_forces::muscles::StateDynamics>(0, 0.2));
+            }
+            rigidbody::GeneralizedVelocity QDot(ws);
+            QDot = QDot.setOnes() / 10;
+            for (size_t r=0; r<nbRepetitions; ++r) {
+                for (size_t k=0; k<nbFrames; ++k) {
+                    size_t f((k + t) % nbFrames);
+                    ws.updateMuscles(Qs[f], QDot, true);
+                    forces[t][f] = ws.muscleForces(states);
+                    rigidbody::GeneralizedTorque Tau(ws.muscularJointTorque(states));
+                    qddot[t][f] = ws.ForwardDynamics(Qs[f], QDot, Tau);
+                }
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t t=0; t<nbThreads; ++t) {
+        for (size_t f=0; f<nbFrames; ++f) {
+            for (unsigned int i=0; i<model.nbMuscleTotal(); ++i) {
+                EXPECT_NEAR(forces[t][f](i), forcesExpected[f](i), requiredPrecision);
+            }
+            for (unsigned int i=0; i<model.nbQddot(); ++i) {
+                EXPECT_NEAR(qddot[t][f](i), qddotExpected[f](i), requiredPrecision);
+            }
+        }
+    }
+}
+
+TEST(MuscleForce, workspaceSharesDescription)
+{
+    Model model(modelPathForMuscleForce);
+    Model ws(model.workspace());
+    ASSERT_EQ(ws.nbMuscleTotal(), model.nbMuscleTotal());
+
+    // The characteristics are shared, the states and the paths are not
+    for (size_t i=0; i<model.nbMuscleTotal(); ++i) {
+        const internal_forces::muscles::Muscle& muscle(model.muscle(i));
+        const internal_forces::muscles::Muscle& muscleWs(ws.muscle(i));
+        EXPECT_EQ(&muscleWs.characteristics(), &muscle.characteristics());
+        EXPECT_NE(&muscleWs.state(), &muscle.state());
+        EXPECT_NE(&muscleWs.position(), &muscle.position());
+    }
+
+    // Updating the workspace leaves the model untouched
+    rigidbody::GeneralizedCoordinates Q(model);
+    Q.setZero();
+    model.updateMuscles(Q, true);
+    utils::Scalar length(model.muscle(0).position().musculoTendonLength());
+    Q.setOnes();
+    ws.updateMuscles(Q, true);
+    SCALAR_TO_DOUBLE(lengthModel, model.muscle(0).position().musculoTendonLength());
+    SCALAR_TO_DOUBLE(lengthExpected, length);
+    EXPECT_NEAR(lengthModel, lengthExpected, requiredPrecision);
+}
+
+TEST(MuscleForce, batchedEngine)
+{
+    Model model(modelPathForMuscleForce);
+
+    // Add a muscle of each type, so every formulation and variant is batched
+    internal_forces::muscles::MuscleGroup& group(model.muscleGroup(0));
+    internal_forces::muscles::MuscleGeometry geometry(group.muscle(0).position());
+    internal_forces::muscles::Characteristics characteristics(group.muscle(0).characteristics());
+    std::vector<internal_forces::muscles::MUSCLE_TYPE> types({
+        internal_forces::muscles::MUSCLE_TYPE::IDEALIZED_ACTUATOR,
+        internal_forces::muscles::MUSCLE_TYPE::HILL,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_ACTIVE,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_THELEN_FATIGABLE,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_ACTIVE,
+        internal_forces::muscles::MUSCLE_TYPE::HILL_DE_GROOTE_FATIGABLE
+    });
+    for (size_t i=0; i<types.size(); ++i) {
+        group.addMuscle("batched" + std::to_string(i), types[i], geometry, characteristics,
+                        internal_forces::muscles::STATE_TYPE::SIMPLE_STATE,
+                        internal_forces::muscles::STATE_FATIGUE_TYPE::SIMPLE_STATE_FATIGUE);
+    }
+    for (size_t j=0; j<group.nbMuscles(); ++j) {
+        internal_forces::muscles::FatigueModel* fatigue(
+            dynamic_cast<internal_forces::muscles::FatigueModel*>(&group.muscle(j)));
+        if (fatigue) {
+            fatigue->setFatigueState(0.7, 0.2, 0.1);
+        }
+    }
+
+    std::vector<std::shared_ptr<internal_forces::muscles::State>> states;
+    for (size_t i=0; i<model.nbMuscles(); ++i) {
+        states.push_back(std::make_shared<internal_forces::muscles::StateDynamics>(
+                             0, 0.1 + 0.8 * static_cast<double>(i) / static_cast<double>(model.nbMuscles())));
+    }
+
+    // Both signs of the velocity go through different branches of the curves
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    utils::Vector F;
+    for (double speed : {1.0, -1.0}) {
+        Q = Q.setOnes() / 10;
+        QDot = QDot.setOnes() * speed;
+        model.updateMuscles(Q, QDot, true);
+        model.muscleForces(states, F);
+        EXPECT_EQ(model.muscleForceEngine().nbBatchedMuscles(), model.nbMuscles() - 1);
+        ASSERT_EQ(static_cast<size_t>(F.size()), model.nbMuscles());
+
+        size_t k(0);
+        for (size_t g=0; g<model.nbMuscleGroups(); ++g) {
+            for (size_t j=0; j<model.muscleGroup(g).nbMuscles(); ++j, ++k) {
+                internal_forces::muscles::Muscle& muscle(model.muscleGroup(g).muscle(j));
+                EXPECT_NEAR(static_cast<internal_forces::Compound&>(muscle).force(), F[k], requiredPrecision);
+                EXPECT_NEAR(muscle.force(*states[k]), F[k], requiredPrecision);
+            }
+        }
+    }
+}
+
+TEST(MuscleForce, analyticalDerivatives)
+{
+    Model model(modelPathForMuscleForce);
+    size_t nbMuscles(model.nbMuscles());
+    std::vector<std::shared_ptr<internal_forces::muscles::State>> states;
+    for (size_t i=0; i<nbMuscles; ++i) {
+        states.push_back(std::make_shared<internal_forces::muscles::StateDynamics>(
+                             0, 0.2 + 0.6 * static_cast<double>(i) / static_cast<double>(nbMuscles)));
+    }
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    Q.setOnes();
+    QDot << 0.7, -0.4;
+    double h(1e-6);
+    double tolerance(1e-4);
+
+    // Activations
+    model.updateMuscles(Q, QDot, true);
+    utils::Matrix dTauActivation(model.muscularJointTorqueActivationJacobian(states));
+    EXPECT_EQ(dTauActivation.rows(), static_cast<Eigen::Index>(model.nbDof()));
+    EXPECT_EQ(dTauActivation.cols(), static_cast<Eigen::Index>(nbMuscles));
+    for (size_t j=0; j<nbMuscles; ++j) {
+        double activation(states[j]->activation());
+        states[j]->setActivation(activation + h);
+        rigidbody::GeneralizedTorque tauPlus(model.muscularJointTorque(states));
+        states[j]->setActivation(activation - h);
+        rigidbody::GeneralizedTorque tauMinus(model.muscularJointTorque(states));
+        states[j]->setActivation(activation);
+        for (unsigned int i=0; i<model.nbDof(); ++i) {
+            EXPECT_NEAR(dTauActivation(i, j), (tauPlus[i] - tauMinus[i]) / (2*h), tolerance);
+        }
+    }
+
+    // Generalized velocities (the muscle lengths jacobian does not depend on them)
+    utils::Matrix dTauQdot(model.muscularJointTorqueQdotJacobian(states));
+    for (unsigned int j=0; j<model.nbQdot(); ++j) {
+        rigidbody::GeneralizedVelocity QDotPlus(QDot);
+        rigidbody::GeneralizedVelocity QDotMinus(QDot);
+        QDotPlus[j] += h;
+        QDotMinus[j] -= h;
+        rigidbody::GeneralizedTorque tauPlus(model.muscularJointTorque(states, Q, QDotPlus));
+        rigidbody::GeneralizedTorque tauMinus(model.muscularJointTorque(states, Q, QDotMinus));
+        for (unsigned int i=0; i<model.nbDof(); ++i) {
+            EXPECT_NEAR(dTauQdot(i, j), (tauPlus[i] - tauMinus[i]) / (2*h), tolerance);
+        }
+    }
+
+    // Generalized coordinates at constant moment arms, at rest so the muscle velocities do not change with them
+    QDot.setZero();
+    model.updateMuscles(Q, QDot, true);
+    utils::Vector forces, dForceActivation, dForceLength, dForceVelocity;
+    model.muscleForceDerivatives(states, forces, dForceActivation, dForceLength, dForceVelocity);
+    utils::Matrix jaco(model.musclesLengthJacobian());
+    utils::Matrix dTauQ(model.muscularJointTorqueQJacobianAtConstantMomentArms(states));
+    utils::Matrix dForceQ(nbMuscles, model.nbQ());
+    for (unsigned int j=0; j<model.nbQ(); ++j) {
+        rigidbody::GeneralizedCoordinates QPlus(Q);
+        rigidbody::GeneralizedCoordinates QMinus(Q);
+        QPlus[j] += h;
+        QMinus[j] -= h;
+        utils::Vector forcesPlus(model.muscleForces(states, QPlus, QDot));
+        utils::Vector forcesMinus(model.muscleForces(states, QMinus, QDot));
+        for (size_t i=0; i<nbMuscles; ++i) {
+            dForceQ(i, j) = (forcesPlus[i] - forcesMinus[i]) / (2*h);
+            EXPECT_NEAR(dForceLength[i] * jaco(i, j), dForceQ(i, j), tolerance);
+        }
+    }
+    utils::Matrix dTauQExpected(-jaco.transpose() * dForceQ);
+    for (unsigned int i=0; i<model.nbDof(); ++i) {
+        for (unsigned int j=0; j<model.nbQ(); ++j) {
+            EXPECT_NEAR(dTauQ(i, j), dTauQExpected(i, j), tolerance);
+        }
+    }
+}
+#endif
+
 TEST(MuscleCharacterics, unittest)
 {
     {
@@ -3035,6 +3385,61 @@ TEST(MuscleJacobian, jacobianLength)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(MuscleJacobian, sharedBodyJacobians)
+{
+    Model model(modelPathForMuscleJacobian);
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.3 + 0.2 * i;
+    }
+
+    // The jacobian of each body is computed once for all the points attached to it
+    size_t nbComputed(model.nbBodyJacobiansComputed());
+    model.updateMuscles(Q, true);
+    size_t nbPoints(0);
+    for (size_t i=0; i<model.nbMuscles(); ++i) {
+        nbPoints += model.muscle(i).position().pointsInGlobal().size();
+    }
+    size_t nbBodies(model.nbBodyJacobiansComputed() - nbComputed);
+    EXPECT_GT(nbBodies, 0u);
+    EXPECT_LT(nbBodies, nbPoints);
+
+    // They are kept as long as the kinematics are not updated with another Q
+    nbComputed = model.nbBodyJacobiansComputed();
+    model.updateMuscles(Q, true);
+    EXPECT_EQ(model.nbBodyJacobiansComputed(), nbComputed);
+
+    // The jacobians of the points match their finite differences
+    std::vector<utils::Matrix> jacobians;
+    for (size_t i=0; i<model.nbMuscles(); ++i) {
+        jacobians.push_back(model.muscle(i).position().jacobian());
+    }
+    double h(1e-6);
+    for (unsigned int k=0; k<model.nbQ(); ++k) {
+        rigidbody::GeneralizedCoordinates QPlus(Q);
+        rigidbody::GeneralizedCoordinates QMinus(Q);
+        QPlus[k] += h;
+        QMinus[k] -= h;
+        std::vector<std::vector<utils::Vector3d>> pointsPlus;
+        model.updateMuscles(QPlus, true);
+        for (size_t i=0; i<model.nbMuscles(); ++i) {
+            pointsPlus.push_back(model.muscle(i).position().pointsInGlobal());
+        }
+        model.updateMuscles(QMinus, true);
+        for (size_t i=0; i<model.nbMuscles(); ++i) {
+            const std::vector<utils::Vector3d>& pointsMinus(model.muscle(i).position().pointsInGlobal());
+            for (size_t j=0; j<pointsMinus.size(); ++j) {
+                for (unsigned int r=0; r<3; ++r) {
+                    EXPECT_NEAR(jacobians[i](3*j + r, k),
+                                (pointsPlus[i][j][r] - pointsMinus[j][r]) / (2*h), 1e-6);
+                }
+            }
+        }
+    }
+}
+#endif
+
 #ifndef BIORBD_USE_CASADI_MATH
 TEST(MuscleFatigue, FatigueXiaDerivativeViaPointers)
 {
@@ -3307,6 +3712,81 @@ TEST(MuscleFatigue, FatigueXiaSetStateLimitsTest)
 }
 #endif
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Simulator, activationsAndFatigue)
+{
+    Model model(modelPathForMuscleForce);
+    Simulator simulator(model, INTEGRATOR_RK45, 1);
+    EXPECT_EQ(simulator.nbActivations(), model.nbMuscles());
+    EXPECT_EQ(simulator.nbFatigueStates(), 3);
+    EXPECT_EQ(simulator.nbStates(),
+              model.nbQ() + model.nbQdot() + model.nbMuscles() + simulator.nbFatigueStates());
+    EXPECT_EQ(simulator.nbControls(), model.nbGeneralizedTorque() + model.nbMuscles());
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    Q.setZero();
+    QDot.setZero();
+    Q[0] = 0.3;
+    Q[1] = 0.5;
+    utils::Vector x0(simulator.state(Q, QDot));
+    for (size_t m=0; m<model.nbMuscles(); ++m) {
+        x0[simulator.activationsIndex() + m] = 0.1;
+    }
+
+    utils::Vector u(simulator.nbControls());
+    u.setZero();
+    for (size_t m=0; m<model.nbMuscles(); ++m) {
+        u[model.nbGeneralizedTorque() + m] = 0.3;
+    }
+
+    // The derivatives of the activations and the accelerations are those of the model
+    utils::Vector xDot;
+    simulator.dynamics(x0, u, xDot);
+    std::vector<std::shared_ptr<internal_forces::muscles::State>> states(model.stateSet());
+    for (auto& state : states) {
+        state->setExcitation(0.3);
+        state->setActivation(0.1);
+    }
+    utils::Vector activationDot(model.activationDot(states));
+    for (size_t m=0; m<model.nbMuscles(); ++m) {
+        EXPECT_NEAR(xDot[simulator.activationsIndex() + m], activationDot[m], requiredPrecision);
+    }
+    size_t fatigueIdx(simulator.fatigueStatesIndex());
+    EXPECT_NEAR(xDot[fatigueIdx] + xDot[fatigueIdx + 1] + xDot[fatigueIdx + 2], 0, requiredPrecision);
+
+    size_t nbIntervals(5);
+    double dt(0.01);
+    utils::Matrix controls(simulator.nbControls(), nbIntervals);
+    for (size_t i=0; i<nbIntervals; ++i) {
+        controls.col(i) = u;
+    }
+
+    simulator.setTolerances(1e-10, 1e-10);
+    utils::Matrix reference(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, reference);
+
+    simulator.setIntegrator(INTEGRATOR_RK4);
+    simulator.setNbSteps(20);
+    utils::Matrix rk4(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, rk4);
+
+    for (size_t i=0; i<nbIntervals + 1; ++i) {
+        for (unsigned int j=0; j<simulator.nbStates(); ++j) {
+            EXPECT_NEAR(rk4(j, i), reference(j, i), 1e-4);
+        }
+        // The fibers are only moved from one fatigue state to another
+        EXPECT_NEAR(reference(fatigueIdx, i) + reference(fatigueIdx + 1, i)
+                    + reference(fatigueIdx + 2, i), 1, 1e-8);
+    }
+    // The activations rise toward the excitations
+    for (size_t m=0; m<model.nbMuscles(); ++m) {
+        EXPECT_GT(reference(simulator.activationsIndex() + m, nbIntervals), 0.1);
+        EXPECT_LT(reference(simulator.activationsIndex() + m, nbIntervals), 0.3);
+    }
+}
+#endif
+
 #ifdef MODULE_STATIC_OPTIM
 
 TEST(StaticOptim, OneFrameNoActivations)
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <gtest/gtest.h>
 #include <rbdl/rbdl_math.h>
@@ -5,14 +7,21 @@
 #include <string.h>
 
 #include "BiorbdModel.h"
+#include "TrajectoryEvaluator.h"
+#include "Simulator.h"
+#include "HybridSimulator.h"
+#include "ModelCodeGenerator.h"
 #include "biorbdConfig.h"
 #include "Utils/Range.h"
+#include "Utils/RotoTrans.h"
 #include "Utils/Matrix3d.h"
 #include "Utils/Matrix.h"
+#include "Utils/Vector.h"
 #include "Utils/SpatialVector.h"
 #include "Utils/String.h"
 
 #include "RigidBody/ExternalForceSet.h"
+#include "RigidBody/LoopConstraintSolver.h"
 #include "RigidBody/GeneralizedCoordinates.h"
 #include "RigidBody/GeneralizedVelocity.h"
 #include "RigidBody/GeneralizedAcceleration.h"
@@ -20,13 +29,20 @@
 #include "RigidBody/Mesh.h"
 #include "RigidBody/SegmentCharacteristics.h"
 #include "RigidBody/SoftContactSphere.h"
+#include "RigidBody/SoftContactEngine.h"
 #include "RigidBody/NodeSegment.h"
 #include "RigidBody/Segment.h"
 #include "RigidBody/IMU.h"
+#include "RigidBody/BlockJacobian.h"
+#include "RigidBody/WholeBodyQuantities.h"
 #ifdef MODULE_KALMAN
     #include "RigidBody/KalmanReconsMarkers.h"
     #include "RigidBody/KalmanReconsIMU.h"
 #endif
+#ifdef BIORBD_TEST_GENERATED_KERNELS
+    #include "pyomecamanKernels.h"
+    #include "loopConstrainedModelKernels.h"
+#endif
 
 using namespace BIORBD_NAMESPACE;
 
@@ -610,6 +626,73 @@ TEST(SoftContacts, ForceAtOrigin) {
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(SoftContacts, engine) {
+    Model model(modelWithSoftContact);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    FILL_VECTOR(Q, std::vector<double>({ -2.01, -3.01, -3.01, 0.1 }));
+    FILL_VECTOR(QDot, std::vector<double>({ -2.01, -3.01, -3.01, 0.1 }));
+    utils::SpatialVector zero(0, 0, 0, 0, 0, 0);
+
+    // The batch against the ground plane gives the same forces as the contacts one by one
+    std::vector<utils::SpatialVector> expected(model.mBodies.size(), zero);
+    for (size_t j = 0; j < model.nbSoftContacts(); ++j) {
+        rigidbody::SoftContactNode& contact(model.softContact(j));
+        expected[model.segment(contact.parent()).findFirstSegmentWithDof(model).id()]
+            += contact.computeForceAtOrigin(model, Q, QDot);
+    }
+    std::vector<utils::SpatialVector> forces(model.mBodies.size(), zero);
+    model.addSoftContactForces(Q, QDot, forces);
+    EXPECT_EQ(model.softContactEngine().nbObstacles(), 1);
+    EXPECT_EQ(model.softContactEngine().nbPairsEvaluated(), 2);
+    for (size_t i = 0; i < forces.size(); ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            EXPECT_NEAR(forces[i][j], expected[i][j], 1e-9);
+        }
+    }
+
+    // Each plane adds its own forces
+    model.softContactEngine().addPlane(utils::Vector3d(0, 0, 0), utils::Vector3d(0, 0, 2));
+    std::vector<utils::SpatialVector> twoPlanes(model.mBodies.size(), zero);
+    model.addSoftContactForces(Q, QDot, twoPlanes);
+    EXPECT_EQ(model.softContactEngine().nbPairsEvaluated(), 4);
+    for (size_t i = 0; i < forces.size(); ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            EXPECT_NEAR(twoPlanes[i][j], 2 * expected[i][j], 1e-8);
+        }
+    }
+
+    // A very large sphere under the model behaves like the ground plane
+    double radius(1e7);
+    model.softContactEngine().clearObstacles();
+    model.softContactEngine().addSphere(utils::Vector3d(0, 0, -radius), radius);
+    EXPECT_EQ(model.softContactEngine().obstacleType(0), rigidbody::SOFT_CONTACT_OBSTACLE_SPHERE);
+    std::vector<utils::SpatialVector> sphere(model.mBodies.size(), zero);
+    model.addSoftContactForces(Q, QDot, sphere);
+    for (size_t i = 0; i < forces.size(); ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            EXPECT_NEAR(sphere[i][j], expected[i][j], 1e-4 * expected[i].norm() + 1e-6);
+        }
+    }
+
+    // The broadphase skips the contacts far from the obstacles
+    model.softContactEngine().clearObstacles();
+    model.softContactEngine().addPlane(utils::Vector3d(0, 0, -1000), utils::Vector3d(0, 0, 1));
+    std::vector<utils::SpatialVector> far(model.mBodies.size(), zero);
+    model.addSoftContactForces(Q, QDot, far);
+    EXPECT_EQ(model.softContactEngine().nbPairsEvaluated(), 0);
+    for (size_t i = 0; i < far.size(); ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            EXPECT_EQ(far[i][j], 0.);
+        }
+    }
+    model.softContactEngine().setBroadphaseMargin(1e4);
+    model.addSoftContactForces(Q, QDot, far);
+    EXPECT_EQ(model.softContactEngine().nbPairsEvaluated(), 2);
+}
+#endif
+
 static std::vector<double> Qtest = { 0.1, 0.1, 0.1, 0.3, 0.3, 0.3, 0.3, 0.3, 0.3, 0.3, 0.3, 0.4, 0.3};
 
 TEST(GeneralizedCoordinates, unitTest)
@@ -966,6 +1049,451 @@ TEST(Joints, massMatrixInverse)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Joints, massMatrixInverseMultiDofTree)
+{
+    // A free floating root (xyz/xyz) carrying two branches, one of which is an Euler sequence
+    Model model;
+    rigidbody::SegmentCharacteristics characteristics(
+        5, utils::Vector3d(0.1, 0.05, -0.2), utils::Matrix3d(0.1, 0, 0, 0, 0.2, 0, 0, 0, 0.3));
+    utils::RotoTrans offset(utils::Rotation(), utils::Vector3d(0.1, 0.2, -0.3));
+    model.AddSegment("Root", "root", "xyz", "xyz", {}, {}, {}, characteristics, utils::RotoTrans());
+    model.AddSegment("Arm", "Root", "", "x", {}, {}, {}, characteristics, offset);
+    model.AddSegment("Forearm", "Arm", "", "y", {}, {}, {}, characteristics, offset);
+    model.AddSegment("Leg", "Root", "", "zyx", {}, {}, {}, characteristics, offset);
+    model.AddSegment("Foot", "Leg", "", "z", {}, {}, {}, characteristics, offset);
+    ASSERT_EQ(model.nbQ(), 12);
+
+    // The subtrees of the root hold every dof, those of the leaves their own dof
+    std::vector<std::vector<size_t>> subTrees(model.getDofSubTrees());
+    ASSERT_EQ(subTrees.size(), model.mBodies.size() - 1);
+    EXPECT_EQ(subTrees[0].size(), 12);
+    EXPECT_EQ(subTrees[1].size(), 12 - 3);
+    EXPECT_EQ(subTrees.back().size(), 1);
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i) - 0.4;
+    }
+    utils::Matrix Minv_expected(model.massMatrix(Q).inverse());
+    utils::Matrix Minv(model.massMatrixInverse(Q));
+    for (unsigned int i=0; i<model.nbQddot(); ++i) {
+        for (unsigned int j=0; j<model.nbQddot(); ++j) {
+            EXPECT_NEAR(Minv(i, j), Minv_expected(i, j), 1e-8);
+        }
+    }
+
+    // The output and the workspace are reused from one call to the other
+    utils::Matrix Minv_out;
+    model.massMatrixInverse(Q, Minv_out);
+    model.massMatrixInverse(Q, Minv_out);
+    for (unsigned int i=0; i<model.nbQddot(); ++i) {
+        for (unsigned int j=0; j<model.nbQddot(); ++j) {
+            EXPECT_NEAR(Minv_out(i, j), Minv_expected(i, j), 1e-8);
+        }
+    }
+}
+
+static void expectDynamicsDerivativesMatchFiniteDifferences(
+    Model& model)
+{
+    unsigned int n(model.nbQ());
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedAcceleration QDDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    for (unsigned int i=0; i<n; ++i) {
+        Q[i] = 0.3 * std::sin(1.3 * i + 0.2);
+        QDot[i] = 1.1 * std::cos(0.7 * i - 0.4);
+        QDDot[i] = 0.8 * std::sin(2.1 * i + 1.);
+        Tau[i] = 2.3 * std::cos(0.9 * i + 0.3);
+    }
+
+    utils::Matrix dTau_dQ, dTau_dQDot, dTau_dQDDot;
+    model.InverseDynamicsDerivatives(Q, QDot, QDDot, dTau_dQ, dTau_dQDot, dTau_dQDDot);
+    utils::Matrix dQDDot_dQ, dQDDot_dQDot, dQDDot_dTau;
+    model.ForwardDynamicsDerivatives(Q, QDot, Tau, dQDDot_dQ, dQDDot_dQDot, dQDDot_dTau);
+
+    // Central differences, column by column
+    double h(1e-6);
+    for (unsigned int k=0; k<n; ++k) {
+        std::vector<utils::Vector> tauPlus, tauMinus, qddotPlus, qddotMinus;
+        for (double sign : {1., -1.}) {
+            for (unsigned int wrt=0; wrt<3; ++wrt) {
+                rigidbody::GeneralizedCoordinates Q_h(Q);
+                rigidbody::GeneralizedVelocity QDot_h(QDot);
+                rigidbody::GeneralizedAcceleration QDDot_h(QDDot);
+                rigidbody::GeneralizedTorque Tau_h(Tau);
+                if (wrt == 0) {
+                    Q_h[k] += sign * h;
+                } else if (wrt == 1) {
+                    QDot_h[k] += sign * h;
+                } else {
+                    QDDot_h[k] += sign * h;
+                    Tau_h[k] += sign * h;
+                }
+                (sign > 0 ? tauPlus : tauMinus).push_back(model.InverseDynamics(Q_h, QDot_h, QDDot_h));
+                (sign > 0 ? qddotPlus : qddotMinus).push_back(model.ForwardDynamics(Q_h, QDot_h, Tau_h));
+            }
+        }
+        std::vector<const utils::Matrix*> dTau = {&dTau_dQ, &dTau_dQDot, &dTau_dQDDot};
+        std::vector<const utils::Matrix*> dQDDot = {&dQDDot_dQ, &dQDDot_dQDot, &dQDDot_dTau};
+        for (unsigned int wrt=0; wrt<3; ++wrt) {
+            for (unsigned int i=0; i<n; ++i) {
+                double expectedTau((tauPlus[wrt][i] - tauMinus[wrt][i]) / (2 * h));
+                EXPECT_NEAR((*dTau[wrt])(i, k), expectedTau, 1e-5 * (1 + fabs(expectedTau)));
+                double expectedQDDot((qddotPlus[wrt][i] - qddotMinus[wrt][i]) / (2 * h));
+                EXPECT_NEAR((*dQDDot[wrt])(i, k), expectedQDDot, 1e-5 * (1 + fabs(expectedQDDot)));
+            }
+        }
+    }
+}
+
+TEST(Joints, dynamicsDerivatives)
+{
+    {
+        Model model(modelPathForGeneralTesting);
+        expectDynamicsDerivativesMatchFiniteDifferences(model);
+    }
+    {
+        // Native translations xyz and Euler sequences, whose motion subspace depends on Q
+        Model model;
+        rigidbody::SegmentCharacteristics characteristics(
+            5, utils::Vector3d(0.1, 0.05, -0.2), utils::Matrix3d(0.1, 0, 0, 0, 0.2, 0, 0, 0, 0.3));
+        utils::RotoTrans offset(utils::Rotation(), utils::Vector3d(0.1, 0.2, -0.3));
+        model.AddSegment("Root", "root", "xyz", "xyz", {}, {}, {}, characteristics, utils::RotoTrans());
+        model.AddSegment("Arm", "Root", "", "x", {}, {}, {}, characteristics, offset);
+        model.AddSegment("Leg", "Root", "", "zyx", {}, {}, {}, characteristics, offset);
+        model.AddSegment("Foot", "Leg", "y", "z", {}, {}, {}, characteristics, offset);
+        expectDynamicsDerivativesMatchFiniteDifferences(model);
+    }
+    {
+        Model model("models/simple_quat.bioMod");
+        rigidbody::GeneralizedCoordinates Q(model);
+        rigidbody::GeneralizedVelocity QDot(model);
+        rigidbody::GeneralizedAcceleration QDDot(model);
+        utils::Matrix dTau_dQ, dTau_dQDot, dTau_dQDDot;
+        EXPECT_THROW(model.InverseDynamicsDerivatives(Q, QDot, QDDot, dTau_dQ, dTau_dQDot, dTau_dQDDot),
+                     std::runtime_error);
+    }
+}
+
+TEST(Joints, nativeMultiDofJoints)
+{
+    rigidbody::SegmentCharacteristics characteristics(
+        10, utils::Vector3d(0.1, 0.2, 0.3),
+        utils::Matrix3d(1, 0, 0, 0, 2, 0, 0, 0, 3));
+
+    // Each sequence is compared to the same sequence split on two chained segments,
+    // which cannot be mapped onto a single rbdl joint
+    std::vector<std::vector<utils::String>> sequences = {
+        {"xyz", "xy", "z"}, {"zyx", "zy", "x"}
+    };
+    for (const auto& seq : sequences) {
+        Model native;
+        native.AddSegment("Seg1", "root", "xyz", seq[0], {}, {}, {},
+                          characteristics, utils::RotoTrans());
+
+        Model chained;
+        chained.AddSegment("Trans1", "root", "xy", "", {}, {}, {},
+                           rigidbody::SegmentCharacteristics(), utils::RotoTrans());
+        chained.AddSegment("Trans2", "Trans1", "z", "", {}, {}, {},
+                           rigidbody::SegmentCharacteristics(), utils::RotoTrans());
+        chained.AddSegment("Rot1", "Trans2", "", seq[1], {}, {}, {},
+                           rigidbody::SegmentCharacteristics(), utils::RotoTrans());
+        chained.AddSegment("Seg1", "Rot1", "", seq[2], {}, {}, {},
+                           characteristics, utils::RotoTrans());
+
+        // One body for the translations and one for the rotations
+        EXPECT_EQ(native.nbQ(), 6);
+        EXPECT_EQ(chained.nbQ(), 6);
+        EXPECT_EQ(native.mBodies.size(), 3);
+        EXPECT_EQ(native.segment(0).id(), native.GetBodyId("Seg1"));
+
+        DECLARE_GENERALIZED_COORDINATES(Q, native);
+        DECLARE_GENERALIZED_VELOCITY(QDot, native);
+        DECLARE_GENERALIZED_TORQUE(Tau, native);
+        FILL_VECTOR(Q, std::vector<double>({0.1, -0.2, 0.3, 0.4, -0.5, 0.6}));
+        FILL_VECTOR(QDot, std::vector<double>({-1.1, 1.2, 1.3, -1.4, 1.5, 1.6}));
+        FILL_VECTOR(Tau, std::vector<double>({2.1, 2.2, -2.3, 2.4, 2.5, -2.6}));
+
+        utils::Matrix M_native(native.massMatrix(Q));
+        utils::Matrix M_chained(chained.massMatrix(Q));
+        utils::Matrix Minv_native(native.massMatrixInverse(Q));
+        utils::Matrix Minv_chained(chained.massMatrixInverse(Q));
+        rigidbody::GeneralizedAcceleration QDDot_native(native.ForwardDynamics(Q, QDot, Tau));
+        rigidbody::GeneralizedAcceleration QDDot_chained(chained.ForwardDynamics(Q, QDot, Tau));
+        utils::Vector3d com_native(native.CoM(Q));
+        utils::Vector3d com_chained(chained.CoM(Q));
+        for (size_t i=0; i<6; ++i) {
+            EXPECT_NEAR(QDDot_native(i), QDDot_chained(i), requiredPrecision);
+            for (size_t j=0; j<6; ++j) {
+                EXPECT_NEAR(M_native(i, j), M_chained(i, j), requiredPrecision);
+                EXPECT_NEAR(Minv_native(i, j), Minv_chained(i, j), requiredPrecision);
+            }
+        }
+        for (size_t i=0; i<3; ++i) {
+            EXPECT_NEAR(com_native(i), com_chained(i), requiredPrecision);
+        }
+    }
+}
+
+TEST(Joints, kinematicsUpdatesElided)
+{
+    Model model(modelPathForGeneralTesting);
+    Model reference(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    rigidbody::GeneralizedAcceleration Qddot(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 0.2;
+        Qdot[i] = static_cast<double>(i) * 1.2;
+        Qddot[i] = static_cast<double>(i) * -0.7;
+    }
+    model.resetKinematicsUpdatesCounters();
+
+    // Same state, nothing to do
+    model.UpdateKinematicsCustom(&Q);
+    model.UpdateKinematicsCustom(&Q);
+    EXPECT_EQ(model.nbKinematicsUpdates(), 1);
+    EXPECT_EQ(model.nbKinematicsUpdatesElided(), 1);
+
+    // Only the velocities are missing, then everything is up to date
+    model.UpdateKinematicsCustom(&Q, &Qdot);
+    model.UpdateKinematicsCustom(&Q, &Qdot);
+    model.UpdateKinematicsCustom(&Q);
+    EXPECT_EQ(model.nbKinematicsUpdates(), 2);
+    EXPECT_EQ(model.nbKinematicsUpdatesElided(), 3);
+
+    // A forward dynamics leaves the model at the state it was computed with
+    rigidbody::GeneralizedTorque Tau(model);
+    Tau.setZero();
+    model.ForwardDynamics(Q, Qdot, Tau);
+    size_t nbUpdates(model.nbKinematicsUpdates());
+    model.UpdateKinematicsCustom(&Q, &Qdot);
+    EXPECT_EQ(model.nbKinematicsUpdates(), nbUpdates);
+
+    // The accelerations of the inverse dynamics include the gravity, they must be recomputed
+    model.InverseDynamics(Q, Qdot, Qddot);
+    std::vector<rigidbody::NodeSegment> accelerations(
+        model.markerAcceleration(Q, Qdot, Qddot, true, true));
+    std::vector<rigidbody::NodeSegment> expectedAccelerations(
+        reference.markerAcceleration(Q, Qdot, Qddot, true, true));
+    for (size_t i=0; i<accelerations.size(); ++i) {
+        for (size_t j=0; j<3; ++j) {
+            EXPECT_NEAR(accelerations[i](j), expectedAccelerations[i](j), requiredPrecision);
+        }
+    }
+
+    // A new state must be propagated, whatever was computed before
+    Q[0] += 0.1;
+    std::vector<rigidbody::NodeSegment> markers(model.markers(Q));
+    std::vector<rigidbody::NodeSegment> expectedMarkers(reference.markers(Q));
+    for (size_t i=0; i<markers.size(); ++i) {
+        for (size_t j=0; j<3; ++j) {
+            EXPECT_NEAR(markers[i](j), expectedMarkers[i](j), requiredPrecision);
+        }
+    }
+
+    // The markers jacobian updates the kinematics once and is then free
+    model.resetKinematicsUpdatesCounters();
+    model.markersJacobian(Q);
+    model.markers(Q);
+    EXPECT_EQ(model.nbKinematicsUpdates(), 0);
+    EXPECT_EQ(model.nbKinematicsUpdatesElided(), 2);
+}
+
+TEST(Joints, kinematicsUpdatesVelocitiesOnly)
+{
+    Model model(modelPathForGeneralTesting);
+    Model reference(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    rigidbody::GeneralizedVelocity Qdot2(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 0.2;
+        Qdot[i] = static_cast<double>(i) * 1.2;
+        Qdot2[i] = static_cast<double>(i) * -0.4;
+    }
+
+    // Only the velocities change, the positions must still be given to rbdl
+    model.markers(Q);
+    for (size_t k=0; k<model.nbMarkers(); ++k) {
+        rigidbody::NodeSegment velocity(model.markerVelocity(Q, Qdot2, k));
+        rigidbody::NodeSegment expectedVelocity(reference.markerVelocity(Q, Qdot2, k));
+        for (size_t j=0; j<3; ++j) {
+            EXPECT_NEAR(velocity(j), expectedVelocity(j), requiredPrecision);
+        }
+    }
+
+    model.markerVelocity(Q, Qdot, 0);
+    model.resetKinematicsUpdatesCounters();
+    rigidbody::NodeSegment velocity(model.markerVelocity(Q, Qdot2, 0));
+    rigidbody::NodeSegment expectedVelocity(reference.markerVelocity(Q, Qdot2, 0));
+    EXPECT_EQ(model.nbKinematicsUpdates(), 1);
+    for (size_t j=0; j<3; ++j) {
+        EXPECT_NEAR(velocity(j), expectedVelocity(j), requiredPrecision);
+    }
+}
+
+TEST(Joints, kinematicsSubtreesUpdate)
+{
+    Model model(modelPathForGeneralTesting);
+    Model reference(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 0.2;
+    }
+    model.UpdateKinematicsCustom(&Q);
+    model.resetKinematicsUpdatesCounters();
+    size_t nbBodies(model.mBodies.size() - 1);
+
+    auto expectSameKinematics = [&]() {
+        std::vector<rigidbody::NodeSegment> markers(model.markers(Q, true, false));
+        std::vector<rigidbody::NodeSegment> expectedMarkers(reference.markers(Q));
+        for (size_t i=0; i<markers.size(); ++i) {
+            for (size_t j=0; j<3; ++j) {
+                EXPECT_NEAR(markers[i](j), expectedMarkers[i](j), requiredPrecision);
+            }
+        }
+        std::vector<utils::RotoTrans> jcs(model.allGlobalJCS(Q, false));
+        std::vector<utils::RotoTrans> expectedJcs(reference.allGlobalJCS(Q));
+        for (size_t i=0; i<jcs.size(); ++i) {
+            for (unsigned int row=0; row<4; ++row) {
+                for (unsigned int col=0; col<4; ++col) {
+                    EXPECT_NEAR(jcs[i](row, col), expectedJcs[i](row, col), requiredPrecision);
+                }
+            }
+        }
+    };
+
+    // Only the last dof changes, the bodies before it are left as they are
+    Q[model.nbQ() - 1] += 0.3;
+    model.UpdateKinematicsCustom(&Q);
+    EXPECT_EQ(model.nbKinematicsUpdates(), 1);
+    EXPECT_GT(model.nbKinematicsBodiesUpdated(), 0);
+    EXPECT_LT(model.nbKinematicsBodiesUpdated(), nbBodies);
+    expectSameKinematics();
+
+    // The root moves everything
+    model.resetKinematicsUpdatesCounters();
+    Q[0] -= 0.2;
+    model.UpdateKinematicsCustom(&Q);
+    EXPECT_EQ(model.nbKinematicsBodiesUpdated(), nbBodies);
+    expectSameKinematics();
+
+    // The caller can give the dof which changed
+    model.resetKinematicsUpdatesCounters();
+    Q[model.nbQ() - 2] += 0.1;
+    Q[model.nbQ() - 1] -= 0.4;
+    model.UpdateKinematicsSubtrees(Q, {model.nbQ() - 2, model.nbQ() - 1});
+    EXPECT_LT(model.nbKinematicsBodiesUpdated(), nbBodies);
+    expectSameKinematics();
+    EXPECT_THROW(model.UpdateKinematicsSubtrees(Q, {model.nbQ()}), std::runtime_error);
+
+    // Velocities need the full update
+    model.resetKinematicsUpdatesCounters();
+    rigidbody::GeneralizedVelocity Qdot(model);
+    Qdot.setOnes();
+    Q[1] += 0.1;
+    model.UpdateKinematicsCustom(&Q, &Qdot);
+    EXPECT_EQ(model.nbKinematicsBodiesUpdated(), nbBodies);
+    expectSameKinematics();
+}
+#endif
+
+#ifdef BIORBD_TEST_GENERATED_KERNELS
+TEST(CodeGenerator, pyomecamanKernels)
+{
+    Model model("models/pyomecaman.bioMod");
+    ASSERT_EQ(pyomecamanKernels::nbQ, model.nbQ());
+    ASSERT_EQ(pyomecamanKernels::nbSegments, model.nbSegment());
+    ASSERT_EQ(pyomecamanKernels::nbMarkers, model.nbMarkers());
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int trial=0; trial<3; ++trial) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = 0.3 * static_cast<double>(trial) - 0.1 * static_cast<double>(i) + 0.05;
+        }
+        pyomecamanKernels::VectorQ q(Q);
+        pyomecamanKernels::State state;
+        pyomecamanKernels::forwardKinematics(q, state);
+
+        pyomecamanKernels::ArrayJCS jcs;
+        pyomecamanKernels::globalJCS(state, jcs);
+        std::vector<utils::RotoTrans> expectedJcs(model.allGlobalJCS(Q));
+        for (size_t s=0; s<model.nbSegment(); ++s) {
+            EXPECT_TRUE(jcs[s].isApprox(expectedJcs[s], requiredPrecision)) << model.segment(s).name();
+        }
+
+        pyomecamanKernels::MatrixMarkers markers;
+        pyomecamanKernels::markers(state, markers);
+        std::vector<rigidbody::NodeSegment> expectedMarkers(model.markers(Q));
+        for (size_t m=0; m<model.nbMarkers(); ++m) {
+            for (unsigned int k=0; k<3; ++k) {
+                EXPECT_NEAR(markers(k, m), expectedMarkers[m](k), requiredPrecision);
+            }
+        }
+
+        pyomecamanKernels::MatrixMarkersJacobian jacobian;
+        pyomecamanKernels::markersJacobian(state, jacobian);
+        std::vector<utils::Matrix> expectedJacobian(model.markersJacobian(Q));
+        for (size_t m=0; m<model.nbMarkers(); ++m) {
+            for (unsigned int k=0; k<3; ++k) {
+                for (unsigned int j=0; j<model.nbQ(); ++j) {
+                    EXPECT_NEAR(jacobian(3*m+k, j), expectedJacobian[m](k, j), requiredPrecision);
+                }
+            }
+        }
+
+        pyomecamanKernels::MatrixMass mass;
+        pyomecamanKernels::massMatrix(state, mass);
+        utils::Matrix expectedMass(model.massMatrix(Q));
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            for (unsigned int j=0; j<model.nbQ(); ++j) {
+                EXPECT_NEAR(mass(i, j), expectedMass(i, j), requiredPrecision);
+            }
+        }
+    }
+}
+
+TEST(CodeGenerator, fixedSegmentsAndEulerSequences)
+{
+    // This model has a fixed segment and rotations about xyz carried by frames with a RT
+    Model model(modelPathForLoopConstraintTesting);
+    ASSERT_EQ(loopConstrainedModelKernels::nbQ, model.nbQ());
+
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.2 * static_cast<double>(i) - 0.4;
+    }
+    loopConstrainedModelKernels::VectorQ q(Q);
+
+    loopConstrainedModelKernels::ArrayJCS jcs;
+    loopConstrainedModelKernels::globalJCS(q, jcs);
+    std::vector<utils::RotoTrans> expectedJcs(model.allGlobalJCS(Q));
+    for (size_t s=0; s<model.nbSegment(); ++s) {
+        EXPECT_TRUE(jcs[s].isApprox(expectedJcs[s], requiredPrecision)) << model.segment(s).name();
+    }
+
+    loopConstrainedModelKernels::MatrixMass mass;
+    loopConstrainedModelKernels::massMatrix(q, mass);
+    utils::Matrix expectedMass(model.massMatrix(Q));
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        for (unsigned int j=0; j<model.nbQ(); ++j) {
+            EXPECT_NEAR(mass(i, j), expectedMass(i, j), requiredPrecision);
+        }
+    }
+}
+
+TEST(CodeGenerator, quaternionsNotSupported)
+{
+    Model model("models/simple_quat.bioMod");
+    EXPECT_THROW(CodeGenerator::kinematicsKernels(model, "simpleQuatKernels"),
+                 std::runtime_error);
+}
+#endif
+
 TEST(Markers, copy)
 {
     {
@@ -994,6 +1522,43 @@ TEST(Markers, copy)
     }
 }
 
+TEST(Markers, parentIdResolvedWhenAdded)
+{
+    Model model(modelPathForGeneralTesting);
+    size_t nbMarkers(model.nbMarkers());
+    utils::String parentName(model.marker(0).parent());
+
+    model.addMarker(rigidbody::NodeSegment(0.1, 0.2, 0.3), "newMarker",
+                    parentName, true, true, "");
+    EXPECT_EQ(model.nbMarkers(), nbMarkers + 1);
+    EXPECT_EQ(model.marker(nbMarkers).parentId(),
+              static_cast<int>(model.GetBodyId(parentName.c_str())));
+    EXPECT_EQ(model.getParentRbdlId(model.marker(nbMarkers)),
+              model.GetBodyId(parentName.c_str()));
+
+    DECLARE_GENERALIZED_COORDINATES(Q, model);
+    std::vector<double> val(model.nbQ());
+    for (size_t i=0; i<val.size(); ++i) {
+        val[i] = static_cast<double>(i) * 0.1;
+    }
+    FILL_VECTOR(Q, val);
+    std::vector<double> expected(3);
+    {
+        // Looked up by name since the node is not bound to the model
+        rigidbody::NodeSegment node(0.1, 0.2, 0.3, "node", parentName, true, true, "", -1);
+        CALL_BIORBD_FUNCTION_1ARG3PARAMS(expectedMarker, model, marker, Q, node, true, true);
+        for (unsigned int i=0; i<3; ++i) {
+            expected[i] = static_cast<double>(expectedMarker(i));
+        }
+    }
+    {
+        CALL_BIORBD_FUNCTION_1ARG3PARAMS(newMarker, model, marker, Q, nbMarkers, true, true);
+        for (unsigned int i=0; i<3; ++i) {
+            EXPECT_NEAR(static_cast<double>(newMarker(i)), expected[i], requiredPrecision);
+        }
+    }
+}
+
 TEST(SegmentCharacteristics, length)
 {
     rigidbody::SegmentCharacteristics segmentCharac;
@@ -1324,6 +1889,68 @@ TEST(CoM, kinematics)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(CoM, wholeBodyQuantities)
+{
+    Model model(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    rigidbody::GeneralizedAcceleration Qddot(model);
+    for (size_t i=0; i<model.nbQ(); ++i) {
+        Q[i] = QtestPyomecaman[i];
+        Qdot[i] = QtestPyomecaman[i]*10;
+        Qddot[i] = QtestPyomecaman[i]*100;
+    }
+
+    rigidbody::WholeBodyQuantities quantities;
+    model.wholeBodyQuantities(Q, Qdot, &Qddot, quantities, true);
+
+    utils::Vector3d com(model.CoM(Q));
+    utils::Vector3d comDot(model.CoMdot(Q, Qdot));
+    utils::Vector3d comDdot(model.CoMddot(Q, Qdot, Qddot));
+    utils::Vector3d angularMomentum(model.angularMomentum(Q, Qdot));
+    std::vector<rigidbody::NodeSegment> comBySegment(model.CoMbySegment(Q));
+    std::vector<utils::Vector3d> comDotBySegment(model.CoMdotBySegment(Q, Qdot));
+    std::vector<utils::Vector3d> comDdotBySegment(model.CoMddotBySegment(Q, Qdot, Qddot));
+
+    EXPECT_NEAR(quantities.mass, model.mass(), requiredPrecision);
+    EXPECT_NEAR(quantities.kineticEnergy, model.KineticEnergy(Q, Qdot), requiredPrecision);
+    EXPECT_NEAR(quantities.potentialEnergy, model.PotentialEnergy(Q), requiredPrecision);
+    utils::Vector3d segmentsAngularMomentum(0, 0, 0);
+    for (size_t i=0; i<3; ++i) {
+        EXPECT_NEAR(quantities.CoM[i], com[i], requiredPrecision);
+        EXPECT_NEAR(quantities.CoMdot[i], comDot[i], requiredPrecision);
+        EXPECT_NEAR(quantities.CoMddot[i], comDdot[i], requiredPrecision);
+        EXPECT_NEAR(quantities.angularMomentum[i], angularMomentum[i], requiredPrecision);
+    }
+    EXPECT_EQ(quantities.segmentsCoM.size(), model.nbSegment());
+    for (size_t s=0; s<model.nbSegment(); ++s) {
+        for (size_t i=0; i<3; ++i) {
+            EXPECT_NEAR(quantities.segmentsCoM[s][i], comBySegment[s][i], requiredPrecision);
+            EXPECT_NEAR(quantities.segmentsCoMdot[s][i], comDotBySegment[s][i], requiredPrecision);
+            EXPECT_NEAR(quantities.segmentsCoMddot[s][i], comDdotBySegment[s][i], requiredPrecision);
+        }
+        segmentsAngularMomentum += quantities.segmentsAngularMomentum[s];
+    }
+    for (size_t i=0; i<3; ++i) {
+        EXPECT_NEAR(segmentsAngularMomentum[i], angularMomentum[i], requiredPrecision);
+    }
+
+    // Without the accelerations, the other quantities are the same and the accelerations are left untouched
+    rigidbody::WholeBodyQuantities noAcceleration;
+    noAcceleration.CoMddot.setZero();
+    model.wholeBodyQuantities(Q, Qdot, nullptr, noAcceleration);
+    EXPECT_TRUE(noAcceleration.segmentsCoM.empty());
+    EXPECT_NEAR(noAcceleration.kineticEnergy + noAcceleration.potentialEnergy,
+                model.TotalEnergy(Q, Qdot), requiredPrecision);
+    for (size_t i=0; i<3; ++i) {
+        EXPECT_NEAR(noAcceleration.CoMdot[i], comDot[i], requiredPrecision);
+        EXPECT_NEAR(noAcceleration.angularMomentum[i], angularMomentum[i], requiredPrecision);
+        EXPECT_EQ(noAcceleration.CoMddot[i], 0.0);
+    }
+}
+#endif
+
 TEST(Segment, copy)
 {
     Model model(modelPathForGeneralTesting);
@@ -1498,6 +2125,37 @@ TEST(Markers, allPositions)
         }
     }
 }
+
+TEST(Markers, allPositionsAllFrames)
+{
+    Model model(modelPathForGeneralTesting);
+    unsigned int nbFrames(5);
+    unsigned int nbQ(static_cast<unsigned int>(model.nbQ()));
+    unsigned int nbMarkers(static_cast<unsigned int>(model.nbMarkers()));
+
+    utils::Matrix Q(nbQ, nbFrames);
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        for (unsigned int q=0; q<nbQ; ++q) {
+            Q(q, f) = 0.1 * static_cast<double>(q) - 0.3 * static_cast<double>(f);
+        }
+    }
+
+    utils::Matrix markers(3*nbMarkers, nbFrames);
+    model.markers(Q, markers);
+
+    for (unsigned int f=0; f<nbFrames; ++f) {
+        rigidbody::GeneralizedCoordinates Qframe(Q.col(f));
+        std::vector<rigidbody::NodeSegment> expected(model.markers(Qframe));
+        for (unsigned int i=0; i<nbMarkers; ++i) {
+            for (unsigned int j=0; j<3; ++j) {
+                EXPECT_NEAR(markers(3*i+j, f), expected[i][j], requiredPrecision);
+            }
+        }
+    }
+
+    utils::Matrix wrongSize(3*nbMarkers, nbFrames + 1);
+    EXPECT_THROW(model.markers(Q, wrongSize), std::runtime_error);
+}
 #endif
 
 TEST(Markers, individualPositions)
@@ -1550,6 +2208,170 @@ TEST(Markers, individualPositions)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Markers, blockJacobian)
+{
+    Model model(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i) - 0.3;
+    }
+
+    rigidbody::BlockJacobian jacobian(model.markersJacobianPattern());
+    EXPECT_EQ(jacobian.nbPoints(), model.nbMarkers());
+    EXPECT_EQ(jacobian.nbQ(), model.nbQ());
+    EXPECT_LT(jacobian.nbNonZeros(), 3 * model.nbMarkers() * model.nbQ());
+
+    // A marker of the root only depends on the root dof
+    EXPECT_EQ(jacobian.columns(0), model.getDofChain(model.getParentRbdlId(model.marker(0))));
+    for (size_t i=0; i<jacobian.nbPoints(); ++i) {
+        for (size_t j=1; j<jacobian.columns(i).size(); ++j) {
+            EXPECT_LT(jacobian.columns(i)[j-1], jacobian.columns(i)[j]);
+        }
+    }
+
+    // Same values as the dense jacobian, filled twice to make sure nothing accumulates
+    for (unsigned int trial=0; trial<2; ++trial) {
+        Q[0] += 0.2;
+        model.markersJacobian(Q, jacobian);
+        std::vector<utils::Matrix> expected(model.markersJacobian(Q));
+        utils::Matrix dense(jacobian.dense());
+        for (size_t m=0; m<model.nbMarkers(); ++m) {
+            utils::Matrix denseMarker(jacobian.dense(m));
+            for (unsigned int k=0; k<3; ++k) {
+                for (unsigned int j=0; j<model.nbQ(); ++j) {
+                    EXPECT_NEAR(dense(static_cast<unsigned int>(3*m+k), j), expected[m](k, j), requiredPrecision);
+                    EXPECT_NEAR(denseMarker(k, j), expected[m](k, j), requiredPrecision);
+                }
+            }
+        }
+    }
+
+    // Products with the jacobian
+    utils::Vector v(utils::Vector::Zero(model.nbQ()));
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        v[i] = 0.5 - 0.1 * static_cast<double>(i);
+    }
+    utils::Vector f(utils::Vector::Zero(3 * model.nbMarkers()));
+    for (unsigned int i=0; i<3 * model.nbMarkers(); ++i) {
+        f[i] = 0.01 * static_cast<double>(i);
+    }
+    utils::Vector Jv(jacobian.multiply(v));
+    utils::Vector expectedJv(jacobian.dense() * v);
+    for (unsigned int i=0; i<3 * model.nbMarkers(); ++i) {
+        EXPECT_NEAR(Jv[i], expectedJv[i], requiredPrecision);
+    }
+    utils::Vector Jtf(jacobian.transposeMultiply(f));
+    utils::Vector expectedJtf(jacobian.dense().transpose() * f);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        EXPECT_NEAR(Jtf[i], expectedJtf[i], requiredPrecision);
+    }
+
+    // Technical markers only
+    rigidbody::BlockJacobian technical(model.technicalMarkersJacobianPattern());
+    EXPECT_EQ(technical.nbPoints(), model.nbTechnicalMarkers());
+    model.technicalMarkersJacobian(Q, technical);
+    std::vector<utils::Matrix> expectedTechnical(model.technicalMarkersJacobian(Q));
+    for (size_t m=0; m<technical.nbPoints(); ++m) {
+        utils::Matrix denseMarker(technical.dense(m));
+        for (unsigned int k=0; k<3; ++k) {
+            for (unsigned int j=0; j<model.nbQ(); ++j) {
+                EXPECT_NEAR(denseMarker(k, j), expectedTechnical[m](k, j), requiredPrecision);
+            }
+        }
+    }
+
+    // A jacobian without the structure of the model cannot be filled
+    rigidbody::BlockJacobian empty;
+    EXPECT_THROW(model.markersJacobian(Q, empty), std::runtime_error);
+}
+#endif
+
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Markers, preallocatedOutputs)
+{
+    Model model(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity Qdot(model);
+    rigidbody::GeneralizedAcceleration Qddot(model);
+    Q.setZero();
+    Qdot.setZero();
+    Qddot.setZero();
+
+    std::vector<utils::Point3d> markers, technical, velocities, accelerations, coms;
+    std::vector<utils::RotoTrans> jcs;
+    std::vector<std::vector<utils::Point3d>> meshes;
+
+    // The first call sizes the outputs
+    model.markers(Q, markers);
+    model.technicalMarkers(Q, technical);
+    model.markersVelocity(Q, Qdot, velocities);
+    model.markerAcceleration(Q, Qdot, Qddot, accelerations);
+    model.CoMbySegment(Q, coms);
+    model.allGlobalJCS(Q, jcs);
+    model.meshPoints(Q, meshes);
+    EXPECT_EQ(markers.size(), model.nbMarkers());
+    EXPECT_EQ(technical.size(), model.nbTechnicalMarkers());
+    EXPECT_EQ(coms.size(), model.nbSegment());
+    EXPECT_EQ(jcs.size(), model.nbSegment());
+    EXPECT_EQ(meshes.size(), model.nbSegment());
+
+    // Then the frames are evaluated in the same outputs
+    for (unsigned int f=0; f<10; ++f) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = 0.1 * static_cast<double>(f + i);
+            Qdot[i] = 0.2 * static_cast<double>(f) - 0.1 * static_cast<double>(i);
+            Qddot[i] = 0.3 * static_cast<double>(i) - 0.05 * static_cast<double>(f);
+        }
+        model.markers(Q, markers);
+        model.technicalMarkers(Q, technical, true, false);
+        model.markersVelocity(Q, Qdot, velocities);
+        model.markerAcceleration(Q, Qdot, Qddot, accelerations);
+        model.CoMbySegment(Q, coms);
+        model.allGlobalJCS(Q, jcs);
+        model.meshPoints(Q, meshes);
+    }
+
+    // Same values as the functions returning new vectors
+    std::vector<rigidbody::NodeSegment> expectedMarkers(model.markers(Q));
+    std::vector<rigidbody::NodeSegment> expectedTechnical(model.technicalMarkers(Q));
+    std::vector<rigidbody::NodeSegment> expectedVelocities(model.markersVelocity(Q, Qdot));
+    std::vector<rigidbody::NodeSegment> expectedAccelerations(
+        model.markerAcceleration(Q, Qdot, Qddot));
+    for (size_t m=0; m<model.nbMarkers(); ++m) {
+        for (unsigned int k=0; k<3; ++k) {
+            EXPECT_NEAR(markers[m](k), expectedMarkers[m](k), requiredPrecision);
+            EXPECT_NEAR(velocities[m](k), expectedVelocities[m](k), requiredPrecision);
+            EXPECT_NEAR(accelerations[m](k), expectedAccelerations[m](k), requiredPrecision);
+        }
+    }
+    for (size_t m=0; m<technical.size(); ++m) {
+        for (unsigned int k=0; k<3; ++k) {
+            EXPECT_NEAR(technical[m](k), expectedTechnical[m](k), requiredPrecision);
+        }
+    }
+    std::vector<rigidbody::NodeSegment> expectedComs(model.CoMbySegment(Q));
+    std::vector<utils::RotoTrans> expectedJcs(model.allGlobalJCS(Q));
+    std::vector<std::vector<utils::Vector3d>> expectedMeshes(model.meshPoints(Q));
+    for (size_t s=0; s<model.nbSegment(); ++s) {
+        for (unsigned int k=0; k<3; ++k) {
+            EXPECT_NEAR(coms[s](k), expectedComs[s](k), requiredPrecision);
+        }
+        for (unsigned int i=0; i<4; ++i) {
+            for (unsigned int j=0; j<4; ++j) {
+                EXPECT_NEAR(jcs[s](i, j), expectedJcs[s](i, j), requiredPrecision);
+            }
+        }
+        ASSERT_EQ(meshes[s].size(), expectedMeshes[s].size());
+        for (size_t v=0; v<meshes[s].size(); ++v) {
+            for (unsigned int k=0; k<3; ++k) {
+                EXPECT_NEAR(meshes[s][v](k), expectedMeshes[s][v](k), requiredPrecision);
+            }
+        }
+    }
+}
+#endif
+
 TEST(Mesh, position)
 {
     Model model(modelPathMeshEqualsMarker);
@@ -1716,6 +2538,67 @@ TEST(Dynamics, ForwardDynamicsFreeFloatingBase)
 
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Dynamics, ForwardDynamicsFreeFloatingBasePreallocated)
+{
+    // A model from the file and a tree whose root is mapped onto multi-dof joints
+    Model modelFromFile(modelPathForGeneralTesting);
+    Model modelMultiDof;
+    rigidbody::SegmentCharacteristics characteristics(
+        2, utils::Vector3d(0.01, -0.02, -0.1), utils::Matrix3d(0.02, 0, 0, 0, 0.03, 0, 0, 0, 0.01));
+    utils::RotoTrans offset(utils::Rotation(), utils::Vector3d(0.1, 0, -0.2));
+    modelMultiDof.AddSegment("Trunk", "root", "xyz", "xyz", {}, {}, {}, characteristics, utils::RotoTrans());
+    modelMultiDof.AddSegment("Arm", "Trunk", "", "y", {}, {}, {}, characteristics, offset);
+    modelMultiDof.AddSegment("Forearm", "Arm", "", "zyx", {}, {}, {}, characteristics, offset);
+    modelMultiDof.AddSegment("Leg", "Trunk", "", "xz", {}, {}, {}, characteristics, offset);
+
+    for (Model* model : {&modelFromFile, &modelMultiDof}) {
+        size_t nbRoot(model->nbRoot());
+        rigidbody::GeneralizedCoordinates Q(*model);
+        rigidbody::GeneralizedVelocity QDot(*model);
+        rigidbody::GeneralizedTorque Tau(*model);
+        rigidbody::GeneralizedAcceleration QJointsDDot(model->nbQddot() - nbRoot);
+        for (unsigned int i=0; i<model->nbQ(); ++i) {
+            Q[i] = 0.3 - 0.07 * static_cast<double>(i);
+            QDot[i] = 0.5 * static_cast<double>(i % 4) - 0.8;
+            Tau[i] = static_cast<double>(i);
+        }
+        for (unsigned int i=0; i<QJointsDDot.size(); ++i) {
+            QJointsDDot[i] = 2.0 - 0.6 * static_cast<double>(i);
+        }
+
+        // The inertias of the bodies must be left untouched by the other dynamics
+        model->ForwardDynamics(Q, QDot, Tau);
+        model->massMatrixInverse(Q);
+        utils::Matrix massMatrix(model->massMatrix(Q));
+        utils::Matrix massMatrixInverse(model->massMatrixInverse(Q));
+        EXPECT_TRUE((massMatrix * massMatrixInverse).isIdentity(1e-8));
+
+        // Reference from the full mass matrix and inverse dynamics
+        rigidbody::GeneralizedAcceleration QDDot(*model);
+        QDDot.setZero();
+        QDDot.tail(model->nbQddot() - nbRoot) = QJointsDDot;
+        rigidbody::GeneralizedTorque nonLinearEffects(model->InverseDynamics(Q, QDot, QDDot));
+        utils::Vector expected(massMatrix.topLeftCorner(nbRoot, nbRoot).llt().solve(
+                                   -nonLinearEffects.head(nbRoot)));
+
+        rigidbody::GeneralizedAcceleration QRootDDot(1);
+        for (size_t k=0; k<2; ++k) {
+            model->ForwardDynamicsFreeFloatingBase(Q, QDot, QJointsDDot, QRootDDot);
+            EXPECT_EQ(static_cast<size_t>(QRootDDot.size()), nbRoot);
+            for (unsigned int i=0; i<nbRoot; ++i) {
+                EXPECT_NEAR(QRootDDot[i], expected[i], requiredPrecision);
+            }
+        }
+        rigidbody::GeneralizedAcceleration QRootDDotReturned(
+            model->ForwardDynamicsFreeFloatingBase(Q, QDot, QJointsDDot));
+        for (unsigned int i=0; i<nbRoot; ++i) {
+            EXPECT_NEAR(QRootDDotReturned[i], expected[i], requiredPrecision);
+        }
+    }
+}
+#endif
+
 #ifdef MODULE_ACTUATORS
 TEST(Dynamics, ForwardChangingMass)
 {
@@ -1786,6 +2669,237 @@ TEST(Dynamics, ForwardDynAndExternalForces)
 }
 
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Dynamics, TrajectoryEvaluator)
+{
+    Model model(modelPathForGeneralTesting);
+    size_t nbFrames(25);
+    utils::Matrix Q(model.nbQ(), nbFrames);
+    utils::Matrix QDot(model.nbQdot(), nbFrames);
+    utils::Matrix QDDot(model.nbQddot(), nbFrames);
+    std::vector<rigidbody::ExternalForceSet> externalForces;
+    for (size_t f=0; f<nbFrames; ++f) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q(i, f) = 0.1 * static_cast<double>(i) - 0.02 * static_cast<double>(f);
+            QDot(i, f) = 0.3 * static_cast<double>(i) + 0.05 * static_cast<double>(f);
+            QDDot(i, f) = -0.2 * static_cast<double>(i) + 0.1 * static_cast<double>(f);
+        }
+        rigidbody::ExternalForceSet forces(model.externalForceSet());
+        forces.add("PiedD", utils::SpatialVector(1.1 * f, 2.2, 3.3, 4.4, 5.5, 6.6 * f));
+        externalForces.push_back(forces);
+    }
+
+    for (size_t nbThreads : {1, 4}) {
+        TrajectoryEvaluator evaluator(model, nbThreads);
+        EXPECT_EQ(evaluator.nbThreads(), nbThreads);
+
+        utils::Matrix tau(model.nbGeneralizedTorque(), nbFrames);
+        utils::Matrix tauExt(model.nbGeneralizedTorque(), nbFrames);
+        utils::Matrix nle(model.nbGeneralizedTorque(), nbFrames);
+        std::vector<utils::Matrix> massMatrices(nbFrames,
+                                                utils::Matrix(model.nbQdot(), model.nbQdot()));
+        evaluator.InverseDynamics(Q, QDot, QDDot, tau);
+        evaluator.InverseDynamics(Q, QDot, QDDot, externalForces, tauExt);
+        evaluator.NonLinearEffect(Q, QDot, nle);
+        evaluator.massMatrix(Q, massMatrices);
+
+        for (size_t f=0; f<nbFrames; ++f) {
+            rigidbody::GeneralizedCoordinates q(Q.col(f));
+            rigidbody::GeneralizedVelocity qdot(QDot.col(f));
+            rigidbody::GeneralizedAcceleration qddot(QDDot.col(f));
+            rigidbody::GeneralizedTorque tauExpected(model.InverseDynamics(q, qdot, qddot));
+            rigidbody::GeneralizedTorque tauExtExpected(
+                model.InverseDynamics(q, qdot, qddot, externalForces[f]));
+            rigidbody::GeneralizedTorque nleExpected(model.NonLinearEffect(q, qdot));
+            utils::Matrix massMatrixExpected(model.massMatrix(q));
+            for (unsigned int i=0; i<model.nbGeneralizedTorque(); ++i) {
+                EXPECT_NEAR(tau(i, f), tauExpected(i), requiredPrecision);
+                EXPECT_NEAR(tauExt(i, f), tauExtExpected(i), requiredPrecision);
+                EXPECT_NEAR(nle(i, f), nleExpected(i), requiredPrecision);
+                for (unsigned int j=0; j<model.nbQdot(); ++j) {
+                    EXPECT_NEAR(massMatrices[f](i, j), massMatrixExpected(i, j), requiredPrecision);
+                }
+            }
+        }
+
+        utils::Matrix tauWrongSize(model.nbGeneralizedTorque(), nbFrames - 1);
+        EXPECT_THROW(evaluator.InverseDynamics(Q, QDot, QDDot, tauWrongSize), std::runtime_error);
+    }
+}
+
+TEST(Dynamics, Simulator)
+{
+    Model model(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = 0.1 * static_cast<double>(i);
+        QDot[i] = 0.2 - 0.05 * static_cast<double>(i);
+        Tau[i] = 0.5 * static_cast<double>(i % 3);
+    }
+
+    Simulator simulator(model, INTEGRATOR_RK4, 1);
+    EXPECT_EQ(simulator.nbStates(), model.nbQ() + model.nbQdot());
+    EXPECT_EQ(simulator.nbControls(), model.nbGeneralizedTorque());
+    EXPECT_EQ(simulator.nbActivations(), 0);
+    EXPECT_EQ(simulator.nbFatigueStates(), 0);
+    utils::Vector x0(simulator.state(Q, QDot));
+
+    // The derivative of the state is [QDot, QDDot]
+    utils::Vector u(Tau);
+    utils::Vector xDot;
+    simulator.dynamics(x0, u, xDot);
+    rigidbody::GeneralizedAcceleration QDDot(model.ForwardDynamics(Q, QDot, Tau));
+    for (unsigned int i=0; i<model.nbQdot(); ++i) {
+        EXPECT_NEAR(xDot[i], QDot[i], requiredPrecision);
+        EXPECT_NEAR(xDot[model.nbQ() + i], QDDot[i], requiredPrecision);
+    }
+
+    size_t nbIntervals(5);
+    double dt(0.01);
+    utils::Matrix controls(simulator.nbControls(), nbIntervals);
+    for (size_t i=0; i<nbIntervals; ++i) {
+        controls.col(i) = u;
+    }
+
+    // The adaptive integrator with tight tolerances is the reference
+    simulator.setIntegrator(INTEGRATOR_RK45);
+    simulator.setTolerances(1e-10, 1e-10);
+    utils::Matrix reference(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, reference);
+    for (unsigned int i=0; i<simulator.nbStates(); ++i) {
+        EXPECT_NEAR(reference(i, 0), x0[i], requiredPrecision);
+    }
+
+    simulator.setIntegrator(INTEGRATOR_RK4);
+    simulator.setNbSteps(4);
+    utils::Matrix states(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, states);
+    for (unsigned int i=0; i<simulator.nbStates(); ++i) {
+        EXPECT_NEAR(states(i, nbIntervals), reference(i, nbIntervals), 1e-6);
+    }
+
+    // The same constant controls given by a function
+    utils::Matrix statesFromFunction(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, [&u](double, const utils::Vector&, utils::Vector& control) {
+        control = u;
+    }, dt, statesFromFunction);
+    for (unsigned int i=0; i<simulator.nbStates(); ++i) {
+        EXPECT_NEAR(statesFromFunction(i, nbIntervals), states(i, nbIntervals), requiredPrecision);
+    }
+
+    // The semi-implicit Euler converges toward the reference as the step decreases
+    simulator.setIntegrator(INTEGRATOR_SEMI_IMPLICIT_EULER);
+    utils::Matrix statesCoarse(simulator.nbStates(), nbIntervals + 1);
+    simulator.setNbSteps(1);
+    simulator.simulate(x0, controls, dt, statesCoarse);
+    simulator.setNbSteps(20);
+    simulator.simulate(x0, controls, dt, states);
+    EXPECT_LT((states.col(nbIntervals) - reference.col(nbIntervals)).norm(),
+              (statesCoarse.col(nbIntervals) - reference.col(nbIntervals)).norm());
+
+    // The rollouts of a batch match the rollouts integrated one by one
+    size_t nbRollouts(6);
+    for (size_t nbThreads : {1, 4}) {
+        Simulator batchSimulator(model, INTEGRATOR_RK4, nbThreads);
+        EXPECT_EQ(batchSimulator.nbThreads(), nbThreads);
+        utils::Matrix x0Batch(batchSimulator.nbStates(), nbRollouts);
+        std::vector<utils::Matrix> controlsBatch;
+        std::vector<utils::Matrix> statesBatch(
+            nbRollouts, utils::Matrix(batchSimulator.nbStates(), nbIntervals + 1));
+        for (size_t r=0; r<nbRollouts; ++r) {
+            x0Batch.col(r) = x0;
+            x0Batch(0, r) += 0.01 * static_cast<double>(r);
+            controlsBatch.push_back(controls * static_cast<double>(r));
+        }
+        batchSimulator.simulateBatch(x0Batch, controlsBatch, dt, statesBatch);
+
+        for (size_t r=0; r<nbRollouts; ++r) {
+            utils::Matrix expected(batchSimulator.nbStates(), nbIntervals + 1);
+            batchSimulator.simulate(x0Batch.col(r), controlsBatch[r], dt, expected);
+            for (unsigned int i=0; i<batchSimulator.nbStates(); ++i) {
+                EXPECT_NEAR(statesBatch[r](i, nbIntervals), expected(i, nbIntervals), requiredPrecision);
+            }
+        }
+
+        std::vector<utils::Matrix> statesWrongSize(
+            nbRollouts, utils::Matrix(batchSimulator.nbStates(), nbIntervals));
+        EXPECT_THROW(batchSimulator.simulateBatch(x0Batch, controlsBatch, dt, statesWrongSize),
+                     std::runtime_error);
+    }
+}
+
+TEST(Dynamics, HybridSimulator)
+{
+    Model model(modelWithRigidContactsExternalForces);
+    HybridSimulator simulator(model, INTEGRATOR_RK4, 1);
+    EXPECT_EQ(simulator.nbRigidContacts(), 2);
+
+    // The cube is dropped without rotation, so it falls freely until its lowest contact touches the ground
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    Q.setZero();
+    QDot.setZero();
+    Q[2] = 0.5;
+    utils::Vector x0(simulator.state(Q, QDot));
+    size_t nbIntervals(100);
+    double dt(0.01);
+    utils::Matrix controls(utils::Matrix::Zero(simulator.nbControls(), nbIntervals));
+    utils::Matrix states(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, states);
+
+    double gravity(-model.getGravity()[2]);
+    EXPECT_NEAR(states(2, 10), 0.5 - 0.5 * gravity * 0.1 * 0.1, 1e-10);
+    ASSERT_GE(simulator.events().size(), 1u);
+    const HybridSimulator::Event& touchDown(simulator.events()[0]);
+    EXPECT_EQ(touchDown.contact, 1u);
+    EXPECT_EQ(touchDown.type, CONTACT_EVENT_MAKE);
+    EXPECT_NEAR(touchDown.time,
+                std::sqrt(2. * (0.5 - 0.01802 + simulator.contactTolerance()) / gravity), 1e-8);
+    for (size_t e=1; e<simulator.events().size(); ++e) {
+        EXPECT_GE(simulator.events()[e].time, simulator.events()[e - 1].time);
+    }
+
+    // At each node, no contact sinks in the ground and the active ones do not move along z
+    std::vector<bool> active(simulator.nbRigidContacts(), false);
+    size_t nextEvent(0);
+    for (size_t k=0; k<=nbIntervals; ++k) {
+        double t(static_cast<double>(k) * dt);
+        for (; nextEvent<simulator.events().size() && simulator.events()[nextEvent].time <= t; ++nextEvent) {
+            const HybridSimulator::Event& event(simulator.events()[nextEvent]);
+            EXPECT_EQ(active[event.contact], event.type == CONTACT_EVENT_BREAK);
+            active[event.contact] = event.type == CONTACT_EVENT_MAKE;
+        }
+        Q = states.col(k).head(model.nbQ());
+        QDot = states.col(k).tail(model.nbQdot());
+        std::vector<utils::Vector3d> positions(model.rigidContacts(Q, true));
+        std::vector<utils::Vector3d> velocities(model.rigidContactsVelocity(Q, QDot, true));
+        for (size_t i=0; i<simulator.nbRigidContacts(); ++i) {
+            EXPECT_GT(positions[i][2], -1e-4);
+            if (active[i]) {
+                EXPECT_NEAR(velocities[i][2], 0, 1e-6);
+            }
+        }
+    }
+    EXPECT_EQ(active, simulator.activeContacts());
+
+    // The constraint sets of the contacts reached are reused by the next simulations
+    size_t nbConstraintSets(simulator.nbConstraintSets());
+    EXPECT_GE(nbConstraintSets, 1u);
+    EXPECT_LE(nbConstraintSets, 3u);
+    utils::Matrix statesAgain(simulator.nbStates(), nbIntervals + 1);
+    simulator.simulate(x0, controls, dt, statesAgain);
+    EXPECT_EQ(simulator.nbConstraintSets(), nbConstraintSets);
+    for (unsigned int i=0; i<simulator.nbStates(); ++i) {
+        EXPECT_NEAR(statesAgain(i, nbIntervals), states(i, nbIntervals), requiredPrecision);
+    }
+
+    simulator.setIntegrator(INTEGRATOR_RK45);
+    EXPECT_THROW(simulator.simulate(x0, controls, dt, statesAgain), std::runtime_error);
+}
+#endif
+
 TEST(QDot, ComputeConstraintImpulsesDirect)
 {
     Model model(modelPathForGeneralTesting);
@@ -1881,6 +2995,74 @@ TEST(Dynamics, ForwardLoopConstraint)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Dynamics, LoopConstraintSolver)
+{
+    Model model(modelPathForLoopConstraintTesting);
+    rigidbody::LoopConstraintSolver& solver(model.loopConstraintSolver());
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 1.1;
+        QDot[i] = static_cast<double>(i) * 1.1;
+        Tau[i] = static_cast<double>(i) * 1.1;
+    }
+
+    // One solve gives both the accelerations and the forces of the loop constraints
+    rigidbody::GeneralizedAcceleration QDDotExpected(model.ForwardDynamicsConstraintsDirect(Q, QDot, Tau));
+    rigidbody::ExternalForceSet externalForces(model);
+    rigidbody::GeneralizedAcceleration QDDot(model);
+    std::vector<utils::SpatialVector> forces;
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDot, forces);
+    for (unsigned int i=0; i<model.nbQddot(); ++i) {
+        EXPECT_NEAR(QDDot[i], QDDotExpected[i], 1e-8 * std::max(1.0, std::fabs(QDDotExpected[i])));
+    }
+    std::vector<double> Fexpected = { 1477.64, 1669.14,  -356.04,348.877, -245.699, 296.057};
+    EXPECT_EQ(forces.size(), model.nbLoopConstraints());
+    for (unsigned int i=0; i<6; ++i) {
+        EXPECT_NEAR(forces[0][i], Fexpected[i], 1e-2);
+    }
+
+    // The factorization is only computed again when the generalized coordinates change
+    size_t nbFactorizations(solver.nbFactorizations());
+    Tau[0] += 1;
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDot, forces);
+    EXPECT_EQ(solver.nbFactorizations(), nbFactorizations);
+    Tau[0] -= 1;
+    Q[0] += 0.1;
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDot, forces);
+    EXPECT_EQ(solver.nbFactorizations(), nbFactorizations + 1);
+    Q[0] -= 0.1;
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDot, forces);
+
+    // The Baumgarte stabilization pulls the accelerations toward the constraints
+    RigidBodyDynamics::Math::VectorNd error(model.getConstraints().size());
+    RigidBodyDynamics::CalcConstraintsPositionError(model, Q, model.getConstraints(), error, true);
+    EXPECT_GT(error.norm(), 1e-3);
+    solver.setBaumgarteStabilization(10, 10);
+    rigidbody::GeneralizedAcceleration QDDotStabilized(model);
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDotStabilized, forces);
+    EXPECT_GT((QDDotStabilized - QDDot).norm(), 1e-6);
+    EXPECT_EQ(solver.nbFactorizations(), nbFactorizations + 2);
+    solver.setBaumgarteStabilization(0, 0);
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDotStabilized, forces);
+    for (unsigned int i=0; i<model.nbQddot(); ++i) {
+        EXPECT_NEAR(QDDotStabilized[i], QDDot[i], 1e-8 * std::max(1.0, std::fabs(QDDot[i])));
+    }
+
+    // The projection removes the drift of the positions and of the velocities
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 0.05;
+    }
+    EXPECT_TRUE(model.projectOnConstraints(Q, QDot));
+    RigidBodyDynamics::CalcConstraintsPositionError(model, Q, model.getConstraints(), error, true);
+    EXPECT_LT(error.norm(), 1e-8);
+    RigidBodyDynamics::CalcConstraintsVelocityError(model, Q, QDot, model.getConstraints(), error, true);
+    EXPECT_LT(error.norm(), 1e-8);
+}
+#endif
+
 TEST(Dynamics, ForwardAccelerationConstraint)
 {
     Model model(modelPathForGeneralTesting);
@@ -1922,6 +3104,80 @@ TEST(Dynamics, ForwardAccelerationConstraint)
     }
 }
 
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(Dynamics, ConstraintSolvers)
+{
+    for (const auto& path : {modelPathForGeneralTesting, modelPathForLoopConstraintTesting}) {
+        Model model(path);
+        rigidbody::GeneralizedCoordinates Q(model);
+        rigidbody::GeneralizedVelocity QDot(model);
+        rigidbody::GeneralizedTorque Tau(model);
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = static_cast<double>(i) * 0.1;
+            QDot[i] = static_cast<double>(i) * 0.3;
+            Tau[i] = static_cast<double>(i) * 0.5;
+        }
+        EXPECT_EQ(model.constraintSolver(), rigidbody::CONSTRAINT_SOLVER_DIRECT);
+
+        rigidbody::GeneralizedAcceleration QDDotDirect(model.ForwardDynamicsConstraintsDirect(Q, QDot, Tau));
+        utils::Vector forcesDirect(model.getConstraints().getForce());
+        rigidbody::GeneralizedVelocity QDotPostDirect(model.ComputeConstraintImpulsesDirect(Q, QDot));
+
+        // The constraint set of the model is the workspace, it holds the last results
+        utils::Vector forces(model.ContactForcesFromForwardDynamicsConstraintsDirect(Q, QDot, Tau));
+        for (unsigned int i=0; i<forces.size(); ++i) {
+            EXPECT_NEAR(forces[i], forcesDirect[i], requiredPrecision);
+        }
+
+        for (auto solver : {rigidbody::CONSTRAINT_SOLVER_DIRECT,
+                            rigidbody::CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE,
+                            rigidbody::CONSTRAINT_SOLVER_NULL_SPACE}) {
+            model.setConstraintSolver(solver);
+            rigidbody::GeneralizedAcceleration QDDot(model.ForwardDynamicsConstraints(Q, QDot, Tau));
+            for (unsigned int i=0; i<model.nbQddot(); ++i) {
+                EXPECT_NEAR(QDDot[i], QDDotDirect[i], 1e-6 * (1 + fabs(QDDotDirect[i])));
+            }
+            rigidbody::GeneralizedVelocity QDotPost(model.ComputeConstraintImpulses(Q, QDot));
+            for (unsigned int i=0; i<model.nbQdot(); ++i) {
+                EXPECT_NEAR(QDotPost[i], QDotPostDirect[i], 1e-6 * (1 + fabs(QDotPostDirect[i])));
+            }
+        }
+        model.setConstraintSolver(rigidbody::CONSTRAINT_SOLVER_DIRECT);
+    }
+
+    // The forces of the loop constraints are computed with the solver of the model
+    Model model(modelPathForLoopConstraintTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    for (unsigned int i=0; i<model.nbQ(); ++i) {
+        Q[i] = static_cast<double>(i) * 1.1;
+        QDot[i] = static_cast<double>(i) * 1.1;
+        Tau[i] = static_cast<double>(i) * 1.1;
+    }
+    rigidbody::ExternalForceSet externalForces(model);
+    rigidbody::GeneralizedAcceleration QDDotDirect(model);
+    std::vector<utils::SpatialVector> forcesDirect;
+    model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDotDirect, forcesDirect);
+    size_t nbFactorizations(model.loopConstraintSolver().nbFactorizations());
+    for (auto solver : {rigidbody::CONSTRAINT_SOLVER_RANGE_SPACE_SPARSE,
+                        rigidbody::CONSTRAINT_SOLVER_NULL_SPACE}) {
+        model.setConstraintSolver(solver);
+        rigidbody::GeneralizedAcceleration QDDot(model);
+        std::vector<utils::SpatialVector> forces;
+        model.calcLoopConstraintForces(Q, QDot, Tau, externalForces, QDDot, forces);
+        for (unsigned int i=0; i<model.nbQddot(); ++i) {
+            EXPECT_NEAR(QDDot[i], QDDotDirect[i], 1e-6 * (1 + fabs(QDDotDirect[i])));
+        }
+        EXPECT_EQ(forces.size(), forcesDirect.size());
+        for (unsigned int i=0; i<6; ++i) {
+            EXPECT_NEAR(forces[0][i], forcesDirect[0][i], 1e-6 * (1 + fabs(forcesDirect[0][i])));
+        }
+    }
+    EXPECT_EQ(model.loopConstraintSolver().nbFactorizations(), nbFactorizations);
+}
+#endif
+
 TEST(QuaternionInModel, sizes)
 {
     Model m("models/simple_quat.bioMod");
@@ -2263,6 +3519,109 @@ TEST(ExternalForces, toRbdl_externalForcesOnlyNotAtOrigin)
         }
     }
 }
+#ifndef BIORBD_USE_CASADI_MATH
+TEST(ExternalForces, toRbdlPerBody)
+{
+    Model model(modelWithRigidContactsExternalForces);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    Q.setZero();
+    QDot.setZero();
+
+    rigidbody::ExternalForceSet externalForces = model.externalForceSet(false, false);
+    RigidBodyDynamics::Math::SpatialVector sp_seg1(1, 2, 3, 4, 5, 6);
+    externalForces.add("Seg1", sp_seg1, utils::Vector3d(1, 2, 3));
+    std::vector<RigidBodyDynamics::Math::SpatialVector> forcePerDof = externalForces.computeRbdlSpatialVectors();
+    std::vector<RigidBodyDynamics::Math::SpatialVector> forcePerBody =
+        externalForces.computeRbdlSpatialVectorsPerBody(Q, QDot);
+
+    // The xyz translations of Seg1 are a single rbdl body
+    RigidBodyDynamics::Math::SpatialVector sp_zero(0, 0, 0, 0, 0, 0);
+    std::vector<RigidBodyDynamics::Math::SpatialVector> sp_expected;
+    sp_expected.push_back(sp_zero); // Root
+    sp_expected.push_back(sp_zero); // Translations xyz of Seg1
+    sp_expected.push_back({-2, 8, 0, 4, 5, 6}); // Rotation y of Seg1
+
+    EXPECT_EQ(forcePerBody.size(), model.mBodies.size());
+    EXPECT_EQ(forcePerBody.size(), sp_expected.size());
+    EXPECT_EQ(forcePerDof.size(), 5);
+    for (size_t i = 0; i < sp_expected.size(); ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            EXPECT_NEAR(forcePerBody[i](j), sp_expected[i](j), requiredPrecision);
+        }
+    }
+    for (size_t j = 0; j < 6; ++j) {
+        EXPECT_NEAR(forcePerBody[model.segment("Seg1").id()](j), forcePerDof[4](j), requiredPrecision);
+    }
+}
+#endif
+
+TEST(ExternalForces, inPlaceUpdate)
+{
+    Model model(modelPathForGeneralTesting);
+    rigidbody::GeneralizedCoordinates Q(model);
+    rigidbody::GeneralizedVelocity QDot(model);
+    rigidbody::GeneralizedAcceleration QDDot(model);
+    rigidbody::GeneralizedTorque Tau(model);
+    Q.setZero();
+    QDot.setZero();
+
+    // The set is bound to the model once and the feet are resolved once
+    rigidbody::ExternalForceSet forcePlates(model);
+    size_t right(forcePlates.bodyIndex("PiedD"));
+    size_t left(forcePlates.bodyIndex("PiedG"));
+
+    // Without any force, rbdl receives no buffer at all
+    EXPECT_EQ(forcePlates.computeRbdlSpatialVectorsInPlace(Q, QDot), nullptr);
+    forcePlates.addToBody(right, utils::SpatialVector(0., 0., 0., 0., 0., 1.));
+    std::vector<RigidBodyDynamics::Math::SpatialVector>* buffer(
+        forcePlates.computeRbdlSpatialVectorsInPlace(Q, QDot));
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(buffer->size(), model.mBodies.size());
+    model.InverseDynamics(Q, QDot, QDDot, forcePlates, Tau);
+
+    for (unsigned int f=0; f<10; ++f) {
+        for (unsigned int i=0; i<model.nbQ(); ++i) {
+            Q[i] = 0.1 * static_cast<double>(f + i);
+            QDot[i] = 0.2 * static_cast<double>(f) - 0.1 * static_cast<double>(i);
+            QDDot[i] = 0.3 * static_cast<double>(i) - 0.05 * static_cast<double>(f);
+        }
+        double t(static_cast<double>(f));
+        utils::SpatialVector grfRight(0.1 * t, -0.2, 0.3, 10. * t, -20., 700. + t);
+        utils::SpatialVector grfLeft(-0.1, 0.2 * t, 0., -5., 15. * t, 650. - t);
+        utils::Vector3d copRight(0.1 + 0.01 * t, -0.1, 0.);
+        utils::Vector3d copLeft(-0.1, 0.2 - 0.02 * t, 0.);
+
+        // Each frame of the force plates is applied in place
+        forcePlates.setZero();
+        forcePlates.addToBody(right, grfRight, copRight);
+        forcePlates.addToBody(left, grfLeft, copLeft);
+        model.InverseDynamics(Q, QDot, QDDot, forcePlates, Tau);
+        EXPECT_EQ(forcePlates.computeRbdlSpatialVectorsInPlace(Q, QDot), buffer);
+
+        // Same as the forces transported at the origin beforehand
+        rigidbody::ExternalForceSet expectedForces(model);
+        expectedForces.add("PiedD", utils::SpatialVector(
+                               utils::Vector3d(grfRight.moment() + copRight.cross(grfRight.force())),
+                               grfRight.force()));
+        expectedForces.add("PiedG", utils::SpatialVector(
+                               utils::Vector3d(grfLeft.moment() + copLeft.cross(grfLeft.force())),
+                               grfLeft.force()));
+        rigidbody::GeneralizedTorque TauExpected(
+            model.InverseDynamics(Q, QDot, QDDot, expectedForces));
+        for (unsigned int i=0; i<model.nbGeneralizedTorque(); ++i) {
+            EXPECT_NEAR(Tau[i], TauExpected[i], 1e-8);
+        }
+    }
+
+    // The parameterless overloads use the persistent default set of the model
+    rigidbody::ExternalForceSet noForces(model);
+    rigidbody::GeneralizedTorque TauNoForces(model.InverseDynamics(Q, QDot, QDDot, noForces));
+    rigidbody::GeneralizedTorque TauDefault(model.InverseDynamics(Q, QDot, QDDot));
+    for (unsigned int i=0; i<model.nbGeneralizedTorque(); ++i) {
+        EXPECT_NEAR(TauDefault[i], TauNoForces[i], requiredPrecision);
+    }
+}
 #endif // BIORBD_USE_CASADI_MATH
 
 #ifdef MODULE_KALMAN
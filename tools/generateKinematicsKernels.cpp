@@ -0,0 +1,31 @@
+#include "biorbd.h"
+#include <iostream>
+
+///
+/// \brief main Generate the kinematics kernels of a model
+/// \return 0 on success
+///
+/// Usage: biorbd_codegen <model.bioMod> <output.h> <namespace>
+///
+/// The generated header only depends on Eigen and can be compiled in any project, see
+/// CodeGenerator for the functions it provides.
+///
+
+using namespace BIORBD_NAMESPACE;
+
+int main(int argc, char** argv)
+{
+    if (argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <model.bioMod> <output.h> <namespace>" << std::endl;
+        return 1;
+    }
+
+    try {
+        Model model(argv[1]);
+        CodeGenerator::writeKinematicsKernels(model, utils::Path(argv[2]), argv[3]);
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}